@@ -0,0 +1,86 @@
+#include <string.h>  /* strcmp */
+#include <math.h>    /* log1p */
+#include <assert.h>  /* assert */
+
+#include "arrival.h"
+#include "prng.h"
+
+/**
+ * Parse an arrival process, "fixed" or "poisson".
+ * Returns zero on success.
+ */
+int
+parse_arrival_process(const char *text, enum arrival_process *process)
+{
+	if (0 == strcmp(text, "fixed")) {
+		*process = ARRIVAL_FIXED;
+	} else if (0 == strcmp(text, "poisson")) {
+		*process = ARRIVAL_POISSON;
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Return the interval from one arrival to the next, in nanoseconds.
+ */
+static double
+next_interval(struct arrival_schedule *as)
+{
+	if (ARRIVAL_POISSON == as->process) {
+		/* Inverse of the exponential distribution's CDF. 1 - u is in (0, 1], so its log is finite */
+		return -as->interval * log1p(-prng_double(&as->rng));
+	}
+	return as->interval;
+}
+
+/**
+ * Prepare the schedule of one of num_threads threads, each of which issues rate operations per second.
+ * Fixed schedules of different threads are staggered evenly across one interval,
+ * so that their combined arrivals are evenly spaced too.
+ */
+void
+arrival_init(struct arrival_schedule *as, enum arrival_process process, double rate, unsigned int thread_num, unsigned int num_threads)
+{
+	assert(rate > 0);
+	assert(thread_num > 0 && thread_num <= num_threads);
+
+	as->process = process;
+	as->interval = 1e9 / rate;
+	as->offset = as->interval * (thread_num - 1) / num_threads;
+	as->rng = prng_seed(thread_num);
+	as->start = 0;
+	as->elapsed = 0;
+}
+
+/**
+ * (Re)start the schedule at the given time.
+ */
+void
+arrival_start(struct arrival_schedule *as, uint64_t now)
+{
+	as->start = now;
+	as->elapsed = (ARRIVAL_POISSON == as->process) ? next_interval(as) : as->offset;
+}
+
+/**
+ * Return the intended time of the next arrival, without consuming it.
+ */
+uint64_t
+arrival_peek(const struct arrival_schedule *as)
+{
+	return as->start + (uint64_t) as->elapsed;
+}
+
+/**
+ * Consume the next arrival, returning its intended time.
+ */
+uint64_t
+arrival_next(struct arrival_schedule *as)
+{
+	uint64_t when = arrival_peek(as);
+
+	as->elapsed += next_interval(as);
+	return when;
+}
@@ -0,0 +1,35 @@
+#ifndef ARRIVAL_H_
+#define ARRIVAL_H_
+
+#include <stdint.h> /* uint64_t */
+
+/*
+ * Open-loop arrival schedule: the times at which operations are intended to be issued,
+ * independent of how long earlier operations take. Latency is then measured from each
+ * operation's intended time, so that a slow server cannot hide queueing delay by slowing
+ * down the load offered to it (coordinated omission).
+ */
+
+/* Processes by which operations arrive */
+enum arrival_process {
+	ARRIVAL_FIXED,  /* At a constant interval */
+	ARRIVAL_POISSON /* At exponentially-distributed intervals of the same mean */
+};
+
+/* Schedule of arrivals of a single thread */
+struct arrival_schedule {
+	enum arrival_process process; /* Arrival process */
+	double interval;              /* Mean interval between arrivals, in nanoseconds */
+	double offset;                /* Offset of the first arrival, in nanoseconds, to stagger threads */
+	uint64_t rng;                 /* Pseudo-random generator state */
+	uint64_t start;               /* Time of the start of the schedule */
+	double elapsed;               /* Time from start to the next arrival, in nanoseconds */
+};
+
+int parse_arrival_process(const char *text, enum arrival_process *process);
+void arrival_init(struct arrival_schedule *as, enum arrival_process process, double rate, unsigned int thread_num, unsigned int num_threads);
+void arrival_start(struct arrival_schedule *as, uint64_t now);
+uint64_t arrival_peek(const struct arrival_schedule *as);
+uint64_t arrival_next(struct arrival_schedule *as);
+
+#endif /* ARRIVAL_H_ */
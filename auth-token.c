@@ -0,0 +1,375 @@
+#define _GNU_SOURCE /* getline */
+#include <stdio.h>   /* fprintf, getline */
+#include <stdlib.h>  /* malloc, free, posix_memalign, mkstemp */
+#include <string.h>  /* strcmp, strdup, strerror */
+#include <errno.h>   /* errno */
+#include <unistd.h>  /* unlink */
+
+#include "auth-token.h"
+#include "test-data.h"
+
+/* Fraction of a token's lifetime, before it expires, at which it is refreshed, and beyond which it is not reused */
+#define AUTH_TOKEN_REFRESH_FRACTION 0.25
+/* Seconds after a failed refresh before another is attempted */
+#define AUTH_TOKEN_RETRY_SECS 10
+
+/**
+ * Return the time, in seconds, at which a token issued at the given time is to be refreshed.
+ */
+static double
+refresh_time(time_t issued, double lifetime)
+{
+	return issued + lifetime * (1 - AUTH_TOKEN_REFRESH_FRACTION);
+}
+
+/**
+ * Return the path of the cache file of the token of the given Keystone URL, tenant and user, which the caller must free.
+ * The file's name is a hash of them; they are also kept within the file to tell apart any which collide.
+ */
+static char *
+cache_path(const char *cache_dir, const struct keystone_thread_args *keystone)
+{
+	uint32_t crc = 0;
+	char *path;
+
+	crc = test_data_crc32c(crc, keystone->url, strlen(keystone->url) + 1);
+	crc = test_data_crc32c(crc, keystone->tenant, strlen(keystone->tenant) + 1);
+	crc = test_data_crc32c(crc, keystone->username, strlen(keystone->username) + 1);
+	if (-1 == asprintf(&path, "%s/token-%08x", cache_dir, (unsigned int) crc)) {
+		return NULL;
+	}
+	return path;
+}
+
+/**
+ * Load from the cache in the given directory a token, and the Swift URL of its service catalog, for the given
+ * Keystone URL, tenant and user, if one is there which, with the given lifetime, is not due for refresh.
+ * On success, sets the token and Swift URL of the given Keystone arguments, and the time at which the token
+ * was issued, and returns zero; otherwise returns -1.
+ */
+int
+auth_token_cache_load(const char *cache_dir, struct keystone_thread_args *keystone, double lifetime, time_t *issued)
+{
+	char *path, *line = NULL, *token = NULL, *swift_url = NULL;
+	size_t size = 0;
+	ssize_t len;
+	unsigned int matched = 0;
+	long long issue_time = 0;
+	FILE *f;
+
+	path = cache_path(cache_dir, keystone);
+	if (NULL == path) {
+		return -1;
+	}
+	f = fopen(path, "r");
+	free(path);
+	if (NULL == f) {
+		return -1; /* Not cached */
+	}
+	while ((len = getline(&line, &size, f)) > 0) {
+		char *value = strchr(line, '=');
+		if ('\n' == line[len - 1]) {
+			line[len - 1] = '\0';
+		}
+		if (NULL == value) {
+			continue;
+		}
+		*value++ = '\0';
+		if (0 == strcmp(line, "url") && 0 == strcmp(value, keystone->url)) {
+			matched |= 1;
+		} else if (0 == strcmp(line, "tenant") && 0 == strcmp(value, keystone->tenant)) {
+			matched |= 2;
+		} else if (0 == strcmp(line, "username") && 0 == strcmp(value, keystone->username)) {
+			matched |= 4;
+		} else if (0 == strcmp(line, "issued")) {
+			issue_time = atoll(value);
+		} else if (0 == strcmp(line, "swift_url") && NULL == swift_url) {
+			swift_url = strdup(value);
+		} else if (0 == strcmp(line, "token") && NULL == token) {
+			token = strdup(value);
+		}
+	}
+	free(line);
+	fclose(f);
+
+	if (7 != matched || NULL == token || NULL == swift_url || time(NULL) >= refresh_time((time_t) issue_time, lifetime)) {
+		free(token);
+		free(swift_url);
+		return -1;
+	}
+	keystone->auth_token = token;
+	keystone->swift_url = swift_url;
+	*issued = (time_t) issue_time;
+	return 0;
+}
+
+/**
+ * Store in the cache in the given directory the token and Swift URL of the given Keystone arguments,
+ * issued at the given time. The cache file is readable only by its owner, and is replaced whole.
+ * Failure is reported, but is otherwise harmless.
+ */
+void
+auth_token_cache_store(const char *cache_dir, const struct keystone_thread_args *keystone, time_t issued)
+{
+	char *path, *tmp_path;
+	FILE *f;
+	int fd, ok;
+
+	path = cache_path(cache_dir, keystone);
+	if (NULL == path) {
+		return;
+	}
+	if (-1 == asprintf(&tmp_path, "%s/.token-XXXXXX", cache_dir)) {
+		free(path);
+		return;
+	}
+	/* mkstemp creates the file with permissions 0600 */
+	fd = mkstemp(tmp_path);
+	if (fd < 0 || NULL == (f = fdopen(fd, "w"))) {
+		fprintf(stderr, "%s: %s\n", tmp_path, strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmp_path);
+		}
+		free(tmp_path);
+		free(path);
+		return;
+	}
+	ok = (fprintf(f, "url=%s\ntenant=%s\nusername=%s\nissued=%lld\nswift_url=%s\ntoken=%s\n",
+		keystone->url, keystone->tenant, keystone->username, (long long) issued, keystone->swift_url, keystone->auth_token) > 0);
+	ok = (0 == fclose(f)) && ok;
+	if (!ok || 0 != rename(tmp_path, path)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		unlink(tmp_path);
+	}
+	free(tmp_path);
+	free(path);
+}
+
+/**
+ * Free every replaced version of the token which no Swift thread still uses.
+ */
+static void
+reclaim(struct auth_tokens *at)
+{
+	struct auth_token **prev = &at->retired, *version;
+	uint64_t oldest = UINT64_MAX;
+	unsigned int i;
+
+	for (i = 0; i < at->num_threads; i++) {
+		uint64_t generation = __atomic_load_n(&at->readers[i].generation, __ATOMIC_ACQUIRE);
+		if (generation < oldest) {
+			oldest = generation;
+		}
+	}
+	while (NULL != (version = *prev)) {
+		if (version->generation < oldest) {
+			*prev = version->retired;
+			free(version->token);
+			free(version);
+		} else {
+			prev = &version->retired;
+		}
+	}
+}
+
+/**
+ * Authenticate anew and publish the new token. Returns zero on success, or else -1.
+ */
+static int
+refresh(struct auth_tokens *at)
+{
+	struct keystone_thread_args keystone = *at->keystone;
+	struct auth_token *version, *old;
+	time_t issued = time(NULL);
+
+	keystone.auth_token = NULL;
+	keystone.swift_url = NULL;
+	keystone_thread_func(&keystone);
+	version = (struct auth_token *) malloc(sizeof(*version));
+	if (KSERR_SUCCESS != keystone.kserr || NULL == version) {
+		fprintf(stderr, "Failed to refresh Keystone token; retrying in %u seconds\n", AUTH_TOKEN_RETRY_SECS);
+		free(keystone.auth_token);
+		free(keystone.swift_url);
+		free(version);
+		return -1;
+	}
+
+	old = at->current;
+	version->token = keystone.auth_token;
+	version->generation = old->generation + 1;
+	version->retired = NULL;
+	__atomic_store_n(&at->current, version, __ATOMIC_RELEASE);
+	at->issued = issued;
+	old->retired = at->retired;
+	at->retired = old;
+	reclaim(at);
+
+	if (at->cache_dir) {
+		auth_token_cache_store(at->cache_dir, &keystone, at->issued);
+	}
+	free(keystone.swift_url);
+	return 0;
+}
+
+/**
+ * Executed by the refresher thread.
+ */
+static void *
+refresher_func(void *arg)
+{
+	struct auth_tokens *at = (struct auth_tokens *) arg;
+	double when = refresh_time(at->issued, at->lifetime);
+	int ret;
+
+	pthread_mutex_lock(&at->mutex);
+	while (!at->stop) {
+		struct timespec deadline;
+
+		deadline.tv_sec = (time_t) when;
+		deadline.tv_nsec = (long) ((when - deadline.tv_sec) * 1e9);
+		ret = pthread_cond_timedwait(&at->condvar, &at->mutex, &deadline);
+		if (at->stop) {
+			break;
+		}
+		if (ETIMEDOUT != ret) {
+			continue;
+		}
+		pthread_mutex_unlock(&at->mutex);
+		if (0 == refresh(at)) {
+			when = refresh_time(at->issued, at->lifetime);
+		} else {
+			when = time(NULL) + AUTH_TOKEN_RETRY_SECS;
+		}
+		pthread_mutex_lock(&at->mutex);
+	}
+	pthread_mutex_unlock(&at->mutex);
+	return NULL;
+}
+
+/**
+ * Publish the token of the given Keystone arguments, issued at the given time, as the first version of
+ * the token of the given number of Swift threads, and start a refresher thread which authenticates anew with
+ * the same arguments before each token expires, caching each token in the given directory unless it is NULL.
+ * The Keystone arguments must outlive the refresher. Returns zero on success.
+ */
+int
+auth_tokens_start(struct auth_tokens *at, const struct keystone_thread_args *keystone, const char *cache_dir, double lifetime, time_t issued, unsigned int num_threads)
+{
+	unsigned int i;
+	int ret;
+
+	memset(at, 0, sizeof(*at));
+	at->keystone = keystone;
+	at->cache_dir = cache_dir;
+	at->lifetime = lifetime;
+	at->issued = issued;
+	at->num_threads = num_threads;
+
+	ret = posix_memalign((void **) &at->readers, AUTH_TOKEN_CACHE_LINE, num_threads * sizeof(*at->readers));
+	if (ret != 0) {
+		errno = ret;
+		perror("posix_memalign");
+		return -1;
+	}
+	for (i = 0; i < num_threads; i++) {
+		at->readers[i].generation = 1;
+	}
+	at->current = (struct auth_token *) calloc(1, sizeof(*at->current));
+	if (NULL == at->current || NULL == (at->current->token = strdup(keystone->auth_token))) {
+		perror("malloc");
+		free(at->current);
+		free(at->readers);
+		return -1;
+	}
+	at->current->generation = 1;
+
+	ret = pthread_mutex_init(&at->mutex, NULL);
+	if (0 == ret) {
+		ret = pthread_cond_init(&at->condvar, NULL);
+		if (0 == ret) {
+			ret = pthread_create(&at->thread_id, NULL, refresher_func, at);
+			if (ret != 0) {
+				pthread_cond_destroy(&at->condvar);
+			}
+		}
+		if (ret != 0) {
+			pthread_mutex_destroy(&at->mutex);
+		}
+	}
+	if (ret != 0) {
+		errno = ret;
+		perror("pthread_create");
+		free(at->current->token);
+		free(at->current);
+		free(at->readers);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Stop the refresher thread, once every Swift thread has ended, and free every version of the token.
+ */
+void
+auth_tokens_stop(struct auth_tokens *at)
+{
+	struct auth_token *version, *next;
+	int ret;
+
+	pthread_mutex_lock(&at->mutex);
+	at->stop = 1;
+	pthread_cond_signal(&at->condvar);
+	pthread_mutex_unlock(&at->mutex);
+	ret = pthread_join(at->thread_id, NULL);
+	if (ret != 0) {
+		errno = ret;
+		perror("pthread_join");
+	}
+	pthread_cond_destroy(&at->condvar);
+	pthread_mutex_destroy(&at->mutex);
+
+	at->current->retired = at->retired;
+	for (version = at->current; version; version = next) {
+		next = version->retired;
+		free(version->token);
+		free(version);
+	}
+	free(at->readers);
+}
+
+/**
+ * Return the first version of the token, with which every Swift thread starts.
+ */
+const char *
+auth_tokens_first(const struct auth_tokens *at)
+{
+	return at->current->token;
+}
+
+/**
+ * If the token has been refreshed since the given Swift thread's reader last adopted a version,
+ * adopt the current version and return its token; otherwise return NULL. Once it has adopted a version,
+ * the Swift thread must no longer use the token of the version it adopted before, which may be freed.
+ * Takes no lock.
+ */
+const char *
+auth_token_poll(struct auth_tokens *at, struct auth_token_reader *reader)
+{
+	const struct auth_token *current = __atomic_load_n(&at->current, __ATOMIC_ACQUIRE);
+
+	if (current->generation == reader->generation) {
+		return NULL;
+	}
+	__atomic_store_n(&reader->generation, current->generation, __ATOMIC_RELEASE);
+	return current->token;
+}
+
+/**
+ * Declare that the given Swift thread's reader needs no version of the token any longer.
+ */
+void
+auth_token_release(struct auth_token_reader *reader)
+{
+	__atomic_store_n(&reader->generation, UINT64_MAX, __ATOMIC_RELEASE);
+}
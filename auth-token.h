@@ -0,0 +1,58 @@
+#ifndef AUTH_TOKEN_H_
+#define AUTH_TOKEN_H_
+
+#include <stdint.h>  /* uint64_t */
+#include <time.h>    /* time_t */
+#include <pthread.h> /* pthread_* */
+
+#include "keystone-thread.h"
+
+/*
+ * Authentication token shared by all Swift threads, kept valid however long they run: a refresher thread
+ * authenticates anew before the current token expires and publishes the new token, read-copy-update style,
+ * by swapping a pointer. Swift threads poll for a new token between requests, taking no lock, and a replaced
+ * token is freed only once every Swift thread has moved on from it.
+ * Tokens, with the Swift URL of their service catalog, may also be cached on disk, keyed by Keystone URL,
+ * tenant and user, so that a run may reuse a token which an earlier run obtained while it is still fresh.
+ */
+
+/* Size of a cache line, to which each Swift thread's reader is aligned so that no two share one */
+#define AUTH_TOKEN_CACHE_LINE 64
+
+/* One version of the token, immutable once published */
+struct auth_token {
+	char *token;                 /* Authentication token */
+	uint64_t generation;         /* Number of the version, counting from one */
+	struct auth_token *retired;  /* Next older version replaced but not yet freed */
+};
+
+/* Version of the token in use by one Swift thread. Only the Swift thread writes it. */
+struct auth_token_reader {
+	uint64_t generation;         /* Generation in use, or UINT64_MAX once the thread needs none; accessed atomically */
+} __attribute__((aligned(AUTH_TOKEN_CACHE_LINE)));
+
+/* Refresher thread and the versions of the token */
+struct auth_tokens {
+	pthread_t thread_id;                 /* pthread thread ID */
+	pthread_mutex_t mutex;               /* Protects stop, with which condvar wakes the refresher to stop */
+	pthread_cond_t condvar;
+	int stop;                            /* Set to stop the refresher */
+	const struct keystone_thread_args *keystone; /* Keystone credentials and settings with which to authenticate anew */
+	const char *cache_dir;               /* Directory of the token cache, or NULL */
+	double lifetime;                     /* Seconds for which a token is valid once issued */
+	time_t issued;                       /* Time at which the current token was issued */
+	struct auth_token *current;          /* Current version; accessed atomically */
+	struct auth_token *retired;          /* Versions replaced but possibly still in use, newest first */
+	struct auth_token_reader *readers;   /* Version in use by each Swift thread */
+	unsigned int num_threads;            /* Number of Swift threads */
+};
+
+int auth_token_cache_load(const char *cache_dir, struct keystone_thread_args *keystone, double lifetime, time_t *issued);
+void auth_token_cache_store(const char *cache_dir, const struct keystone_thread_args *keystone, time_t issued);
+int auth_tokens_start(struct auth_tokens *at, const struct keystone_thread_args *keystone, const char *cache_dir, double lifetime, time_t issued, unsigned int num_threads);
+void auth_tokens_stop(struct auth_tokens *at);
+const char *auth_tokens_first(const struct auth_tokens *at);
+const char *auth_token_poll(struct auth_tokens *at, struct auth_token_reader *reader);
+void auth_token_release(struct auth_token_reader *reader);
+
+#endif /* AUTH_TOKEN_H_ */
@@ -0,0 +1,431 @@
+#include <stdio.h>   /* snprintf, fprintf */
+#include <stdlib.h>  /* malloc, realloc, free, posix_memalign */
+#include <string.h>  /* memset, memcpy, strlen, strstr, strncmp */
+#include <errno.h>   /* errno */
+
+#include <json/json.h>
+
+#include "bulk.h"
+#include "swift-http.h"
+
+/* Query of an account post of a bulk delete */
+#define BULK_DELETE_QUERY "?bulk-delete"
+
+/* Response body gathered in memory */
+struct response_body {
+	char *data;                      /* Data received so far, NUL-terminated, or NULL if none */
+	size_t len;                      /* Length of data */
+};
+
+/**
+ * Prepare the queues of the given number of Swift threads, all empty. Returns zero on success, or else an errno value.
+ */
+int
+bulk_init(struct bulk_phases *bp, unsigned int num_threads)
+{
+	unsigned int i;
+	int ret;
+
+	memset(bp, 0, sizeof(*bp));
+	bp->max_deletes = -1;
+	ret = posix_memalign((void **) &bp->queues, BULK_CACHE_LINE, num_threads * sizeof(*bp->queues));
+	if (ret != 0) {
+		return ret;
+	}
+	memset(bp->queues, 0, num_threads * sizeof(*bp->queues));
+	ret = pthread_mutex_init(&bp->mutex, NULL);
+	for (i = 0; 0 == ret && i < num_threads; i++) {
+		bp->queues[i].phases = bp;
+		ret = pthread_mutex_init(&bp->queues[i].mutex, NULL);
+		if (0 == ret) {
+			ret = pthread_cond_init(&bp->queues[i].condvar, NULL);
+			if (ret != 0) {
+				pthread_mutex_destroy(&bp->queues[i].mutex);
+			}
+		}
+		if (0 == ret) {
+			bp->num_queues++;
+		}
+	}
+	if (ret != 0) {
+		bulk_destroy(bp);
+	}
+	return ret;
+}
+
+/**
+ * Release the queues, once every Swift thread has ended.
+ */
+void
+bulk_destroy(struct bulk_phases *bp)
+{
+	unsigned int i;
+
+	for (i = 0; i < bp->num_queues; i++) {
+		pthread_cond_destroy(&bp->queues[i].condvar);
+		pthread_mutex_destroy(&bp->queues[i].mutex);
+	}
+	pthread_mutex_destroy(&bp->mutex);
+	free(bp->queues);
+	bp->queues = NULL;
+	bp->num_queues = 0;
+}
+
+static size_t
+gather_body(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	struct response_body *body = (struct response_body *) userdata;
+	char *data;
+
+	size *= nmemb;
+	data = (char *) realloc(body->data, body->len + size + 1);
+	if (NULL == data) {
+		return 0; /* Fails the transfer */
+	}
+	memcpy(data + body->len, ptr, size);
+	body->len += size;
+	data[body->len] = '\0';
+	body->data = data;
+	return size;
+}
+
+/**
+ * Return the number of objects the cluster at the given Swift URL deletes per bulk delete, as its /info
+ * advertises, or zero if it offers none or does not say.
+ */
+static int
+probe_bulk_delete(struct swift_thread_args *args, CURL *curl)
+{
+	struct response_body body = { NULL, 0 };
+	struct json_object *info, *bulk_delete, *max;
+	const char *version = strstr(args->swift_url, "/v1/");
+	char url[SWIFT_HTTP_URL_MAX];
+	long response_code = 0;
+	int max_deletes = 0;
+	CURLcode res;
+
+	if (NULL == version || snprintf(url, sizeof(url), "%.*s/info", (int) (version - args->swift_url), args->swift_url) >= (int) sizeof(url)) {
+		return 0;
+	}
+	/* The cluster's capabilities are public, needing no token */
+	if (SCERR_SUCCESS != swift_http_prepare(&args->swift, curl, SWIFT_HTTP_GET, url, NULL, args->proxy, args->debug)) {
+		return 0;
+	}
+	res = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, gather_body);
+	if (CURLE_OK == res) {
+		res = curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+	}
+	if (CURLE_OK == res) {
+		res = curl_easy_perform(curl);
+	}
+	if (CURLE_OK == res) {
+		res = curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+	}
+	if (CURLE_OK == res && 200 == response_code && body.data) {
+		info = json_tokener_parse(body.data);
+		if (info && json_object_object_get_ex(info, "bulk_delete", &bulk_delete) && json_object_object_get_ex(bulk_delete, "max_deletes_per_request", &max)) {
+			max_deletes = json_object_get_int(max);
+		}
+		if (info) {
+			json_object_put(info);
+		}
+	}
+	free(body.data);
+	if (max_deletes < 0) {
+		max_deletes = 0;
+	}
+	return (max_deletes > BULK_DELETE_MAX) ? BULK_DELETE_MAX : max_deletes;
+}
+
+/**
+ * Return the number of objects of each task of the cleanup: as many as the cluster deletes per bulk delete,
+ * if it offers it, as found by the first Swift thread to ask, upon the given easy handle; or else BULK_BATCH.
+ */
+unsigned long
+bulk_cleanup_batch(struct swift_thread_args *args, CURL *curl)
+{
+	struct bulk_phases *bp = args->bulk->phases;
+	int max_deletes;
+
+	pthread_mutex_lock(&bp->mutex);
+	if (bp->max_deletes < 0) {
+		bp->max_deletes = probe_bulk_delete(args, curl);
+		if (args->debug) {
+			fprintf(stderr, "Bulk delete of up to %d objects %s\n", bp->max_deletes, bp->max_deletes ? "offered" : "not offered");
+		}
+	}
+	max_deletes = bp->max_deletes;
+	pthread_mutex_unlock(&bp->mutex);
+	return max_deletes ? (unsigned long) max_deletes : BULK_BATCH;
+}
+
+/**
+ * Put every object of the given Swift thread's keyspace, or delete every one, on the thread's queue, in tasks of
+ * the given number of objects, which the thread and then any other may take. The keyspace, and the workload
+ * state if not NULL, must not change until the thread's queue is closed.
+ */
+void
+bulk_publish(struct swift_thread_args *args, enum bulk_phase phase, const struct keyspace *ks, const struct workload_state *ws, unsigned long batch)
+{
+	struct bulk_queue *q = args->bulk;
+
+	pthread_mutex_lock(&q->mutex);
+	q->phase = phase;
+	q->owner = args;
+	q->ks = ks;
+	q->ws = ws;
+	q->batch = batch;
+	q->next = 0;
+	q->end = ks->num_objects;
+	pthread_mutex_unlock(&q->mutex);
+}
+
+/**
+ * Take a task for the given Swift thread: the next of its own queue, from the front, or else the last of
+ * another thread's queue, from the back, trying the others in turn from the thread after it, so that thieves
+ * spread over the queues. Returns zero if a task was taken, or else -1 if no queue has any left.
+ */
+int
+bulk_take(struct swift_thread_args *args, struct bulk_task *task)
+{
+	struct bulk_queue *own = args->bulk;
+	struct bulk_phases *bp = own->phases;
+	unsigned int start = own - bp->queues, i;
+
+	for (i = 0; i < bp->num_queues; i++) {
+		struct bulk_queue *q = &bp->queues[(start + i) % bp->num_queues];
+		int taken = 0;
+
+		pthread_mutex_lock(&q->mutex);
+		if (q->next < q->end) {
+			task->queue = q;
+			task->phase = q->phase;
+			task->count = (q->end - q->next < q->batch) ? q->end - q->next : q->batch;
+			task->stolen = (q != own);
+			if (task->stolen) {
+				q->end -= task->count;
+				task->first = q->end;
+				q->stolen++;
+			} else {
+				task->first = q->next;
+				q->next += task->count;
+			}
+			taken = 1;
+		}
+		pthread_mutex_unlock(&q->mutex);
+		if (taken) {
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Put the given object of the given owner, generating its data as it is sent, and recording its CRC-32C
+ * if verifying hashes.
+ */
+static enum swift_error
+put_owned_object(const struct bulk_queue *q, struct swift_thread_args *args, CURL *curl, const struct curl_slist *headers, unsigned long object)
+{
+	struct swift_thread_args *owner = q->owner;
+	struct supply_data_args supply_args;
+	enum swift_error scerr;
+	CURLcode res;
+
+	test_data_source_init(&supply_args.source, owner->data_type, owner->thread_num, object);
+	supply_args.hash = (VERIFY_HASH == owner->verify_data);
+	supply_args.crc = 0;
+	supply_args.len = swift_thread_object_len(owner, object, q->ws ? workload_object_size(q->ws, object) : owner->data_size);
+	supply_args.off = 0;
+
+	scerr = swift_http_prepare(&args->swift, curl, SWIFT_HTTP_PUT, keyspace_object_url(q->ks, object), headers, args->proxy, args->debug);
+	if (SCERR_SUCCESS == scerr) {
+		res = curl_easy_setopt(curl, CURLOPT_READFUNCTION, supply_data);
+		if (CURLE_OK == res) {
+			res = curl_easy_setopt(curl, CURLOPT_READDATA, &supply_args);
+		}
+		if (CURLE_OK == res) {
+			res = curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t) supply_args.len);
+		}
+		if (CURLE_OK != res) {
+			args->swift.curl_error("curl_easy_setopt", res);
+			scerr = SCERR_INVARG;
+		}
+	}
+	if (SCERR_SUCCESS == scerr) {
+		scerr = swift_http_result(&args->swift, curl, curl_easy_perform(curl));
+	}
+	if (SCERR_SUCCESS == scerr && supply_args.hash) {
+		/* No other thread puts the same object, so none writes the same CRC */
+		owner->object_crcs[object] = supply_args.crc;
+	}
+	return scerr;
+}
+
+/**
+ * Delete the given consecutive objects of the given owner in one bulk delete, of which any already absent
+ * are no failure.
+ */
+static enum swift_error
+bulk_delete(const struct bulk_queue *q, struct swift_thread_args *args, CURL *curl, const struct curl_slist *headers, unsigned long first, unsigned long count)
+{
+	size_t prefix_len = strlen(q->owner->swift_url), len = 0;
+	struct response_body body = { NULL, 0 };
+	struct curl_slist *list = NULL, *h;
+	struct json_object *result, *status;
+	char url[SWIFT_HTTP_URL_MAX], *paths;
+	enum swift_error scerr = SCERR_SUCCESS;
+	unsigned long k;
+	CURLcode res;
+
+	/* Each object's path within the account, URL-encoded as in its URL, one per line */
+	for (k = first; k < first + count; k++) {
+		len += strlen(keyspace_object_url(q->ks, k)) - prefix_len + 1;
+	}
+	paths = (char *) malloc(len + 1);
+	if (NULL == paths || snprintf(url, sizeof(url), "%s" BULK_DELETE_QUERY, q->owner->swift_url) >= (int) sizeof(url)) {
+		free(paths);
+		return SCERR_ALLOC_FAILED;
+	}
+	for (len = 0, k = first; k < first + count; k++) {
+		len += sprintf(paths + len, "%s\n", keyspace_object_url(q->ks, k) + prefix_len);
+	}
+
+	for (h = (struct curl_slist *) headers; h && SCERR_SUCCESS == scerr; h = h->next) {
+		list = curl_slist_append(list, h->data);
+		if (NULL == list) {
+			scerr = SCERR_ALLOC_FAILED;
+		}
+	}
+	if (SCERR_SUCCESS == scerr && (NULL == (list = curl_slist_append(list, "Content-Type: text/plain"))
+			|| NULL == (list = curl_slist_append(list, "Accept: application/json")))) {
+		scerr = SCERR_ALLOC_FAILED;
+	}
+
+	if (SCERR_SUCCESS == scerr) {
+		scerr = swift_http_prepare(&args->swift, curl, SWIFT_HTTP_POST, url, list, args->proxy, args->debug);
+	}
+	if (SCERR_SUCCESS == scerr) {
+		res = curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t) len);
+		if (CURLE_OK == res) {
+			res = curl_easy_setopt(curl, CURLOPT_POSTFIELDS, paths);
+		}
+		if (CURLE_OK == res) {
+			res = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, gather_body);
+		}
+		if (CURLE_OK == res) {
+			res = curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+		}
+		if (CURLE_OK != res) {
+			args->swift.curl_error("curl_easy_setopt", res);
+			scerr = SCERR_INVARG;
+		}
+	}
+	if (SCERR_SUCCESS == scerr) {
+		scerr = swift_http_result(&args->swift, curl, curl_easy_perform(curl));
+	}
+	if (SCERR_SUCCESS == scerr) {
+		/* The response is a success whatever befell each object; its body tells */
+		result = body.data ? json_tokener_parse(body.data) : NULL;
+		if (NULL == result || !json_object_object_get_ex(result, "Response Status", &status) || '2' != json_object_get_string(status)[0]) {
+			fprintf(stderr, "Bulk delete from %s failed: %s\n", url, body.data ? body.data : "(no response body)");
+			scerr = SCERR_URL_FAILED;
+		}
+		if (result) {
+			json_object_put(result);
+		}
+	}
+
+	curl_slist_free_all(list);
+	free(body.data);
+	free(paths);
+	return scerr;
+}
+
+/**
+ * Perform the given task on behalf of the Swift thread whose queue it was taken from, as the given Swift
+ * thread, upon the given easy handle with the given authentication headers.
+ */
+enum swift_error
+bulk_perform(const struct bulk_task *task, struct swift_thread_args *args, CURL *curl, const struct curl_slist *headers)
+{
+	const struct bulk_queue *q = task->queue;
+	enum swift_error scerr = SCERR_SUCCESS;
+	unsigned long k;
+
+	if (BULK_CLEANUP == task->phase && q->phases->max_deletes > 0) {
+		return bulk_delete(q, args, curl, headers, task->first, task->count);
+	}
+	for (k = task->first; k < task->first + task->count && SCERR_SUCCESS == scerr; k++) {
+		if (BULK_PREFILL == task->phase) {
+			scerr = put_owned_object(q, args, curl, headers, k);
+		} else if (NULL == q->ws || workload_object_present(q->ws, k)) {
+			scerr = swift_http_prepare(&args->swift, curl, SWIFT_HTTP_DELETE, keyspace_object_url(q->ks, k), headers, args->proxy, args->debug);
+			if (SCERR_SUCCESS == scerr) {
+				scerr = swift_http_result(&args->swift, curl, curl_easy_perform(curl));
+			}
+		}
+	}
+	return scerr;
+}
+
+/**
+ * Mark the given task done, successfully or not.
+ */
+void
+bulk_done(const struct bulk_task *task)
+{
+	struct bulk_queue *q = task->queue;
+
+	if (!task->stolen) {
+		return;
+	}
+	pthread_mutex_lock(&q->mutex);
+	if (0 == --q->stolen) {
+		pthread_cond_broadcast(&q->condvar);
+	}
+	pthread_mutex_unlock(&q->mutex);
+}
+
+/**
+ * Withdraw every task left on the given Swift thread's queue, and wait until every task stolen from it is done,
+ * so that no other thread addresses the thread's objects any longer.
+ */
+void
+bulk_close(struct swift_thread_args *args)
+{
+	struct bulk_queue *q = args->bulk;
+
+	pthread_mutex_lock(&q->mutex);
+	q->next = q->end;
+	while (q->stolen > 0) {
+		pthread_cond_wait(&q->condvar, &q->mutex);
+	}
+	pthread_mutex_unlock(&q->mutex);
+}
+
+/**
+ * Return the number of seconds from the first of the given Swift threads to start the given phase to the last
+ * to end it, or zero if none did.
+ */
+double
+bulk_phase_secs(const struct swift_thread_args *args, unsigned int n, enum bulk_phase phase)
+{
+	const struct timespec *start = NULL, *end = NULL;
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		const struct timespec *thread_start = (BULK_PREFILL == phase) ? &args[i].start_prefill_time : &args[i].start_cleanup_time;
+		const struct timespec *thread_end = (BULK_PREFILL == phase) ? &args[i].end_prefill_time : &args[i].end_cleanup_time;
+		if (0 == thread_end->tv_sec && 0 == thread_end->tv_nsec) {
+			continue; /* Never ended it */
+		}
+		if (NULL == start || swift_timespecs_to_secs(thread_start, start) > 0) {
+			start = thread_start;
+		}
+		if (NULL == end || swift_timespecs_to_secs(end, thread_end) > 0) {
+			end = thread_end;
+		}
+	}
+	return start ? swift_timespecs_to_secs(start, end) : 0;
+}
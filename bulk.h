@@ -0,0 +1,74 @@
+#ifndef BULK_H_
+#define BULK_H_
+
+#include <pthread.h> /* pthread_* */
+#include <curl/curl.h>
+
+#include "swift-thread.h"
+
+/*
+ * Prefill and cleanup shared by all Swift threads. Each Swift thread's objects are split into tasks, each a
+ * batch of consecutive objects, on a queue of the thread's own: the thread takes tasks from the front of its
+ * queue, and once it has none left, steals from the back of the queues of the others, so that no thread is
+ * left idle while another still has objects to put or delete. Any thread may so put or delete the objects of
+ * any other, directly over HTTP upon its own easy handle; each queue keeps what a thief needs to address its
+ * owner's objects and generate their data. Where the cluster offers bulk delete, each task of the cleanup
+ * deletes all of its objects in one request.
+ */
+
+/* Size of a cache line, to which each queue is aligned so that no two share one */
+#define BULK_CACHE_LINE 64
+/* Number of objects of each task put, or deleted one by one */
+#define BULK_BATCH 16
+/* Greatest number of objects deleted by one bulk delete, as Swift's default max_deletes_per_request */
+#define BULK_DELETE_MAX 10000
+
+/* Phases whose objects are shared out as tasks */
+enum bulk_phase {
+	BULK_PREFILL, /* Put every object once */
+	BULK_CLEANUP  /* Delete every object still present */
+};
+
+/* Objects of one Swift thread not yet taken by any thread, and what is needed to address them */
+struct bulk_queue {
+	pthread_mutex_t mutex;           /* Protects all of the below */
+	pthread_cond_t condvar;          /* Broadcast when the last task stolen from the queue is done */
+	enum bulk_phase phase;           /* Phase of the tasks */
+	unsigned long next;              /* First object of the owner's next task */
+	unsigned long end;               /* End of the objects not yet taken, from which thieves take theirs */
+	unsigned long batch;             /* Number of objects per task */
+	unsigned int stolen;             /* Number of tasks stolen and not yet done */
+	struct swift_thread_args *owner; /* Swift thread whose objects these are */
+	const struct keyspace *ks;       /* Names and URLs of the owner's objects */
+	const struct workload_state *ws; /* Which of the owner's objects are present and their sizes, or NULL */
+	struct bulk_phases *phases;      /* Every queue */
+} __attribute__((aligned(BULK_CACHE_LINE)));
+
+/* Queues of all Swift threads of a process */
+struct bulk_phases {
+	struct bulk_queue *queues;       /* Queue of each Swift thread */
+	unsigned int num_queues;         /* Number of Swift threads */
+	pthread_mutex_t mutex;           /* Protects max_deletes */
+	int max_deletes;                 /* Objects per bulk delete, zero if the cluster offers none, or -1 until probed */
+};
+
+/* A task taken from a queue */
+struct bulk_task {
+	struct bulk_queue *queue;        /* Queue from which the task was taken */
+	enum bulk_phase phase;           /* Phase of the task */
+	unsigned long first;             /* First object of the task */
+	unsigned long count;             /* Number of objects of the task */
+	unsigned int stolen;             /* Whether the task was stolen from another thread's queue */
+};
+
+int bulk_init(struct bulk_phases *bp, unsigned int num_threads);
+void bulk_destroy(struct bulk_phases *bp);
+unsigned long bulk_cleanup_batch(struct swift_thread_args *args, CURL *curl);
+void bulk_publish(struct swift_thread_args *args, enum bulk_phase phase, const struct keyspace *ks, const struct workload_state *ws, unsigned long batch);
+int bulk_take(struct swift_thread_args *args, struct bulk_task *task);
+enum swift_error bulk_perform(const struct bulk_task *task, struct swift_thread_args *args, CURL *curl, const struct curl_slist *headers);
+void bulk_done(const struct bulk_task *task);
+void bulk_close(struct swift_thread_args *args);
+double bulk_phase_secs(const struct swift_thread_args *args, unsigned int n, enum bulk_phase phase);
+
+#endif /* BULK_H_ */
@@ -0,0 +1,690 @@
+#define _GNU_SOURCE /* asprintf */
+#include <stdio.h>   /* fprintf, asprintf, snprintf */
+#include <stdlib.h>  /* malloc, realloc, free, _exit */
+#include <string.h>  /* memset, strdup, strlen, strerror */
+#include <stddef.h>  /* offsetof */
+#include <errno.h>   /* errno */
+#include <unistd.h>  /* close, execv, sleep */
+#include <netdb.h>   /* getaddrinfo, getnameinfo */
+#include <sys/socket.h> /* socket, bind, listen, accept, connect, send, recv */
+#include <netinet/in.h> /* IPPROTO_TCP */
+#include <netinet/tcp.h> /* TCP_NODELAY */
+
+#include "controller.h"
+
+/* Identifies a configuration message sent by a controller to an agent */
+#define CONTROLLER_MAGIC 0x53574354
+/* Nanoseconds ahead of the time at which it is sent that the start is set, so that every agent has it in time */
+#define CONTROLLER_START_MARGIN 500000000
+/* Seconds for which an agent retries connecting to a controller not yet listening, once a second */
+#define AGENT_CONNECT_SECS 60
+/* Number of times of each Swift thread sent from agent to controller */
+#define NUM_THREAD_TIMES 12
+/* Time of a Swift thread, relative to the start, which was never saved */
+#define TIME_UNSET INT64_MIN
+
+/* Header of each message, followed by its payload */
+struct message_header {
+	uint32_t type;                   /* Type of the message, one of enum controller_message */
+	uint32_t len;                    /* Length of the payload */
+};
+
+/* Payload of a configuration message, followed by the options, each terminated by a NUL */
+struct config_header {
+	uint32_t magic;                  /* CONTROLLER_MAGIC */
+	uint32_t record_size;            /* Size of struct thread_record, which differs between most builds */
+	uint32_t index;                  /* Index of the agent */
+	uint32_t num_agents;             /* Number of agents */
+	uint32_t argc;                   /* Number of options */
+};
+
+/* Payload of a message of the statistics of one Swift thread */
+struct thread_record {
+	uint32_t thread_num;             /* Swift thread index, across all agents */
+	int32_t cpu;                     /* CPU to which the thread was bound, or -1 */
+	int32_t node;                    /* NUMA node of that CPU, or -1 */
+	int32_t scerr;                   /* Swift client error encountered */
+	int64_t times[NUM_THREAD_TIMES]; /* Each of thread_times, in nanoseconds after the start, or TIME_UNSET */
+	struct swift_op_stats rows[SWIFT_ROW_MAX + 1]; /* Statistics of each row */
+};
+
+/* Times of a Swift thread sent from agent to controller */
+static const size_t thread_times[NUM_THREAD_TIMES] = {
+	offsetof(struct swift_thread_args, start_time),
+	offsetof(struct swift_thread_args, start_prefill_time),
+	offsetof(struct swift_thread_args, end_prefill_time),
+	offsetof(struct swift_thread_args, start_put_time),
+	offsetof(struct swift_thread_args, end_put_time),
+	offsetof(struct swift_thread_args, start_get_time),
+	offsetof(struct swift_thread_args, end_get_time),
+	offsetof(struct swift_thread_args, start_mixed_time),
+	offsetof(struct swift_thread_args, end_mixed_time),
+	offsetof(struct swift_thread_args, start_cleanup_time),
+	offsetof(struct swift_thread_args, end_cleanup_time),
+	offsetof(struct swift_thread_args, end_time)
+};
+
+/**
+ * Return the time of the clock used for timing at the given wall-clock time, in nanoseconds since the epoch,
+ * or the time now if that is already past.
+ */
+static uint64_t
+clock_at(uint64_t wall_nanosecs)
+{
+	uint64_t now = swift_clock_nanosecs();
+	struct timespec wall;
+
+	clock_gettime(CLOCK_REALTIME, &wall);
+	if (wall_nanosecs <= (uint64_t) wall.tv_sec * 1000000000 + wall.tv_nsec) {
+		return now;
+	}
+	return now + (wall_nanosecs - ((uint64_t) wall.tv_sec * 1000000000 + wall.tv_nsec));
+}
+
+static int
+write_all(int fd, const void *buf, size_t len)
+{
+	const char *p = (const char *) buf;
+
+	while (len > 0) {
+		ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (EINTR == errno) {
+				continue;
+			}
+			return -1;
+		}
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int
+read_all(int fd, void *buf, size_t len)
+{
+	char *p = (char *) buf;
+
+	while (len > 0) {
+		ssize_t n = recv(fd, p, len, 0);
+		if (n < 0) {
+			if (EINTR == errno) {
+				continue;
+			}
+			return -1;
+		}
+		if (0 == n) {
+			errno = ECONNRESET; /* Closed by the other end */
+			return -1;
+		}
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int
+send_message(int fd, enum controller_message type, const void *payload, size_t len)
+{
+	struct message_header header;
+
+	header.type = type;
+	header.len = len;
+	if (0 != write_all(fd, &header, sizeof(header))) {
+		return -1;
+	}
+	return write_all(fd, payload, len);
+}
+
+/**
+ * Receive a message of the given type whose payload is of the given length into the given buffer.
+ * Returns zero on success, or else -1 with errno set.
+ */
+static int
+expect_message(int fd, enum controller_message type, void *payload, size_t len)
+{
+	struct message_header header;
+
+	if (0 != read_all(fd, &header, sizeof(header))) {
+		return -1;
+	}
+	if (header.type != type || header.len != len) {
+		errno = EPROTO;
+		return -1;
+	}
+	return read_all(fd, payload, len);
+}
+
+/**
+ * Resolve the given address, [host:]port, of which the host, if given, may be an IPv6 address in brackets.
+ * Without a host, it is the wildcard address if passive, or else the loopback address.
+ * Returns the list of the address's socket addresses, which the caller must free, or NULL on failure.
+ */
+static struct addrinfo *
+resolve(const char *address, int passive)
+{
+	struct addrinfo hints, *res = NULL;
+	char *host, *port, *node = NULL;
+	int ret;
+
+	host = strdup(address);
+	if (NULL == host) {
+		perror("strdup");
+		return NULL;
+	}
+	port = strrchr(host, ':');
+	if (port) {
+		*port++ = '\0';
+		node = host;
+		if ('[' == node[0] && ']' == node[strlen(node) - 1]) {
+			node[strlen(node) - 1] = '\0';
+			node++;
+		}
+	} else {
+		port = host;
+	}
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = passive ? AI_PASSIVE : 0;
+	ret = getaddrinfo(node, port, &hints, &res);
+	if (ret != 0) {
+		fprintf(stderr, "%s: %s\n", address, gai_strerror(ret));
+		res = NULL;
+	}
+	free(host);
+	return res;
+}
+
+/**
+ * Send small messages at once, since every agent waits on the start.
+ */
+static void
+set_no_delay(int fd)
+{
+	int on = 1;
+
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+/**
+ * Listen on the given address for the given number of agents. Returns the listening socket, or -1 on failure.
+ */
+static int
+listen_on(const char *address, unsigned int num_agents)
+{
+	struct addrinfo *res, *ai;
+	int fd = -1, on = 1;
+
+	res = resolve(address, 1);
+	if (NULL == res) {
+		return -1;
+	}
+	for (ai = res; ai; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0) {
+			continue;
+		}
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		if (0 == bind(fd, ai->ai_addr, ai->ai_addrlen) && 0 == listen(fd, num_agents)) {
+			break;
+		}
+		close(fd);
+		fd = -1;
+	}
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", address, strerror(errno));
+	}
+	freeaddrinfo(res);
+	return fd;
+}
+
+/**
+ * Connect to the controller at the given address, retrying for a while if it is not yet listening.
+ * Returns the connected socket, or -1 on failure.
+ */
+static int
+connect_to(const char *address)
+{
+	struct addrinfo *res, *ai;
+	unsigned int attempt;
+	int fd = -1;
+
+	res = resolve(address, 0);
+	if (NULL == res) {
+		return -1;
+	}
+	for (attempt = 0; fd < 0 && attempt < AGENT_CONNECT_SECS; attempt++) {
+		if (attempt > 0) {
+			sleep(1);
+		}
+		for (ai = res; ai; ai = ai->ai_next) {
+			fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+			if (fd < 0) {
+				continue;
+			}
+			if (0 == connect(fd, ai->ai_addr, ai->ai_addrlen)) {
+				break;
+			}
+			close(fd);
+			fd = -1;
+		}
+		if (fd < 0 && ECONNREFUSED != errno) {
+			break;
+		}
+	}
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", address, strerror(errno));
+	} else {
+		set_no_delay(fd);
+	}
+	freeaddrinfo(res);
+	return fd;
+}
+
+/**
+ * Record an option of the run, with its argument if it takes one, to be sent to agents.
+ * Returns zero on success, or else -1.
+ */
+int
+controller_record_option(struct controller_options *options, int opt, const char *arg)
+{
+	char **argv;
+
+	argv = (char **) realloc(options->argv, (options->argc + 2) * sizeof(*argv));
+	if (NULL == argv) {
+		return -1;
+	}
+	options->argv = argv;
+	if (-1 == asprintf(&argv[options->argc], "-%c", opt)) {
+		return -1;
+	}
+	options->argc++;
+	if (arg) {
+		argv[options->argc] = strdup(arg);
+		if (NULL == argv[options->argc]) {
+			return -1;
+		}
+		options->argc++;
+	}
+	return 0;
+}
+
+void
+controller_options_free(struct controller_options *options)
+{
+	unsigned int i;
+
+	for (i = 0; i < options->argc; i++) {
+		free(options->argv[i]);
+	}
+	free(options->argv);
+	options->argv = NULL;
+	options->argc = 0;
+}
+
+/**
+ * Send the given agent its index and the options of the run. Returns zero on success, or else -1.
+ */
+static int
+send_config(int fd, const struct controller_options *options, unsigned int index, unsigned int num_agents)
+{
+	struct config_header *config;
+	size_t len = sizeof(*config);
+	unsigned int i;
+	char *p;
+	int ret;
+
+	for (i = 0; i < options->argc; i++) {
+		len += strlen(options->argv[i]) + 1;
+	}
+	config = (struct config_header *) malloc(len);
+	if (NULL == config) {
+		return -1;
+	}
+	config->magic = CONTROLLER_MAGIC;
+	config->record_size = sizeof(struct thread_record);
+	config->index = index;
+	config->num_agents = num_agents;
+	config->argc = options->argc;
+	p = (char *) (config + 1);
+	for (i = 0; i < options->argc; i++) {
+		strcpy(p, options->argv[i]);
+		p += strlen(p) + 1;
+	}
+	ret = send_message(fd, CONTROLLER_CONFIG, config, len);
+	free(config);
+	return ret;
+}
+
+static struct swift_op_stats *
+thread_row(struct swift_thread_args *args, unsigned int row)
+{
+	if (SWIFT_ROW_SEGMENT == row) {
+		return &args->segment_stats;
+	}
+	if (SWIFT_ROW_CHUNK == row) {
+		return &args->chunk_stats;
+	}
+	if (SWIFT_ROW_PAGE == row) {
+		return &args->page_stats;
+	}
+	if (row >= SWIFT_ROW_SIZED) {
+		return &args->sized_stats[row - SWIFT_ROW_SIZED];
+	}
+	return &args->op_stats[row];
+}
+
+/**
+ * Take the statistics of a Swift thread from the given record, converting its times to the controller's clock.
+ */
+static void
+unpack_thread(struct swift_thread_args *args, const struct thread_record *record, const struct swift_run *run)
+{
+	unsigned int i;
+
+	args->thread_num = record->thread_num;
+	args->cpu = record->cpu;
+	args->node = record->node;
+	args->scerr = (enum swift_error) record->scerr;
+	for (i = 0; i < NUM_THREAD_TIMES; i++) {
+		struct timespec *ts = (struct timespec *) ((char *) args + thread_times[i]);
+		uint64_t nanosecs = run->start + record->times[i];
+		if (TIME_UNSET == record->times[i] || (record->times[i] < 0 && (uint64_t) -record->times[i] >= run->start)) {
+			memset(ts, 0, sizeof(*ts));
+		} else {
+			ts->tv_sec = nanosecs / 1000000000;
+			ts->tv_nsec = nanosecs % 1000000000;
+		}
+	}
+	for (i = 0; i <= SWIFT_ROW_MAX; i++) {
+		*thread_row(args, i) = record->rows[i];
+	}
+}
+
+/**
+ * Receive the statistics of the given number of Swift threads of one agent, with their request timings if they
+ * were timed, until the agent is done. Returns zero on success, or else -1 with errno set.
+ */
+static int
+receive_results(int fd, struct swift_thread_args *args, unsigned int n, const struct swift_run *run)
+{
+	struct thread_record *record;
+	struct message_header header;
+	unsigned int received = 0;
+	int ret = -1;
+
+	record = (struct thread_record *) malloc(sizeof(*record));
+	if (NULL == record) {
+		return -1;
+	}
+	while (0 == read_all(fd, &header, sizeof(header))) {
+		if (CONTROLLER_DONE == header.type && 0 == header.len && received == n) {
+			ret = 0;
+			break;
+		}
+		if (CONTROLLER_THREAD == header.type && sizeof(*record) == header.len && received < n) {
+			if (0 != read_all(fd, record, sizeof(*record))) {
+				break;
+			}
+			unpack_thread(&args[received++], record, run);
+		} else if (CONTROLLER_TIMINGS == header.type && (SWIFT_OP_MAX + 1) * sizeof(struct request_timings) == header.len
+				&& received > 0 && args[received - 1].timings) {
+			if (0 != read_all(fd, args[received - 1].timings, header.len)) {
+				break;
+			}
+		} else {
+			errno = EPROTO;
+			break;
+		}
+	}
+	free(record);
+	return ret;
+}
+
+/**
+ * Wait for the given number of agents to connect to the given address, [host:]port, and send each its share of
+ * the run: the given options and its index. Once all are ready, set the start of the given run, and then receive
+ * the statistics of each agent's Swift threads into the given arguments, threads_per_agent per agent in turn,
+ * whose timings, if not NULL, receive their request timings. The Swift threads of any agent which fails after
+ * the start are left failed, with no statistics. Returns zero if every agent started, or else -1.
+ */
+int
+controller_run(const char *address, unsigned int num_agents, const struct controller_options *options, struct swift_thread_args *args, unsigned int threads_per_agent, struct swift_run *run)
+{
+	struct sockaddr_storage peer;
+	socklen_t peer_len;
+	char host[NI_MAXHOST];
+	int listen_fd, *fds, ret = 0;
+	unsigned int i;
+	int64_t start;
+
+	for (i = 0; i < num_agents * threads_per_agent; i++) {
+		args[i].thread_num = i + 1;
+		args[i].cpu = -1;
+		args[i].node = -1;
+		args[i].scerr = SCERR_INIT_FAILED; /* Until the agent sends its statistics */
+	}
+
+	fds = (int *) malloc(num_agents * sizeof(*fds));
+	if (NULL == fds) {
+		perror("malloc");
+		return -1;
+	}
+	listen_fd = listen_on(address, num_agents);
+	if (listen_fd < 0) {
+		free(fds);
+		return -1;
+	}
+	fprintf(stderr, "Waiting for %u agents on %s\n", num_agents, address);
+	for (i = 0; 0 == ret && i < num_agents; i++) {
+		peer_len = sizeof(peer);
+		fds[i] = accept(listen_fd, (struct sockaddr *) &peer, &peer_len);
+		if (fds[i] < 0) {
+			perror("accept");
+			ret = -1;
+			break;
+		}
+		set_no_delay(fds[i]);
+		if (0 != getnameinfo((struct sockaddr *) &peer, peer_len, host, sizeof(host), NULL, 0, NI_NUMERICHOST)) {
+			strcpy(host, "?");
+		}
+		fprintf(stderr, "Agent %u connected from %s\n", i, host);
+		if (0 != send_config(fds[i], options, i, num_agents)) {
+			fprintf(stderr, "Agent %u: %s\n", i, strerror(errno));
+			ret = -1;
+		}
+	}
+	close(listen_fd);
+	num_agents = i; /* Those connected */
+
+	/* Once every agent has put its objects, start all of them together, a little ahead */
+	for (i = 0; 0 == ret && i < num_agents; i++) {
+		if (0 != expect_message(fds[i], CONTROLLER_READY, NULL, 0)) {
+			fprintf(stderr, "Agent %u failed before the start: %s\n", i, strerror(errno));
+			ret = -1;
+		}
+	}
+	if (0 == ret) {
+		struct timespec wall;
+
+		clock_gettime(CLOCK_REALTIME, &wall);
+		start = (int64_t) wall.tv_sec * 1000000000 + wall.tv_nsec + CONTROLLER_START_MARGIN;
+		for (i = 0; 0 == ret && i < num_agents; i++) {
+			if (0 != send_message(fds[i], CONTROLLER_START, &start, sizeof(start))) {
+				fprintf(stderr, "Agent %u: %s\n", i, strerror(errno));
+				ret = -1;
+			}
+		}
+		run->start = clock_at((uint64_t) start);
+	}
+
+	for (i = 0; 0 == ret && i < num_agents; i++) {
+		if (0 != receive_results(fds[i], &args[i * threads_per_agent], threads_per_agent, run)) {
+			fprintf(stderr, "Agent %u failed to send its statistics: %s\n", i, strerror(errno));
+		}
+	}
+
+	for (i = 0; i < num_agents; i++) {
+		close(fds[i]);
+	}
+	free(fds);
+	return ret;
+}
+
+/**
+ * Connect to the controller at the given address, host:port, receive the options of this agent's share of the
+ * run, and execute the given program anew with them, and with the agent's session with the controller.
+ * Returns only on failure, with -1.
+ */
+int
+agent_exec(const char *address, const char *program, unsigned int verbose)
+{
+	struct message_header header;
+	struct config_header *config;
+	char session[64], **argv, *p, *end;
+	unsigned int i;
+	int fd;
+
+	fd = connect_to(address);
+	if (fd < 0) {
+		return -1;
+	}
+	if (verbose) {
+		fprintf(stderr, "Connected to controller %s\n", address);
+	}
+	if (0 != read_all(fd, &header, sizeof(header))) {
+		fprintf(stderr, "%s: %s\n", address, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	config = (CONTROLLER_CONFIG == header.type && header.len >= sizeof(*config)) ? (struct config_header *) malloc(header.len + 1) : NULL;
+	if (NULL == config || 0 != read_all(fd, config, header.len)) {
+		fprintf(stderr, "%s: Failed to receive the configuration of the run\n", address);
+		free(config);
+		close(fd);
+		return -1;
+	}
+	if (CONTROLLER_MAGIC != config->magic || sizeof(struct thread_record) != config->record_size) {
+		fprintf(stderr, "%s: Controller is not of the same build as this agent\n", address);
+		free(config);
+		close(fd);
+		return -1;
+	}
+
+	/* Program, options, session and NULL */
+	argv = (char **) malloc((config->argc + 4) * sizeof(*argv));
+	if (NULL == argv) {
+		perror("malloc");
+		free(config);
+		close(fd);
+		return -1;
+	}
+	argv[0] = (char *) program;
+	p = (char *) (config + 1);
+	end = (char *) config + header.len;
+	*end = '\0';
+	for (i = 0; i < config->argc && p < end; i++) {
+		argv[i + 1] = p;
+		p += strlen(p) + 1;
+	}
+	snprintf(session, sizeof(session), "%d:%u:%u", fd, config->index, config->num_agents);
+	argv[i + 1] = "-Y";
+	argv[i + 2] = session;
+	argv[i + 3] = NULL;
+	if (verbose) {
+		fprintf(stderr, "Running as agent %u of %u\n", config->index, config->num_agents);
+	}
+
+	/* The connection is inherited, as it was not opened close-on-exec */
+	execv("/proc/self/exe", argv);
+	perror("/proc/self/exe");
+	free(argv);
+	free(config);
+	close(fd);
+	return -1;
+}
+
+/**
+ * Parse an agent's session with its controller, as fd:index:num-agents. Returns zero on success, or else -1.
+ */
+int
+parse_agent_session(const char *text, struct agent_session *session)
+{
+	char trailing;
+
+	if (3 != sscanf(text, "%d:%u:%u%c", &session->fd, &session->index, &session->num_agents, &trailing)
+			|| session->fd < 0 || session->index >= session->num_agents) {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Barrier of an agent's run, given its session: tell the controller that this agent's Swift threads have put
+ * their objects, and return the start which it then sets, on the clock used for timing. Should the controller
+ * be lost, the agent cannot go on, and exits.
+ */
+uint64_t
+agent_barrier(void *arg)
+{
+	struct agent_session *session = (struct agent_session *) arg;
+	int64_t start;
+
+	if (0 != send_message(session->fd, CONTROLLER_READY, NULL, 0)
+			|| 0 != expect_message(session->fd, CONTROLLER_START, &start, sizeof(start))) {
+		fprintf(stderr, "Lost the controller before the start: %s\n", strerror(errno));
+		_exit(EXIT_FAILURE); /* Every Swift thread would otherwise wait forever, holding the run's mutex */
+	}
+	return clock_at((uint64_t) start);
+}
+
+/**
+ * Send the controller the statistics of the given Swift threads of the given run, which have all ended,
+ * with their request timings if they were timed, and end the session. Returns zero on success, or else -1.
+ */
+int
+agent_send_results(struct agent_session *session, const struct swift_thread_args *args, unsigned int n, const struct swift_run *run)
+{
+	struct thread_record *record;
+	unsigned int i, j;
+	int ret = 0;
+
+	record = (struct thread_record *) malloc(sizeof(*record));
+	if (NULL == record) {
+		perror("malloc");
+		return -1;
+	}
+	for (i = 0; 0 == ret && i < n; i++) {
+		memset(record, 0, sizeof(*record));
+		record->thread_num = args[i].thread_num;
+		record->cpu = args[i].cpu;
+		record->node = args[i].node;
+		record->scerr = args[i].scerr;
+		for (j = 0; j < NUM_THREAD_TIMES; j++) {
+			const struct timespec *ts = (const struct timespec *) ((const char *) &args[i] + thread_times[j]);
+			if (0 == ts->tv_sec && 0 == ts->tv_nsec) {
+				record->times[j] = TIME_UNSET;
+			} else {
+				record->times[j] = (int64_t) ((uint64_t) ts->tv_sec * 1000000000 + ts->tv_nsec - run->start);
+			}
+		}
+		for (j = 0; j <= SWIFT_ROW_MAX; j++) {
+			record->rows[j] = *swift_row_stats(&args[i], j);
+		}
+		ret = send_message(session->fd, CONTROLLER_THREAD, record, sizeof(*record));
+		if (0 == ret && args[i].timings) {
+			ret = send_message(session->fd, CONTROLLER_TIMINGS, args[i].timings, (SWIFT_OP_MAX + 1) * sizeof(struct request_timings));
+		}
+	}
+	if (0 == ret) {
+		ret = send_message(session->fd, CONTROLLER_DONE, NULL, 0);
+	}
+	if (ret != 0) {
+		fprintf(stderr, "Failed to send statistics to the controller: %s\n", strerror(errno));
+	}
+	free(record);
+	close(session->fd);
+	session->fd = -1;
+	return ret;
+}
@@ -0,0 +1,50 @@
+#ifndef CONTROLLER_H_
+#define CONTROLLER_H_
+
+#include <stdint.h>  /* uint32_t, int64_t, uint64_t */
+
+#include "swift-thread.h"
+
+/*
+ * Distributed runs: a controller waits for a given number of agents to connect to it over TCP, and sends each
+ * the options of the run and its index among them. Each agent runs the Swift threads of its share of the run,
+ * numbered after those of the agents before it, so that no two agents' objects collide. Once every agent has
+ * put its objects, the controller sets a start, in wall-clock time, shortly ahead, at which all agents start
+ * together; their clocks are taken to be synchronised, by NTP or the like. Each agent then sends back the
+ * statistics of each of its Swift threads: raw histograms and counters, which the controller merges as though
+ * all of the Swift threads had run within it, and times relative to the start. The controller and its agents
+ * must be the same build on the same architecture, as the statistics are sent in their in-memory layout.
+ */
+
+/* Messages between controller and agent */
+enum controller_message {
+	CONTROLLER_CONFIG = 1, /* To agent: its index, the number of agents, and the options of the run */
+	CONTROLLER_READY,      /* To controller: the agent's Swift threads have all put their objects */
+	CONTROLLER_START,      /* To agent: the wall-clock time, in nanoseconds, at which to start */
+	CONTROLLER_THREAD,     /* To controller: the statistics of one Swift thread */
+	CONTROLLER_TIMINGS,    /* To controller: the request timings of the Swift thread last sent, if timed */
+	CONTROLLER_DONE        /* To controller: the agent has sent the statistics of all of its Swift threads */
+};
+
+/* Options of the run, as sent to agents */
+struct controller_options {
+	char **argv;                 /* Options, each as a separate argument, in short form */
+	unsigned int argc;           /* Number of arguments */
+};
+
+/* One agent's session with its controller, within the agent's run */
+struct agent_session {
+	int fd;                      /* Connection to the controller */
+	unsigned int index;          /* Index of the agent among all agents, counting from zero */
+	unsigned int num_agents;     /* Number of agents */
+};
+
+int controller_record_option(struct controller_options *options, int opt, const char *arg);
+void controller_options_free(struct controller_options *options);
+int controller_run(const char *address, unsigned int num_agents, const struct controller_options *options, struct swift_thread_args *args, unsigned int threads_per_agent, struct swift_run *run);
+int agent_exec(const char *address, const char *program, unsigned int verbose);
+int parse_agent_session(const char *text, struct agent_session *session);
+uint64_t agent_barrier(void *arg);
+int agent_send_results(struct agent_session *session, const struct swift_thread_args *args, unsigned int n, const struct swift_run *run);
+
+#endif /* CONTROLLER_H_ */
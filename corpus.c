@@ -0,0 +1,184 @@
+#define _XOPEN_SOURCE 500 /* nftw */
+
+#include <stdio.h>   /* fprintf, perror */
+#include <stdlib.h>  /* realloc, free, qsort */
+#include <string.h>  /* strcmp, strdup, strerror */
+#include <errno.h>   /* errno */
+#include <fcntl.h>   /* open */
+#include <unistd.h>  /* close */
+#include <ftw.h>     /* nftw */
+#include <sys/mman.h> /* mmap, munmap */
+#include <sys/stat.h> /* fstat, struct stat */
+#include <assert.h>  /* assert */
+
+#include "corpus.h"
+
+/* Greatest number of directories held open while walking a corpus directory */
+#define WALK_MAX_FDS 16
+
+/* Stands in for the mapping of an empty file, which mmap cannot map */
+static const unsigned char empty_file[1];
+
+/* The corpus, shared read-only by all Swift threads once loaded */
+static struct corpus_file *files;
+static size_t num_files;
+static size_t max_files;
+static unsigned int corpus_threads;
+
+/**
+ * Map the given regular file read-only and append it to the corpus.
+ * Returns zero on success.
+ */
+static int
+add_file(const char *path)
+{
+	struct corpus_file *file;
+	struct stat st;
+	void *p = (void *) empty_file;
+	int fd, ret = 0;
+
+	if (num_files == max_files) {
+		size_t n = max_files ? 2 * max_files : 64;
+		struct corpus_file *grown = (struct corpus_file *) realloc(files, n * sizeof(*files));
+		if (NULL == grown) {
+			perror("realloc");
+			return -1;
+		}
+		files = grown;
+		max_files = n;
+	}
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	if (0 != fstat(fd, &st)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		ret = -1;
+	} else if (st.st_size > 0) {
+		p = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (MAP_FAILED == p) {
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+			ret = -1;
+		}
+	}
+	close(fd); /* The mapping outlives the descriptor */
+	if (0 != ret) {
+		return ret;
+	}
+
+	file = &files[num_files];
+	file->path = strdup(path);
+	if (NULL == file->path) {
+		perror("strdup");
+		if (p != empty_file) {
+			munmap(p, (size_t) st.st_size);
+		}
+		return -1;
+	}
+	file->data = (const unsigned char *) p;
+	file->len = (size_t) st.st_size;
+	num_files++;
+	return 0;
+}
+
+/**
+ * Add each regular file found while walking a corpus directory.
+ */
+static int
+walk_entry(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+	if (FTW_F == type && S_ISREG(st->st_mode)) {
+		return add_file(path);
+	}
+	if (FTW_DNR == type || FTW_NS == type) {
+		fprintf(stderr, "%s: Cannot read\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+static int
+compare_paths(const void *a, const void *b)
+{
+	return strcmp(((const struct corpus_file *) a)->path, ((const struct corpus_file *) b)->path);
+}
+
+/**
+ * Load the given file, or every regular file beneath the given directory, as the corpus,
+ * sharded across the given number of Swift threads.
+ * Files are ordered by path, so that each thread puts the same files on every run.
+ * Must be called before any thread generates test data. Returns zero on success.
+ */
+int
+corpus_load(const char *path, int is_dir, unsigned int num_threads)
+{
+	int ret;
+
+	corpus_free();
+	if (is_dir) {
+		ret = nftw(path, walk_entry, WALK_MAX_FDS, FTW_PHYS);
+		if (ret < 0) {
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		}
+	} else {
+		ret = add_file(path);
+	}
+	if (0 == ret && 0 == num_files) {
+		fprintf(stderr, "%s: No regular files\n", path);
+		ret = -1;
+	}
+	if (0 != ret) {
+		corpus_free();
+		return -1;
+	}
+	qsort(files, num_files, sizeof(*files), compare_paths);
+	corpus_threads = num_threads;
+	return 0;
+}
+
+/**
+ * Unmap and forget every file of the corpus. Must not be called while any thread uses the corpus.
+ */
+void
+corpus_free(void)
+{
+	size_t i;
+
+	for (i = 0; i < num_files; i++) {
+		if (files[i].data != empty_file) {
+			munmap((void *) files[i].data, files[i].len);
+		}
+		free((void *) files[i].path);
+	}
+	free(files);
+	files = NULL;
+	num_files = max_files = 0;
+}
+
+/**
+ * Return the file of the corpus put as the given object of the given Swift thread.
+ */
+const struct corpus_file *
+corpus_file(unsigned int thread_num, unsigned long object)
+{
+	assert(num_files > 0);
+	return &files[((unsigned long long) object * corpus_threads + thread_num - 1) % num_files];
+}
+
+/**
+ * Return the length of the longest file of the corpus.
+ */
+size_t
+corpus_max_len(void)
+{
+	size_t i, len = 0;
+
+	for (i = 0; i < num_files; i++) {
+		if (files[i].len > len) {
+			len = files[i].len;
+		}
+	}
+	return len;
+}
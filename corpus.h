@@ -0,0 +1,25 @@
+#ifndef CORPUS_H_
+#define CORPUS_H_
+
+#include <stddef.h>  /* size_t */
+
+/*
+ * Corpus of local files whose contents are put as test data, each mapped read-only into memory
+ * once and shared by all Swift threads, so that data is sent and verified straight from the mapping.
+ * Object k of Swift thread t is file (k * num_threads + t - 1) modulo the number of files, sharding
+ * the corpus across threads so that no two threads put the same file while files remain.
+ */
+
+/* A local file of the corpus */
+struct corpus_file {
+	const char *path;          /* Path of the file */
+	const unsigned char *data; /* Read-only mapping of the file's contents; never NULL, even if empty */
+	size_t len;                /* Length of the file */
+};
+
+int corpus_load(const char *path, int is_dir, unsigned int num_threads);
+void corpus_free(void);
+const struct corpus_file *corpus_file(unsigned int thread_num, unsigned long object);
+size_t corpus_max_len(void);
+
+#endif /* CORPUS_H_ */
@@ -0,0 +1,175 @@
+/*
+ * data-bench.c
+ *
+ * Microbenchmark of test data generation and verification, free of any network or Swift
+ * server, to show how fast each thread can supply and check object data.
+ */
+
+#include <stdio.h>   /* fprintf, perror */
+#include <stdlib.h>  /* malloc, free */
+#include <string.h>  /* memset */
+#include <pthread.h> /* pthread_* */
+#include <curl/curl.h> /* CURL_MAX_WRITE_SIZE */
+
+#include "data-bench.h"
+#include "test-data.h"
+#include "swift-thread.h"
+
+/* In/out parameters to a benchmark thread */
+struct bench_thread_args {
+	pthread_t thread_id;           /* pthread thread ID */
+	unsigned int thread_num;       /* Benchmark thread index */
+	enum test_data_type type;      /* Type of test data */
+	size_t object_size;            /* Length of each object */
+	unsigned int num_objects;      /* Number of objects to generate, then verify */
+	enum verify_mode verify;       /* Whether and how to verify, as well as generate */
+	int failed;                    /* Whether verification failed */
+};
+
+/**
+ * Generate or verify the thread's objects, in pieces of the size which libcurl passes to its callbacks.
+ * Verifying a hash hashes the data both as it is generated and as it is verified, as a put and a get would.
+ */
+static void *
+bench_thread_func(void *arg)
+{
+	struct bench_thread_args *args = (struct bench_thread_args *) arg;
+	char *buf;
+	unsigned int object;
+
+	buf = (char *) malloc(CURL_MAX_WRITE_SIZE);
+	if (NULL == buf) {
+		args->failed = 1;
+		return NULL;
+	}
+
+	for (object = 0; object < args->num_objects && !args->failed; object++) {
+		struct supply_data_args supply_args;
+		struct compare_data_args compare_args;
+
+		test_data_source_init(&supply_args.source, args->type, args->thread_num, object);
+		supply_args.hash = (VERIFY_HASH == args->verify);
+		supply_args.crc = 0;
+		supply_args.len = args->object_size;
+		supply_args.off = 0;
+		compare_args.swift = NULL;
+		compare_args.source = supply_args.source;
+		compare_args.mode = args->verify;
+		compare_args.crc = 0;
+		compare_args.len = args->object_size;
+		compare_args.off = 0;
+
+		while (supply_args.off < supply_args.len) {
+			size_t n = supply_data(buf, 1, CURL_MAX_WRITE_SIZE, &supply_args);
+			if (VERIFY_NONE != args->verify && compare_data(buf, 1, n, &compare_args) != n) {
+				args->failed = 1;
+				break;
+			}
+		}
+		if (VERIFY_NONE != args->verify && !compare_data_complete(&compare_args, supply_args.crc)) {
+			args->failed = 1;
+		}
+	}
+
+	free(buf);
+	return NULL;
+}
+
+/**
+ * Run one measurement across all threads, returning the elapsed time in seconds, or a negative value on failure.
+ */
+static double
+run_measurement(struct bench_thread_args *args, unsigned int num_threads, enum test_data_type type, enum verify_mode verify)
+{
+	uint64_t start;
+	unsigned int i;
+	int ret, failed = 0;
+
+	start = swift_clock_nanosecs();
+	for (i = 0; i < num_threads; i++) {
+		args[i].type = type;
+		args[i].verify = verify;
+		args[i].failed = 0;
+		ret = pthread_create(&args[i].thread_id, NULL, bench_thread_func, &args[i]);
+		if (ret != 0) {
+			perror("pthread_create");
+			return -1;
+		}
+	}
+	for (i = 0; i < num_threads; i++) {
+		pthread_join(args[i].thread_id, NULL);
+		failed |= args[i].failed;
+	}
+	return failed ? -1 : (swift_clock_nanosecs() - start) / 1e9;
+}
+
+/**
+ * Measure the rate at which num_threads threads each generate, then generate and verify, then generate and hash,
+ * num_objects objects of each type of test data.
+ * Returns EXIT_SUCCESS, or EXIT_FAILURE if any verification failed.
+ */
+int
+run_data_benchmark(unsigned int num_threads, size_t object_size, unsigned int num_objects)
+{
+	static const struct {
+		const char *name;
+		enum test_data_type type;
+		int portable;
+		int shared;
+	} cases[] = {
+		{ "simple-text", SIMPLE_TEXT,   0, 0 },
+		{ "simple-text", SIMPLE_TEXT,   0, 1 },
+		{ "zeroes",      ALL_ZEROES,    0, 0 },
+		{ "random",      PSEUDO_RANDOM, 1, 0 },
+		{ "random",      PSEUDO_RANDOM, 0, 0 },
+		{ "random",      PSEUDO_RANDOM, 0, 1 }
+	};
+	struct bench_thread_args *args;
+	double total = (double) object_size * num_objects * num_threads;
+	unsigned int i, c;
+	int ret = EXIT_SUCCESS;
+
+	args = (struct bench_thread_args *) calloc(num_threads, sizeof(*args));
+	if (NULL == args) {
+		perror("calloc");
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < num_threads; i++) {
+		args[i].thread_num = i + 1;
+		args[i].object_size = object_size;
+		args[i].num_objects = num_objects;
+	}
+
+	fprintf(stderr, "Test data rates for %u threads, each of %u objects of %lu bytes (GB/s):\n", num_threads, num_objects, (unsigned long) object_size);
+	for (c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+		double gen_secs, verify_secs, hash_secs;
+		const char *kernel;
+
+		test_data_init(cases[c].portable);
+		if (cases[c].shared && 0 != test_data_share(cases[c].type, object_size)) {
+			ret = EXIT_FAILURE;
+			continue;
+		}
+		kernel = cases[c].shared ? "shared" : test_data_kernel_name();
+		gen_secs = run_measurement(args, num_threads, cases[c].type, VERIFY_NONE);
+		verify_secs = run_measurement(args, num_threads, cases[c].type, VERIFY_DATA);
+		hash_secs = run_measurement(args, num_threads, cases[c].type, VERIFY_HASH);
+		test_data_unshare();
+		if (gen_secs < 0 || verify_secs < 0 || hash_secs < 0) {
+			fprintf(stderr, "%11s (%-6s): verification failed\n", cases[c].name, kernel);
+			ret = EXIT_FAILURE;
+			continue;
+		}
+		fprintf(stderr, "%11s (%-6s): generate %8.3f  generate+verify %8.3f  generate+hash (%s) %8.3f\n",
+			cases[c].name, kernel,
+			(gen_secs > 0) ? total / gen_secs / 1e9 : 0.0,
+			(verify_secs > 0) ? total / verify_secs / 1e9 : 0.0,
+			test_data_crc_kernel_name(),
+			(hash_secs > 0) ? total / hash_secs / 1e9 : 0.0
+		);
+	}
+	test_data_init(0);
+
+	free(args);
+	return ret;
+}
@@ -0,0 +1,8 @@
+#ifndef DATA_BENCH_H_
+#define DATA_BENCH_H_
+
+#include <stddef.h>  /* size_t */
+
+int run_data_benchmark(unsigned int num_threads, size_t object_size, unsigned int num_objects);
+
+#endif /* DATA_BENCH_H_ */
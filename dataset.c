@@ -0,0 +1,239 @@
+#define _GNU_SOURCE /* asprintf */
+#include <stdio.h>    /* fprintf, fopen, fwrite */
+#include <stdlib.h>   /* free, mkstemp */
+#include <string.h>   /* memcpy, memset, strcmp, strerror, strlen */
+#include <errno.h>    /* errno */
+#include <unistd.h>   /* close, unlink */
+#include <fcntl.h>    /* open */
+#include <sys/mman.h> /* mmap, munmap */
+#include <sys/stat.h> /* fstat, fchmod */
+
+#include "dataset.h"
+#include "swift-http.h"
+
+/* "SWDATSET", identifying a manifest */
+#define DATASET_MAGIC 0x5357444154534554ULL
+/* Version of the manifest's layout */
+#define DATASET_VERSION 1
+
+/**
+ * Fill in the header of a manifest of the given options.
+ */
+static void
+init_header(struct dataset_header *h, const struct dataset_config *config)
+{
+	memset(h, 0, sizeof(*h));
+	h->magic = DATASET_MAGIC;
+	h->version = DATASET_VERSION;
+	h->record_size = sizeof(struct dataset_object);
+	h->data_type = config->data_type;
+	h->hashed = config->hashed;
+	h->num_threads = config->num_threads;
+	h->first_thread = config->first_thread;
+	h->num_containers = config->num_containers;
+	h->num_objects = config->num_objects;
+	h->data_size = config->data_size;
+	strncpy(h->data_name, config->data_name, sizeof(h->data_name) - 1);
+	strncpy(h->swift_url, config->swift_url, sizeof(h->swift_url) - 1);
+}
+
+/**
+ * Return whether the given header of a manifest matches the given options, explaining why not if not.
+ */
+static int
+header_matches(const char *path, const struct dataset_header *h, const struct dataset_config *config)
+{
+	struct dataset_header want;
+
+	init_header(&want, config);
+	if (h->magic != want.magic || h->version != want.version || h->record_size != want.record_size) {
+		fprintf(stderr, "%s: not a dataset manifest of this version\n", path);
+	} else if (h->data_type != want.data_type || 0 != strcmp(h->data_name, want.data_name)) {
+		fprintf(stderr, "%s: dataset holds %s data, not %s\n", path, h->data_name, want.data_name);
+	} else if (h->num_threads != want.num_threads || h->first_thread != want.first_thread) {
+		fprintf(stderr, "%s: dataset is of Swift threads %u to %u, not %u to %u\n", path,
+			h->first_thread, h->first_thread + h->num_threads - 1, want.first_thread, want.first_thread + want.num_threads - 1);
+	} else if (h->num_containers != want.num_containers || h->num_objects != want.num_objects) {
+		fprintf(stderr, "%s: dataset has %u containers and %llu objects per Swift thread, not %u and %llu\n", path,
+			h->num_containers, (unsigned long long) h->num_objects, want.num_containers, (unsigned long long) want.num_objects);
+	} else if (h->data_size != want.data_size) {
+		fprintf(stderr, "%s: dataset's objects are of size %llu, not %llu\n", path, (unsigned long long) h->data_size, (unsigned long long) want.data_size);
+	} else if (want.hashed && !h->hashed) {
+		fprintf(stderr, "%s: dataset has no hashes against which to verify data\n", path);
+	} else if (0 != strcmp(h->swift_url, want.swift_url)) {
+		fprintf(stderr, "%s: dataset is held at %s, not %s\n", path, h->swift_url, want.swift_url);
+	} else {
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * Load the manifest at the given path, which must match the given options, copying the record of each object
+ * of every Swift thread into objects and, if crcs is not NULL, each object's CRC-32C into crcs, each an array of
+ * num_threads * num_objects. Returns zero on success, or else -1 having explained why.
+ */
+int
+dataset_load(const char *path, const struct dataset_config *config, struct dataset_object *objects, uint32_t *crcs)
+{
+	const struct dataset_header *h;
+	const struct dataset_object *records;
+	size_t count = (size_t) config->num_threads * config->num_objects, i;
+	struct stat st;
+	void *map;
+	int fd, ret = -1;
+
+	if (strlen(config->data_name) >= DATASET_NAME_MAX || strlen(config->swift_url) >= DATASET_URL_MAX) {
+		fprintf(stderr, "%s: test data name or Swift URL too long to record\n", path);
+		return -1;
+	}
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0 || 0 != fstat(fd, &st)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+		}
+		return -1;
+	}
+	if ((size_t) st.st_size != sizeof(*h) + count * sizeof(*records)) {
+		fprintf(stderr, "%s: not a dataset manifest of %zu objects\n", path, count);
+		close(fd);
+		return -1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (MAP_FAILED == map) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	h = (const struct dataset_header *) map;
+	records = (const struct dataset_object *) (h + 1);
+	if (header_matches(path, h, config)) {
+		memcpy(objects, records, count * sizeof(*records));
+		for (i = 0; crcs && i < count; i++) {
+			crcs[i] = records[i].crc;
+		}
+		ret = 0;
+	}
+	munmap(map, st.st_size);
+	return ret;
+}
+
+/**
+ * Write a manifest of the given options and records of every object of every Swift thread to the given path,
+ * replacing any there only once it is complete. Returns zero on success, or else -1 having explained why.
+ */
+int
+dataset_save(const char *path, const struct dataset_config *config, const struct dataset_object *objects)
+{
+	size_t count = (size_t) config->num_threads * config->num_objects;
+	struct dataset_header h;
+	char *tmp_path;
+	FILE *f;
+	int fd, ok;
+
+	if (strlen(config->data_name) >= DATASET_NAME_MAX || strlen(config->swift_url) >= DATASET_URL_MAX) {
+		fprintf(stderr, "%s: test data name or Swift URL too long to record\n", path);
+		return -1;
+	}
+	init_header(&h, config);
+	if (-1 == asprintf(&tmp_path, "%s.XXXXXX", path)) {
+		fputs("Out of memory saving dataset\n", stderr);
+		return -1;
+	}
+	/* mkstemp creates the file with permissions 0600, though a manifest holds nothing secret */
+	fd = mkstemp(tmp_path);
+	if (fd < 0 || 0 != fchmod(fd, 0644) || NULL == (f = fdopen(fd, "w"))) {
+		fprintf(stderr, "%s: %s\n", tmp_path, strerror(errno));
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmp_path);
+		}
+		free(tmp_path);
+		return -1;
+	}
+	ok = (1 == fwrite(&h, sizeof(h), 1, f) && count == fwrite(objects, sizeof(*objects), count, f));
+	ok = (0 == fclose(f)) && ok;
+	if (!ok || 0 != rename(tmp_path, path)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		unlink(tmp_path);
+		free(tmp_path);
+		return -1;
+	}
+	free(tmp_path);
+	return 0;
+}
+
+/**
+ * Set which of the given Swift thread's objects exist, and their sizes, in the given state of its mixed workload,
+ * from the records of a reused dataset.
+ */
+enum swift_error
+dataset_restore(struct swift_thread_args *args, struct workload_state *ws)
+{
+	unsigned long k;
+
+	for (k = 0; k < args->num_objects; k++) {
+		if (!args->dataset[k].present) {
+			workload_object_absent(ws, k);
+		} else if (workload_object_restore(ws, k, args->dataset[k].size)) {
+			fprintf(stderr, "Swift thread %u: object %lu has size %llu, which the workload does not give\n",
+				args->thread_num, k, (unsigned long long) args->dataset[k].size);
+			return SCERR_INVARG;
+		}
+	}
+	return SCERR_SUCCESS;
+}
+
+/**
+ * Head a sample of the given Swift thread's objects of a reused dataset, spread evenly across them, upon the given
+ * easy handle with the given authentication headers, to check that each exists with the size recorded.
+ */
+enum swift_error
+dataset_check(struct swift_thread_args *args, CURL *curl, const struct curl_slist *headers, const struct keyspace *ks)
+{
+	unsigned long samples = (args->num_objects < DATASET_SAMPLES) ? args->num_objects : DATASET_SAMPLES, i, k;
+	enum swift_error scerr = SCERR_SUCCESS;
+	curl_off_t len;
+	CURLcode res;
+
+	for (i = 0; i < samples && SCERR_SUCCESS == scerr; i++) {
+		k = (unsigned long) ((double) i * args->num_objects / samples);
+		if (!args->dataset[k].present) {
+			continue; /* Deleted by a mixed workload */
+		}
+		scerr = swift_http_prepare(&args->swift, curl, SWIFT_HTTP_HEAD, keyspace_object_url(ks, k), headers, args->proxy, args->debug);
+		if (SCERR_SUCCESS == scerr) {
+			scerr = swift_http_result(&args->swift, curl, curl_easy_perform(curl));
+		}
+		if (SCERR_SUCCESS == scerr) {
+			res = curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &len);
+			if (CURLE_OK != res) {
+				args->swift.curl_error("curl_easy_getinfo", res);
+				scerr = SCERR_INVARG;
+			} else if ((uint64_t) len != args->dataset[k].size) {
+				fprintf(stderr, "Swift thread %u: object %lu has size %lld, not %llu as recorded in the dataset\n",
+					args->thread_num, k, (long long) len, (unsigned long long) args->dataset[k].size);
+				scerr = SCERR_URL_FAILED; /* Not the right error code, but swift client should not know about datasets */
+			}
+		}
+	}
+	return scerr;
+}
+
+/**
+ * Record which of the given Swift thread's objects exist as it ends, their sizes and, if verifying hashes,
+ * their CRC-32Cs, given the state of its mixed workload, or NULL if it has none.
+ */
+void
+dataset_record(struct swift_thread_args *args, const struct workload_state *ws)
+{
+	unsigned long k;
+
+	for (k = 0; k < args->num_objects; k++) {
+		struct dataset_object *o = &args->dataset[k];
+		o->present = (NULL == ws || workload_object_present(ws, k));
+		o->size = o->present ? swift_thread_object_len(args, k, ws ? workload_object_size(ws, k) : args->data_size) : 0;
+		o->crc = (o->present && args->object_crcs) ? args->object_crcs[k] : 0;
+	}
+}
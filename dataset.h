@@ -0,0 +1,69 @@
+#ifndef DATASET_H_
+#define DATASET_H_
+
+#include <stdint.h>  /* uint32_t, uint64_t */
+#include <curl/curl.h>
+
+#include "swift-thread.h"
+
+/*
+ * Datasets kept from one run for reuse by later runs, so that a run need not put every object before it
+ * measures, nor delete every object after. A run which keeps its dataset leaves its containers and objects
+ * in place, and writes a manifest of them: a fixed header, describing the run's Swift threads and their test
+ * data, then a flat array of one record per object, of its size and CRC-32C, in thread order, so that the
+ * file may be mapped as it is. The names of the containers and objects follow from the thread numbers and
+ * counts in the header, as in every run. A run which reuses a dataset checks that the manifest matches its
+ * own options, then, instead of putting every object, heads a sample of the objects of each Swift thread to
+ * check that they are as recorded, and takes the sizes and CRCs of all from the manifest.
+ */
+
+/* Number of objects of each Swift thread headed to check a reused dataset */
+#define DATASET_SAMPLES 32
+/* Longest test data name, and account URL, recorded in a manifest, including the terminating NUL */
+#define DATASET_NAME_MAX 256
+#define DATASET_URL_MAX 1024
+
+/* Header of a manifest, at its start */
+struct dataset_header {
+	uint64_t magic;                  /* DATASET_MAGIC, as written by the host; a file of other byte order does not match */
+	uint32_t version;                /* DATASET_VERSION */
+	uint32_t record_size;            /* Size of struct dataset_object */
+	uint32_t data_type;              /* Type of test data, one of enum test_data_type */
+	uint32_t hashed;                 /* Whether the CRC-32C of each object is recorded */
+	uint32_t num_threads;            /* Number of Swift threads whose objects are recorded */
+	uint32_t first_thread;           /* Number of the first of them; the rest follow in order */
+	uint32_t num_containers;         /* Number of containers of each Swift thread */
+	uint32_t reserved;               /* Zero */
+	uint64_t num_objects;            /* Number of objects of each Swift thread */
+	uint64_t data_size;              /* Default size of each object */
+	char data_name[DATASET_NAME_MAX]; /* Test data, as given to --data */
+	char swift_url[DATASET_URL_MAX]; /* Swift account URL holding the containers */
+};
+
+/* Record of one object, of which a manifest holds num_threads * num_objects after its header */
+struct dataset_object {
+	uint64_t size;                   /* Length of the object's data, or zero if absent */
+	uint32_t crc;                    /* CRC-32C of the object's data, if hashed */
+	uint32_t present;                /* Whether the object exists */
+};
+
+/* Options of a run which a dataset must match to be reused */
+struct dataset_config {
+	enum test_data_type data_type;   /* Type of test data */
+	const char *data_name;           /* Test data, as given to --data */
+	const char *swift_url;           /* Swift account URL */
+	unsigned int num_threads;        /* Number of Swift threads of this process */
+	unsigned int first_thread;       /* Number of the first of them */
+	unsigned int num_containers;     /* Number of containers of each Swift thread */
+	unsigned long num_objects;       /* Number of objects of each Swift thread */
+	size_t data_size;                /* Default size of each object */
+	unsigned int hashed;             /* Whether CRC-32Cs are needed, or to be recorded */
+};
+
+int dataset_load(const char *path, const struct dataset_config *config, struct dataset_object *objects, uint32_t *crcs);
+int dataset_save(const char *path, const struct dataset_config *config, const struct dataset_object *objects);
+enum swift_error dataset_restore(struct swift_thread_args *args, struct workload_state *ws);
+enum swift_error dataset_check(struct swift_thread_args *args, CURL *curl, const struct curl_slist *headers, const struct keyspace *ks);
+void dataset_record(struct swift_thread_args *args, const struct workload_state *ws);
+
+#endif /* DATASET_H_ */
@@ -0,0 +1,201 @@
+#include <string.h>  /* memset */
+#include <math.h>    /* ceil */
+
+#include "histogram.h"
+
+/**
+ * Return the index of the bucket in which the given value is counted.
+ */
+static unsigned int
+bucket_index(uint64_t value)
+{
+	unsigned int shift;
+
+	if (value < 2 * HISTOGRAM_HALF_SUB_BUCKETS) {
+		return (unsigned int) value;
+	}
+	/* Shift the value so that its most significant bit lands at bit (HISTOGRAM_SUB_BUCKET_BITS - 1) */
+	shift = (63 - __builtin_clzll(value)) - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+	return (shift + 1) * HISTOGRAM_HALF_SUB_BUCKETS + (unsigned int) ((value >> shift) - HISTOGRAM_HALF_SUB_BUCKETS);
+}
+
+/**
+ * Return the largest value which would be counted in the bucket with the given index.
+ */
+static uint64_t
+bucket_highest_value(unsigned int index)
+{
+	unsigned int shift;
+	uint64_t sub_bucket;
+
+	if (index < 2 * HISTOGRAM_HALF_SUB_BUCKETS) {
+		return index;
+	}
+	shift = index / HISTOGRAM_HALF_SUB_BUCKETS - 1;
+	sub_bucket = index % HISTOGRAM_HALF_SUB_BUCKETS + HISTOGRAM_HALF_SUB_BUCKETS;
+	return ((sub_bucket + 1) << shift) - 1;
+}
+
+/**
+ * Return the value reported for values counted in the bucket with the given index: the largest value which it counts.
+ */
+uint64_t
+histogram_bucket_value(unsigned int index)
+{
+	return bucket_highest_value(index);
+}
+
+void
+histogram_init(struct histogram *h)
+{
+	memset(h, 0, sizeof(*h));
+	h->min = UINT64_MAX;
+}
+
+void
+histogram_record(struct histogram *h, uint64_t value)
+{
+	h->buckets[bucket_index(value)]++;
+	h->count++;
+	h->sum += value;
+	if (value < h->min) {
+		h->min = value;
+	}
+	if (value > h->max) {
+		h->max = value;
+	}
+}
+
+/* Store the given value into the given field of a histogram being read by other threads */
+#define STORE_SHARED(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+/**
+ * Record the given value into a histogram owned by the calling thread, but read by others with histogram_snapshot.
+ * Each field is stored whole, so a reader never sees a torn value, yet no atomic read-modify-write is needed,
+ * as only the owning thread writes.
+ */
+void
+histogram_record_shared(struct histogram *h, uint64_t value)
+{
+	unsigned int index = bucket_index(value);
+
+	STORE_SHARED(h->buckets[index], h->buckets[index] + 1);
+	STORE_SHARED(h->count, h->count + 1);
+	STORE_SHARED(h->sum, h->sum + value);
+	if (value < h->min) {
+		STORE_SHARED(h->min, value);
+	}
+	if (value > h->max) {
+		STORE_SHARED(h->max, value);
+	}
+}
+
+/**
+ * Copy into dst a histogram being recorded into by another thread with histogram_record_shared.
+ * The copy is not of a single instant: its count may differ from the sum of its buckets by the values being recorded.
+ */
+void
+histogram_snapshot(struct histogram *dst, const struct histogram *src)
+{
+	unsigned int i;
+
+	for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		dst->buckets[i] = __atomic_load_n(&src->buckets[i], __ATOMIC_RELAXED);
+	}
+	dst->count = __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+	dst->sum = __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+	dst->min = __atomic_load_n(&src->min, __ATOMIC_RELAXED);
+	dst->max = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+}
+
+/**
+ * Add all of the values recorded in src to dst.
+ */
+void
+histogram_merge(struct histogram *dst, const struct histogram *src)
+{
+	unsigned int i;
+
+	if (0 == src->count) {
+		return;
+	}
+	for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		dst->buckets[i] += src->buckets[i];
+	}
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if (src->min < dst->min) {
+		dst->min = src->min;
+	}
+	if (src->max > dst->max) {
+		dst->max = src->max;
+	}
+}
+
+/**
+ * Remove from dst the values recorded in src, an earlier state of the same histogram, leaving those recorded since.
+ * The minimum and maximum are then those of the buckets left occupied, to within the precision of the buckets.
+ */
+void
+histogram_subtract(struct histogram *dst, const struct histogram *src)
+{
+	unsigned int i, lowest = HISTOGRAM_BUCKETS, highest = 0;
+
+	for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		dst->buckets[i] = (dst->buckets[i] > src->buckets[i]) ? dst->buckets[i] - src->buckets[i] : 0;
+		if (dst->buckets[i]) {
+			if (HISTOGRAM_BUCKETS == lowest) {
+				lowest = i;
+			}
+			highest = i;
+		}
+	}
+	dst->count = (dst->count > src->count) ? dst->count - src->count : 0;
+	dst->sum = (dst->sum > src->sum) ? dst->sum - src->sum : 0;
+	if (HISTOGRAM_BUCKETS == lowest) {
+		dst->min = UINT64_MAX;
+		dst->max = 0;
+	} else {
+		dst->min = (0 == lowest) ? 0 : bucket_highest_value(lowest - 1) + 1;
+		dst->max = bucket_highest_value(highest);
+	}
+}
+
+/**
+ * Return the value at or below which the given percentage of recorded values lie,
+ * to within the precision of the histogram's buckets. Returns zero if no values have been recorded.
+ */
+uint64_t
+histogram_percentile(const struct histogram *h, double percentile)
+{
+	uint64_t rank, seen = 0;
+	unsigned int i;
+
+	if (0 == h->count) {
+		return 0;
+	}
+	if (percentile >= 100.0) {
+		return h->max;
+	}
+	rank = (uint64_t) ceil(percentile / 100.0 * h->count);
+	if (rank < 1) {
+		rank = 1;
+	}
+	for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen >= rank) {
+			uint64_t value = bucket_highest_value(i);
+			return (value > h->max) ? h->max : value;
+		}
+	}
+	return h->max;
+}
+
+double
+histogram_mean(const struct histogram *h)
+{
+	if (0 == h->count) {
+		return 0.0;
+	}
+	return (double) h->sum / h->count;
+}
@@ -0,0 +1,37 @@
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <stdint.h> /* uint64_t */
+
+/*
+ * Log-bucketed (HDR-style) histogram of non-negative integer values.
+ * Values below 2^HISTOGRAM_SUB_BUCKET_BITS are counted exactly; larger values
+ * are counted in buckets whose width is 1/2^(HISTOGRAM_SUB_BUCKET_BITS - 1)
+ * of the value, i.e. with a relative error of under 1.6%.
+ * A histogram is owned by a single thread, so recording takes no locks.
+ * One which other threads read while it is recorded into is recorded into with histogram_record_shared,
+ * and read with histogram_snapshot.
+ */
+#define HISTOGRAM_SUB_BUCKET_BITS 7
+#define HISTOGRAM_HALF_SUB_BUCKETS (1U << (HISTOGRAM_SUB_BUCKET_BITS - 1))
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BUCKET_BITS + 2) * HISTOGRAM_HALF_SUB_BUCKETS)
+
+struct histogram {
+	uint64_t count;                      /* Number of values recorded */
+	uint64_t sum;                        /* Sum of all values recorded */
+	uint64_t min;                        /* Smallest value recorded, or UINT64_MAX if none */
+	uint64_t max;                        /* Largest value recorded */
+	uint64_t buckets[HISTOGRAM_BUCKETS]; /* Count of values recorded in each bucket */
+};
+
+void histogram_init(struct histogram *h);
+void histogram_record(struct histogram *h, uint64_t value);
+void histogram_record_shared(struct histogram *h, uint64_t value);
+void histogram_snapshot(struct histogram *dst, const struct histogram *src);
+void histogram_merge(struct histogram *dst, const struct histogram *src);
+void histogram_subtract(struct histogram *dst, const struct histogram *src);
+uint64_t histogram_percentile(const struct histogram *h, double percentile);
+double histogram_mean(const struct histogram *h);
+uint64_t histogram_bucket_value(unsigned int index);
+
+#endif /* HISTOGRAM_H_ */
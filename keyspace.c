@@ -0,0 +1,387 @@
+#include <stdio.h>   /* snprintf */
+#include <stdlib.h>  /* malloc, realloc, free, strtod */
+#include <string.h>  /* strncmp, strlen */
+#include <math.h>    /* exp, log, expm1, log1p */
+#include <assert.h>  /* assert */
+
+#include "keyspace.h"
+#include "prng.h"
+
+/* Longest container or object name generated */
+#define NAME_MAX_LEN 64
+/* Default Zipf exponent, if none given */
+#define ZIPF_SKEW_DEFAULT 0.99
+/* Default hot set size and share of operations, if none given */
+#define HOT_FRACTION_DEFAULT 0.2
+#define HOT_OPS_FRACTION_DEFAULT 0.8
+
+/**
+ * Parse a key distribution of the form "uniform", "sequential", "zipf[:<skew>]" or "hotset[:<fraction>[:<ops-fraction>]]".
+ * Returns zero on success.
+ */
+int
+parse_key_distribution(const char *text, struct key_distribution_spec *spec)
+{
+	char *end;
+
+	spec->zipf_skew = ZIPF_SKEW_DEFAULT;
+	spec->hot_fraction = HOT_FRACTION_DEFAULT;
+	spec->hot_ops_fraction = HOT_OPS_FRACTION_DEFAULT;
+
+	if (0 == strcmp(text, "uniform")) {
+		spec->type = KEY_UNIFORM;
+	} else if (0 == strcmp(text, "sequential")) {
+		spec->type = KEY_SEQUENTIAL;
+	} else if (0 == strncmp(text, "zipf", 4) && ('\0' == text[4] || ':' == text[4])) {
+		spec->type = KEY_ZIPF;
+		if (':' == text[4]) {
+			spec->zipf_skew = strtod(text + 5, &end);
+			if (*end || !(spec->zipf_skew > 0)) {
+				return -1;
+			}
+		}
+	} else if (0 == strncmp(text, "hotset", 6) && ('\0' == text[6] || ':' == text[6])) {
+		spec->type = KEY_HOTSET;
+		if (':' == text[6]) {
+			spec->hot_fraction = strtod(text + 7, &end);
+			if (':' == *end) {
+				spec->hot_ops_fraction = strtod(end + 1, &end);
+			}
+			if (*end || !(spec->hot_fraction > 0 && spec->hot_fraction <= 1) || !(spec->hot_ops_fraction >= 0 && spec->hot_ops_fraction <= 1)) {
+				return -1;
+			}
+		}
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Append the URL-encoded form of the given name to the buffer, which must have room for three times its length.
+ * Returns the number of characters appended.
+ */
+static size_t
+url_encode(const char *name, char *buf)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	char *p = buf;
+
+	for (; *name; name++) {
+		unsigned char c = (unsigned char) *name;
+		if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || '-' == c || '_' == c || '.' == c || '~' == c) {
+			*p++ = c;
+		} else {
+			*p++ = '%';
+			*p++ = hex[c >> 4];
+			*p++ = hex[c & 0xF];
+		}
+	}
+	return p - buf;
+}
+
+static void
+gen_container_name(unsigned int thread_num, unsigned int num_containers, unsigned int container, char *name)
+{
+	if (1 == num_containers) {
+		/* Same name as used before there could be more than one container per thread */
+		snprintf(name, NAME_MAX_LEN, "Container %u", thread_num);
+	} else {
+		snprintf(name, NAME_MAX_LEN, "Container %u-%u", thread_num, container);
+	}
+}
+
+static void
+gen_object_name(unsigned int thread_num, unsigned long num_objects, unsigned long object, char *name)
+{
+	if (1 == num_objects) {
+		/* Same name as used before there could be more than one object per thread */
+		snprintf(name, NAME_MAX_LEN, "Object %u", thread_num);
+	} else {
+		snprintf(name, NAME_MAX_LEN, "Object %u-%lu", thread_num, object);
+	}
+}
+
+/**
+ * Ensure the given flat table has room for len more elements of the given size beyond used.
+ * Returns zero on success.
+ */
+static int
+reserve_table(void **table, size_t *cap, size_t used, size_t len, size_t elem_size)
+{
+	void *new_table;
+	size_t new_cap = *cap ? *cap : 4096;
+
+	if (used + len <= *cap) {
+		return 0;
+	}
+	while (new_cap < used + len) {
+		new_cap *= 2;
+	}
+	new_table = realloc(*table, new_cap * elem_size);
+	if (NULL == new_table) {
+		return -1;
+	}
+	*table = new_table;
+	*cap = new_cap;
+	return 0;
+}
+
+/**
+ * Generate the names and/or URLs of a thread's containers and objects.
+ */
+enum swift_error
+keyspace_init(struct keyspace *ks, unsigned int tables, unsigned int thread_num, unsigned int num_containers, unsigned long num_objects, const char *swift_url)
+{
+	size_t names_cap = 0, names_used = 0, urls_cap = 0, urls_used = 0;
+	size_t swift_url_len = swift_url ? strlen(swift_url) : 0;
+	size_t entries = num_containers + num_objects, i;
+	char name[NAME_MAX_LEN];
+	char encoded[3 * NAME_MAX_LEN];
+	size_t encoded_container_len = 0;
+
+	assert(num_containers > 0);
+	assert(num_objects > 0);
+	assert(!(tables & KEYSPACE_URLS) || swift_url != NULL);
+
+	ks->num_objects = num_objects;
+	ks->num_containers = num_containers;
+	ks->names = NULL;
+	ks->name_offsets = NULL;
+	ks->urls = NULL;
+	ks->url_offsets = NULL;
+
+	if (tables & KEYSPACE_NAMES) {
+		ks->name_offsets = (size_t *) malloc(entries * sizeof(size_t));
+		if (NULL == ks->name_offsets) {
+			return SCERR_ALLOC_FAILED;
+		}
+	}
+	if (tables & KEYSPACE_URLS) {
+		ks->url_offsets = (size_t *) malloc(entries * sizeof(size_t));
+		if (NULL == ks->url_offsets) {
+			keyspace_free(ks);
+			return SCERR_ALLOC_FAILED;
+		}
+	}
+
+	for (i = 0; i < entries; i++) {
+		int len;
+		if (i < num_containers) {
+			gen_container_name(thread_num, num_containers, i, name);
+		} else {
+			gen_object_name(thread_num, num_objects, i - num_containers, name);
+		}
+		len = strlen(name);
+
+		if (tables & KEYSPACE_NAMES) {
+			if (reserve_table((void **) &ks->names, &names_cap, names_used, len + 1, sizeof(wchar_t))) {
+				keyspace_free(ks);
+				return SCERR_ALLOC_FAILED;
+			}
+			ks->name_offsets[i] = names_used;
+			names_used += swprintf(ks->names + names_used, len + 1, L"%s", name) + 1;
+		}
+
+		if (tables & KEYSPACE_URLS) {
+			/* Container URL is <swift-url>/<container>; object URL is <container-url>/<object> */
+			size_t url_len;
+			const char *container_url;
+			size_t encoded_len = url_encode(name, encoded);
+			if (i < num_containers) {
+				url_len = swift_url_len + 1 + encoded_len;
+			} else {
+				container_url = keyspace_container_url(ks, (i - num_containers) % num_containers);
+				encoded_container_len = strlen(container_url);
+				url_len = encoded_container_len + 1 + encoded_len;
+			}
+			if (reserve_table((void **) &ks->urls, &urls_cap, urls_used, url_len + 1, 1)) {
+				keyspace_free(ks);
+				return SCERR_ALLOC_FAILED;
+			}
+			ks->url_offsets[i] = urls_used;
+			if (i < num_containers) {
+				memcpy(ks->urls + urls_used, swift_url, swift_url_len);
+			} else {
+				/* Container URL must be re-fetched, as reserve_table may have moved it */
+				memcpy(ks->urls + urls_used, keyspace_container_url(ks, (i - num_containers) % num_containers), encoded_container_len);
+			}
+			ks->urls[urls_used + url_len - encoded_len - 1] = '/';
+			memcpy(ks->urls + urls_used + url_len - encoded_len, encoded, encoded_len);
+			ks->urls[urls_used + url_len] = '\0';
+			urls_used += url_len + 1;
+		}
+	}
+
+	return SCERR_SUCCESS;
+}
+
+void
+keyspace_free(struct keyspace *ks)
+{
+	free(ks->names);
+	free(ks->name_offsets);
+	free(ks->urls);
+	free(ks->url_offsets);
+	ks->names = NULL;
+	ks->name_offsets = NULL;
+	ks->urls = NULL;
+	ks->url_offsets = NULL;
+}
+
+wchar_t *
+keyspace_container_name(const struct keyspace *ks, unsigned int container)
+{
+	return ks->names + ks->name_offsets[container];
+}
+
+wchar_t *
+keyspace_object_name(const struct keyspace *ks, unsigned long object)
+{
+	return ks->names + ks->name_offsets[ks->num_containers + object];
+}
+
+const char *
+keyspace_container_url(const struct keyspace *ks, unsigned int container)
+{
+	return ks->urls + ks->url_offsets[container];
+}
+
+const char *
+keyspace_object_url(const struct keyspace *ks, unsigned long object)
+{
+	return ks->urls + ks->url_offsets[ks->num_containers + object];
+}
+
+/**
+ * Write into name the part common to the names of those of the given thread's objects whose numbers
+ * begin with the given digits, or the name of its only object if it has one, for use as the prefix
+ * of a listing of the thread's containers.
+ */
+void
+keyspace_object_prefix(unsigned int thread_num, unsigned long num_objects, const char *digits, char *name, size_t len)
+{
+	if (1 == num_objects) {
+		snprintf(name, len, "Object %u", thread_num);
+	} else {
+		snprintf(name, len, "Object %u-%s", thread_num, digits);
+	}
+}
+
+/**
+ * Return the index of the container which holds the given object.
+ */
+unsigned int
+keyspace_object_container(const struct keyspace *ks, unsigned long object)
+{
+	return object % ks->num_containers;
+}
+
+/*
+ * Zipf sampling by rejection-inversion (Hörmann and Derflinger, 1996), which takes constant
+ * time and space however many keys there are, for any positive exponent.
+ */
+
+/* (exp(x) - 1) / x, accurate near zero */
+static double
+helper2(double x)
+{
+	return (fabs(x) > 1e-8) ? expm1(x) / x : 1.0 + x / 2.0 * (1.0 + x / 3.0 * (1.0 + x / 4.0));
+}
+
+/* log(1 + x) / x, accurate near zero */
+static double
+helper1(double x)
+{
+	return (fabs(x) > 1e-8) ? log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+static double
+zipf_h(double skew, double x)
+{
+	return exp(-skew * log(x));
+}
+
+static double
+zipf_h_integral(double skew, double x)
+{
+	double log_x = log(x);
+	return helper2((1.0 - skew) * log_x) * log_x;
+}
+
+static double
+zipf_h_integral_inverse(double skew, double x)
+{
+	double t = x * (1.0 - skew);
+	if (t < -1.0) {
+		t = -1.0; /* Limit value to the range [1, +inf) in case of rounding error */
+	}
+	return exp(helper1(t) * x);
+}
+
+/**
+ * Prepare to choose keys in [0, num_keys) from the given distribution, seeded so that runs are repeatable.
+ */
+void
+key_chooser_init(struct key_chooser *kc, const struct key_distribution_spec *spec, unsigned long num_keys, uint64_t seed)
+{
+	double skew = spec->zipf_skew;
+
+	assert(num_keys > 0);
+
+	kc->spec = *spec;
+	kc->num_keys = num_keys;
+	kc->rng = prng_seed(seed);
+	kc->next = 0;
+
+	kc->hot_keys = (unsigned long) (spec->hot_fraction * num_keys);
+	if (0 == kc->hot_keys) {
+		kc->hot_keys = 1;
+	}
+
+	kc->h_integral_x1 = zipf_h_integral(skew, 1.5) - 1.0;
+	kc->h_integral_n = zipf_h_integral(skew, num_keys + 0.5);
+	kc->zipf_s = 2.0 - zipf_h_integral_inverse(skew, zipf_h_integral(skew, 2.5) - zipf_h(skew, 2.0));
+}
+
+/**
+ * Choose the key addressed by the next operation.
+ */
+unsigned long
+key_chooser_next(struct key_chooser *kc)
+{
+	switch (kc->spec.type) {
+	case KEY_UNIFORM:
+		return prng_below(&kc->rng, kc->num_keys);
+	case KEY_SEQUENTIAL:
+		{
+			unsigned long key = kc->next;
+			if (++kc->next == kc->num_keys) {
+				kc->next = 0;
+			}
+			return key;
+		}
+	case KEY_HOTSET:
+		if (kc->hot_keys >= kc->num_keys || prng_double(&kc->rng) < kc->spec.hot_ops_fraction) {
+			return prng_below(&kc->rng, kc->hot_keys < kc->num_keys ? kc->hot_keys : kc->num_keys);
+		}
+		return kc->hot_keys + prng_below(&kc->rng, kc->num_keys - kc->hot_keys);
+	case KEY_ZIPF:
+		for (;;) {
+			double skew = kc->spec.zipf_skew;
+			double u = kc->h_integral_n + prng_double(&kc->rng) * (kc->h_integral_x1 - kc->h_integral_n);
+			double x = zipf_h_integral_inverse(skew, u);
+			unsigned long k = (unsigned long) (x + 0.5);
+			if (k < 1) {
+				k = 1;
+			} else if (k > kc->num_keys) {
+				k = kc->num_keys;
+			}
+			if (k - x <= kc->zipf_s || u >= zipf_h_integral(skew, k + 0.5) - zipf_h(skew, k)) {
+				return k - 1; /* Rank 1, the most popular, is key zero */
+			}
+		}
+	}
+	assert(0);
+	return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef KEYSPACE_H_
+#define KEYSPACE_H_
+
+#include <stdint.h>  /* uint64_t */
+#include <wchar.h>   /* wchar_t */
+
+#include "swift-client.h"
+
+/*
+ * The set of objects, spread across a set of containers, upon which a Swift thread operates,
+ * and the choice of which object each operation addresses.
+ * All names, or all URLs, are generated up front into flat tables so that addressing
+ * an object costs nothing while measuring.
+ */
+
+/* Distributions from which the object addressed by each operation may be chosen */
+enum key_distribution {
+	KEY_UNIFORM,    /* Every object equally likely */
+	KEY_ZIPF,       /* Object of popularity rank k chosen with probability proportional to 1/k^skew */
+	KEY_SEQUENTIAL, /* Each object in turn, cycling */
+	KEY_HOTSET      /* A fraction of the objects receives a (larger) fraction of operations */
+};
+
+/* Parameters of a key distribution */
+struct key_distribution_spec {
+	enum key_distribution type; /* Distribution */
+	double zipf_skew;           /* Exponent of a Zipf distribution; must be positive */
+	double hot_fraction;        /* Fraction of objects in the hot set */
+	double hot_ops_fraction;    /* Fraction of operations addressing the hot set */
+};
+
+/* Which tables a keyspace generates */
+enum keyspace_tables {
+	KEYSPACE_NAMES = 1, /* Wide-character names, for use with the Swift client library */
+	KEYSPACE_URLS = 2   /* Full URL-encoded URLs, for use with swift-http */
+};
+
+/* Objects and containers of a single Swift thread */
+struct keyspace {
+	unsigned long num_objects;     /* Number of objects */
+	unsigned int num_containers;   /* Number of containers, across which objects are spread round-robin */
+	wchar_t *names;                /* Container names followed by object names, each NUL-terminated, or NULL */
+	size_t *name_offsets;          /* Offset into names of each container name followed by each object name */
+	char *urls;                    /* Container URLs followed by object URLs, each NUL-terminated, or NULL */
+	size_t *url_offsets;           /* Offset into urls of each container URL followed by each object URL */
+};
+
+/* State of the choice of objects from a distribution */
+struct key_chooser {
+	struct key_distribution_spec spec; /* Distribution */
+	unsigned long num_keys;            /* Number of objects from which to choose */
+	uint64_t rng;                      /* Pseudo-random generator state */
+	unsigned long next;                /* Next key of a sequential distribution */
+	unsigned long hot_keys;            /* Number of objects in the hot set */
+	double h_integral_x1;              /* Zipf rejection-inversion constants */
+	double h_integral_n;
+	double zipf_s;
+};
+
+int parse_key_distribution(const char *text, struct key_distribution_spec *spec);
+enum swift_error keyspace_init(struct keyspace *ks, unsigned int tables, unsigned int thread_num, unsigned int num_containers, unsigned long num_objects, const char *swift_url);
+void keyspace_free(struct keyspace *ks);
+wchar_t *keyspace_container_name(const struct keyspace *ks, unsigned int container);
+wchar_t *keyspace_object_name(const struct keyspace *ks, unsigned long object);
+const char *keyspace_container_url(const struct keyspace *ks, unsigned int container);
+const char *keyspace_object_url(const struct keyspace *ks, unsigned long object);
+void keyspace_object_prefix(unsigned int thread_num, unsigned long num_objects, const char *digits, char *name, size_t len);
+unsigned int keyspace_object_container(const struct keyspace *ks, unsigned long object);
+void key_chooser_init(struct key_chooser *kc, const struct key_distribution_spec *spec, unsigned long num_keys, uint64_t seed);
+unsigned long key_chooser_next(struct key_chooser *kc);
+
+#endif /* KEYSPACE_H_ */
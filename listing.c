@@ -0,0 +1,419 @@
+#include <stddef.h>  /* offsetof */
+#include <stdio.h>   /* fprintf, snprintf */
+#include <stdlib.h>  /* strtoul, strtod */
+#include <string.h>  /* memcmp, memcpy, memset, strchr, strcmp, strcpy, strlen, strtok_r */
+
+#include "listing.h"
+
+/* Strings of a listing told apart by its parser */
+enum listing_string {
+	LISTING_STRING_NONE,  /* Not within a string */
+	LISTING_STRING_OTHER, /* A string of no interest */
+	LISTING_STRING_KEY,   /* A key of an entry */
+	LISTING_STRING_NAME   /* The name or subdir of an entry */
+};
+
+/**
+ * Copy the given value of a "prefix" or "delimiter" item of the "list" clause into the given room.
+ * Returns zero on success.
+ */
+static int
+parse_listing_param(const char *item, const char *value, char *param)
+{
+	if (strlen(value) >= LISTING_PARAM_MAX) {
+		fprintf(stderr, "Workload: %s of listings longer than %u characters\n", item, LISTING_PARAM_MAX - 1);
+		return -1;
+	}
+	strcpy(param, value);
+	return 0;
+}
+
+/**
+ * Parse a comma-separated list of "<name>:<value>" items of the "list" clause, whose names are limit, pages,
+ * prefix, delimiter and account, into the given parameters of listings, which hold their defaults for any not given.
+ * Returns zero on success.
+ */
+int
+parse_listing_spec(char *value, struct listing_spec *spec)
+{
+	char *item, *save = NULL;
+
+	for (item = strtok_r(value, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+		char *colon = strchr(item, ':'), *end;
+		int ret = 0;
+
+		if (NULL == colon) {
+			fprintf(stderr, "Workload: listing parameter '%s' has no value\n", item);
+			return -1;
+		}
+		*colon++ = '\0';
+		if (0 == strcmp(item, "limit")) {
+			spec->limit = strtoul(colon, &end, 10);
+			ret = (end == colon || *end || 0 == spec->limit || '-' == *colon) ? -1 : 0;
+		} else if (0 == strcmp(item, "pages")) {
+			spec->max_pages = strtoul(colon, &end, 10);
+			ret = (end == colon || *end || '-' == *colon) ? -1 : 0;
+		} else if (0 == strcmp(item, "prefix")) {
+			ret = parse_listing_param(item, colon, spec->prefix);
+		} else if (0 == strcmp(item, "delimiter")) {
+			ret = parse_listing_param(item, colon, spec->delimiter);
+		} else if (0 == strcmp(item, "account")) {
+			spec->account = strtod(colon, &end);
+			ret = (end == colon || *end || !(spec->account >= 0 && spec->account <= 1)) ? -1 : 0;
+		} else {
+			fprintf(stderr, "Workload: unrecognised listing parameter '%s'. Choices are: limit, pages, prefix, delimiter, account\n", item);
+			return -1;
+		}
+		if (ret) {
+			fprintf(stderr, "Workload: invalid value '%s' of listing parameter '%s'\n", colon, item);
+			return ret;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Start a listing of the container or account at the given URL, of the names with the given prefix,
+ * or of the account if prefix is NULL. The listing's first page is then ready to be prepared.
+ */
+void
+listing_init(struct listing *l, const struct listing_spec *spec, const char *url, const char *prefix)
+{
+	l->spec = spec;
+	l->url = url;
+	l->account = (NULL == prefix);
+	snprintf(l->prefix, sizeof(l->prefix), "%s", prefix ? prefix : "");
+	l->pages = 0;
+	l->entries = 0;
+	l->parser.marker[0] = '\0';
+}
+
+/**
+ * Append the given query parameter, percent-encoded, to the URL of the given length so far in the given room.
+ * Returns the URL's new length, or len if there is no room.
+ */
+static size_t
+append_param(char *url, size_t len, size_t room, const char *name, const char *value)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	const unsigned char *v;
+	size_t n;
+
+	n = len + snprintf(url + len, room - len, "&%s=", name);
+	for (v = (const unsigned char *) value; *v && n + 4 <= room; v++) {
+		if (('A' <= *v && *v <= 'Z') || ('a' <= *v && *v <= 'z') || ('0' <= *v && *v <= '9')
+			|| '-' == *v || '.' == *v || '_' == *v || '~' == *v) {
+			url[n++] = (char) *v;
+		} else {
+			url[n++] = '%';
+			url[n++] = hex[*v >> 4];
+			url[n++] = hex[*v & 0xF];
+		}
+	}
+	if (*v || n >= room) {
+		return len;
+	}
+	url[n] = '\0';
+	return n;
+}
+
+/**
+ * Append the given code point, decoded from an escape sequence, to the string being read.
+ * Returns zero on success, or else -1 if it may not be part of a name.
+ */
+static int
+append_code_point(struct listing_parser *p, unsigned int cp)
+{
+	unsigned char utf8[4];
+	size_t n, i;
+
+	if (0 == cp) {
+		return -1;
+	} else if (cp < 0x80) {
+		utf8[0] = (unsigned char) cp;
+		n = 1;
+	} else if (cp < 0x800) {
+		utf8[0] = (unsigned char) (0xC0 | (cp >> 6));
+		utf8[1] = (unsigned char) (0x80 | (cp & 0x3F));
+		n = 2;
+	} else if (cp < 0x10000) {
+		utf8[0] = (unsigned char) (0xE0 | (cp >> 12));
+		utf8[1] = (unsigned char) (0x80 | ((cp >> 6) & 0x3F));
+		utf8[2] = (unsigned char) (0x80 | (cp & 0x3F));
+		n = 3;
+	} else {
+		utf8[0] = (unsigned char) (0xF0 | (cp >> 18));
+		utf8[1] = (unsigned char) (0x80 | ((cp >> 12) & 0x3F));
+		utf8[2] = (unsigned char) (0x80 | ((cp >> 6) & 0x3F));
+		utf8[3] = (unsigned char) (0x80 | (cp & 0x3F));
+		n = 4;
+	}
+	for (i = 0; i < n; i++) {
+		if (LISTING_STRING_KEY == p->string) {
+			if (p->key_len < sizeof(p->key)) {
+				p->key[p->key_len] = (char) utf8[i];
+			}
+			p->key_len++;
+		} else if (LISTING_STRING_NAME == p->string) {
+			if (p->name_len + 1 >= sizeof(p->name)) {
+				return -1;
+			}
+			p->name[p->name_len++] = (char) utf8[i];
+		}
+	}
+	return 0;
+}
+
+/**
+ * Decode one hex digit of a \u escape sequence, or return -1 if it is not one.
+ */
+static int
+hex_digit(char c)
+{
+	if ('0' <= c && c <= '9') {
+		return c - '0';
+	} else if ('a' <= c && c <= 'f') {
+		return c - 'a' + 10;
+	} else if ('A' <= c && c <= 'F') {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+/**
+ * Parse one character within a string. Returns zero on success, or else -1 if the listing is malformed.
+ */
+static int
+parse_string_char(struct listing_parser *p, char c)
+{
+	static const char escapes[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
+	unsigned int cp;
+	int digit;
+
+	if (p->escape > 1) {
+		/* Within the four hex digits of a \u escape sequence */
+		digit = hex_digit(c);
+		if (digit < 0) {
+			return -1;
+		}
+		p->code_point = (p->code_point << 4) | (unsigned int) digit;
+		if (++p->escape < 6) {
+			return 0;
+		}
+		p->escape = 0;
+		cp = p->code_point;
+		if (0xD800 <= cp && cp < 0xDC00) {
+			if (p->high_surrogate) {
+				return -1;
+			}
+			p->high_surrogate = cp;
+			return 0;
+		} else if (!p->high_surrogate != !(0xDC00 <= cp && cp < 0xE000)) {
+			/* Low surrogate other than after a high one, or a high one followed by other than a low one */
+			return -1;
+		} else if (p->high_surrogate) {
+			cp = 0x10000 + ((p->high_surrogate - 0xD800) << 10) + (cp - 0xDC00);
+			p->high_surrogate = 0;
+		}
+		return append_code_point(p, cp);
+	}
+	if (p->high_surrogate && !(1 == p->escape && 'u' == c) && !(0 == p->escape && '\\' == c)) {
+		/* High surrogate not followed by a low one */
+		return -1;
+	}
+	if (1 == p->escape) {
+		const char *e;
+
+		if ('u' == c) {
+			p->escape = 2;
+			p->code_point = 0;
+			return 0;
+		}
+		for (e = escapes; *e && *e != c; e += 2)
+			;
+		if (!*e) {
+			return -1;
+		}
+		p->escape = 0;
+		return append_code_point(p, (unsigned char) e[1]);
+	}
+	if ('\\' == c) {
+		p->escape = 1;
+	} else if ('"' == c) {
+		p->string = LISTING_STRING_NONE;
+	} else if ((unsigned char) c < 0x20) {
+		return -1;
+	} else if (LISTING_STRING_KEY == p->string) {
+		if (p->key_len < sizeof(p->key)) {
+			p->key[p->key_len] = c;
+		}
+		p->key_len++;
+	} else if (LISTING_STRING_NAME == p->string) {
+		/* Bytes of UTF-8 pass through as they are */
+		if (p->name_len + 1 >= sizeof(p->name)) {
+			return -1;
+		}
+		p->name[p->name_len++] = c;
+	}
+	return 0;
+}
+
+/**
+ * Parse one character outside any string. Returns zero on success, or else -1 if the listing is malformed.
+ */
+static int
+parse_char(struct listing_parser *p, char c)
+{
+	if (' ' == c || '\t' == c || '\r' == c || '\n' == c) {
+		return 0;
+	}
+	if (p->complete || (0 == p->depth && '[' != c)) {
+		/* Anything but white space around the array */
+		return -1;
+	}
+	switch (c) {
+	case '"':
+		if (2 == p->depth && p->expect_key) {
+			p->string = LISTING_STRING_KEY;
+			p->key_len = 0;
+		} else if (2 == p->depth && p->capture) {
+			p->string = LISTING_STRING_NAME;
+			p->name_len = 0;
+		} else {
+			p->string = LISTING_STRING_OTHER;
+		}
+		break;
+	case '[':
+	case '{':
+		if (1 == p->depth && '{' != c) {
+			return -1;
+		}
+		if (1 == ++p->depth) {
+			p->expect_key = 0;
+		} else if (2 == p->depth) {
+			p->expect_key = 1;
+			p->capture = 0;
+			p->name_len = 0;
+		}
+		break;
+	case ']':
+	case '}':
+		if (2 == p->depth) {
+			/* End of an entry, which must have a name or subdir */
+			if ('}' != c || 0 == p->name_len) {
+				return -1;
+			}
+			memcpy(p->marker, p->name, p->name_len);
+			p->marker[p->name_len] = '\0';
+			p->entries++;
+		}
+		if (0 == --p->depth) {
+			p->complete = 1;
+		}
+		break;
+	case ':':
+		if (2 == p->depth) {
+			p->expect_key = 0;
+			p->capture = (4 == p->key_len && 0 == memcmp(p->key, "name", 4))
+				|| (6 == p->key_len && 0 == memcmp(p->key, "subdir", 6));
+		}
+		break;
+	case ',':
+		if (2 == p->depth) {
+			p->expect_key = 1;
+			p->capture = 0;
+		}
+		break;
+	}
+	return 0;
+}
+
+/**
+ * Receive part of a page of a listing from curl, parsing it as it arrives.
+ * Returns the number of bytes taken, or zero to fail the transfer if the page is not a listing.
+ */
+static size_t
+parse_page(char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	struct listing_parser *p = (struct listing_parser *) userdata;
+	size_t len = size * nmemb, i;
+
+	p->bytes += len;
+	for (i = 0; i < len && !p->failed; i++) {
+		if (LISTING_STRING_NONE == p->string) {
+			p->failed = (0 != parse_char(p, ptr[i]));
+		} else {
+			p->failed = (0 != parse_string_char(p, ptr[i]));
+		}
+	}
+	return p->failed ? 0 : len;
+}
+
+/**
+ * Prepare the given easy handle to get the next page of the given listing, with the given authentication headers.
+ */
+enum swift_error
+listing_prepare_page(struct listing *l, swift_context_t *swift, CURL *curl, const struct curl_slist *headers, const char *proxy, unsigned int debug)
+{
+	struct listing_parser *p = &l->parser;
+	size_t room = sizeof(l->page_url), len, n;
+	char limit[32];
+	enum swift_error scerr;
+	CURLcode res;
+
+	len = snprintf(l->page_url, room, "%s?format=json", l->url);
+	snprintf(limit, sizeof(limit), "%lu", l->spec->limit);
+	n = (len < room) ? append_param(l->page_url, len, room, "limit", limit) : len;
+	if (n > len && !l->account && l->prefix[0]) {
+		len = n;
+		n = append_param(l->page_url, len, room, "prefix", l->prefix);
+	}
+	if (n > len && !l->account && l->spec->delimiter[0]) {
+		len = n;
+		n = append_param(l->page_url, len, room, "delimiter", l->spec->delimiter);
+	}
+	if (n > len && l->pages) {
+		len = n;
+		n = append_param(l->page_url, len, room, "marker", p->marker);
+	}
+	if (n <= len) {
+		fprintf(stderr, "URL of listing of %s is too long\n", l->url);
+		return SCERR_INVARG;
+	}
+
+	/* The marker is already in the URL, so the parser is free to overwrite it */
+	memset(p, 0, offsetof(struct listing_parser, name));
+	scerr = swift_http_prepare(swift, curl, SWIFT_HTTP_GET, l->page_url, headers, proxy, debug);
+	if (SCERR_SUCCESS == scerr) {
+		res = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, parse_page);
+		if (CURLE_OK == res) {
+			res = curl_easy_setopt(curl, CURLOPT_WRITEDATA, p);
+		}
+		if (CURLE_OK != res) {
+			swift->curl_error("curl_easy_setopt", res);
+			scerr = SCERR_INVARG;
+		}
+	}
+	return scerr;
+}
+
+/**
+ * Account for the page of the given listing just got. Returns 1 if there is another page to get,
+ * zero if the listing is complete, or -1 if the page was not a listing, having explained why.
+ */
+int
+listing_page_done(struct listing *l)
+{
+	const struct listing_parser *p = &l->parser;
+
+	if (p->failed || !p->complete) {
+		fprintf(stderr, "Listing of %s: page %lu is not a complete listing\n", l->url, l->pages + 1);
+		return -1;
+	}
+	l->pages++;
+	l->entries += p->entries;
+	if (p->entries < l->spec->limit) {
+		return 0;
+	}
+	return (0 == l->spec->max_pages || l->pages < l->spec->max_pages) ? 1 : 0;
+}
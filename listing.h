@@ -0,0 +1,71 @@
+#ifndef LISTING_H_
+#define LISTING_H_
+
+#include <stddef.h>  /* size_t */
+#include <curl/curl.h>
+
+#include "swift-http.h"
+
+/*
+ * Listings of containers and of the account, as a mixed workload's list operations perform them: each reads
+ * the listing in JSON, page by page, each page the entries after the last of the page before (its marker), up
+ * to a given number per page (its limit), until a page comes back short or a given number of pages has been read.
+ * A container listing may ask for only the names with a given prefix, and may roll up those sharing a part up to a
+ * given delimiter into one "subdir" entry. Each page is parsed as it arrives, by a streaming parser which keeps
+ * only the count of entries and the name of the last, so that no page is buffered however large.
+ */
+
+/* Entries per page if the workload gives no limit, as Swift's default container_listing_limit */
+#define LISTING_LIMIT_DEFAULT 10000
+/* Longest name of a container or object, as Swift's default, including the terminating NUL */
+#define LISTING_NAME_MAX 1025
+/* Longest prefix digits and delimiter given by a workload, including the terminating NUL */
+#define LISTING_PARAM_MAX 64
+
+/* Parameters of the listings of a mixed workload, shared read-only by all Swift threads */
+struct listing_spec {
+	unsigned long limit;                /* Entries per page */
+	unsigned long max_pages;            /* Pages read per listing, or zero to read to the end */
+	char prefix[LISTING_PARAM_MAX];     /* Leading digits of the numbers of the objects listed, or empty to list all */
+	char delimiter[LISTING_PARAM_MAX];  /* Delimiter by which to roll up names, or empty for none */
+	double account;                     /* Fraction of listings of the account rather than of a container */
+};
+
+/* Streaming parser of one page of a listing in JSON: an array of objects, each with a "name" or a "subdir" */
+struct listing_parser {
+	unsigned int depth;                 /* Nesting of the arrays and objects open */
+	unsigned int string;                /* String being read, one of enum listing_string */
+	unsigned int escape;                /* Characters of an escape sequence seen so far within a string, or zero */
+	unsigned int code_point;            /* Code point of a \u escape sequence, as far as seen */
+	unsigned int high_surrogate;        /* High surrogate of a pair, awaiting its low surrogate, or zero */
+	unsigned int expect_key;            /* Whether the next string of an entry is a key, not a value */
+	unsigned int key_len;               /* Length of the key being read, or of the last read */
+	char key[8];                        /* Key being read, or last read, as far as it fits */
+	unsigned int capture;               /* Whether the next value of the entry is its name or subdir */
+	unsigned int complete;              /* Whether the array has closed */
+	unsigned int failed;                /* Whether the page is not a listing */
+	unsigned long entries;              /* Entries of the page */
+	size_t bytes;                       /* Length of the page */
+	size_t name_len;                    /* Length of name */
+	char name[LISTING_NAME_MAX];        /* Name or subdir of the last entry, as far as read */
+	char marker[LISTING_NAME_MAX];      /* Name or subdir of the last complete entry, from which the next page starts */
+};
+
+/* One listing in progress */
+struct listing {
+	const struct listing_spec *spec;    /* Parameters of the listing */
+	const char *url;                    /* URL of the container or account listed */
+	char prefix[LISTING_NAME_MAX];      /* Prefix of the names listed, or empty for all */
+	unsigned int account;               /* Whether the account is listed, with neither prefix nor delimiter */
+	unsigned long pages;                /* Pages read so far */
+	unsigned long entries;              /* Entries of all pages read so far */
+	struct listing_parser parser;       /* Parser of the page being read */
+	char page_url[SWIFT_HTTP_URL_MAX];  /* URL of the page being read */
+};
+
+int parse_listing_spec(char *value, struct listing_spec *spec);
+void listing_init(struct listing *l, const struct listing_spec *spec, const char *url, const char *prefix);
+enum swift_error listing_prepare_page(struct listing *l, swift_context_t *swift, CURL *curl, const struct curl_slist *headers, const char *proxy, unsigned int debug);
+int listing_page_done(struct listing *l);
+
+#endif /* LISTING_H_ */
@@ -0,0 +1,199 @@
+#include <stdio.h>   /* fprintf, perror */
+#include <stdlib.h>  /* posix_memalign, malloc, free */
+#include <string.h>  /* memset, memcpy */
+#include <errno.h>   /* errno */
+#include <signal.h>  /* sigset_t, sig*, SIGUSR1 */
+#include <time.h>    /* struct timespec */
+
+#include "live-report.h"
+#include "swift-thread.h"
+
+/* Store the given value into the given counter, read by the reporter as it changes */
+#define STORE_COUNTER(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+#define LOAD_COUNTER(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+/**
+ * Count an operation recorded by the Swift thread owning the given counters, with the given latency in nanoseconds.
+ */
+void
+live_record(struct live_counters *c, uint64_t latency, size_t bytes)
+{
+	STORE_COUNTER(c->ops, c->ops + 1);
+	STORE_COUNTER(c->bytes, c->bytes + bytes);
+	histogram_record_shared(&c->latency, latency);
+}
+
+/**
+ * Count an operation failed by the Swift thread owning the given counters.
+ */
+void
+live_error(struct live_counters *c)
+{
+	STORE_COUNTER(c->errors, c->errors + 1);
+}
+
+/**
+ * Display one line of statistics of the given number of seconds.
+ */
+static void
+show_line(double elapsed, const char *label, double secs, uint64_t ops, uint64_t bytes, uint64_t errors, const struct histogram *h)
+{
+	fprintf(stderr, "[%10.3f s] %8s: ops %10llu  ops/s %12.3f  MB/s %12.3f  errors %6llu  p50 %12.3f  p99 %12.3f  max %12.3f\n",
+		elapsed, label,
+		(unsigned long long) ops,
+		(secs > 0) ? ops / secs : 0.0,
+		(secs > 0) ? bytes / secs / 1000000 : 0.0,
+		(unsigned long long) errors,
+		histogram_percentile(h, 50.0) / 1000.0,
+		histogram_percentile(h, 99.0) / 1000.0,
+		h->count ? h->max / 1000.0 : 0.0
+	);
+}
+
+/**
+ * Sample every Swift thread's counters, and display the statistics of the interval since the last report and of the whole run.
+ * Latencies are in microseconds.
+ */
+static void
+report(struct live_reporter *rep)
+{
+	uint64_t now = swift_clock_nanosecs(), ops = 0, bytes = 0, errors = 0;
+	double elapsed = (now - rep->start) / 1e9;
+	unsigned int i;
+
+	histogram_init(rep->total);
+	for (i = 0; i < rep->num_threads; i++) {
+		ops += LOAD_COUNTER(rep->counters[i].ops);
+		bytes += LOAD_COUNTER(rep->counters[i].bytes);
+		errors += LOAD_COUNTER(rep->counters[i].errors);
+		histogram_snapshot(rep->sample, &rep->counters[i].latency);
+		histogram_merge(rep->total, rep->sample);
+	}
+
+	/* The interval's latencies are those recorded since the last report */
+	memcpy(rep->sample, rep->total, sizeof(*rep->sample));
+	histogram_subtract(rep->sample, rep->last_total);
+	if (rep->sample->max > rep->total->max) {
+		rep->sample->max = rep->total->max; /* Known exactly, unlike the interval's maximum */
+	}
+	show_line(elapsed, "interval", (now - rep->last) / 1e9, ops - rep->last_ops, bytes - rep->last_bytes, errors - rep->last_errors, rep->sample);
+	show_line(elapsed, "total", elapsed, ops, bytes, errors, rep->total);
+
+	memcpy(rep->last_total, rep->total, sizeof(*rep->last_total));
+	rep->last = now;
+	rep->last_ops = ops;
+	rep->last_bytes = bytes;
+	rep->last_errors = errors;
+}
+
+/**
+ * Executed by the reporter thread: report every interval, and upon each SIGUSR1, until stopped.
+ */
+static void *
+reporter_func(void *arg)
+{
+	struct live_reporter *rep = (struct live_reporter *) arg;
+	struct timespec timeout;
+	sigset_t set;
+	int ret;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGUSR1);
+	timeout.tv_sec = (time_t) rep->interval;
+	timeout.tv_nsec = (long) ((rep->interval - timeout.tv_sec) * 1e9);
+
+	for (;;) {
+		ret = (rep->interval > 0) ? sigtimedwait(&set, NULL, &timeout) : sigwaitinfo(&set, NULL);
+		if (ret < 0 && EINTR == errno) {
+			continue;
+		}
+		if (__atomic_load_n(&rep->stop, __ATOMIC_ACQUIRE)) {
+			break;
+		}
+		/* Either the interval has passed or SIGUSR1 asks for a report now */
+		report(rep);
+	}
+	return NULL;
+}
+
+/**
+ * Allocate counters for the given number of Swift threads, and start a reporter thread reporting upon them every
+ * given number of seconds, or if zero, only upon SIGUSR1. Must be called before any Swift thread is created, as it
+ * blocks SIGUSR1 in the calling thread so that every thread created from then on leaves SIGUSR1 to the reporter.
+ * Returns zero on success.
+ */
+int
+live_reporter_start(struct live_reporter *rep, unsigned int num_threads, double interval)
+{
+	sigset_t set;
+	unsigned int i;
+	int ret;
+
+	memset(rep, 0, sizeof(*rep));
+	rep->num_threads = num_threads;
+	rep->interval = interval;
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGUSR1);
+	ret = pthread_sigmask(SIG_BLOCK, &set, NULL);
+	if (ret != 0) {
+		errno = ret;
+		perror("pthread_sigmask");
+		return -1;
+	}
+
+	ret = posix_memalign((void **) &rep->counters, LIVE_CACHE_LINE, num_threads * sizeof(*rep->counters));
+	if (ret != 0) {
+		errno = ret;
+		perror("posix_memalign");
+		return -1;
+	}
+	for (i = 0; i < num_threads; i++) {
+		memset(&rep->counters[i], 0, sizeof(rep->counters[i]));
+		histogram_init(&rep->counters[i].latency);
+	}
+	rep->total = (struct histogram *) malloc(3 * sizeof(*rep->total));
+	if (NULL == rep->total) {
+		perror("malloc");
+		free(rep->counters);
+		return -1;
+	}
+	rep->last_total = &rep->total[1];
+	rep->sample = &rep->total[2];
+	histogram_init(rep->last_total);
+
+	rep->start = rep->last = swift_clock_nanosecs();
+	ret = pthread_create(&rep->thread_id, NULL, reporter_func, rep);
+	if (ret != 0) {
+		errno = ret;
+		perror("pthread_create");
+		free(rep->total);
+		free(rep->counters);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Stop the reporter thread, once every Swift thread has ended, and release its counters.
+ */
+void
+live_reporter_stop(struct live_reporter *rep)
+{
+	int ret;
+
+	__atomic_store_n(&rep->stop, 1, __ATOMIC_RELEASE);
+	/* Wake the reporter, which takes the signal as it waits */
+	ret = pthread_kill(rep->thread_id, SIGUSR1);
+	if (ret != 0) {
+		errno = ret;
+		perror("pthread_kill");
+	}
+	ret = pthread_join(rep->thread_id, NULL);
+	if (ret != 0) {
+		errno = ret;
+		perror("pthread_join");
+	}
+	free(rep->total);
+	free(rep->counters);
+}
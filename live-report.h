@@ -0,0 +1,50 @@
+#ifndef LIVE_REPORT_H_
+#define LIVE_REPORT_H_
+
+#include <stdint.h>  /* uint64_t */
+#include <pthread.h> /* pthread_t */
+#include <stddef.h>  /* size_t */
+
+#include "histogram.h"
+
+/*
+ * Statistics reported while the Swift threads run: each Swift thread counts its recorded operations in
+ * counters of its own, which a reporter thread samples every interval, or at once upon SIGUSR1, printing
+ * the throughput and latency of the interval since its last report and of the whole run so far.
+ */
+
+/* Size of a cache line, to which each Swift thread's counters are aligned so that no two share one */
+#define LIVE_CACHE_LINE 64
+
+/*
+ * Counters of one Swift thread's operations. Only the Swift thread writes them, storing each field whole,
+ * so that counting takes no locks and no atomic read-modify-write, while the reporter reads them as they change.
+ */
+struct live_counters {
+	uint64_t ops;               /* Number of operations recorded */
+	uint64_t bytes;             /* Object data transferred by them */
+	uint64_t errors;            /* Number of operations failed */
+	struct histogram latency;   /* Latency of each in nanoseconds, from its intended start */
+} __attribute__((aligned(LIVE_CACHE_LINE)));
+
+/* Reporter thread and its samples */
+struct live_reporter {
+	pthread_t thread_id;             /* pthread thread ID */
+	struct live_counters *counters;  /* Counters of each Swift thread */
+	unsigned int num_threads;        /* Number of Swift threads */
+	double interval;                 /* Seconds between reports, or zero to report only upon SIGUSR1 */
+	int stop;                        /* Set to stop the reporter; accessed atomically */
+	uint64_t start;                  /* Time at which reporting started */
+	uint64_t last;                   /* Time of the last report */
+	uint64_t last_ops, last_bytes, last_errors; /* Totals at the last report */
+	struct histogram *total;         /* Latencies of the whole run so far */
+	struct histogram *last_total;    /* Latencies of the whole run at the last report */
+	struct histogram *sample;        /* One Swift thread's latencies, as last sampled */
+};
+
+int live_reporter_start(struct live_reporter *rep, unsigned int num_threads, double interval);
+void live_reporter_stop(struct live_reporter *rep);
+void live_record(struct live_counters *c, uint64_t latency, size_t bytes);
+void live_error(struct live_counters *c);
+
+#endif /* LIVE_REPORT_H_ */
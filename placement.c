@@ -0,0 +1,285 @@
+#define _GNU_SOURCE /* cpu_set_t, sched_getaffinity, pthread_attr_setaffinity_np */
+#include <stdio.h>   /* fopen, fscanf, fprintf, snprintf */
+#include <stdlib.h>  /* malloc, realloc, free, strtol, qsort */
+#include <string.h>  /* strcmp, strncmp */
+#include <errno.h>   /* errno */
+#include <sched.h>   /* sched_getaffinity, CPU_* */
+#include <dirent.h>  /* opendir, readdir */
+
+#include "placement.h"
+
+/* Where Linux describes each CPU's topology */
+#define PLACEMENT_SYSFS_CPU "/sys/devices/system/cpu"
+
+/* Topology of one CPU on which the process may run */
+struct cpu_info {
+	int cpu;         /* CPU number */
+	int node;        /* NUMA node, or zero if unknown */
+	int package;     /* Physical package (socket) */
+	int core;        /* Core within the package */
+	int sibling;     /* Rank among the hyperthreads of its core, counting from zero */
+	int core_rank;   /* Rank of its core among those of its node, counting from zero */
+};
+
+/**
+ * Parse a placement policy: none, compact, scatter, or list:<cpus>, where cpus is a comma-separated list
+ * of CPU numbers and ranges of them, such as 0,2,4-7. Returns zero on success.
+ */
+int
+parse_placement(const char *text, struct placement_spec *spec)
+{
+	const char *p;
+
+	spec->cpus = NULL;
+	spec->num_cpus = 0;
+	if (0 == strcmp(text, "none")) {
+		spec->policy = PLACEMENT_NONE;
+		return 0;
+	}
+	if (0 == strcmp(text, "compact")) {
+		spec->policy = PLACEMENT_COMPACT;
+		return 0;
+	}
+	if (0 == strcmp(text, "scatter")) {
+		spec->policy = PLACEMENT_SCATTER;
+		return 0;
+	}
+	if (0 != strncmp(text, "list:", 5)) {
+		return -1;
+	}
+	spec->policy = PLACEMENT_LIST;
+	for (p = text + 5; ; p++) {
+		char *end;
+		long first, last, cpu;
+		int *cpus;
+
+		first = strtol(p, &end, 10);
+		if (end == p || first < 0 || first >= CPU_SETSIZE) {
+			break;
+		}
+		last = first;
+		if ('-' == *end) {
+			p = end + 1;
+			last = strtol(p, &end, 10);
+			if (end == p || last < first || last >= CPU_SETSIZE) {
+				break;
+			}
+		}
+		cpus = (int *) realloc(spec->cpus, (spec->num_cpus + (last - first + 1)) * sizeof(*cpus));
+		if (NULL == cpus) {
+			break;
+		}
+		spec->cpus = cpus;
+		for (cpu = first; cpu <= last; cpu++) {
+			spec->cpus[spec->num_cpus++] = (int) cpu;
+		}
+		p = end;
+		if ('\0' == *p) {
+			return 0;
+		}
+		if (',' != *p) {
+			break;
+		}
+	}
+	free(spec->cpus);
+	spec->cpus = NULL;
+	spec->num_cpus = 0;
+	return -1;
+}
+
+const char *
+placement_policy_name(enum placement_policy policy)
+{
+	switch (policy) {
+	case PLACEMENT_NONE:
+		return "none";
+	case PLACEMENT_COMPACT:
+		return "compact";
+	case PLACEMENT_SCATTER:
+		return "scatter";
+	case PLACEMENT_LIST:
+		return "list";
+	}
+	return "unknown";
+}
+
+/**
+ * Read a single integer from the given topology file of the given CPU, or return the given default if it cannot be read.
+ */
+static int
+read_topology(int cpu, const char *name, int dflt)
+{
+	char path[128];
+	FILE *f;
+	int value;
+
+	snprintf(path, sizeof(path), PLACEMENT_SYSFS_CPU "/cpu%d/topology/%s", cpu, name);
+	f = fopen(path, "r");
+	if (NULL == f) {
+		return dflt;
+	}
+	if (1 != fscanf(f, "%d", &value)) {
+		value = dflt;
+	}
+	fclose(f);
+	return value;
+}
+
+/**
+ * Return the NUMA node of the given CPU, from the node link in its sysfs directory, or zero if it has none.
+ */
+static int
+cpu_node(int cpu)
+{
+	char path[128];
+	struct dirent *entry;
+	DIR *dir;
+	int node = 0;
+
+	snprintf(path, sizeof(path), PLACEMENT_SYSFS_CPU "/cpu%d", cpu);
+	dir = opendir(path);
+	if (NULL == dir) {
+		return 0;
+	}
+	while (NULL != (entry = readdir(dir))) {
+		if (1 == sscanf(entry->d_name, "node%d", &node)) {
+			break;
+		}
+	}
+	closedir(dir);
+	return node;
+}
+
+static int
+compare_compact(const void *a, const void *b)
+{
+	const struct cpu_info *x = (const struct cpu_info *) a, *y = (const struct cpu_info *) b;
+
+	if (x->node != y->node) {
+		return x->node - y->node;
+	}
+	if (x->package != y->package) {
+		return x->package - y->package;
+	}
+	if (x->core != y->core) {
+		return x->core - y->core;
+	}
+	return x->cpu - y->cpu;
+}
+
+static int
+compare_scatter(const void *a, const void *b)
+{
+	const struct cpu_info *x = (const struct cpu_info *) a, *y = (const struct cpu_info *) b;
+
+	if (x->sibling != y->sibling) {
+		return x->sibling - y->sibling;
+	}
+	if (x->core_rank != y->core_rank) {
+		return x->core_rank - y->core_rank;
+	}
+	if (x->node != y->node) {
+		return x->node - y->node;
+	}
+	return x->cpu - y->cpu;
+}
+
+/**
+ * Choose the CPU of each of the given number of Swift threads by the given policy, and find its NUMA node,
+ * setting each to -1 if the threads are not to be bound. Threads outnumbering the CPUs wrap around to the first.
+ * Returns zero on success, or -1, having reported why, if the policy cannot be followed.
+ */
+int
+placement_assign(const struct placement_spec *spec, unsigned int num_threads, int *cpus, int *nodes)
+{
+	struct cpu_info *info;
+	unsigned int num_cpus = 0, i, j;
+	cpu_set_t allowed;
+	int cpu;
+
+	for (i = 0; i < num_threads; i++) {
+		cpus[i] = -1;
+		nodes[i] = -1;
+	}
+	if (PLACEMENT_NONE == spec->policy) {
+		return 0;
+	}
+	if (0 != sched_getaffinity(0, sizeof(allowed), &allowed)) {
+		perror("sched_getaffinity");
+		return -1;
+	}
+
+	if (PLACEMENT_LIST == spec->policy) {
+		for (i = 0; i < spec->num_cpus; i++) {
+			if (!CPU_ISSET(spec->cpus[i], &allowed)) {
+				fprintf(stderr, "CPU %d is not one on which the process may run\n", spec->cpus[i]);
+				return -1;
+			}
+		}
+		for (i = 0; i < num_threads; i++) {
+			cpus[i] = spec->cpus[i % spec->num_cpus];
+			nodes[i] = cpu_node(cpus[i]);
+		}
+		return 0;
+	}
+
+	info = (struct cpu_info *) malloc(CPU_COUNT(&allowed) * sizeof(*info));
+	if (NULL == info) {
+		perror("malloc");
+		return -1;
+	}
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &allowed)) {
+			info[num_cpus].cpu = cpu;
+			info[num_cpus].node = cpu_node(cpu);
+			info[num_cpus].package = read_topology(cpu, "physical_package_id", 0);
+			info[num_cpus].core = read_topology(cpu, "core_id", cpu);
+			num_cpus++;
+		}
+	}
+
+	/* Rank the hyperthreads of each core, and the cores of each node, in compact order */
+	qsort(info, num_cpus, sizeof(*info), compare_compact);
+	for (i = 0; i < num_cpus; i++) {
+		if (i > 0 && info[i].node == info[i - 1].node && info[i].package == info[i - 1].package && info[i].core == info[i - 1].core) {
+			info[i].sibling = info[i - 1].sibling + 1;
+			info[i].core_rank = info[i - 1].core_rank;
+			continue;
+		}
+		info[i].sibling = 0;
+		info[i].core_rank = 0;
+		for (j = i; j-- > 0 && info[j].node == info[i].node; ) {
+			if (0 == info[j].sibling) {
+				info[i].core_rank = info[j].core_rank + 1;
+				break;
+			}
+		}
+	}
+	if (PLACEMENT_SCATTER == spec->policy) {
+		qsort(info, num_cpus, sizeof(*info), compare_scatter);
+	}
+
+	for (i = 0; i < num_threads; i++) {
+		cpus[i] = info[i % num_cpus].cpu;
+		nodes[i] = info[i % num_cpus].node;
+	}
+	free(info);
+	return 0;
+}
+
+/**
+ * Set the given thread attributes to bind the thread created with them to the given CPU, unless it is -1.
+ * Returns zero on success, or else an errno value.
+ */
+int
+placement_set_attr(pthread_attr_t *attr, int cpu)
+{
+	cpu_set_t set;
+
+	if (cpu < 0) {
+		return 0;
+	}
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_attr_setaffinity_np(attr, sizeof(set), &set);
+}
@@ -0,0 +1,33 @@
+#ifndef PLACEMENT_H_
+#define PLACEMENT_H_
+
+#include <pthread.h> /* pthread_attr_t */
+
+/*
+ * Placement of Swift threads upon CPUs: each is bound, from its creation, to a CPU chosen by a policy
+ * from those the process may run on, according to the machine's topology as Linux describes it in sysfs.
+ * As a thread bound from its creation first touches the memory which it allocates or initialises itself,
+ * that memory comes, by the kernel's default first-touch policy, from the NUMA node of its CPU.
+ */
+
+/* Policies by which Swift threads are placed */
+enum placement_policy {
+	PLACEMENT_NONE,    /* Not bound: left to the scheduler */
+	PLACEMENT_COMPACT, /* Packed: hyperthreads of a core, then cores of a node, then the next node */
+	PLACEMENT_SCATTER, /* Spread: each node in turn, one hyperthread per core before any core's second */
+	PLACEMENT_LIST     /* Upon the CPUs of a given list, in turn */
+};
+
+/* Placement policy, as parsed */
+struct placement_spec {
+	enum placement_policy policy;
+	int *cpus;                   /* CPUs of PLACEMENT_LIST, in order, or NULL */
+	unsigned int num_cpus;       /* Number of CPUs listed */
+};
+
+int parse_placement(const char *text, struct placement_spec *spec);
+int placement_assign(const struct placement_spec *spec, unsigned int num_threads, int *cpus, int *nodes);
+int placement_set_attr(pthread_attr_t *attr, int cpu);
+const char *placement_policy_name(enum placement_policy policy);
+
+#endif /* PLACEMENT_H_ */
@@ -0,0 +1,47 @@
+#include "prng.h"
+
+/**
+ * Return a generator state derived from the given seed (by splitmix64), so that runs are repeatable.
+ */
+uint64_t
+prng_seed(uint64_t seed)
+{
+	seed += 0x9E3779B97F4A7C15ULL;
+	seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+	/* xorshift64* must not start from zero */
+	return (seed ^ (seed >> 31)) | 1;
+}
+
+/**
+ * Return the next value of a 64-bit pseudo-random sequence (xorshift64*).
+ */
+uint64_t
+prng_next(uint64_t *state)
+{
+	uint64_t x = *state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Return a pseudo-random integer in [0, n), without the bias of a modulus.
+ */
+unsigned long
+prng_below(uint64_t *state, unsigned long n)
+{
+	return (unsigned long) (((unsigned __int128) prng_next(state) * n) >> 64);
+}
+
+/**
+ * Return a pseudo-random double in [0, 1).
+ */
+double
+prng_double(uint64_t *state)
+{
+	return (prng_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
@@ -0,0 +1,16 @@
+#ifndef PRNG_H_
+#define PRNG_H_
+
+#include <stdint.h> /* uint64_t */
+
+/*
+ * Small, fast pseudo-random generator (xorshift64*) for choosing keys and arrival times.
+ * Each generator state is owned by a single thread. Not suitable for cryptographic use.
+ */
+
+uint64_t prng_seed(uint64_t seed);
+uint64_t prng_next(uint64_t *state);
+unsigned long prng_below(uint64_t *state, unsigned long n);
+double prng_double(uint64_t *state);
+
+#endif /* PRNG_H_ */
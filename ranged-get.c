@@ -0,0 +1,253 @@
+#include <stdio.h>   /* snprintf, fprintf */
+#include <stdlib.h>  /* calloc, malloc, free */
+#include <string.h>  /* memset, memcpy */
+
+#include "ranged-get.h"
+#include "swift-http.h"
+
+#ifdef min
+#undef min
+#endif
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+/**
+ * Acquire the pool of connections and the ring of chunk buffers, if objects are to be got in chunks.
+ */
+void
+range_init(struct range_downloader *dl, struct swift_thread_args *args)
+{
+	CURLMcode mres = CURLM_OK;
+	unsigned int i;
+
+	memset(dl, 0, sizeof(*dl));
+	dl->args = args;
+	if (0 == args->get_chunk_size || SCERR_SUCCESS != args->scerr) {
+		return;
+	}
+
+	dl->multi = curl_multi_init();
+	dl->conns = (struct range_connection *) calloc(args->get_connections, sizeof(*dl->conns));
+	dl->ring = (unsigned char *) malloc(args->get_connections * args->get_chunk_size);
+	dl->ring_done = (unsigned char *) calloc(args->get_connections, sizeof(*dl->ring_done));
+	dl->headers = swift_http_auth_headers(args->auth_token);
+	if (NULL == dl->multi || NULL == dl->conns || NULL == dl->ring || NULL == dl->ring_done || NULL == dl->headers) {
+		args->scerr = SCERR_ALLOC_FAILED;
+		return;
+	}
+	for (i = 0; i < args->get_connections; i++) {
+		dl->conns[i].curl = curl_easy_init();
+		if (NULL == dl->conns[i].curl) {
+			args->scerr = SCERR_INIT_FAILED;
+			return;
+		}
+	}
+
+	/* Keep no more connections than the pool, multiplexing chunks over them where HTTP/2 allows */
+	mres = curl_multi_setopt(dl->multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long) args->get_connections);
+	if (CURLM_OK == mres) {
+		mres = curl_multi_setopt(dl->multi, CURLMOPT_PIPELINING, (long) CURLPIPE_MULTIPLEX);
+	}
+	if (CURLM_OK != mres) {
+		fprintf(stderr, "curl_multi_setopt: %s\n", curl_multi_strerror(mres));
+		args->scerr = SCERR_INIT_FAILED;
+	}
+}
+
+/**
+ * Release everything held by the downloader. Usable as a pthread cleanup handler.
+ */
+void
+range_free(void *arg)
+{
+	struct range_downloader *dl = (struct range_downloader *) arg;
+	unsigned int i;
+
+	if (dl->conns) {
+		for (i = 0; i < dl->args->get_connections; i++) {
+			if (dl->conns[i].curl) {
+				curl_easy_cleanup(dl->conns[i].curl);
+			}
+		}
+		free(dl->conns);
+	}
+	if (dl->multi) {
+		curl_multi_cleanup(dl->multi);
+	}
+	if (dl->headers) {
+		curl_slist_free_all(dl->headers);
+	}
+	free(dl->ring);
+	free(dl->ring_done);
+	memset(dl, 0, sizeof(*dl));
+}
+
+/**
+ * Receive the next part of a chunk into its buffer, failing the transfer if the chunk is longer than expected.
+ */
+static size_t
+receive_chunk(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	struct range_connection *conn = (struct range_connection *) userdata;
+
+	size *= nmemb;
+	if (size > conn->len - conn->received) {
+		return 0; /* Longer than expected */
+	}
+	memcpy(conn->buf + conn->received, ptr, size);
+	conn->received += size;
+
+	return size;
+}
+
+/**
+ * Start getting the given chunk of the object at the given URL, of the given total length, on the given connection.
+ * An object of a single chunk is got whole, without a range.
+ */
+static enum swift_error
+start_chunk(struct range_downloader *dl, struct range_connection *conn, const char *url, unsigned long chunk, unsigned long num_chunks, size_t len)
+{
+	struct swift_thread_args *args = dl->args;
+	uint64_t off = (uint64_t) chunk * args->get_chunk_size;
+	char range[48];
+	enum swift_error scerr;
+	CURLcode res = CURLE_OK;
+	CURLMcode mres;
+
+	conn->chunk = chunk;
+	conn->buf = dl->ring + (chunk % args->get_connections) * args->get_chunk_size;
+	conn->len = min(args->get_chunk_size, len - off);
+	conn->received = 0;
+
+	scerr = swift_http_prepare(&args->swift, conn->curl, SWIFT_HTTP_GET, url, dl->headers, args->proxy, args->debug);
+	if (SCERR_SUCCESS != scerr) {
+		return scerr;
+	}
+	if (num_chunks > 1) {
+		snprintf(range, sizeof(range), "%llu-%llu", (unsigned long long) off, (unsigned long long) (off + conn->len - 1));
+		res = curl_easy_setopt(conn->curl, CURLOPT_RANGE, range);
+	}
+	if (CURLE_OK == res) {
+		res = curl_easy_setopt(conn->curl, CURLOPT_WRITEFUNCTION, receive_chunk);
+	}
+	if (CURLE_OK == res) {
+		res = curl_easy_setopt(conn->curl, CURLOPT_WRITEDATA, conn);
+	}
+	if (CURLE_OK == res) {
+		res = curl_easy_setopt(conn->curl, CURLOPT_PRIVATE, conn);
+	}
+	if (CURLE_OK != res) {
+		args->swift.curl_error("curl_easy_setopt", res);
+		return SCERR_INVARG;
+	}
+
+	conn->start = swift_clock_nanosecs();
+	mres = curl_multi_add_handle(dl->multi, conn->curl);
+	if (CURLM_OK != mres) {
+		fprintf(stderr, "curl_multi_add_handle: %s\n", curl_multi_strerror(mres));
+		return SCERR_INIT_FAILED;
+	}
+	return SCERR_SUCCESS;
+}
+
+/**
+ * Get the object at the given URL, of the given length, as chunks, as many at once as there are connections
+ * in the pool, passing each complete chunk on in order, and verifying it if so required, as the chunks
+ * before it complete. Chunk gets are recorded in chunk_stats, if not NULL.
+ * After any failure, those in flight are completed but no more are started.
+ */
+enum swift_error
+range_get(struct range_downloader *dl, const char *url, unsigned long object, size_t len, struct swift_op_stats *chunk_stats)
+{
+	struct swift_thread_args *args = dl->args;
+	unsigned int num_buffers = args->get_connections, i;
+	unsigned long num_chunks = (len > 0) ? (len + args->get_chunk_size - 1) / args->get_chunk_size : 1;
+	unsigned long next = 0, passed = 0, in_flight = 0;
+	struct compare_data_args compare_args;
+	enum swift_error scerr = SCERR_SUCCESS, result;
+	CURLMcode mres;
+	CURLMsg *msg;
+	int running, msgs_left;
+
+	compare_args.swift = &args->swift;
+	test_data_source_init(&compare_args.source, args->data_type, args->thread_num, object);
+	compare_args.mode = args->verify_data;
+	compare_args.crc = 0;
+	compare_args.len = len;
+	compare_args.off = 0;
+
+	memset(dl->ring_done, 0, num_buffers * sizeof(*dl->ring_done));
+	dl->idle = NULL;
+	for (i = num_buffers; i-- > 0; ) {
+		dl->conns[i].next_idle = dl->idle;
+		dl->idle = &dl->conns[i];
+	}
+
+	for (;;) {
+		/* Start chunks on idle connections, no further ahead of the last passed on than there are buffers */
+		while (SCERR_SUCCESS == scerr && dl->idle && next < num_chunks && next < passed + num_buffers) {
+			struct range_connection *conn = dl->idle;
+			dl->idle = conn->next_idle;
+			scerr = start_chunk(dl, conn, url, next++, num_chunks, len);
+			if (SCERR_SUCCESS == scerr) {
+				in_flight++;
+			}
+		}
+		if (0 == in_flight) {
+			break;
+		}
+
+		mres = curl_multi_perform(dl->multi, &running);
+		if (CURLM_OK == mres && running) {
+			mres = curl_multi_wait(dl->multi, NULL, 0, 1000, NULL);
+		}
+		if (CURLM_OK != mres) {
+			/* Abandon the requests in flight */
+			fprintf(stderr, "curl_multi_perform: %s\n", curl_multi_strerror(mres));
+			for (i = 0; i < num_buffers; i++) {
+				curl_multi_remove_handle(dl->multi, dl->conns[i].curl);
+			}
+			return SCERR_URL_FAILED;
+		}
+		while (NULL != (msg = curl_multi_info_read(dl->multi, &msgs_left))) {
+			struct range_connection *conn = NULL;
+			if (CURLMSG_DONE != msg->msg) {
+				continue;
+			}
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &conn);
+			curl_multi_remove_handle(dl->multi, msg->easy_handle);
+			in_flight--;
+			conn->next_idle = dl->idle;
+			dl->idle = conn;
+			result = swift_http_result(&args->swift, conn->curl, msg->data.result);
+			if (SCERR_SUCCESS == result && conn->received != conn->len) {
+				fprintf(stderr, "Swift thread %u: chunk %lu of object %lu is short\n", args->thread_num, conn->chunk, object);
+				result = SCERR_URL_FAILED;
+			}
+			if (SCERR_SUCCESS != result) {
+				if (SCERR_SUCCESS == scerr) {
+					scerr = result;
+				}
+				continue;
+			}
+			if (chunk_stats) {
+				swift_record_op(chunk_stats, conn->start, conn->start, conn->len);
+			}
+			dl->ring_done[conn->chunk % num_buffers] = 1;
+		}
+
+		/* Pass on, in order, every chunk complete since the last passed on */
+		while (SCERR_SUCCESS == scerr && passed < next && dl->ring_done[passed % num_buffers]) {
+			size_t chunk_len = min(args->get_chunk_size, len - (size_t) passed * args->get_chunk_size);
+			dl->ring_done[passed % num_buffers] = 0;
+			if (VERIFY_NONE != args->verify_data && compare_data(dl->ring + (passed % num_buffers) * args->get_chunk_size, 1, chunk_len, &compare_args) != chunk_len) {
+				scerr = swift_thread_check_data(args, &compare_args, object);
+			}
+			passed++;
+		}
+	}
+
+	if (SCERR_SUCCESS == scerr && VERIFY_NONE != args->verify_data) {
+		scerr = swift_thread_check_data(args, &compare_args, object);
+	}
+	return scerr;
+}
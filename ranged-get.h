@@ -0,0 +1,42 @@
+#ifndef RANGED_GET_H_
+#define RANGED_GET_H_
+
+#include <stdint.h>  /* uint64_t */
+#include <curl/curl.h>
+
+#include "swift-thread.h"
+
+/*
+ * Download of objects as concurrent HTTP range requests for fixed-size chunks, over a bounded pool
+ * of connections. Chunks complete in any order into a ring of one buffer per connection, and are
+ * passed on, and verified, strictly in order, so that a chunk is started only once the chunk which
+ * last used its buffer has been passed on.
+ */
+
+/* One connection of the pool, with the chunk in flight upon it */
+struct range_connection {
+	CURL *curl;                   /* Easy handle, reused for each request so that its connection persists */
+	unsigned long chunk;          /* Index of the chunk being got */
+	unsigned char *buf;           /* Buffer in the ring into which the chunk is received */
+	size_t len;                   /* Length of the chunk */
+	size_t received;              /* Length of the chunk received so far */
+	uint64_t start;               /* Time at which the chunk's get started */
+	struct range_connection *next_idle; /* Next idle connection */
+};
+
+/* Per-thread state of ranged downloads */
+struct range_downloader {
+	struct swift_thread_args *args;   /* The thread's in/out parameters */
+	CURLM *multi;                     /* Multi handle driving the pool */
+	struct range_connection *conns;   /* Pool of get_connections connections */
+	struct range_connection *idle;    /* Connections with no chunk in flight */
+	struct curl_slist *headers;       /* Authentication headers */
+	unsigned char *ring;              /* One chunk buffer per connection, chunk k using buffer k modulo their number */
+	unsigned char *ring_done;         /* Per buffer, whether the chunk received into it is complete and not yet passed on */
+};
+
+void range_init(struct range_downloader *dl, struct swift_thread_args *args);
+void range_free(void *arg);
+enum swift_error range_get(struct range_downloader *dl, const char *url, unsigned long object, size_t len, struct swift_op_stats *chunk_stats);
+
+#endif /* RANGED_GET_H_ */
@@ -0,0 +1,110 @@
+#include "request-timing.h"
+
+/**
+ * Return the name of the given phase of a request.
+ */
+const char *
+request_phase_name(enum request_phase phase)
+{
+	static const char *const names[REQUEST_PHASE_MAX + 1] = {
+		"dns", "connect", "tls", "setup", "ttfb", "xfer", "total"
+	};
+
+	return names[phase];
+}
+
+/**
+ * Reset the given timings.
+ */
+void
+request_timings_init(struct request_timings *t)
+{
+	unsigned int phase;
+
+	t->requests = 0;
+	t->new_connections = 0;
+	for (phase = 0; phase <= REQUEST_PHASE_MAX; phase++) {
+		histogram_init(&t->phases[phase]);
+	}
+}
+
+/**
+ * Return the time, in microseconds, from the start of the last transfer of the given handle to the given point,
+ * or zero if libcurl does not know it.
+ */
+static curl_off_t
+time_to(CURL *curl, CURLINFO info)
+{
+	curl_off_t us = 0;
+
+	if (CURLE_OK != curl_easy_getinfo(curl, info, &us) || us < 0) {
+		return 0;
+	}
+	return us;
+}
+
+/**
+ * Record the duration of the given phase, from one point to another in microseconds since the start of the request.
+ */
+static void
+record_phase(struct request_timings *t, enum request_phase phase, curl_off_t from, curl_off_t to)
+{
+	histogram_record(&t->phases[phase], (to > from) ? (uint64_t) (to - from) * 1000 : 0);
+}
+
+/**
+ * Record the phases of the last transfer completed by the given handle.
+ * libcurl gives the time from the start of the transfer to the end of each phase; as a reused connection
+ * skips name lookup, connect and handshake, those are recorded only of transfers which opened a new connection.
+ */
+void
+request_timings_record(struct request_timings *t, CURL *curl)
+{
+	curl_off_t dns, connect, tls, pretransfer, first_byte, total;
+	long num_connects = 0;
+
+	dns = time_to(curl, CURLINFO_NAMELOOKUP_TIME_T);
+	connect = time_to(curl, CURLINFO_CONNECT_TIME_T);
+	tls = time_to(curl, CURLINFO_APPCONNECT_TIME_T);
+	pretransfer = time_to(curl, CURLINFO_PRETRANSFER_TIME_T);
+	first_byte = time_to(curl, CURLINFO_STARTTRANSFER_TIME_T);
+	total = time_to(curl, CURLINFO_TOTAL_TIME_T);
+	if (CURLE_OK != curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &num_connects)) {
+		num_connects = 0;
+	}
+
+	t->requests++;
+	if (num_connects > 0) {
+		t->new_connections++;
+		record_phase(t, REQUEST_DNS, 0, dns);
+		record_phase(t, REQUEST_CONNECT, dns, connect);
+		if (tls > 0) {
+			record_phase(t, REQUEST_TLS, connect, tls);
+		}
+		record_phase(t, REQUEST_SETUP, (tls > 0) ? tls : connect, pretransfer);
+	} else {
+		record_phase(t, REQUEST_SETUP, 0, pretransfer);
+	}
+	/* A request whose response has no body may end before libcurl notes its first byte */
+	if (first_byte < pretransfer) {
+		first_byte = total;
+	}
+	record_phase(t, REQUEST_FIRST_BYTE, pretransfer, first_byte);
+	record_phase(t, REQUEST_TRANSFER, first_byte, total);
+	record_phase(t, REQUEST_TOTAL, 0, total);
+}
+
+/**
+ * Add the timings of one source to those of a destination.
+ */
+void
+request_timings_merge(struct request_timings *dst, const struct request_timings *src)
+{
+	unsigned int phase;
+
+	dst->requests += src->requests;
+	dst->new_connections += src->new_connections;
+	for (phase = 0; phase <= REQUEST_PHASE_MAX; phase++) {
+		histogram_merge(&dst->phases[phase], &src->phases[phase]);
+	}
+}
@@ -0,0 +1,40 @@
+#ifndef REQUEST_TIMING_H_
+#define REQUEST_TIMING_H_
+
+#include <curl/curl.h>
+
+#include "histogram.h"
+
+/*
+ * Breakdown of the time taken by requests issued through libcurl, from the timings libcurl keeps of each transfer,
+ * into the phases of a request: name lookup, TCP connect and TLS handshake, which only a request opening a new
+ * connection goes through, then the wait for the first byte of the response and the transfer of the rest.
+ * Kept apart from each other, slow connection setup, such as that of a proxy which does not keep connections alive,
+ * can be told apart from slow servers.
+ */
+
+/* Phases of a request, each recorded as the time from its start to its end */
+enum request_phase {
+	REQUEST_DNS,         /* Name lookup, of new connections only */
+	REQUEST_CONNECT,     /* TCP connect, after name lookup, of new connections only */
+	REQUEST_TLS,         /* TLS handshake, after TCP connect, of new TLS connections only */
+	REQUEST_SETUP,       /* From connection setup, or the start if reusing a connection, until the request is about to be sent */
+	REQUEST_FIRST_BYTE,  /* From then until libcurl starts the transfer: the first byte of the response, or of the body of an upload */
+	REQUEST_TRANSFER,    /* From then until the end: the rest of the response, or the body of an upload and all of the response */
+	REQUEST_TOTAL,       /* From start to end */
+	REQUEST_PHASE_MAX = REQUEST_TOTAL
+};
+
+/* Timings of one type of request */
+struct request_timings {
+	unsigned long long requests;        /* Number of requests timed */
+	unsigned long long new_connections; /* Number of them which opened a new connection rather than reusing one */
+	struct histogram phases[REQUEST_PHASE_MAX + 1]; /* Duration of each phase in nanoseconds, indexed by phase */
+};
+
+const char *request_phase_name(enum request_phase phase);
+void request_timings_init(struct request_timings *t);
+void request_timings_record(struct request_timings *t, CURL *curl);
+void request_timings_merge(struct request_timings *dst, const struct request_timings *src);
+
+#endif /* REQUEST_TIMING_H_ */
@@ -0,0 +1,824 @@
+#define _GNU_SOURCE /* gethostname */
+#include <stdio.h>   /* fopen, fprintf */
+#include <stdlib.h>  /* malloc, calloc, free, qsort */
+#include <string.h>  /* strcmp, strerror */
+#include <errno.h>   /* errno */
+#include <math.h>    /* sqrt, erfc, fabs */
+#include <time.h>    /* time, gmtime_r, strftime */
+#include <unistd.h>  /* gethostname, sysconf */
+#include <sys/utsname.h> /* uname */
+
+#include <curl/curl.h>
+#include <json/json.h>
+
+#include "results.h"
+#include "bulk.h"
+
+/* Version of the layout of JSON results, checked when they are loaded as a baseline */
+#define RESULTS_VERSION 1
+/* Significance level below which a regression's p-value must fall for it to be flagged */
+#define COMPARE_ALPHA 0.01
+/* Least relative change in median latency or in throughput which is flagged, however significant */
+#define COMPARE_MIN_CHANGE 0.05
+/* Greatest sample sizes for which Mann-Whitney U's p-value is computed exactly, rather than approximated */
+#define MANN_WHITNEY_EXACT_MAX 20
+
+#define ELEMENTSOF(arr) ((sizeof(arr) / sizeof((arr)[0])))
+
+/* Latency percentiles reported for each type of operation */
+static const double percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+static const char *const percentile_names[] = { "p50", "p90", "p99", "p99.9" };
+
+/* Totals of one row of statistics, across one or more Swift threads */
+struct row_totals {
+	unsigned long long ops;    /* Number of successful operations */
+	unsigned long long bytes;  /* Object data transferred by them */
+	unsigned long long errors; /* Number of failed operations */
+	double secs;               /* Duration of the phase in which they were performed */
+};
+
+/* A value observed with a given weight (a number of times), as a sample of a Mann-Whitney U test */
+struct sample {
+	double value;
+	double weight;
+};
+
+int
+parse_results_format(const char *text, enum results_format *format)
+{
+	if (0 == strcmp(text, "json")) {
+		*format = RESULTS_JSON;
+	} else if (0 == strcmp(text, "csv")) {
+		*format = RESULTS_CSV;
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Merge the statistics of the given row across the given Swift threads into the given histograms, and total them.
+ */
+static void
+merge_row(const struct swift_thread_args *args, unsigned int n, unsigned int row, struct histogram *latency, struct histogram *service, struct row_totals *totals)
+{
+	struct timespec start, end;
+	unsigned int i;
+
+	histogram_init(latency);
+	histogram_init(service);
+	totals->bytes = 0;
+	totals->errors = 0;
+	for (i = 0; i < n; i++) {
+		const struct swift_op_stats *stats = swift_row_stats(&args[i], row);
+		histogram_merge(latency, &stats->latency);
+		histogram_merge(service, &stats->service);
+		totals->bytes += stats->bytes;
+		totals->errors += stats->errors;
+	}
+	totals->ops = latency->count;
+	totals->secs = 0;
+	if (0 == totals->ops && 0 == totals->errors) {
+		/* Not performed, perhaps not in any phase */
+		return;
+	}
+	swift_row_window(args, n, row, &start, &end);
+	totals->secs = swift_timespecs_to_secs(&start, &end);
+}
+
+static double
+ops_per_sec(const struct row_totals *totals)
+{
+	return (totals->secs > 0) ? totals->ops / totals->secs : 0.0;
+}
+
+static double
+mb_per_sec(const struct row_totals *totals)
+{
+	return (totals->secs > 0) ? totals->bytes / totals->secs / 1000000 : 0.0;
+}
+
+/**
+ * Return the current time, in UTC, in ISO 8601 format.
+ */
+static const char *
+utc_time(char *buf, size_t len)
+{
+	time_t now = time(NULL);
+	struct tm tm;
+
+	if (NULL == gmtime_r(&now, &tm) || 0 == strftime(buf, len, "%Y-%m-%dT%H:%M:%SZ", &tm)) {
+		return "";
+	}
+	return buf;
+}
+
+/**
+ * Return a JSON object of the mean, percentiles and maximum of the given latencies, in microseconds.
+ */
+static struct json_object *
+latencies_json(const struct histogram *h)
+{
+	struct json_object *obj = json_object_new_object();
+	unsigned int i;
+
+	json_object_object_add(obj, "mean", json_object_new_double(histogram_mean(h) / 1000));
+	for (i = 0; i < ELEMENTSOF(percentiles); i++) {
+		json_object_object_add(obj, percentile_names[i], json_object_new_double(histogram_percentile(h, percentiles[i]) / 1000.0));
+	}
+	json_object_object_add(obj, "max", json_object_new_double(h->max / 1000.0));
+	return obj;
+}
+
+/**
+ * Return a JSON array of the non-empty buckets of the given histogram, each as [value in nanoseconds, count].
+ */
+static struct json_object *
+histogram_json(const struct histogram *h)
+{
+	struct json_object *arr = json_object_new_array();
+	unsigned int i;
+
+	for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		if (h->buckets[i]) {
+			struct json_object *bucket = json_object_new_array();
+			json_object_array_add(bucket, json_object_new_int64((int64_t) histogram_bucket_value(i)));
+			json_object_array_add(bucket, json_object_new_int64((int64_t) h->buckets[i]));
+			json_object_array_add(arr, bucket);
+		}
+	}
+	return arr;
+}
+
+/**
+ * Return a JSON object of the request timings of the given type of operation, merged across the given Swift threads,
+ * with the latency percentiles of each phase timed, or NULL if none of its requests were timed.
+ */
+static struct json_object *
+request_timings_json(const struct swift_thread_args *args, unsigned int n, enum swift_op_type op)
+{
+	struct request_timings *merged;
+	struct json_object *obj, *phases;
+	unsigned int phase, i;
+
+	merged = (struct request_timings *) malloc(sizeof(*merged));
+	if (NULL == merged) {
+		return NULL;
+	}
+	request_timings_init(merged);
+	for (i = 0; i < n; i++) {
+		request_timings_merge(merged, &args[i].timings[op]);
+	}
+	if (0 == merged->requests) {
+		free(merged);
+		return NULL;
+	}
+	obj = json_object_new_object();
+	json_object_object_add(obj, "requests", json_object_new_int64((int64_t) merged->requests));
+	json_object_object_add(obj, "new_connections", json_object_new_int64((int64_t) merged->new_connections));
+	phases = json_object_new_object();
+	for (phase = 0; phase <= REQUEST_PHASE_MAX; phase++) {
+		if (merged->phases[phase].count) {
+			json_object_object_add(phases, request_phase_name(phase), latencies_json(&merged->phases[phase]));
+		}
+	}
+	json_object_object_add(obj, "phases_us", phases);
+	free(merged);
+	return obj;
+}
+
+/**
+ * Return a JSON object of the statistics of each row performed by the given Swift threads,
+ * with the latency histogram of each if requested, and the request timings of each type of operation if timed.
+ */
+static struct json_object *
+operations_json(const struct swift_thread_args *args, unsigned int n, int with_histograms, struct histogram *latency, struct histogram *service)
+{
+	struct json_object *ops = json_object_new_object();
+	unsigned int row;
+
+	for (row = 0; row <= SWIFT_ROW_MAX; row++) {
+		struct row_totals totals;
+		struct json_object *obj;
+
+		merge_row(args, n, row, latency, service, &totals);
+		if (0 == totals.ops && 0 == totals.errors) {
+			continue;
+		}
+		obj = json_object_new_object();
+		json_object_object_add(obj, "ops", json_object_new_int64((int64_t) totals.ops));
+		json_object_object_add(obj, "errors", json_object_new_int64((int64_t) totals.errors));
+		json_object_object_add(obj, "bytes", json_object_new_int64((int64_t) totals.bytes));
+		json_object_object_add(obj, "seconds", json_object_new_double(totals.secs));
+		json_object_object_add(obj, "ops_per_sec", json_object_new_double(ops_per_sec(&totals)));
+		json_object_object_add(obj, "mb_per_sec", json_object_new_double(mb_per_sec(&totals)));
+		json_object_object_add(obj, "latency_us", latencies_json(latency));
+		if (args->rate > 0) {
+			json_object_object_add(obj, "service_us", latencies_json(service));
+		}
+		if (with_histograms) {
+			json_object_object_add(obj, "latency_histogram", histogram_json(latency));
+		}
+		if (args->timings && row <= SWIFT_OP_MAX) {
+			struct json_object *timings = request_timings_json(args, n, row);
+			if (timings) {
+				json_object_object_add(obj, "request_timings", timings);
+			}
+		}
+		json_object_object_add(ops, swift_row_name(row), obj);
+	}
+	return ops;
+}
+
+static struct json_object *
+string_or_null(const char *s)
+{
+	return s ? json_object_new_string(s) : NULL;
+}
+
+static struct json_object *
+config_json(const struct results_config *config)
+{
+	struct json_object *obj = json_object_new_object();
+
+	json_object_object_add(obj, "engine", string_or_null(config->engine));
+	json_object_object_add(obj, "data", string_or_null(config->data));
+	json_object_object_add(obj, "verify", string_or_null(config->verify));
+	json_object_object_add(obj, "num_threads", json_object_new_int64(config->num_threads));
+	json_object_object_add(obj, "iterations", json_object_new_int64(config->iterations));
+	json_object_object_add(obj, "size", json_object_new_int64(config->size));
+	json_object_object_add(obj, "sizes", string_or_null(config->sizes));
+	json_object_object_add(obj, "objects", json_object_new_int64(config->num_objects));
+	json_object_object_add(obj, "containers", json_object_new_int64(config->num_containers));
+	json_object_object_add(obj, "queue_depth", json_object_new_int64(config->queue_depth));
+	json_object_object_add(obj, "key_distribution", string_or_null(config->key_distribution));
+	json_object_object_add(obj, "workload", string_or_null(config->workload));
+	json_object_object_add(obj, "rate", json_object_new_double(config->rate));
+	json_object_object_add(obj, "arrival", string_or_null(config->arrival));
+	json_object_object_add(obj, "segment_size", json_object_new_int64(config->segment_size));
+	json_object_object_add(obj, "segment_connections", json_object_new_int64(config->segment_connections));
+	json_object_object_add(obj, "get_chunk_size", json_object_new_int64(config->get_chunk_size));
+	json_object_object_add(obj, "get_connections", json_object_new_int64(config->get_connections));
+	json_object_object_add(obj, "ramp_up", json_object_new_double(config->ramp_up));
+	json_object_object_add(obj, "warm_up", json_object_new_double(config->warm_up));
+	json_object_object_add(obj, "cool_down", json_object_new_double(config->cool_down));
+	json_object_object_add(obj, "duration", json_object_new_double(config->duration));
+	json_object_object_add(obj, "shared_data", json_object_new_boolean(config->shared_data));
+	json_object_object_add(obj, "shared_setup", json_object_new_boolean(config->shared_setup));
+	json_object_object_add(obj, "keep_dataset", string_or_null(config->keep_dataset));
+	json_object_object_add(obj, "reuse_dataset", string_or_null(config->reuse_dataset));
+	json_object_object_add(obj, "request_timings", json_object_new_boolean(config->request_timings));
+	json_object_object_add(obj, "placement", string_or_null(config->placement));
+	json_object_object_add(obj, "agents", json_object_new_int64(config->num_agents));
+	return obj;
+}
+
+static struct json_object *
+host_json(void)
+{
+	struct json_object *obj = json_object_new_object();
+	char hostname[256];
+	struct utsname uts;
+
+	if (0 == gethostname(hostname, sizeof(hostname))) {
+		hostname[sizeof(hostname) - 1] = '\0';
+		json_object_object_add(obj, "hostname", json_object_new_string(hostname));
+	}
+	if (0 == uname(&uts)) {
+		json_object_object_add(obj, "os", json_object_new_string(uts.sysname));
+		json_object_object_add(obj, "os_release", json_object_new_string(uts.release));
+		json_object_object_add(obj, "machine", json_object_new_string(uts.machine));
+	}
+	json_object_object_add(obj, "cpus", json_object_new_int64(sysconf(_SC_NPROCESSORS_ONLN)));
+	json_object_object_add(obj, "curl", json_object_new_string(curl_version()));
+	json_object_object_add(obj, "data_kernel", json_object_new_string(test_data_kernel_name()));
+	json_object_object_add(obj, "crc_kernel", json_object_new_string(test_data_crc_kernel_name()));
+	return obj;
+}
+
+static struct json_object *
+durations_json(const struct swift_thread_args *args)
+{
+	struct json_object *obj = json_object_new_object();
+
+	json_object_object_add(obj, "total", json_object_new_double(swift_timespecs_to_secs(&args->start_time, &args->end_time)));
+	json_object_object_add(obj, "prefill", json_object_new_double(swift_timespecs_to_secs(&args->start_prefill_time, &args->end_prefill_time)));
+	if (args->workload) {
+		json_object_object_add(obj, "mixed", json_object_new_double(swift_timespecs_to_secs(&args->start_mixed_time, &args->end_mixed_time)));
+	} else {
+		json_object_object_add(obj, "put", json_object_new_double(swift_timespecs_to_secs(&args->start_put_time, &args->end_put_time)));
+		json_object_object_add(obj, "get", json_object_new_double(swift_timespecs_to_secs(&args->start_get_time, &args->end_get_time)));
+	}
+	json_object_object_add(obj, "cleanup", json_object_new_double(swift_timespecs_to_secs(&args->start_cleanup_time, &args->end_cleanup_time)));
+	return obj;
+}
+
+/**
+ * Return the durations of the prefill and the cleanup of all of the given Swift threads together.
+ */
+static struct json_object *
+setup_json(const struct swift_thread_args *args, unsigned int n)
+{
+	struct json_object *obj = json_object_new_object();
+
+	json_object_object_add(obj, "prefill", json_object_new_double(bulk_phase_secs(args, n, BULK_PREFILL)));
+	json_object_object_add(obj, "cleanup", json_object_new_double(bulk_phase_secs(args, n, BULK_CLEANUP)));
+	return obj;
+}
+
+static int
+write_json(FILE *out, const struct results_config *config, const struct swift_thread_args *args, unsigned int n, struct histogram *latency, struct histogram *service)
+{
+	struct json_object *root, *threads;
+	unsigned int i, failed = 0;
+	char now[32];
+
+	root = json_object_new_object();
+	if (NULL == root) {
+		fputs("Out of memory building results\n", stderr);
+		return -1;
+	}
+	json_object_object_add(root, "version", json_object_new_int64(RESULTS_VERSION));
+	json_object_object_add(root, "time", json_object_new_string(utc_time(now, sizeof(now))));
+	json_object_object_add(root, "host", host_json());
+	json_object_object_add(root, "config", config_json(config));
+	json_object_object_add(root, "operations", operations_json(args, n, 1, latency, service));
+	json_object_object_add(root, "durations", setup_json(args, n));
+
+	threads = json_object_new_array();
+	for (i = 0; i < n; i++) {
+		struct json_object *thread = json_object_new_object();
+		json_object_object_add(thread, "thread", json_object_new_int64(args[i].thread_num));
+		json_object_object_add(thread, "error", json_object_new_int64(args[i].scerr));
+		if (args[i].cpu >= 0) {
+			json_object_object_add(thread, "cpu", json_object_new_int64(args[i].cpu));
+			json_object_object_add(thread, "node", json_object_new_int64(args[i].node));
+		}
+		json_object_object_add(thread, "durations", durations_json(&args[i]));
+		json_object_object_add(thread, "operations", operations_json(&args[i], 1, 0, latency, service));
+		json_object_array_add(threads, thread);
+		if (SCERR_SUCCESS != args[i].scerr) {
+			failed++;
+		}
+	}
+	json_object_object_add(root, "failed_threads", json_object_new_int64(failed));
+	json_object_object_add(root, "threads", threads);
+
+	fputs(json_object_to_json_string_ext(root, JSON_C_TO_STRING_PRETTY), out);
+	fputc('\n', out);
+	json_object_put(root);
+	return 0;
+}
+
+/**
+ * Write a CSV row of each row of statistics performed by the given Swift threads, in the given scope.
+ */
+static void
+write_csv_rows(FILE *out, const char *scope, const struct swift_thread_args *args, unsigned int n, struct histogram *latency, struct histogram *service)
+{
+	unsigned int row, i;
+
+	for (row = 0; row <= SWIFT_ROW_MAX; row++) {
+		struct row_totals totals;
+
+		merge_row(args, n, row, latency, service, &totals);
+		if (0 == totals.ops && 0 == totals.errors) {
+			continue;
+		}
+		fprintf(out, "%s,%s,%llu,%llu,%llu,%.6f,%.3f,%.3f,%.3f",
+			scope, swift_row_name(row), totals.ops, totals.errors, totals.bytes, totals.secs,
+			ops_per_sec(&totals), mb_per_sec(&totals), histogram_mean(latency) / 1000);
+		for (i = 0; i < ELEMENTSOF(percentiles); i++) {
+			fprintf(out, ",%.3f", histogram_percentile(latency, percentiles[i]) / 1000.0);
+		}
+		fprintf(out, ",%.3f\n", latency->max / 1000.0);
+	}
+}
+
+static int
+write_csv(FILE *out, const struct results_config *config, const struct swift_thread_args *args, unsigned int n, struct histogram *latency, struct histogram *service)
+{
+	struct utsname uts;
+	char now[32], hostname[256];
+	unsigned int i;
+
+	fprintf(out, "# version=%d\n", RESULTS_VERSION);
+	fprintf(out, "# time=%s\n", utc_time(now, sizeof(now)));
+	if (0 == gethostname(hostname, sizeof(hostname))) {
+		hostname[sizeof(hostname) - 1] = '\0';
+		fprintf(out, "# hostname=%s\n", hostname);
+	}
+	if (0 == uname(&uts)) {
+		fprintf(out, "# os=%s %s %s\n", uts.sysname, uts.release, uts.machine);
+	}
+	fprintf(out, "# cpus=%ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+	fprintf(out, "# curl=%s\n", curl_version());
+	fprintf(out, "# data_kernel=%s\n# crc_kernel=%s\n", test_data_kernel_name(), test_data_crc_kernel_name());
+	fprintf(out, "# engine=%s\n# data=%s\n# verify=%s\n", config->engine, config->data, config->verify);
+	fprintf(out, "# num_threads=%u\n# iterations=%u\n# size=%lu\n# objects=%lu\n# containers=%u\n# queue_depth=%u\n",
+		config->num_threads, config->iterations, config->size, config->num_objects, config->num_containers, config->queue_depth);
+	if (config->sizes) {
+		fprintf(out, "# sizes=%s\n", config->sizes);
+	}
+	if (config->key_distribution) {
+		fprintf(out, "# key_distribution=%s\n", config->key_distribution);
+	}
+	if (config->workload) {
+		fprintf(out, "# workload=%s\n", config->workload);
+	}
+	fprintf(out, "# rate=%g\n# arrival=%s\n", config->rate, config->arrival);
+	fprintf(out, "# segment_size=%lu\n# segment_connections=%u\n# get_chunk_size=%lu\n# get_connections=%u\n",
+		config->segment_size, config->segment_connections, config->get_chunk_size, config->get_connections);
+	fprintf(out, "# ramp_up=%g\n# warm_up=%g\n# cool_down=%g\n# duration=%g\n# shared_data=%u\n# shared_setup=%u\n# request_timings=%u\n",
+		config->ramp_up, config->warm_up, config->cool_down, config->duration, config->shared_data, config->shared_setup, config->request_timings);
+	fprintf(out, "# prefill_secs=%.6f\n# cleanup_secs=%.6f\n", bulk_phase_secs(args, n, BULK_PREFILL), bulk_phase_secs(args, n, BULK_CLEANUP));
+	fprintf(out, "# placement=%s\n# agents=%u\n", config->placement, config->num_agents);
+	if (config->keep_dataset) {
+		fprintf(out, "# keep_dataset=%s\n", config->keep_dataset);
+	}
+	if (config->reuse_dataset) {
+		fprintf(out, "# reuse_dataset=%s\n", config->reuse_dataset);
+	}
+	for (i = 0; i < n; i++) {
+		if (args[i].cpu >= 0) {
+			fprintf(out, "# thread%u_cpu=%d\n# thread%u_node=%d\n", args[i].thread_num, args[i].cpu, args[i].thread_num, args[i].node);
+		}
+	}
+
+	fputs("scope,op,ops,errors,bytes,seconds,ops_per_sec,mb_per_sec,latency_mean_us", out);
+	for (i = 0; i < ELEMENTSOF(percentiles); i++) {
+		fprintf(out, ",latency_%s_us", percentile_names[i]);
+	}
+	fputs(",latency_max_us\n", out);
+
+	write_csv_rows(out, "all", args, n, latency, service);
+	for (i = 0; i < n; i++) {
+		char scope[32];
+		snprintf(scope, sizeof(scope), "thread%u", args[i].thread_num);
+		write_csv_rows(out, scope, &args[i], 1, latency, service);
+	}
+	return 0;
+}
+
+/**
+ * Write the results of the given Swift threads' run in the given format to the file at the given path,
+ * or to standard output if the path is "-". Returns zero on success, or else -1.
+ */
+int
+results_write(const char *path, enum results_format format, const struct results_config *config, const struct swift_thread_args *args, unsigned int n)
+{
+	struct histogram *merged;
+	FILE *out;
+	int ret;
+
+	merged = malloc(2 * sizeof(*merged));
+	if (NULL == merged) {
+		perror("malloc");
+		return -1;
+	}
+	if (0 == strcmp(path, "-")) {
+		out = stdout;
+	} else {
+		out = fopen(path, "w");
+		if (NULL == out) {
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+			free(merged);
+			return -1;
+		}
+	}
+
+	if (RESULTS_JSON == format) {
+		ret = write_json(out, config, args, n, &merged[0], &merged[1]);
+	} else {
+		ret = write_csv(out, config, args, n, &merged[0], &merged[1]);
+	}
+
+	if (stdout == out) {
+		if (0 != fflush(out)) {
+			perror("fflush");
+			ret = -1;
+		}
+	} else if (0 != fclose(out)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		ret = -1;
+	}
+	free(merged);
+	return ret;
+}
+
+static int
+compare_samples(const void *a, const void *b)
+{
+	double va = ((const struct sample *) a)->value, vb = ((const struct sample *) b)->value;
+	return (va > vb) - (va < vb);
+}
+
+/**
+ * Return the exact probability, if the two samples' values were drawn from the same distribution,
+ * of a Mann-Whitney U statistic of the first over the second of at least u, for samples of the given sizes
+ * without ties. Returns a negative value if out of memory.
+ */
+static double
+mann_whitney_exact(unsigned int n1, unsigned int n2, double u)
+{
+	unsigned int umax = n1 * n2, i, j, k;
+	double *counts, total = 0, tail = 0;
+
+	/* counts[(i * (n2 + 1) + j) * (umax + 1) + k]: orderings of i values of the first sample and j of the second with U = k */
+	counts = calloc((size_t) (n1 + 1) * (n2 + 1) * (umax + 1), sizeof(*counts));
+	if (NULL == counts) {
+		return -1;
+	}
+#define COUNT(i, j, k) counts[((size_t) (i) * (n2 + 1) + (j)) * (umax + 1) + (k)]
+	for (i = 0; i <= n1; i++) {
+		for (j = 0; j <= n2; j++) {
+			if (0 == i || 0 == j) {
+				COUNT(i, j, 0) = 1;
+				continue;
+			}
+			for (k = 0; k <= i * j; k++) {
+				/* The largest value is either of the first sample, exceeding all j of the second, or of the second */
+				COUNT(i, j, k) = ((k >= j) ? COUNT(i - 1, j, k - j) : 0) + COUNT(i, j - 1, k);
+			}
+		}
+	}
+	for (k = 0; k <= umax; k++) {
+		total += COUNT(n1, n2, k);
+		if (k >= u) {
+			tail += COUNT(n1, n2, k);
+		}
+	}
+#undef COUNT
+	free(counts);
+	return tail / total;
+}
+
+/**
+ * Return the one-sided p-value of a Mann-Whitney U test of whether the values of the first sample tend to be
+ * greater than those of the second. Each sample is sorted in place. Small samples without ties are tested
+ * exactly; others by the normal approximation, corrected for ties and for continuity.
+ * Returns a negative value if out of memory.
+ */
+static double
+mann_whitney_greater(struct sample *x, size_t nx, struct sample *y, size_t ny)
+{
+	double n1 = 0, n2 = 0, rank_sum = 0, ranked = 0, ties = 0, u, mean, var, big_n;
+	size_t i = 0, j = 0;
+	int unit_weights = 1;
+
+	qsort(x, nx, sizeof(*x), compare_samples);
+	qsort(y, ny, sizeof(*y), compare_samples);
+	while (i < nx || j < ny) {
+		double value, wx = 0, wy = 0, t;
+
+		value = (j >= ny || (i < nx && x[i].value <= y[j].value)) ? x[i].value : y[j].value;
+		for (; i < nx && x[i].value == value; i++) {
+			wx += x[i].weight;
+			unit_weights &= (1 == x[i].weight);
+		}
+		for (; j < ny && y[j].value == value; j++) {
+			wy += y[j].weight;
+			unit_weights &= (1 == y[j].weight);
+		}
+		/* Each of the tied values takes the mean of the ranks which they span */
+		t = wx + wy;
+		rank_sum += wx * (ranked + (t + 1) / 2);
+		ranked += t;
+		ties += t * t * t - t;
+		n1 += wx;
+		n2 += wy;
+	}
+	if (0 == n1 || 0 == n2) {
+		return 1.0;
+	}
+	u = rank_sum - n1 * (n1 + 1) / 2;
+
+	if (unit_weights && 0 == ties && n1 <= MANN_WHITNEY_EXACT_MAX && n2 <= MANN_WHITNEY_EXACT_MAX) {
+		return mann_whitney_exact((unsigned int) n1, (unsigned int) n2, u);
+	}
+	big_n = n1 + n2;
+	mean = n1 * n2 / 2;
+	var = n1 * n2 / 12 * ((big_n + 1) - ties / (big_n * (big_n - 1)));
+	if (var <= 0) {
+		return 1.0;
+	}
+	return 0.5 * erfc((u - mean - 0.5) / sqrt(var) / sqrt(2.0));
+}
+
+/**
+ * Return the least one-sided p-value which a Mann-Whitney U test of samples of the given sizes can give:
+ * that of every value of one exceeding every value of the other, one of all of their orderings.
+ */
+static double
+mann_whitney_least_p(size_t n1, size_t n2)
+{
+	double orderings = 1;
+	size_t i;
+
+	for (i = 1; i <= n2; i++) {
+		orderings = orderings * (n1 + i) / i;
+	}
+	return 1 / orderings;
+}
+
+static struct json_object *
+json_get(struct json_object *obj, const char *key)
+{
+	struct json_object *value = NULL;
+
+	if (NULL == obj || !json_object_object_get_ex(obj, key, &value)) {
+		return NULL;
+	}
+	return value;
+}
+
+/**
+ * Print a comparison of one measure of one row with the baseline, flagged if it is a regression.
+ * Returns whether it is.
+ */
+static int
+report_comparison(const char *name, const char *measure, double baseline, double current, double p, double worse)
+{
+	double change = (baseline > 0) ? (current - baseline) / baseline : 0.0;
+	int regression = (p >= 0 && p < COMPARE_ALPHA && worse * change >= COMPARE_MIN_CHANGE);
+
+	fprintf(stderr, "%6s: %-16s %12.3f -> %12.3f (%+7.2f%%)  p %.6f%s\n",
+		name, measure, baseline, current, change * 100, p, regression ? "  REGRESSION" : "");
+	return regression;
+}
+
+/**
+ * Compare the latency of one row, across all Swift threads, with that of the baseline.
+ * Returns whether it has regressed, or -1 on error.
+ */
+static int
+compare_latency(const char *name, struct json_object *base_op, const struct histogram *latency)
+{
+	struct json_object *base_hist = json_get(base_op, "latency_histogram");
+	struct sample *current, *baseline;
+	size_t num_current = 0, num_baseline, i;
+	double p;
+
+	if (NULL == base_hist || !json_object_is_type(base_hist, json_type_array)) {
+		fprintf(stderr, "%6s: baseline has no latency histogram\n", name);
+		return -1;
+	}
+	num_baseline = json_object_array_length(base_hist);
+	current = malloc((HISTOGRAM_BUCKETS + num_baseline) * sizeof(*current));
+	if (NULL == current) {
+		perror("malloc");
+		return -1;
+	}
+	baseline = &current[HISTOGRAM_BUCKETS];
+	for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		if (latency->buckets[i]) {
+			current[num_current].value = (double) histogram_bucket_value(i);
+			current[num_current].weight = (double) latency->buckets[i];
+			num_current++;
+		}
+	}
+	for (i = 0; i < num_baseline; i++) {
+		struct json_object *bucket = json_object_array_get_idx(base_hist, i);
+		if (!json_object_is_type(bucket, json_type_array) || 2 != json_object_array_length(bucket)) {
+			fprintf(stderr, "%6s: baseline latency histogram is malformed\n", name);
+			free(current);
+			return -1;
+		}
+		baseline[i].value = json_object_get_double(json_object_array_get_idx(bucket, 0));
+		baseline[i].weight = json_object_get_double(json_object_array_get_idx(bucket, 1));
+	}
+
+	p = mann_whitney_greater(current, num_current, baseline, num_baseline);
+	free(current);
+	if (p < 0) {
+		perror("calloc");
+		return -1;
+	}
+	return report_comparison(name, "latency p50 us", json_object_get_double(json_get(json_get(base_op, "latency_us"), "p50")),
+		histogram_percentile(latency, 50.0) / 1000.0, p, 1.0);
+}
+
+/**
+ * Compare the throughput of one row with that of the baseline, testing the throughput of each Swift thread.
+ * Returns whether it has regressed, or -1 on error.
+ */
+static int
+compare_throughput(const char *name, unsigned int row, struct json_object *base_op, struct json_object *base_threads, const struct swift_thread_args *args, unsigned int n, const struct row_totals *totals)
+{
+	struct sample *current, *baseline;
+	size_t num_current = 0, num_baseline = 0, max_baseline, i;
+	double p;
+
+	max_baseline = (base_threads && json_object_is_type(base_threads, json_type_array)) ? json_object_array_length(base_threads) : 0;
+	current = malloc((n + max_baseline) * sizeof(*current));
+	if (NULL == current) {
+		perror("malloc");
+		return -1;
+	}
+	baseline = &current[n];
+	for (i = 0; i < n; i++) {
+		const struct swift_op_stats *stats = swift_row_stats(&args[i], row);
+		struct timespec start, end;
+		double secs;
+
+		if (0 == stats->latency.count) {
+			continue;
+		}
+		swift_row_window(&args[i], 1, row, &start, &end);
+		secs = swift_timespecs_to_secs(&start, &end);
+		current[num_current].value = (secs > 0) ? stats->latency.count / secs : 0.0;
+		current[num_current].weight = 1;
+		num_current++;
+	}
+	for (i = 0; i < max_baseline; i++) {
+		struct json_object *thread_op = json_get(json_get(json_object_array_get_idx(base_threads, i), "operations"), name);
+		struct json_object *rate = json_get(thread_op, "ops_per_sec");
+		if (NULL == rate || 0 == json_object_get_int64(json_get(thread_op, "ops"))) {
+			continue;
+		}
+		baseline[num_baseline].value = json_object_get_double(rate);
+		baseline[num_baseline].weight = 1;
+		num_baseline++;
+	}
+
+	/* Too few threads on either side cannot show a significant change, however large */
+	if (mann_whitney_least_p(num_baseline, num_current) >= COMPARE_ALPHA) {
+		double before = json_object_get_double(json_get(base_op, "ops_per_sec")), after = ops_per_sec(totals);
+
+		free(current);
+		fprintf(stderr, "%6s: %-16s %12.3f -> %12.3f (%+7.2f%%)  insufficient samples: %zu and %zu threads cannot give p < %g\n",
+			name, "throughput ops/s", before, after, (before > 0) ? (after - before) / before * 100 : 0.0, num_baseline, num_current, COMPARE_ALPHA);
+		return 0;
+	}
+
+	/* Throughput regresses if the baseline's tends to be greater */
+	p = mann_whitney_greater(baseline, num_baseline, current, num_current);
+	free(current);
+	if (p < 0) {
+		perror("calloc");
+		return -1;
+	}
+	return report_comparison(name, "throughput ops/s", json_object_get_double(json_get(base_op, "ops_per_sec")), ops_per_sec(totals), p, -1.0);
+}
+
+/**
+ * Compare the throughput and latency of each type of operation of the given Swift threads' run with those of
+ * the baseline run whose JSON results are at the given path, by one-sided Mann-Whitney U tests: of the latencies
+ * of all operations, and of the throughputs of each Swift thread if there are enough. A regression is flagged if it is both
+ * significant and large enough to matter. Returns the number of regressions, or -1 on error.
+ */
+int
+results_compare(const char *baseline_path, const struct swift_thread_args *args, unsigned int n)
+{
+	struct json_object *root, *base_ops, *base_threads;
+	struct histogram *merged;
+	unsigned int row;
+	int regressions = 0, ret;
+
+	root = json_object_from_file(baseline_path);
+	if (NULL == root) {
+		fprintf(stderr, "%s: cannot load baseline results as JSON\n", baseline_path);
+		return -1;
+	}
+	if (RESULTS_VERSION != json_object_get_int64(json_get(root, "version"))
+		|| NULL == (base_ops = json_get(root, "operations"))
+	) {
+		fprintf(stderr, "%s: not results of version %d\n", baseline_path, RESULTS_VERSION);
+		json_object_put(root);
+		return -1;
+	}
+	base_threads = json_get(root, "threads");
+	merged = malloc(2 * sizeof(*merged));
+	if (NULL == merged) {
+		perror("malloc");
+		json_object_put(root);
+		return -1;
+	}
+
+	fprintf(stderr, "Comparison with baseline %s (one-sided Mann-Whitney U tests, flagged if p < %g and change at least %g%%):\n",
+		baseline_path, COMPARE_ALPHA, COMPARE_MIN_CHANGE * 100);
+	for (row = 0; row <= SWIFT_ROW_MAX && regressions >= 0; row++) {
+		const char *name = swift_row_name(row);
+		struct json_object *base_op = json_get(base_ops, name);
+		struct row_totals totals;
+
+		merge_row(args, n, row, &merged[0], &merged[1], &totals);
+		if (0 == totals.ops) {
+			continue;
+		}
+		if (NULL == base_op || 0 == json_object_get_int64(json_get(base_op, "ops"))) {
+			fprintf(stderr, "%6s: not in baseline\n", name);
+			continue;
+		}
+		ret = compare_throughput(name, row, base_op, base_threads, args, n, &totals);
+		if (ret >= 0) {
+			regressions += ret;
+			ret = compare_latency(name, base_op, &merged[0]);
+		}
+		regressions = (ret < 0) ? -1 : regressions + ret;
+	}
+
+	free(merged);
+	json_object_put(root);
+	return regressions;
+}
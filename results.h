@@ -0,0 +1,55 @@
+#ifndef RESULTS_H_
+#define RESULTS_H_
+
+#include "swift-thread.h"
+
+/*
+ * Machine-readable results of a run: its configuration, the host on which it ran, and the throughput,
+ * latency and errors of each type of operation, aggregated across all Swift threads and for each,
+ * and, in JSON, the breakdown of its requests' time into phases if requests were timed,
+ * written as JSON or CSV; and the comparison of a run with a baseline run's JSON results, flagging
+ * statistically significant regressions of throughput or latency.
+ */
+
+/* Formats in which results may be written */
+enum results_format {
+	RESULTS_JSON, /* A single JSON object, including each type of operation's latency histogram */
+	RESULTS_CSV   /* Comment lines of configuration and host, then one row per type of operation per scope */
+};
+
+/* Configuration of a run, as given on the command line */
+struct results_config {
+	const char *engine;              /* Engine name */
+	const char *data;                /* Type of test data, as given */
+	const char *verify;              /* Data-verification mode */
+	unsigned int num_threads;        /* Number of Swift threads, of each agent if distributed */
+	unsigned int iterations;         /* Number of iterations */
+	unsigned long size;              /* Size in bytes of each object, or of the largest if sizes vary */
+	const char *sizes;               /* Distribution of object sizes, as given, or NULL if all are of size */
+	unsigned long num_objects;       /* Number of objects of each Swift thread */
+	unsigned int num_containers;     /* Number of containers of each Swift thread */
+	unsigned int queue_depth;        /* Queue depth of the multi engine */
+	const char *key_distribution;    /* Key distribution, as given, or NULL if given by the workload */
+	const char *workload;            /* Workload, as given, or NULL */
+	double rate;                     /* Operations per second across all Swift threads, or zero */
+	const char *arrival;             /* Arrival process */
+	unsigned long segment_size;      /* Segment size, or zero */
+	unsigned int segment_connections; /* Connections per Swift thread for segments */
+	unsigned long get_chunk_size;    /* Chunk size of gets, or zero */
+	unsigned int get_connections;    /* Connections per Swift thread for chunks */
+	double ramp_up, warm_up, cool_down; /* Phase durations in seconds */
+	double duration;                 /* Duration in seconds of each measured phase, or zero if given by iterations */
+	unsigned int shared_data;        /* Whether test data was shared */
+	unsigned int shared_setup;       /* Whether Swift threads shared the prefill and cleanup */
+	const char *keep_dataset;        /* Manifest of the dataset kept, or NULL */
+	const char *reuse_dataset;       /* Manifest of the dataset reused, or NULL */
+	unsigned int request_timings;    /* Whether requests were timed */
+	const char *placement;           /* Placement policy of Swift threads, as given */
+	unsigned int num_agents;         /* Number of agents of a distributed run, or zero */
+};
+
+int parse_results_format(const char *text, enum results_format *format);
+int results_write(const char *path, enum results_format format, const struct results_config *config, const struct swift_thread_args *args, unsigned int n);
+int results_compare(const char *baseline_path, const struct swift_thread_args *args, unsigned int n);
+
+#endif /* RESULTS_H_ */
@@ -0,0 +1,15 @@
+#!/bin/sh
+
+scriptdir=$( dirname "$0" )
+port=${PORT:-8080}
+"$scriptdir/Debug/test-swift-server" --port "$port" &
+server_pid=$!
+trap 'kill $server_pid' EXIT
+sleep 1
+export OS_AUTH_URL=http://127.0.0.1:$port/v2.0
+export OS_TENANT_NAME=test
+export OS_USERNAME=test
+export OS_PASSWORD=test
+unset http_proxy
+export LD_LIBRARY_PATH=$LD_LIBRARY_PATH:$scriptdir/../swift-client/Debug:$scriptdir/../keystone-client/Debug
+"$scriptdir/Debug/test-swift-client" "$@"
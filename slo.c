@@ -0,0 +1,420 @@
+#include <stdio.h>   /* snprintf, fprintf */
+#include <stdlib.h>  /* calloc, realloc, free */
+#include <string.h>  /* memset, memcpy, strlen */
+
+#include "slo.h"
+
+/* Appended to an object's URL to make the URL of each of its segments */
+#define SEGMENT_INFIX "/segments/"
+/* Appended to an object's URL to put a manifest, or to delete a manifest and its segments */
+#define MANIFEST_PUT_QUERY "?multipart-manifest=put"
+#define MANIFEST_DELETE_QUERY "?multipart-manifest=delete"
+/* Longest manifest entry beyond its segment path */
+#define MANIFEST_ENTRY_OVERHEAD 64
+
+#ifdef min
+#undef min
+#endif
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+/**
+ * Acquire the pool of connections and other resources of uploads, if objects are to be segmented.
+ */
+void
+slo_init(struct slo_uploader *up, struct swift_thread_args *args)
+{
+	CURLMcode mres = CURLM_OK;
+	unsigned int i;
+
+	memset(up, 0, sizeof(*up));
+	up->args = args;
+	if (0 == args->segment_size || SCERR_SUCCESS != args->scerr) {
+		return;
+	}
+
+	up->multi = curl_multi_init();
+	up->conns = (struct slo_connection *) calloc(args->segment_connections, sizeof(*up->conns));
+	up->segment_counts = (unsigned int *) calloc(args->num_objects, sizeof(*up->segment_counts));
+	up->segment_crcs = (uint32_t *) calloc(SLO_MAX_SEGMENTS, sizeof(*up->segment_crcs));
+	up->headers = swift_http_auth_headers(args->auth_token);
+	if (NULL == up->multi || NULL == up->conns || NULL == up->segment_counts || NULL == up->segment_crcs || NULL == up->headers) {
+		args->scerr = SCERR_ALLOC_FAILED;
+		return;
+	}
+	for (i = 0; i < args->segment_connections; i++) {
+		up->conns[i].curl = curl_easy_init();
+		if (NULL == up->conns[i].curl) {
+			args->scerr = SCERR_INIT_FAILED;
+			return;
+		}
+	}
+
+	/* Keep no more connections than the pool, multiplexing segments over them where HTTP/2 allows */
+	mres = curl_multi_setopt(up->multi, CURLMOPT_MAX_HOST_CONNECTIONS, (long) args->segment_connections);
+	if (CURLM_OK == mres) {
+		mres = curl_multi_setopt(up->multi, CURLMOPT_PIPELINING, (long) CURLPIPE_MULTIPLEX);
+	}
+	if (CURLM_OK != mres) {
+		fprintf(stderr, "curl_multi_setopt: %s\n", curl_multi_strerror(mres));
+		args->scerr = SCERR_INIT_FAILED;
+	}
+}
+
+/**
+ * Release everything held by the uploader. Usable as a pthread cleanup handler.
+ */
+void
+slo_free(void *arg)
+{
+	struct slo_uploader *up = (struct slo_uploader *) arg;
+	unsigned int i;
+
+	if (up->conns) {
+		for (i = 0; i < up->args->segment_connections; i++) {
+			if (up->conns[i].curl) {
+				curl_easy_cleanup(up->conns[i].curl);
+			}
+		}
+		free(up->conns);
+	}
+	if (up->multi) {
+		curl_multi_cleanup(up->multi);
+	}
+	if (up->headers) {
+		curl_slist_free_all(up->headers);
+	}
+	free(up->segment_counts);
+	free(up->segment_crcs);
+	free(up->manifest);
+	memset(up, 0, sizeof(*up));
+}
+
+/**
+ * Supply the next part of the manifest being put.
+ */
+static size_t
+supply_manifest(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	struct slo_uploader *up = (struct slo_uploader *) userdata;
+
+	size = min(size * nmemb, up->manifest_len - up->manifest_off);
+	memcpy(ptr, up->manifest + up->manifest_off, size);
+	up->manifest_off += size;
+
+	return size;
+}
+
+/**
+ * Build the URL of the given segment of the object at the given URL.
+ */
+static enum swift_error
+segment_url(const char *url, unsigned int segment, char *buf, size_t len)
+{
+	int ret = snprintf(buf, len, "%s" SEGMENT_INFIX "%08u", url, segment);
+
+	return (ret < 0 || (size_t) ret >= len) ? SCERR_INVARG : SCERR_SUCCESS;
+}
+
+/**
+ * Set up the given connection to put the given length of the given object's test data from the given offset,
+ * to the given URL. Its easy handle is performed by the caller.
+ */
+static enum swift_error
+prepare_data_put(struct slo_uploader *up, struct slo_connection *conn, const char *url, unsigned long object, uint64_t off, uint64_t end)
+{
+	struct swift_thread_args *args = up->args;
+	enum swift_error scerr;
+	CURLcode res;
+
+	scerr = swift_http_prepare(&args->swift, conn->curl, SWIFT_HTTP_PUT, url, up->headers, args->proxy, args->debug);
+	if (SCERR_SUCCESS != scerr) {
+		return scerr;
+	}
+	/* The source supplies the data from the offset at which it starts, up to the offset at which it ends */
+	test_data_source_init(&conn->supply_args.source, args->data_type, args->thread_num, object);
+	conn->supply_args.hash = (VERIFY_HASH == args->verify_data);
+	conn->supply_args.crc = 0;
+	conn->supply_args.off = off;
+	conn->supply_args.len = end;
+	res = curl_easy_setopt(conn->curl, CURLOPT_READFUNCTION, supply_data);
+	if (CURLE_OK == res) {
+		res = curl_easy_setopt(conn->curl, CURLOPT_READDATA, &conn->supply_args);
+	}
+	if (CURLE_OK == res) {
+		res = curl_easy_setopt(conn->curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t) (end - off));
+	}
+	if (CURLE_OK == res) {
+		res = curl_easy_setopt(conn->curl, CURLOPT_PRIVATE, conn);
+	}
+	if (CURLE_OK != res) {
+		args->swift.curl_error("curl_easy_setopt", res);
+		return SCERR_INVARG;
+	}
+	return SCERR_SUCCESS;
+}
+
+/**
+ * Start putting the given segment of the given object, of the given total length, on the given connection.
+ */
+static enum swift_error
+start_segment(struct slo_uploader *up, struct slo_connection *conn, const char *url, unsigned long object, unsigned int segment, size_t len)
+{
+	uint64_t off = (uint64_t) segment * up->args->segment_size;
+	enum swift_error scerr;
+	CURLMcode mres;
+
+	scerr = segment_url(url, segment, conn->url, sizeof(conn->url));
+	if (SCERR_SUCCESS == scerr) {
+		scerr = prepare_data_put(up, conn, conn->url, object, off, min(off + up->args->segment_size, len));
+	}
+	if (SCERR_SUCCESS == scerr) {
+		conn->segment = segment;
+		conn->start = swift_clock_nanosecs();
+		mres = curl_multi_add_handle(up->multi, conn->curl);
+		if (CURLM_OK != mres) {
+			fprintf(stderr, "curl_multi_add_handle: %s\n", curl_multi_strerror(mres));
+			scerr = SCERR_INIT_FAILED;
+		}
+	}
+	return scerr;
+}
+
+/**
+ * Put all segments of the given object, as many at once as there are connections in the pool,
+ * starting the next on each connection as soon as the last completes.
+ * After any failure, those in flight are completed but no more are started.
+ */
+static enum swift_error
+put_segments(struct slo_uploader *up, const char *url, unsigned long object, unsigned int num_segments, size_t len, struct swift_op_stats *segment_stats)
+{
+	struct swift_thread_args *args = up->args;
+	enum swift_error scerr = SCERR_SUCCESS, result;
+	unsigned int next = 0, in_flight = 0, i;
+	CURLMcode mres;
+	CURLMsg *msg;
+	int running, msgs_left;
+
+	for (i = 0; i < args->segment_connections && next < num_segments && SCERR_SUCCESS == scerr; i++) {
+		scerr = start_segment(up, &up->conns[i], url, object, next++, len);
+		if (SCERR_SUCCESS == scerr) {
+			in_flight++;
+		}
+	}
+
+	while (in_flight) {
+		mres = curl_multi_perform(up->multi, &running);
+		if (CURLM_OK == mres && running) {
+			mres = curl_multi_wait(up->multi, NULL, 0, 1000, NULL);
+		}
+		if (CURLM_OK != mres) {
+			/* Abandon the requests in flight */
+			fprintf(stderr, "curl_multi_perform: %s\n", curl_multi_strerror(mres));
+			for (i = 0; i < args->segment_connections; i++) {
+				curl_multi_remove_handle(up->multi, up->conns[i].curl);
+			}
+			return SCERR_URL_FAILED;
+		}
+		while (NULL != (msg = curl_multi_info_read(up->multi, &msgs_left))) {
+			struct slo_connection *conn = NULL;
+			if (CURLMSG_DONE != msg->msg) {
+				continue;
+			}
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &conn);
+			curl_multi_remove_handle(up->multi, msg->easy_handle);
+			in_flight--;
+			result = swift_http_result(&args->swift, conn->curl, msg->data.result);
+			if (SCERR_SUCCESS != result) {
+				if (SCERR_SUCCESS == scerr) {
+					scerr = result;
+				}
+				continue;
+			}
+			if (segment_stats) {
+				swift_record_op(segment_stats, conn->start, conn->start, conn->supply_args.len - (uint64_t) conn->segment * args->segment_size);
+			}
+			up->segment_crcs[conn->segment] = conn->supply_args.crc;
+			if (SCERR_SUCCESS == scerr && next < num_segments) {
+				scerr = start_segment(up, conn, url, object, next++, len);
+				if (SCERR_SUCCESS == scerr) {
+					in_flight++;
+				}
+			}
+		}
+	}
+	return scerr;
+}
+
+/**
+ * Build the manifest of the given number of segments of the object at the given URL, of the given length.
+ * Each segment's path is its URL beyond the Swift endpoint, decoded.
+ */
+static enum swift_error
+build_manifest(struct slo_uploader *up, const char *url, unsigned int num_segments, size_t len)
+{
+	struct swift_thread_args *args = up->args;
+	size_t endpoint_len = strlen(args->swift_url), used = 0;
+	char seg_url[SWIFT_HTTP_URL_MAX];
+	unsigned int i;
+
+	for (i = 0; i < num_segments; i++) {
+		size_t seg_len = min(args->segment_size, len - (size_t) i * args->segment_size);
+		enum swift_error scerr = segment_url(url, i, seg_url, sizeof(seg_url));
+		char *path;
+		int path_len;
+
+		if (SCERR_SUCCESS != scerr) {
+			return scerr;
+		}
+		path = curl_easy_unescape(up->conns[0].curl, seg_url + endpoint_len, 0, &path_len);
+		if (NULL == path) {
+			return SCERR_ALLOC_FAILED;
+		}
+		if (used + path_len + MANIFEST_ENTRY_OVERHEAD > up->manifest_cap) {
+			size_t cap = 2 * (used + path_len + MANIFEST_ENTRY_OVERHEAD);
+			char *grown = (char *) realloc(up->manifest, cap);
+			if (NULL == grown) {
+				curl_free(path);
+				return SCERR_ALLOC_FAILED;
+			}
+			up->manifest = grown;
+			up->manifest_cap = cap;
+		}
+		/* Generated names need no JSON escaping */
+		used += snprintf(up->manifest + used, up->manifest_cap - used, "%c{\"path\":\"%s\",\"etag\":null,\"size_bytes\":%lu}%s",
+			(0 == i) ? '[' : ',', path, (unsigned long) seg_len, (num_segments - 1 == i) ? "]" : "");
+		curl_free(path);
+	}
+	up->manifest_len = used;
+	up->manifest_off = 0;
+	return SCERR_SUCCESS;
+}
+
+/**
+ * Perform the given request, already set up on the first connection of the pool, outside the multi handle.
+ */
+static enum swift_error
+perform(struct slo_uploader *up)
+{
+	CURL *curl = up->conns[0].curl;
+	CURLcode res;
+
+	/* Discard any response body, such as the report of a delete of a manifest and its segments */
+	res = curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, ignore_data);
+	if (CURLE_OK != res) {
+		up->args->swift.curl_error("curl_easy_setopt", res);
+		return SCERR_INVARG;
+	}
+	return swift_http_result(&up->args->swift, curl, curl_easy_perform(curl));
+}
+
+/**
+ * Delete the given segments of the object at the given URL, one at a time.
+ */
+static enum swift_error
+delete_segments(struct slo_uploader *up, const char *url, unsigned int from, unsigned int to)
+{
+	struct swift_thread_args *args = up->args;
+	struct slo_connection *conn = &up->conns[0];
+	enum swift_error scerr = SCERR_SUCCESS;
+
+	for (; from < to && SCERR_SUCCESS == scerr; from++) {
+		scerr = segment_url(url, from, conn->url, sizeof(conn->url));
+		if (SCERR_SUCCESS == scerr) {
+			scerr = swift_http_prepare(&args->swift, conn->curl, SWIFT_HTTP_DELETE, conn->url, up->headers, args->proxy, args->debug);
+		}
+		if (SCERR_SUCCESS == scerr) {
+			scerr = perform(up);
+		}
+	}
+	return scerr;
+}
+
+/**
+ * Put the given length of the given object's test data to the given URL: as a static large object if it is
+ * longer than one segment, or else as a plain object. Segment puts are recorded in segment_stats, if not NULL.
+ * Sets *crc to the CRC-32C of the whole object if verifying hashes. Any segments of the object's last manifest
+ * which the new data leaves unused are deleted, as Swift clients do when overwriting a large object.
+ */
+enum swift_error
+slo_put(struct slo_uploader *up, const char *url, unsigned long object, size_t len, uint32_t *crc, struct swift_op_stats *segment_stats)
+{
+	struct swift_thread_args *args = up->args;
+	struct slo_connection *conn = &up->conns[0];
+	unsigned int num_segments = (len + args->segment_size - 1) / args->segment_size, i;
+	char manifest_url[SWIFT_HTTP_URL_MAX];
+	enum swift_error scerr;
+	CURLcode res;
+
+	if (num_segments <= 1) {
+		scerr = prepare_data_put(up, conn, url, object, 0, len);
+		if (SCERR_SUCCESS == scerr) {
+			scerr = perform(up);
+		}
+		*crc = conn->supply_args.crc;
+		num_segments = 0;
+	} else {
+		scerr = put_segments(up, url, object, num_segments, len, segment_stats);
+		if (SCERR_SUCCESS == scerr) {
+			scerr = build_manifest(up, url, num_segments, len);
+		}
+		if (SCERR_SUCCESS == scerr && snprintf(manifest_url, sizeof(manifest_url), "%s" MANIFEST_PUT_QUERY, url) >= (int) sizeof(manifest_url)) {
+			scerr = SCERR_INVARG;
+		}
+		if (SCERR_SUCCESS == scerr) {
+			scerr = swift_http_prepare(&args->swift, conn->curl, SWIFT_HTTP_PUT, manifest_url, up->headers, args->proxy, args->debug);
+		}
+		if (SCERR_SUCCESS == scerr) {
+			res = curl_easy_setopt(conn->curl, CURLOPT_READFUNCTION, supply_manifest);
+			if (CURLE_OK == res) {
+				res = curl_easy_setopt(conn->curl, CURLOPT_READDATA, up);
+			}
+			if (CURLE_OK == res) {
+				res = curl_easy_setopt(conn->curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t) up->manifest_len);
+			}
+			if (CURLE_OK != res) {
+				args->swift.curl_error("curl_easy_setopt", res);
+				scerr = SCERR_INVARG;
+			}
+		}
+		if (SCERR_SUCCESS == scerr) {
+			scerr = perform(up);
+		}
+		/* The object's CRC-32C, from those of its segments */
+		*crc = up->segment_crcs[0];
+		for (i = 1; i < num_segments; i++) {
+			*crc = test_data_crc32c_combine(*crc, up->segment_crcs[i], min(args->segment_size, len - (size_t) i * args->segment_size));
+		}
+	}
+
+	if (SCERR_SUCCESS == scerr) {
+		scerr = delete_segments(up, url, num_segments, up->segment_counts[object]);
+		up->segment_counts[object] = num_segments;
+	}
+	return scerr;
+}
+
+/**
+ * Delete the object at the given URL, with all of its segments if it is a static large object.
+ */
+enum swift_error
+slo_delete(struct slo_uploader *up, const char *url, unsigned long object)
+{
+	struct swift_thread_args *args = up->args;
+	char delete_url[SWIFT_HTTP_URL_MAX];
+	enum swift_error scerr = SCERR_SUCCESS;
+
+	if (up->segment_counts[object]) {
+		if (snprintf(delete_url, sizeof(delete_url), "%s" MANIFEST_DELETE_QUERY, url) >= (int) sizeof(delete_url)) {
+			return SCERR_INVARG;
+		}
+		url = delete_url;
+	}
+	scerr = swift_http_prepare(&args->swift, up->conns[0].curl, SWIFT_HTTP_DELETE, url, up->headers, args->proxy, args->debug);
+	if (SCERR_SUCCESS == scerr) {
+		scerr = perform(up);
+	}
+	if (SCERR_SUCCESS == scerr) {
+		up->segment_counts[object] = 0;
+	}
+	return scerr;
+}
@@ -0,0 +1,47 @@
+#ifndef SLO_H_
+#define SLO_H_
+
+#include <stdint.h>  /* uint32_t, uint64_t */
+#include <curl/curl.h>
+
+#include "swift-thread.h"
+#include "swift-http.h"
+
+/*
+ * Upload of objects as Swift static large objects: each object is split into segments, which are put
+ * concurrently over a bounded pool of connections, and then a manifest listing them is put under the
+ * object's own name. The segments of object "name" are the objects "name/segments/<index>" beside it.
+ */
+
+/* Greatest number of segments of a static large object, as Swift's default max_manifest_segments */
+#define SLO_MAX_SEGMENTS 1000
+
+/* One connection of the pool, with the request in flight upon it */
+struct slo_connection {
+	CURL *curl;                          /* Easy handle, reused for each request so that its connection persists */
+	unsigned int segment;                /* Index of the segment being put */
+	struct supply_data_args supply_args; /* Arguments to supply_data while putting the segment */
+	uint64_t start;                      /* Time at which the segment's put started */
+	char url[SWIFT_HTTP_URL_MAX];        /* URL of the segment */
+};
+
+/* Per-thread state of static large object uploads */
+struct slo_uploader {
+	struct swift_thread_args *args;      /* The thread's in/out parameters */
+	CURLM *multi;                        /* Multi handle driving the pool */
+	struct slo_connection *conns;        /* Pool of segment_connections connections */
+	struct curl_slist *headers;          /* Authentication headers */
+	unsigned int *segment_counts;        /* Per object, number of segments of its manifest, or zero if none */
+	uint32_t *segment_crcs;              /* CRC-32C of each segment of the object being put, if verifying hashes */
+	char *manifest;                      /* Manifest of the object being put */
+	size_t manifest_cap;                 /* Allocated length of manifest */
+	size_t manifest_len;                 /* Length of manifest */
+	size_t manifest_off;                 /* Length of manifest already sent */
+};
+
+void slo_init(struct slo_uploader *up, struct swift_thread_args *args);
+void slo_free(void *arg);
+enum swift_error slo_put(struct slo_uploader *up, const char *url, unsigned long object, size_t len, uint32_t *crc, struct swift_op_stats *segment_stats);
+enum swift_error slo_delete(struct slo_uploader *up, const char *url, unsigned long object);
+
+#endif /* SLO_H_ */
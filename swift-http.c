@@ -0,0 +1,159 @@
+#include <stdio.h>   /* snprintf */
+
+#include "swift-http.h"
+
+/**
+ * Supply no data, for requests such as container creation which have an empty body.
+ */
+static size_t
+supply_no_data(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	return 0;
+}
+
+/**
+ * Return a header list carrying the given authentication token, or NULL on allocation failure.
+ * The caller owns the list and must free it with curl_slist_free_all.
+ */
+struct curl_slist *
+swift_http_auth_headers(const char *auth_token)
+{
+	char header[1024];
+
+	snprintf(header, sizeof(header), "X-Auth-Token: %s", auth_token);
+	return curl_slist_append(NULL, header);
+}
+
+/**
+ * Return a header list carrying the given authentication token and the metadata set by a benchmark post,
+ * or NULL on allocation failure. The caller owns the list and must free it with curl_slist_free_all.
+ */
+struct curl_slist *
+swift_http_post_headers(const char *auth_token)
+{
+	struct curl_slist *headers, *list;
+
+	headers = swift_http_auth_headers(auth_token);
+	if (NULL == headers) {
+		return NULL;
+	}
+	list = curl_slist_append(headers, SWIFT_HTTP_POST_METADATA);
+	if (NULL == list) {
+		curl_slist_free_all(headers);
+	}
+	return list;
+}
+
+/**
+ * Replace the given header list, unless it is NULL, with one built by the given function with the given
+ * authentication token. No request in flight may be using the list replaced.
+ */
+enum swift_error
+swift_http_rebuild_headers(struct curl_slist **headers, struct curl_slist *(*build)(const char *auth_token), const char *auth_token)
+{
+	struct curl_slist *list;
+
+	if (NULL == *headers) {
+		return SCERR_SUCCESS;
+	}
+	list = build(auth_token);
+	if (NULL == list) {
+		return SCERR_ALLOC_FAILED;
+	}
+	curl_slist_free_all(*headers);
+	*headers = list;
+	return SCERR_SUCCESS;
+}
+
+/**
+ * Reset the given easy handle and set it up to perform the given request.
+ * The caller then sets any read and write callbacks, and the upload size of a PUT with a body.
+ * headers and url must remain valid until the request completes.
+ */
+enum swift_error
+swift_http_prepare(swift_context_t *swift, CURL *curl, enum swift_http_method method, const char *url, const struct curl_slist *headers, const char *proxy, unsigned int debug)
+{
+	CURLcode res;
+
+	curl_easy_reset(curl);
+
+	res = curl_easy_setopt(curl, CURLOPT_URL, url);
+	if (CURLE_OK == res) {
+		res = curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+	}
+	if (CURLE_OK == res) {
+		/* An empty proxy string disables use of any proxy from the environment */
+		res = curl_easy_setopt(curl, CURLOPT_PROXY, proxy ? proxy : "");
+	}
+	if (CURLE_OK == res) {
+		res = curl_easy_setopt(curl, CURLOPT_VERBOSE, (long) debug);
+	}
+	if (CURLE_OK == res) {
+		res = curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+	}
+	if (CURLE_OK == res) {
+		switch (method) {
+		case SWIFT_HTTP_GET:
+			res = curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+			break;
+		case SWIFT_HTTP_PUT:
+			res = curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+			if (CURLE_OK == res) {
+				/* Empty body unless the caller supplies otherwise */
+				res = curl_easy_setopt(curl, CURLOPT_READFUNCTION, supply_no_data);
+			}
+			if (CURLE_OK == res) {
+				res = curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t) 0);
+			}
+			break;
+		case SWIFT_HTTP_HEAD:
+			res = curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+			break;
+		case SWIFT_HTTP_DELETE:
+			res = curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+			break;
+		case SWIFT_HTTP_POST:
+			res = curl_easy_setopt(curl, CURLOPT_POST, 1L);
+			if (CURLE_OK == res) {
+				res = curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, 0L);
+			}
+			break;
+		}
+	}
+
+	if (CURLE_OK != res) {
+		swift->curl_error("curl_easy_setopt", res);
+		return SCERR_INVARG;
+	}
+	return SCERR_SUCCESS;
+}
+
+/**
+ * Translate the outcome of a completed request into a Swift client error code,
+ * reporting any failure.
+ */
+enum swift_error
+swift_http_result(swift_context_t *swift, CURL *curl, CURLcode res)
+{
+	long response_code = 0;
+	char *url = NULL;
+
+	if (CURLE_OK != res) {
+		swift->curl_error("curl_easy_perform", res);
+		return SCERR_URL_FAILED;
+	}
+	res = curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+	if (CURLE_OK != res) {
+		swift->curl_error("curl_easy_getinfo", res);
+		return SCERR_URL_FAILED;
+	}
+	if (response_code >= 200 && response_code < 300) {
+		return SCERR_SUCCESS;
+	}
+	curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &url);
+	fprintf(stderr, "HTTP response code %ld from %s\n", response_code, url ? url : "(unknown URL)");
+	if (401 == response_code || 403 == response_code) {
+		return SCERR_AUTH_FAILED;
+	}
+	return SCERR_URL_FAILED;
+}
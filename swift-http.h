@@ -0,0 +1,33 @@
+#ifndef SWIFT_HTTP_H_
+#define SWIFT_HTTP_H_
+
+#include <curl/curl.h>
+
+#include "swift-client.h"
+
+/*
+ * Swift requests issued directly through libcurl, bypassing the Swift client library,
+ * for use where the library's blocking, one-request-at-a-time interface does not suffice.
+ */
+
+/* Maximum length of a URL built for a listing page, a static large object's segment or manifest, or a bulk request */
+#define SWIFT_HTTP_URL_MAX 4096
+/* Metadata header set on an object by each benchmark post */
+#define SWIFT_HTTP_POST_METADATA "X-Object-Meta-Swift-Bench: posted"
+
+/* HTTP methods used against Swift */
+enum swift_http_method {
+	SWIFT_HTTP_GET,
+	SWIFT_HTTP_PUT,
+	SWIFT_HTTP_HEAD,
+	SWIFT_HTTP_DELETE,
+	SWIFT_HTTP_POST
+};
+
+struct curl_slist *swift_http_auth_headers(const char *auth_token);
+struct curl_slist *swift_http_post_headers(const char *auth_token);
+enum swift_error swift_http_rebuild_headers(struct curl_slist **headers, struct curl_slist *(*build)(const char *auth_token), const char *auth_token);
+enum swift_error swift_http_prepare(swift_context_t *swift, CURL *curl, enum swift_http_method method, const char *url, const struct curl_slist *headers, const char *proxy, unsigned int debug);
+enum swift_error swift_http_result(swift_context_t *swift, CURL *curl, CURLcode res);
+
+#endif /* SWIFT_HTTP_H_ */
@@ -0,0 +1,980 @@
+/*
+ * swift-multi-thread.c
+ *
+ * Multi-request Swift thread: performs the same workload as swift_thread_func,
+ * but keeps queue_depth requests in flight at once, each in its own request
+ * slot, all driven as non-blocking state machines by a single libcurl multi
+ * handle, with socket readiness delivered through epoll.
+ *
+ * The workload proceeds in phases, as in swift_thread_func; within each phase,
+ * every slot takes the next of the phase's operations as soon as its previous
+ * one completes. When puts and gets are issued at a fixed rate, each of them
+ * instead waits for its arrival time, and then for a slot to become idle.
+ * The warm-up and cool-down repeat the first and last measured phases,
+ * for as long as they last rather than for a number of operations, unrecorded.
+ * If the run has a duration, each measured phase likewise lasts until its deadline.
+ */
+
+#include <stdio.h>     /* fprintf */
+#include <stdlib.h>    /* calloc, free */
+#include <limits.h>    /* ULONG_MAX */
+#include <string.h>    /* memset */
+#include <pthread.h>   /* pthread_* */
+#include <assert.h>    /* assert */
+#include <errno.h>     /* errno */
+#include <unistd.h>    /* close */
+#include <sys/epoll.h> /* epoll_* */
+#include <sys/timerfd.h> /* timerfd_* */
+
+#include "swift-thread.h"
+#include "swift-http.h"
+#include "dataset.h"
+
+/* Maximum number of epoll events to process per wakeup */
+#define MAX_EVENTS 256
+/* Number of times to draw from the key distribution before settling for any object with no request in flight */
+#define MAX_KEY_ATTEMPTS 64
+
+/* Phases of a multi-request Swift thread's workload */
+enum multi_phase {
+	PHASE_CREATE_CONTAINERS, /* Create every container */
+	PHASE_PREFILL,           /* Put every object once */
+	PHASE_PUT,               /* Put objects chosen from the key distribution */
+	PHASE_GET,               /* Get objects chosen from the key distribution */
+	PHASE_MIXED,             /* Perform operations drawn from a mixed workload, instead of PHASE_PUT and PHASE_GET */
+	PHASE_DELETE_OBJECTS,    /* Delete every object */
+	PHASE_DELETE_CONTAINERS  /* Delete every container */
+};
+
+/* Test data transferred by a slot's request */
+enum slot_transfer {
+	TRANSFER_NONE,  /* None, or none to be checked */
+	TRANSFER_PUT,   /* Test data put */
+	TRANSFER_VERIFY /* Test data got, to be verified */
+};
+
+/* A sequence of requests, only one of which is in flight at any time */
+struct request_slot {
+	CURL *curl;                            /* Easy handle, reused for each of the slot's requests */
+	unsigned int busy;                     /* Whether the slot has a request in flight */
+	struct supply_data_args supply_args;   /* Arguments to supply_data during a put */
+	struct compare_data_args compare_args; /* Arguments to compare_data during a get */
+	enum slot_transfer transfer;           /* Test data transferred by the request in flight */
+	unsigned long data_object;             /* Object whose test data the request in flight transfers */
+	enum swift_op_type op;                 /* Type of the measured operation in flight */
+	unsigned long key;                     /* Object addressed by the mixed operation in flight */
+	size_t op_bytes;                       /* Object data transferred by the measured operation in flight */
+	uint64_t op_intended;                  /* Time at which the request in flight was intended to start */
+	uint64_t op_start;                     /* Time at which the request in flight was started */
+	uint64_t page_start;                   /* Time at which the request for the page in flight of a listing was started */
+	struct listing listing;                /* Listing in progress of the mixed operation in flight */
+	unsigned int retired_headers;          /* Whether the request in flight carries the headers of a replaced token */
+};
+
+/* State of a multi-request Swift thread */
+struct multi_state {
+	struct swift_thread_args *args; /* The thread's in/out parameters */
+	CURLM *multi;                   /* Multi handle driving all slots' easy handles */
+	int epoll_fd;                   /* Watches all sockets which the multi handle asks about */
+	uint64_t timer_deadline;        /* Time at which the multi handle wants a timeout action, or zero for none */
+	struct curl_slist *headers;     /* Request headers common to all requests */
+	struct curl_slist *post_headers; /* Request headers of a mixed workload's posts */
+	struct curl_slist *retired_headers; /* Request headers of a replaced token, while requests in flight carry them, or NULL */
+	struct curl_slist *retired_post_headers; /* Post headers of a replaced token, likewise */
+	unsigned int retired_in_flight; /* Number of requests in flight carrying the headers of a replaced token */
+	struct request_slot *slots;     /* Array of queue_depth slots */
+	unsigned int in_flight;         /* Number of slots with a request in flight */
+	enum multi_phase phase;         /* Current phase */
+	unsigned long next_task;        /* Index of the next operation of the current phase to start */
+	unsigned long num_tasks;        /* Number of operations in the current phase */
+	unsigned int discard;           /* Whether the current phase's operations go unrecorded, for as long as it lasts */
+	uint64_t until;                 /* Time at which an unrecorded phase ends, or zero if it lasts the cool-down */
+	uint64_t deadline;              /* Time at which a recorded phase ends, or zero if it lasts a number of operations */
+	struct keyspace keyspace;       /* URLs of the thread's containers and objects */
+	struct key_chooser chooser;     /* Choice of object for each measured put and get */
+	struct workload_state ws;       /* Which objects exist, and their sizes, in a mixed workload */
+	unsigned char *busy_keys;       /* Per object, whether a mixed operation, or a put if sizes vary, upon it is in flight */
+	unsigned int paced;             /* Whether the current phase's operations are issued on the arrival schedule */
+	struct arrival_schedule arrivals; /* Intended start times of paced operations */
+	int arrival_fd;                 /* Timer, watched by epoll_fd, which expires at the next arrival */
+	struct request_slot **idle;     /* Stack of slots with no request in flight, during a paced phase */
+	unsigned int num_idle;          /* Number of slots on the idle stack */
+};
+
+/**
+ * Told by libcurl which events to watch for on a socket.
+ */
+static int
+socket_callback(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp)
+{
+	struct multi_state *ms = (struct multi_state *) userp;
+	struct epoll_event ev;
+	int ret;
+
+	if (CURL_POLL_REMOVE == what) {
+		epoll_ctl(ms->epoll_fd, EPOLL_CTL_DEL, s, NULL);
+		return 0;
+	}
+
+	ev.events = ((what & CURL_POLL_IN) ? EPOLLIN : 0) | ((what & CURL_POLL_OUT) ? EPOLLOUT : 0);
+	ev.data.fd = s;
+	if (socketp) {
+		ret = epoll_ctl(ms->epoll_fd, EPOLL_CTL_MOD, s, &ev);
+	} else {
+		ret = epoll_ctl(ms->epoll_fd, EPOLL_CTL_ADD, s, &ev);
+		if (ret != 0 && EEXIST == errno) {
+			ret = epoll_ctl(ms->epoll_fd, EPOLL_CTL_MOD, s, &ev);
+		}
+		/* Mark the socket as being watched, so that subsequent calls modify rather than add */
+		curl_multi_assign(ms->multi, s, ms);
+	}
+	if (ret != 0) {
+		ms->args->swift.errno_error("epoll_ctl", errno);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Told by libcurl when next to perform a timeout action.
+ */
+static int
+timer_callback(CURLM *multi, long timeout_ms, void *userp)
+{
+	struct multi_state *ms = (struct multi_state *) userp;
+
+	if (timeout_ms < 0) {
+		ms->timer_deadline = 0;
+	} else {
+		ms->timer_deadline = swift_clock_nanosecs() + (uint64_t) timeout_ms * 1000000;
+	}
+	return 0;
+}
+
+/**
+ * Set up the slot to put the given length of test data into the given object.
+ */
+static enum swift_error
+prepare_put(struct multi_state *ms, struct request_slot *slot, unsigned long object, size_t len)
+{
+	struct swift_thread_args *args = ms->args;
+	enum swift_error scerr;
+	CURLcode res;
+
+	scerr = swift_http_prepare(&args->swift, slot->curl, SWIFT_HTTP_PUT, keyspace_object_url(&ms->keyspace, object), ms->headers, args->proxy, args->debug);
+	if (SCERR_SUCCESS != scerr) {
+		return scerr;
+	}
+	test_data_source_init(&slot->supply_args.source, args->data_type, args->thread_num, object);
+	slot->supply_args.hash = (VERIFY_HASH == args->verify_data);
+	slot->supply_args.crc = 0;
+	slot->supply_args.len = len;
+	slot->supply_args.off = 0;
+	slot->transfer = TRANSFER_PUT;
+	slot->data_object = object;
+	res = curl_easy_setopt(slot->curl, CURLOPT_READFUNCTION, supply_data);
+	if (CURLE_OK == res) {
+		res = curl_easy_setopt(slot->curl, CURLOPT_READDATA, &slot->supply_args);
+	}
+	if (CURLE_OK == res) {
+		res = curl_easy_setopt(slot->curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t) len);
+	}
+	if (CURLE_OK != res) {
+		args->swift.curl_error("curl_easy_setopt", res);
+		return SCERR_INVARG;
+	}
+	return SCERR_SUCCESS;
+}
+
+/**
+ * Set up the slot to get the given object, verifying that the given length of its test data is received if so required.
+ * Or, if the given URL is not the object's, get that without verification.
+ */
+static enum swift_error
+prepare_get(struct multi_state *ms, struct request_slot *slot, const char *url, unsigned long object, size_t len, enum verify_mode verify)
+{
+	struct swift_thread_args *args = ms->args;
+	enum swift_error scerr;
+	CURLcode res;
+
+	scerr = swift_http_prepare(&args->swift, slot->curl, SWIFT_HTTP_GET, url, ms->headers, args->proxy, args->debug);
+	if (SCERR_SUCCESS != scerr) {
+		return scerr;
+	}
+	if (VERIFY_NONE != verify) {
+		slot->compare_args.swift = &args->swift;
+		test_data_source_init(&slot->compare_args.source, args->data_type, args->thread_num, object);
+		slot->compare_args.mode = verify;
+		slot->compare_args.crc = 0;
+		slot->compare_args.len = len;
+		slot->compare_args.off = 0;
+		slot->transfer = TRANSFER_VERIFY;
+		slot->data_object = object;
+		res = curl_easy_setopt(slot->curl, CURLOPT_WRITEFUNCTION, compare_data);
+		if (CURLE_OK == res) {
+			res = curl_easy_setopt(slot->curl, CURLOPT_WRITEDATA, &slot->compare_args);
+		}
+	} else {
+		res = curl_easy_setopt(slot->curl, CURLOPT_WRITEFUNCTION, ignore_data);
+	}
+	if (CURLE_OK != res) {
+		args->swift.curl_error("curl_easy_setopt", res);
+		return SCERR_INVARG;
+	}
+	return SCERR_SUCCESS;
+}
+
+/**
+ * Choose the object of the next mixed operation, or put if sizes vary, from the key distribution, avoiding any object
+ * with a request in flight, so that concurrent requests never race upon one object and find it other than expected.
+ * There is always such an object, as there are at least as many objects as slots.
+ */
+static unsigned long
+choose_idle_key(struct multi_state *ms)
+{
+	unsigned long key = key_chooser_next(&ms->chooser);
+	unsigned int attempts;
+
+	for (attempts = 1; ms->busy_keys[key] && attempts < MAX_KEY_ATTEMPTS; attempts++) {
+		key = key_chooser_next(&ms->chooser);
+	}
+	/* If the distribution keeps choosing busy objects, take the next idle one */
+	while (ms->busy_keys[key]) {
+		key = (key + 1) % ms->args->num_objects;
+	}
+	return key;
+}
+
+/**
+ * Set up the slot to perform the next operation of a mixed workload.
+ */
+static enum swift_error
+prepare_mixed(struct multi_state *ms, struct request_slot *slot)
+{
+	struct swift_thread_args *args = ms->args;
+	const struct listing_spec *spec = &args->workload->listing;
+	char prefix[LISTING_NAME_MAX] = "";
+	struct workload_op op;
+
+	workload_next(&ms->ws, choose_idle_key(ms), &op);
+	op.size = swift_thread_object_len(args, op.key, op.size);
+	slot->op = op.op;
+	slot->key = op.key;
+	slot->op_bytes = (SWIFT_OP_PUT == op.op || SWIFT_OP_GET == op.op) ? op.size : 0;
+	ms->busy_keys[op.key] = 1;
+
+	switch (op.op) {
+	case SWIFT_OP_PUT:
+		return prepare_put(ms, slot, op.key, op.size);
+	case SWIFT_OP_GET:
+		return prepare_get(ms, slot, keyspace_object_url(&ms->keyspace, op.key), op.key, op.size, args->verify_data);
+	case SWIFT_OP_HEAD:
+		return swift_http_prepare(&args->swift, slot->curl, SWIFT_HTTP_HEAD, keyspace_object_url(&ms->keyspace, op.key), ms->headers, args->proxy, args->debug);
+	case SWIFT_OP_DELETE:
+		return swift_http_prepare(&args->swift, slot->curl, SWIFT_HTTP_DELETE, keyspace_object_url(&ms->keyspace, op.key), ms->headers, args->proxy, args->debug);
+	case SWIFT_OP_LIST:
+		if (op.account) {
+			listing_init(&slot->listing, spec, args->swift_url, NULL);
+		} else {
+			if (spec->prefix[0]) {
+				keyspace_object_prefix(args->thread_num, args->num_objects, spec->prefix, prefix, sizeof(prefix));
+			}
+			listing_init(&slot->listing, spec, keyspace_container_url(&ms->keyspace, keyspace_object_container(&ms->keyspace, op.key)), prefix);
+		}
+		return listing_prepare_page(&slot->listing, &args->swift, slot->curl, ms->headers, args->proxy, args->debug);
+	case SWIFT_OP_POST:
+		return swift_http_prepare(&args->swift, slot->curl, SWIFT_HTTP_POST, keyspace_object_url(&ms->keyspace, op.key), ms->post_headers, args->proxy, args->debug);
+	}
+	return SCERR_INVARG;
+}
+
+/**
+ * Free the header lists of a replaced token, once no request in flight carries them.
+ */
+static void
+free_retired_headers(struct multi_state *ms)
+{
+	if (ms->retired_headers) {
+		curl_slist_free_all(ms->retired_headers);
+		ms->retired_headers = NULL;
+	}
+	if (ms->retired_post_headers) {
+		curl_slist_free_all(ms->retired_post_headers);
+		ms->retired_post_headers = NULL;
+	}
+}
+
+/**
+ * Adopt any refreshed authentication token, building header lists which carry it. Those of the old token are
+ * kept until no request in flight carries them, and no newer token is adopted until then.
+ */
+static enum swift_error
+keep_token(struct multi_state *ms)
+{
+	struct swift_thread_args *args = ms->args;
+	struct curl_slist *headers, *post_headers = NULL;
+	unsigned int i;
+
+	if (ms->retired_headers || !swift_thread_adopt_token(args)) {
+		return SCERR_SUCCESS;
+	}
+	headers = swift_http_auth_headers(args->auth_token);
+	if (ms->post_headers) {
+		post_headers = swift_http_post_headers(args->auth_token);
+	}
+	if (NULL == headers || (ms->post_headers && NULL == post_headers)) {
+		curl_slist_free_all(headers);
+		curl_slist_free_all(post_headers);
+		return SCERR_ALLOC_FAILED;
+	}
+	ms->retired_headers = ms->headers;
+	ms->retired_post_headers = ms->post_headers;
+	ms->headers = headers;
+	ms->post_headers = post_headers;
+
+	ms->retired_in_flight = 0;
+	for (i = 0; i < args->queue_depth; i++) {
+		ms->slots[i].retired_headers = ms->slots[i].busy;
+		ms->retired_in_flight += ms->slots[i].busy;
+	}
+	if (0 == ms->retired_in_flight) {
+		free_retired_headers(ms);
+	}
+	return SCERR_SUCCESS;
+}
+
+/**
+ * Add the slot's prepared request to the multi handle.
+ */
+static enum swift_error
+add_request(struct multi_state *ms, struct request_slot *slot)
+{
+	CURLMcode mres;
+	CURLcode res;
+
+	res = curl_easy_setopt(slot->curl, CURLOPT_PRIVATE, slot);
+	if (CURLE_OK != res) {
+		ms->args->swift.curl_error("curl_easy_setopt", res);
+		return SCERR_INVARG;
+	}
+	mres = curl_multi_add_handle(ms->multi, slot->curl);
+	if (CURLM_OK != mres) {
+		fprintf(stderr, "curl_multi_add_handle: %s\n", curl_multi_strerror(mres));
+		return SCERR_INIT_FAILED;
+	}
+	slot->busy = 1;
+	ms->in_flight++;
+	return SCERR_SUCCESS;
+}
+
+/**
+ * Issue the slot's next request in the current phase, if any remain.
+ * Returns SCERR_SUCCESS if a request was issued or none remain.
+ */
+static enum swift_error
+start_next_request(struct multi_state *ms, struct request_slot *slot)
+{
+	struct swift_thread_args *args = ms->args;
+	enum swift_error scerr = SCERR_SUCCESS;
+	unsigned long task;
+
+	if (PHASE_DELETE_OBJECTS == ms->phase && swift_thread_tracks_objects(args)) {
+		/* Skip objects deleted during the mixed phase */
+		while (ms->next_task < ms->num_tasks && !workload_object_present(&ms->ws, ms->next_task)) {
+			ms->next_task++;
+		}
+	}
+	if (ms->discard && !(ms->until ? swift_clock_nanosecs() < ms->until : swift_thread_cooling(args))) {
+		/* The unrecorded phase is over: start no more */
+		ms->num_tasks = ms->next_task;
+	}
+	if (ms->next_task >= ms->num_tasks) {
+		return SCERR_SUCCESS;
+	}
+	scerr = keep_token(ms);
+	if (SCERR_SUCCESS != scerr) {
+		return scerr;
+	}
+	task = ms->next_task++;
+	slot->transfer = TRANSFER_NONE;
+
+	switch (ms->phase) {
+	case PHASE_CREATE_CONTAINERS:
+		scerr = swift_http_prepare(&args->swift, slot->curl, SWIFT_HTTP_PUT, keyspace_container_url(&ms->keyspace, task), ms->headers, args->proxy, args->debug);
+		break;
+	case PHASE_PREFILL:
+		scerr = prepare_put(ms, slot, task, swift_thread_object_len(args, task, swift_thread_tracks_objects(args) ? workload_prefill(&ms->ws, task) : args->data_size));
+		break;
+	case PHASE_PUT:
+		slot->op = SWIFT_OP_PUT;
+		if (args->sizes) {
+			/* Each put draws a new size for its object, which no other request may then find otherwise */
+			task = choose_idle_key(ms);
+			slot->key = task;
+			ms->busy_keys[task] = 1;
+		} else {
+			task = key_chooser_next(&ms->chooser);
+		}
+		slot->op_bytes = swift_thread_object_len(args, task, args->sizes ? workload_prefill(&ms->ws, task) : args->data_size);
+		scerr = prepare_put(ms, slot, task, slot->op_bytes);
+		break;
+	case PHASE_GET:
+		slot->op = SWIFT_OP_GET;
+		task = key_chooser_next(&ms->chooser);
+		slot->op_bytes = swift_thread_object_len(args, task, args->sizes ? workload_object_size(&ms->ws, task) : args->data_size);
+		scerr = prepare_get(ms, slot, keyspace_object_url(&ms->keyspace, task), task, slot->op_bytes, args->verify_data);
+		break;
+	case PHASE_MIXED:
+		scerr = prepare_mixed(ms, slot);
+		break;
+	case PHASE_DELETE_OBJECTS:
+		scerr = swift_http_prepare(&args->swift, slot->curl, SWIFT_HTTP_DELETE, keyspace_object_url(&ms->keyspace, task), ms->headers, args->proxy, args->debug);
+		break;
+	case PHASE_DELETE_CONTAINERS:
+		scerr = swift_http_prepare(&args->swift, slot->curl, SWIFT_HTTP_DELETE, keyspace_container_url(&ms->keyspace, task), ms->headers, args->proxy, args->debug);
+		break;
+	}
+
+	if (SCERR_SUCCESS == scerr) {
+		slot->op_start = swift_clock_nanosecs();
+		slot->page_start = slot->op_start;
+		if (!ms->paced) {
+			slot->op_intended = slot->op_start;
+		}
+		scerr = add_request(ms, slot);
+	}
+	return scerr;
+}
+
+/**
+ * Issue the request for the next page of the listing of the slot's mixed operation in flight.
+ */
+static enum swift_error
+start_next_page(struct multi_state *ms, struct request_slot *slot)
+{
+	struct swift_thread_args *args = ms->args;
+	enum swift_error scerr;
+
+	scerr = keep_token(ms);
+	if (SCERR_SUCCESS == scerr) {
+		scerr = listing_prepare_page(&slot->listing, &args->swift, slot->curl, ms->headers, args->proxy, args->debug);
+	}
+	if (SCERR_SUCCESS == scerr) {
+		slot->page_start = swift_clock_nanosecs();
+		scerr = add_request(ms, slot);
+	}
+	return scerr;
+}
+
+/**
+ * Record the first error encountered by the thread. The slot which encountered it takes no further part in the phase.
+ */
+static void
+record_error(struct multi_state *ms, enum swift_error scerr)
+{
+	if (SCERR_SUCCESS == ms->args->scerr) {
+		ms->args->scerr = scerr;
+	}
+}
+
+/**
+ * Handle the completion of the slot's request in flight, then issue its next,
+ * or leave it idle until the next arrival if the phase is paced.
+ */
+static void
+complete_request(struct multi_state *ms, struct request_slot *slot, CURLcode res)
+{
+	struct swift_thread_args *args = ms->args;
+	enum swift_error scerr = swift_http_result(&args->swift, slot->curl, res);
+	int more = 0;
+
+	slot->busy = 0;
+	if (slot->retired_headers) {
+		slot->retired_headers = 0;
+		if (0 == --ms->retired_in_flight) {
+			free_retired_headers(ms);
+		}
+	}
+	if (PHASE_MIXED == ms->phase || (PHASE_PUT == ms->phase && args->sizes)) {
+		ms->busy_keys[slot->key] = 0;
+	}
+	if (SCERR_SUCCESS == scerr && TRANSFER_VERIFY == slot->transfer) {
+		scerr = swift_thread_check_data(args, &slot->compare_args, slot->data_object);
+	}
+	if (SCERR_SUCCESS == scerr && PHASE_MIXED == ms->phase && SWIFT_OP_LIST == slot->op) {
+		more = listing_page_done(&slot->listing);
+		if (more < 0) {
+			scerr = SCERR_URL_FAILED; /* Not the right error code, but swift client should not know about listings */
+		} else if (!ms->discard) {
+			swift_record_op(&args->page_stats, slot->page_start, slot->page_start, slot->listing.parser.bytes);
+		}
+	}
+	if (more > 0) {
+		/* The operation goes on with the listing's next page */
+		scerr = start_next_page(ms, slot);
+	}
+	if (SCERR_SUCCESS != scerr) {
+		if ((PHASE_PUT == ms->phase || PHASE_GET == ms->phase || PHASE_MIXED == ms->phase) && !ms->discard) {
+			swift_thread_record_failure(args, slot->op);
+		}
+		record_error(ms, scerr);
+		return;
+	}
+	if (more > 0) {
+		return;
+	}
+	if (TRANSFER_PUT == slot->transfer && slot->supply_args.hash) {
+		args->object_crcs[slot->data_object] = slot->supply_args.crc;
+	}
+
+	if ((PHASE_PUT == ms->phase || PHASE_GET == ms->phase || PHASE_MIXED == ms->phase) && !ms->discard) {
+		uint64_t latency = swift_thread_record_op(args, slot->op, slot->op_intended, slot->op_start, slot->op_bytes);
+		swift_thread_record_timings(args, slot->op, slot->curl);
+		if (ms->deadline && !ms->paced && slot->op_intended + latency >= ms->deadline) {
+			/* The next request would start at or beyond the deadline: start no more. Paced phases stop by their schedule. */
+			ms->num_tasks = ms->next_task;
+		}
+	}
+
+	if (ms->paced) {
+		ms->idle[ms->num_idle++] = slot;
+		return;
+	}
+
+	scerr = start_next_request(ms, slot);
+	if (SCERR_SUCCESS != scerr) {
+		record_error(ms, scerr);
+	}
+}
+
+/**
+ * Collect all completed requests from the multi handle.
+ */
+static void
+process_completions(struct multi_state *ms)
+{
+	CURLMsg *msg;
+	int msgs_left;
+
+	while (NULL != (msg = curl_multi_info_read(ms->multi, &msgs_left))) {
+		struct request_slot *slot = NULL;
+		CURL *easy = msg->easy_handle;
+		CURLcode res = msg->data.result;
+
+		if (CURLMSG_DONE != msg->msg) {
+			continue;
+		}
+		curl_easy_getinfo(easy, CURLINFO_PRIVATE, (char **) &slot);
+		curl_multi_remove_handle(ms->multi, easy);
+		assert(slot != NULL);
+		assert(ms->in_flight > 0);
+		ms->in_flight--;
+		complete_request(ms, slot, res);
+	}
+}
+
+/**
+ * Return whether operations of the current phase remain to arrive on the arrival schedule, before its deadline if it has one.
+ */
+static int
+arrivals_pending(const struct multi_state *ms)
+{
+	return ms->paced && ms->next_task < ms->num_tasks && SCERR_SUCCESS == ms->args->scerr
+		&& (0 == ms->deadline || arrival_peek(&ms->arrivals) < ms->deadline);
+}
+
+/**
+ * Issue every operation whose arrival time has passed, for as long as slots are idle.
+ * Any which remain wait for a slot, and their latency includes that wait.
+ */
+static void
+dispatch_arrivals(struct multi_state *ms)
+{
+	uint64_t now = swift_clock_nanosecs();
+
+	while (ms->num_idle && arrivals_pending(ms) && arrival_peek(&ms->arrivals) <= now) {
+		struct request_slot *slot = ms->idle[--ms->num_idle];
+		enum swift_error scerr;
+
+		slot->op_intended = arrival_next(&ms->arrivals);
+		scerr = start_next_request(ms, slot);
+		if (SCERR_SUCCESS != scerr) {
+			record_error(ms, scerr);
+		}
+	}
+}
+
+/**
+ * Set the arrival timer to expire at the next arrival, if there is an idle slot to issue it.
+ * A timer is used rather than the epoll timeout, which has only millisecond resolution.
+ */
+static void
+arm_arrival_timer(struct multi_state *ms)
+{
+	struct itimerspec its;
+	uint64_t now, when, delay = 0;
+
+	if (ms->num_idle && arrivals_pending(ms)) {
+		now = swift_clock_nanosecs();
+		when = arrival_peek(&ms->arrivals);
+		/* A zero delay would disarm the timer */
+		delay = (when > now) ? when - now : 1;
+	}
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = delay / 1000000000;
+	its.it_value.tv_nsec = delay % 1000000000;
+	timerfd_settime(ms->arrival_fd, 0, &its, NULL);
+}
+
+/**
+ * Drive the multi handle until no slot has a request in flight and no operation remains to arrive.
+ */
+static void
+run_until_idle(struct multi_state *ms)
+{
+	struct swift_thread_args *args = ms->args;
+	struct epoll_event events[MAX_EVENTS];
+	int running;
+
+	while (ms->in_flight || arrivals_pending(ms)) {
+		int i, n, timeout_ms = -1;
+		uint64_t now;
+
+		if (ms->paced) {
+			dispatch_arrivals(ms);
+			if (!ms->in_flight && !arrivals_pending(ms)) {
+				break;
+			}
+			arm_arrival_timer(ms);
+		}
+
+		if (ms->timer_deadline) {
+			now = swift_clock_nanosecs();
+			timeout_ms = (ms->timer_deadline > now) ? (int) ((ms->timer_deadline - now + 999999) / 1000000) : 0;
+		}
+
+		n = epoll_wait(ms->epoll_fd, events, MAX_EVENTS, timeout_ms);
+		if (n < 0) {
+			if (EINTR == errno) {
+				continue;
+			}
+			args->swift.errno_error("epoll_wait", errno);
+			args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about epoll errors */
+			break;
+		}
+
+		for (i = 0; i < n; i++) {
+			int flags = 0;
+			if (events[i].data.fd == ms->arrival_fd) {
+				uint64_t expirations;
+				/* Just acknowledge the expiry: arrivals are dispatched on the next pass */
+				if (read(ms->arrival_fd, &expirations, sizeof(expirations)) < 0 && EAGAIN != errno) {
+					args->swift.errno_error("read", errno);
+				}
+				continue;
+			}
+			if (events[i].events & EPOLLIN) {
+				flags |= CURL_CSELECT_IN;
+			}
+			if (events[i].events & EPOLLOUT) {
+				flags |= CURL_CSELECT_OUT;
+			}
+			if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+				flags |= CURL_CSELECT_ERR;
+			}
+			curl_multi_socket_action(ms->multi, events[i].data.fd, flags, &running);
+		}
+
+		if (ms->timer_deadline && swift_clock_nanosecs() >= ms->timer_deadline) {
+			ms->timer_deadline = 0;
+			curl_multi_socket_action(ms->multi, CURL_SOCKET_TIMEOUT, 0, &running);
+		}
+
+		process_completions(ms);
+	}
+}
+
+/**
+ * Perform the given number of operations of the given phase, keeping every slot busy until none remain.
+ * Does nothing if the thread has already failed.
+ */
+static void
+run_phase(struct multi_state *ms, enum multi_phase phase, unsigned long num_tasks)
+{
+	unsigned int i;
+
+	if (SCERR_SUCCESS != ms->args->scerr) {
+		return;
+	}
+	ms->phase = phase;
+	ms->next_task = 0;
+	ms->num_tasks = num_tasks;
+	ms->paced = ms->args->rate > 0 && (PHASE_PUT == phase || PHASE_GET == phase || PHASE_MIXED == phase);
+	if (ms->paced) {
+		/* Every slot waits for an arrival */
+		for (i = 0; i < ms->args->queue_depth; i++) {
+			ms->idle[i] = &ms->slots[i];
+		}
+		ms->num_idle = ms->args->queue_depth;
+		arrival_start(&ms->arrivals, swift_clock_nanosecs());
+		run_until_idle(ms);
+		ms->paced = 0;
+		return;
+	}
+	for (i = 0; i < ms->args->queue_depth && ms->next_task < ms->num_tasks; i++) {
+		enum swift_error scerr = start_next_request(ms, &ms->slots[i]);
+		if (SCERR_SUCCESS != scerr) {
+			record_error(ms, scerr);
+			break;
+		}
+	}
+	run_until_idle(ms);
+}
+
+/**
+ * Perform the recorded operations of the given measured phase, the given one of the steady state counting from zero:
+ * num_iterations per slot, on average, or, if the run has a duration, as many as start before the phase's deadline.
+ * The deadline is checked against the completion time of each operation, which is taken anyway, as the next
+ * operation of its slot starts then, or, if the phase is paced, against the arrival schedule.
+ */
+static void
+run_measured_phase(struct multi_state *ms, enum multi_phase phase, unsigned int index)
+{
+	ms->deadline = swift_thread_phase_deadline(ms->args, index);
+	run_phase(ms, phase, ms->deadline ? ULONG_MAX : (unsigned long) ms->args->num_iterations * ms->args->queue_depth);
+	ms->deadline = 0;
+}
+
+/**
+ * Perform operations of the given phase, unrecorded, until the given time, or if zero, for as long as
+ * the cool-down lasts. Does nothing if the thread has already failed.
+ */
+static void
+run_unrecorded_phase(struct multi_state *ms, enum multi_phase phase, uint64_t until)
+{
+	ms->discard = 1;
+	ms->until = until;
+	run_phase(ms, phase, ULONG_MAX);
+	ms->discard = 0;
+}
+
+/**
+ * Release everything held by the multi-request state. Usable as a pthread cleanup handler.
+ */
+static void
+free_multi_state(void *arg)
+{
+	struct multi_state *ms = (struct multi_state *) arg;
+	unsigned int i;
+
+	if (ms->slots) {
+		for (i = 0; i < ms->args->queue_depth; i++) {
+			struct request_slot *slot = &ms->slots[i];
+			if (slot->curl) {
+				if (ms->multi && slot->busy) {
+					curl_multi_remove_handle(ms->multi, slot->curl);
+				}
+				curl_easy_cleanup(slot->curl);
+			}
+		}
+		free(ms->slots);
+	}
+	if (ms->multi) {
+		curl_multi_cleanup(ms->multi);
+	}
+	if (ms->epoll_fd >= 0) {
+		close(ms->epoll_fd);
+	}
+	if (ms->arrival_fd >= 0) {
+		close(ms->arrival_fd);
+	}
+	free(ms->idle);
+	free_retired_headers(ms);
+	if (ms->headers) {
+		curl_slist_free_all(ms->headers);
+	}
+	if (ms->post_headers) {
+		curl_slist_free_all(ms->post_headers);
+	}
+	workload_state_free(&ms->ws);
+	free(ms->busy_keys);
+	keyspace_free(&ms->keyspace);
+}
+
+static void
+local_swift_end(void *arg)
+{
+	swift_end((swift_context_t *) arg);
+}
+
+/**
+ * Executed by each multi-request Swift thread.
+ */
+void *
+swift_multi_thread_func(void *arg)
+{
+	struct swift_thread_args *args;
+	struct multi_state ms;
+	unsigned int i;
+
+	assert(arg != NULL);
+	args = (struct swift_thread_args *) arg;
+	assert(args->swift_url != NULL);
+	assert(args->auth_token != NULL);
+	assert(args->queue_depth > 0);
+
+	swift_thread_init_stats(args);
+
+	args->scerr = swift_start(&args->swift);
+	if (args->scerr != SCERR_SUCCESS) {
+		swift_thread_wait_for_start(args);
+		swift_thread_release_token(args);
+		return NULL;
+	}
+	pthread_cleanup_push(local_swift_end, &args->swift);
+
+	/* Save thread start time */
+	swift_thread_save_time(args, &args->start_time);
+
+	memset(&ms, 0, sizeof(ms));
+	ms.args = args;
+	ms.epoll_fd = -1;
+	ms.arrival_fd = -1;
+	pthread_cleanup_push(free_multi_state, &ms);
+
+	if (SCERR_SUCCESS == args->scerr) {
+		args->scerr = keyspace_init(&ms.keyspace, KEYSPACE_URLS, args->thread_num, args->num_containers, args->num_objects, args->swift_url);
+	}
+	key_chooser_init(&ms.chooser, &args->key_distribution, args->num_objects, args->thread_num);
+
+	if (SCERR_SUCCESS == args->scerr) {
+		ms.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (ms.epoll_fd < 0) {
+			args->swift.errno_error("epoll_create1", errno);
+			args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about epoll errors */
+		}
+	}
+
+	if (SCERR_SUCCESS == args->scerr && swift_thread_tracks_objects(args)) {
+		ms.post_headers = swift_http_post_headers(args->auth_token);
+		ms.busy_keys = (unsigned char *) calloc(args->num_objects, 1);
+		if (NULL == ms.post_headers || NULL == ms.busy_keys || workload_state_init(&ms.ws, args->workload, args->sizes, args->data_size, args->num_objects, args->thread_num)) {
+			args->scerr = SCERR_ALLOC_FAILED;
+		}
+	}
+
+	if (SCERR_SUCCESS == args->scerr && args->rate > 0) {
+		struct epoll_event ev;
+		arrival_init(&ms.arrivals, args->arrival, args->rate, args->thread_num, args->num_threads);
+		ms.idle = (struct request_slot **) calloc(args->queue_depth, sizeof(*ms.idle));
+		if (NULL == ms.idle) {
+			args->scerr = SCERR_ALLOC_FAILED;
+		} else {
+			/* CLOCK_MONOTONIC, as timerfd does not accept CLOCK_MONOTONIC_RAW; the timer is only ever set relative to now */
+			ms.arrival_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+			ev.events = EPOLLIN;
+			ev.data.fd = ms.arrival_fd;
+			if (ms.arrival_fd < 0 || 0 != epoll_ctl(ms.epoll_fd, EPOLL_CTL_ADD, ms.arrival_fd, &ev)) {
+				args->swift.errno_error("timerfd_create", errno);
+				args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about timer errors */
+			}
+		}
+	}
+
+	if (SCERR_SUCCESS == args->scerr) {
+		ms.headers = swift_http_auth_headers(args->auth_token);
+		ms.slots = (struct request_slot *) calloc(args->queue_depth, sizeof(*ms.slots));
+		ms.multi = curl_multi_init();
+		if (NULL == ms.headers || NULL == ms.slots || NULL == ms.multi) {
+			args->scerr = SCERR_ALLOC_FAILED;
+		}
+	}
+
+	if (SCERR_SUCCESS == args->scerr) {
+		CURLMcode mres = curl_multi_setopt(ms.multi, CURLMOPT_SOCKETFUNCTION, socket_callback);
+		if (CURLM_OK == mres) {
+			mres = curl_multi_setopt(ms.multi, CURLMOPT_SOCKETDATA, &ms);
+		}
+		if (CURLM_OK == mres) {
+			mres = curl_multi_setopt(ms.multi, CURLMOPT_TIMERFUNCTION, timer_callback);
+		}
+		if (CURLM_OK == mres) {
+			mres = curl_multi_setopt(ms.multi, CURLMOPT_TIMERDATA, &ms);
+		}
+		if (CURLM_OK == mres) {
+			/* Keep one idle connection per slot, so that every slot's next request can reuse one */
+			mres = curl_multi_setopt(ms.multi, CURLMOPT_MAXCONNECTS, (long) args->queue_depth);
+		}
+		if (CURLM_OK != mres) {
+			fprintf(stderr, "curl_multi_setopt: %s\n", curl_multi_strerror(mres));
+			args->scerr = SCERR_INIT_FAILED;
+		}
+	}
+
+	for (i = 0; i < args->queue_depth && SCERR_SUCCESS == args->scerr; i++) {
+		ms.slots[i].curl = curl_easy_init();
+		if (NULL == ms.slots[i].curl) {
+			args->scerr = SCERR_INIT_FAILED;
+		}
+	}
+
+	run_phase(&ms, PHASE_CREATE_CONTAINERS, args->reuse_dataset ? 0 : args->num_containers);
+
+	/* Prefill: put every object once, so that any object may then be got, unless they exist already */
+	swift_thread_save_time(args, &args->start_prefill_time);
+	if (args->reuse_dataset && SCERR_SUCCESS == args->scerr) {
+		if (swift_thread_tracks_objects(args)) {
+			args->scerr = dataset_restore(args, &ms.ws);
+		}
+		if (SCERR_SUCCESS == args->scerr) {
+			/* A sample is checked one object at a time, over the first slot's handle, before any is in flight */
+			args->scerr = dataset_check(args, ms.slots[0].curl, ms.headers, &ms.keyspace);
+		}
+	}
+	run_phase(&ms, PHASE_PREFILL, args->reuse_dataset ? 0 : args->num_objects);
+	swift_thread_save_time(args, &args->end_prefill_time);
+
+	swift_thread_wait_for_start(args);
+
+	/* Ramp-up and warm-up: become active in turn, then perform unrecorded operations until the steady state */
+	if (SCERR_SUCCESS == args->scerr) {
+		swift_wait_until(swift_thread_activation(args));
+	}
+	run_unrecorded_phase(&ms, args->workload ? PHASE_MIXED : PHASE_PUT, swift_thread_steady_start(args));
+
+	if (args->workload) {
+		swift_thread_save_time(args, &args->start_mixed_time);
+		run_measured_phase(&ms, PHASE_MIXED, 0);
+		swift_thread_save_time(args, &args->end_mixed_time);
+	} else {
+		swift_thread_save_time(args, &args->start_put_time);
+		run_measured_phase(&ms, PHASE_PUT, 0);
+		swift_thread_save_time(args, &args->end_put_time);
+
+		swift_thread_save_time(args, &args->start_get_time);
+		run_measured_phase(&ms, PHASE_GET, 1);
+		swift_thread_save_time(args, &args->end_get_time);
+	}
+
+	/* Cool-down: keep up the load, unrecorded, until the cool-down after every thread's steady state has passed */
+	swift_thread_end_steady(args);
+	run_unrecorded_phase(&ms, args->workload ? PHASE_MIXED : PHASE_GET, 0);
+
+	/* Cleanup: delete every object still present, then every container, unless keeping them */
+	swift_thread_save_time(args, &args->start_cleanup_time);
+	if (args->keep_dataset && SCERR_SUCCESS == args->scerr) {
+		dataset_record(args, swift_thread_tracks_objects(args) ? &ms.ws : NULL);
+	}
+	run_phase(&ms, PHASE_DELETE_OBJECTS, args->keep_dataset ? 0 : args->num_objects);
+	run_phase(&ms, PHASE_DELETE_CONTAINERS, args->keep_dataset ? 0 : args->num_containers);
+	swift_thread_save_time(args, &args->end_cleanup_time);
+
+	/* Save end time */
+	swift_thread_save_time(args, &args->end_time);
+	swift_thread_release_token(args);
+
+	pthread_cleanup_pop(1);
+	pthread_cleanup_pop(1);
+
+	return NULL;
+}
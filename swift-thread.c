@@ -1,187 +1,1055 @@
 #include <stdio.h>   /* [sw]printf */
 #include <stdlib.h>  /* perror, malloc, free, strdup */
-#include <string.h>  /* strdup */
+#include <string.h>  /* strdup, memset */
 #include <pthread.h> /* pthread_* */
 #include <assert.h>  /* assert */
 #include <time.h>    /* clock_gettime */
 #include <errno.h>   /* errno */
+#include <stdint.h>  /* uint64_t */
 
 #include "swift-thread.h"
 
-#ifdef CLOCK_MONOTONIC_RAW
-/* Use NTP-immune but Linux-specific clock */
-#define CLOCK_TO_USE CLOCK_MONOTONIC_RAW
-#else /* ndef CLOCK_MONOTONIC_RAW */
-/* Use POSIX-defined but NTP-vulnerable clock */
-#define CLOCK_TO_USE CLOCK_MONOTONIC
-#endif /* ndef CLOCK_MONOTONIC_RAW */
+#include "swift-http.h"
+#include "slo.h"
+#include "ranged-get.h"
+#include "bulk.h"
+#include "dataset.h"
 
-/* File from which to read pseudo-random data */
-#define RANDOM_FILE "/dev/urandom"
+#define ELEMENTSOF(arr) ((sizeof(arr) / sizeof((arr)[0])))
 
-#ifdef min
-#undef min
-#endif
-#define min(a, b) ((a) < (b) ? (a) : (b))
+/* Resources of the mixed phase, beyond those of the put and get phases, and of timed requests */
+struct mixed_resources {
+	struct workload_state ws;        /* Which objects exist, and their sizes */
+	CURL *curl;                      /* Easy handle for the operations which the Swift client library lacks, and for timed requests */
+	struct curl_slist *headers;      /* Authentication headers */
+	struct curl_slist *post_headers; /* Authentication and metadata headers of a post */
+	struct listing listing;          /* Listing in progress */
+};
 
-#define ELEMENTSOF(arr) ((sizeof(arr) / sizeof((arr)[0])))
+/* Phases in which a Swift thread performs the operations it measures */
+enum thread_phase {
+	THREAD_PUT,  /* Put objects chosen from the key distribution */
+	THREAD_GET,  /* Get objects chosen from the key distribution */
+	THREAD_MIXED /* Perform operations drawn from a mixed workload, instead of THREAD_PUT and THREAD_GET */
+};
 
-/* In/out arguments to a compare_data callback */
-struct compare_data_args {
-	swift_context_t *swift;
-	void *data;
-	size_t len;
-	size_t off;
+/* Everything with which a Swift thread performs its operations */
+struct thread_state {
+	struct swift_thread_args *args;   /* The thread's in/out parameters */
+	struct keyspace keyspace;         /* Names and URLs of the thread's containers and objects */
+	struct key_chooser chooser;       /* Choice of object for each measured operation */
+	struct arrival_schedule arrivals; /* Intended start times of operations issued at a fixed rate */
+	struct slo_uploader slo;          /* Puts of objects as static large objects */
+	struct range_downloader dl;       /* Gets of objects as concurrent ranges */
+	struct mixed_resources mixed;     /* Resources of the mixed phase and of timed requests */
+	unsigned int current_container;   /* Container addressed by the Swift client library */
+	uint64_t deadline;                /* Time at which the current measured phase ends, or zero if it lasts a number of operations */
+	unsigned int expired;             /* Whether the current measured phase has reached its deadline */
 };
 
 /**
- * Compare the given data to that expected.
+ * Return the current time of the clock used for timing, in nanoseconds.
+ * The clock is known to work by the time this is called, having been used for the thread's start time.
+ */
+uint64_t
+swift_clock_nanosecs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_TO_USE, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Sleep until the given time of the clock used for timing, if it is yet to come.
  */
-static size_t
-compare_data(void *ptr, size_t size, size_t nmemb, void *userdata)
+void
+swift_wait_until(uint64_t when)
 {
-	struct compare_data_args *args = (struct compare_data_args *) userdata;
+	uint64_t now;
 
-	if (size * nmemb > args->len - args->off) {
-		return CURL_READFUNC_ABORT; /* Longer than expected */
+	/* Not clock_nanosleep, which does not accept CLOCK_MONOTONIC_RAW */
+	while ((now = swift_clock_nanosecs()) < when) {
+		struct timespec delay;
+		delay.tv_sec = (when - now) / 1000000000;
+		delay.tv_nsec = (when - now) % 1000000000;
+		nanosleep(&delay, NULL);
 	}
+}
 
-	if (NULL == args->data) {
-		/* Require received data to be all-zero bytes */
-		const char *p;
-		for (p = ptr; p < (char *) ptr + (size * nmemb); p++) {
-			if (*p) {
-				return CURL_READFUNC_ABORT; /* Not the expected data */
-			}
-		}
-	} else {
-		/* Require received data to be identical to expected data */
-		if (memcmp(ptr, (((unsigned char *) args->data)) + args->off, min(size * nmemb, args->len - args->off))) {
-			return CURL_READFUNC_ABORT; /* Not the expected data */
+/**
+ * Record the successful completion of an operation which was intended to start at one time and started at another.
+ * The two are the same unless operations are issued at a fixed rate, in which case an operation may start late
+ * because earlier operations are yet to complete. Returns the latency recorded.
+ */
+uint64_t
+swift_record_op(struct swift_op_stats *stats, uint64_t intended_nanosecs, uint64_t start_nanosecs, size_t bytes)
+{
+	uint64_t now = swift_clock_nanosecs();
+
+	histogram_record(&stats->latency, now - intended_nanosecs);
+	histogram_record(&stats->service, now - start_nanosecs);
+	stats->bytes += bytes;
+	return now - intended_nanosecs;
+}
+
+/**
+ * Return the class of the given object size, each class's sizes up to sixteen times those of the class before.
+ */
+static unsigned int
+size_class(size_t size)
+{
+	unsigned int class;
+	size_t limit = 4096;
+
+	for (class = 0; class < SWIFT_SIZE_CLASSES - 1 && size > limit; class++) {
+		limit <<= 4;
+	}
+	return class;
+}
+
+/**
+ * Record the successful completion of a measured operation of the given type, as swift_record_op,
+ * and count it in the Swift thread's live counters. A put or get is also recorded by the class of
+ * its object's size, if sizes vary. Returns the latency recorded.
+ */
+uint64_t
+swift_thread_record_op(struct swift_thread_args *args, enum swift_op_type op, uint64_t intended_nanosecs, uint64_t start_nanosecs, size_t bytes)
+{
+	uint64_t latency = swift_record_op(&args->op_stats[op], intended_nanosecs, start_nanosecs, bytes);
+
+	if (args->sizes && SIZES_FIXED != args->sizes->type && (SWIFT_OP_PUT == op || SWIFT_OP_GET == op)) {
+		swift_record_op(&args->sized_stats[(SWIFT_OP_GET == op) * SWIFT_SIZE_CLASSES + size_class(bytes)], intended_nanosecs, start_nanosecs, bytes);
+	}
+	live_record(args->live, latency, bytes);
+	return latency;
+}
+
+/**
+ * Record the failure of a measured operation of the given type, and count it in the Swift thread's live counters.
+ */
+void
+swift_thread_record_failure(struct swift_thread_args *args, enum swift_op_type op)
+{
+	args->op_stats[op].errors++;
+	live_error(args->live);
+}
+
+/**
+ * Record libcurl's timings of a measured operation of the given type, performed as a single request
+ * by the given easy handle, if requests are timed.
+ */
+void
+swift_thread_record_timings(struct swift_thread_args *args, enum swift_op_type op, CURL *curl)
+{
+	if (args->timings) {
+		request_timings_record(&args->timings[op], curl);
+	}
+}
+
+/**
+ * Save the current time into the given timestamp.
+ */
+void
+swift_thread_save_time(struct swift_thread_args *args, struct timespec *ts)
+{
+	if (SCERR_SUCCESS == args->scerr && 0 != clock_gettime(CLOCK_TO_USE, ts)) {
+		args->swift.errno_error("clock_gettime", errno);
+		args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about POSIX clock errors */
+	}
+}
+
+/**
+ * Reset all of the Swift thread's per-operation statistics.
+ */
+void
+swift_thread_init_stats(struct swift_thread_args *args)
+{
+	unsigned int op;
+
+	for (op = 0; op <= SWIFT_OP_MAX; op++) {
+		histogram_init(&args->op_stats[op].latency);
+		histogram_init(&args->op_stats[op].service);
+		args->op_stats[op].bytes = 0;
+		args->op_stats[op].errors = 0;
+	}
+	histogram_init(&args->segment_stats.latency);
+	histogram_init(&args->segment_stats.service);
+	args->segment_stats.bytes = 0;
+	args->segment_stats.errors = 0;
+	histogram_init(&args->chunk_stats.latency);
+	histogram_init(&args->chunk_stats.service);
+	args->chunk_stats.bytes = 0;
+	args->chunk_stats.errors = 0;
+	histogram_init(&args->page_stats.latency);
+	histogram_init(&args->page_stats.service);
+	args->page_stats.bytes = 0;
+	args->page_stats.errors = 0;
+	for (op = 0; op < 2 * SWIFT_SIZE_CLASSES; op++) {
+		histogram_init(&args->sized_stats[op].latency);
+		histogram_init(&args->sized_stats[op].service);
+		args->sized_stats[op].bytes = 0;
+		args->sized_stats[op].errors = 0;
+	}
+	if (args->timings) {
+		for (op = 0; op <= SWIFT_OP_MAX; op++) {
+			request_timings_init(&args->timings[op]);
 		}
 	}
+}
+
+/**
+ * If the authentication token has been refreshed since the Swift thread last adopted one, adopt the new one,
+ * so that requests prepared from now on carry it, and return non-zero, so that the caller rebuilds whatever
+ * it has built from the old token, which it must use no longer. Called between requests; takes no lock.
+ */
+int
+swift_thread_adopt_token(struct swift_thread_args *args)
+{
+	const char *auth_token = auth_token_poll(args->tokens, args->token_reader);
+
+	if (NULL == auth_token) {
+		return 0;
+	}
+	args->auth_token = auth_token;
+	return 1;
+}
+
+/**
+ * Declare that the Swift thread needs no authentication token any longer, so that none is kept for it.
+ */
+void
+swift_thread_release_token(struct swift_thread_args *args)
+{
+	auth_token_release(args->token_reader);
+}
 
-	args->off += size * nmemb;
+/**
+ * Return the name of the given row of statistics.
+ */
+const char *
+swift_row_name(unsigned int row)
+{
+	static const char *const sized_names[2 * SWIFT_SIZE_CLASSES] = {
+		"put<=4k", "put<=64k", "put<=1m", "put<=16m", "put<=256m", "put>256m",
+		"get<=4k", "get<=64k", "get<=1m", "get<=16m", "get<=256m", "get>256m"
+	};
 
-	return size * nmemb;
+	if (row <= SWIFT_OP_MAX) {
+		return swift_op_name(row);
+	} else if (SWIFT_ROW_SEGMENT == row) {
+		return "segment";
+	} else if (SWIFT_ROW_CHUNK == row) {
+		return "chunk";
+	} else if (SWIFT_ROW_PAGE == row) {
+		return "page";
+	}
+	return sized_names[row - SWIFT_ROW_SIZED];
 }
 
 /**
- * Ignore the given data.
+ * Return the Swift thread's statistics of the given row.
  */
-static size_t
-ignore_data(void *ptr, size_t size, size_t nmemb, void *userdata)
+const struct swift_op_stats *
+swift_row_stats(const struct swift_thread_args *args, unsigned int row)
 {
-	return size * nmemb;
+	if (row <= SWIFT_OP_MAX) {
+		return &args->op_stats[row];
+	}
+	if (SWIFT_ROW_SEGMENT == row) {
+		return &args->segment_stats;
+	} else if (SWIFT_ROW_CHUNK == row) {
+		return &args->chunk_stats;
+	}
+	return (SWIFT_ROW_PAGE == row) ? &args->page_stats : &args->sized_stats[row - SWIFT_ROW_SIZED];
 }
 
 /**
- * Supply zeroed data on request.
+ * Return the number of seconds from one time to another, negative if the second is the earlier.
  */
-static size_t
-make_zero_data(void *ptr, size_t size, size_t nmemb, void *userdata)
+double
+swift_timespecs_to_secs(const struct timespec *start, const struct timespec *end)
 {
-	size *= nmemb;
-	memset(ptr, 0, size);
-	return size;
+	return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
 }
 
 /**
- * Fill the given test data with repetitions of an easily-identifiable text.
+ * Convert a time of the clock used for timing, in nanoseconds, into a timestamp.
  */
 static void
-gen_test_data_simple_text(unsigned int thread_num, char *data, size_t len)
+nanosecs_to_timespec(uint64_t nanosecs, struct timespec *ts)
+{
+	ts->tv_sec = (time_t) (nanosecs / 1000000000);
+	ts->tv_nsec = (long) (nanosecs % 1000000000);
+}
+
+/**
+ * Return the earliest start and latest end, across the given Swift threads, of the operations of the given row,
+ * or, if the run has a duration, the window common to all of them, from the start of the measured phase in which
+ * they were performed to its deadline. Segments and chunks are put and got within the puts and gets of their objects,
+ * and pages within their listings; puts and gets of each class of object size are among all puts and gets.
+ */
+void
+swift_row_window(const struct swift_thread_args *args, unsigned int n, unsigned int row, struct timespec *start, struct timespec *end)
 {
-	const char *chunk_fmt = "This is the test data for thread %u ";
-	size_t chunk_len = snprintf(NULL, 0, chunk_fmt, thread_num);
-	char *p;
+	const struct swift_run *run = args->run;
+	unsigned int i;
 
-	for (p = data; len > chunk_len; p += chunk_len, len -= chunk_len) {
-		sprintf(p, chunk_fmt, thread_num);
+	if (SWIFT_ROW_SEGMENT == row) {
+		row = SWIFT_OP_PUT;
+	} else if (SWIFT_ROW_CHUNK == row) {
+		row = SWIFT_OP_GET;
+	} else if (SWIFT_ROW_PAGE == row) {
+		row = SWIFT_OP_LIST;
+	} else if (row >= SWIFT_ROW_SIZED) {
+		row = (row < SWIFT_ROW_SIZED + SWIFT_SIZE_CLASSES) ? SWIFT_OP_PUT : SWIFT_OP_GET;
+	}
+	if (run && run->duration && run->start) {
+		/* The gets are the second measured phase, unless all types of operation are interleaved */
+		unsigned int phase = (SWIFT_OP_GET == row && NULL == args->workload) ? 1 : 0;
+		nanosecs_to_timespec(swift_thread_phase_deadline(args, phase) - run->duration, start);
+		nanosecs_to_timespec(swift_thread_phase_deadline(args, phase), end);
+		return;
+	}
+	memset(start, 0, sizeof(*start));
+	memset(end, 0, sizeof(*end));
+	for (i = 0; i < n; i++) {
+		const struct timespec *op_start, *op_end;
+		if (args[i].workload) {
+			/* All types of operation are interleaved */
+			op_start = &args[i].start_mixed_time;
+			op_end = &args[i].end_mixed_time;
+		} else if (SWIFT_OP_PUT == row) {
+			op_start = &args[i].start_put_time;
+			op_end = &args[i].end_put_time;
+		} else if (SWIFT_OP_GET == row) {
+			op_start = &args[i].start_get_time;
+			op_end = &args[i].end_get_time;
+		} else {
+			assert(0);
+			return;
+		}
+		if (0 == i || swift_timespecs_to_secs(op_start, start) > 0) {
+			*start = *op_start;
+		}
+		if (0 == i || swift_timespecs_to_secs(end, op_end) > 0) {
+			*end = *op_end;
+		}
 	}
 }
 
 /**
- * Fill the given test data with pseudo-random bits.
+ * Prepare the start and phases of a run of the given number of Swift threads, with the given durations in seconds,
+ * the last being that of each measured phase, or zero if each lasts a number of operations.
+ * Returns zero on success, or else an errno value.
  */
-static void
-gen_test_data_urandom(char *data, size_t len)
+int
+swift_run_init(struct swift_run *run, unsigned int num_threads, double ramp_up, double warm_up, double cool_down, double duration)
 {
 	int ret;
-	size_t size;
-	FILE *urandom;
 
-	urandom = fopen(RANDOM_FILE, "r");
-	if (NULL == urandom) {
-		perror("fopen " RANDOM_FILE);
-		exit(EXIT_FAILURE);
+	memset(run, 0, sizeof(*run));
+	run->num_threads = num_threads;
+	run->pending_start = num_threads;
+	run->pending_steady = num_threads;
+	run->ramp_up = (uint64_t) (ramp_up * 1e9);
+	run->warm_up = (uint64_t) (warm_up * 1e9);
+	run->cool_down = (uint64_t) (cool_down * 1e9);
+	run->duration = (uint64_t) (duration * 1e9);
+
+	ret = pthread_mutex_init(&run->mutex, NULL);
+	if (0 == ret) {
+		ret = pthread_cond_init(&run->condvar, NULL);
+		if (ret != 0) {
+			pthread_mutex_destroy(&run->mutex);
+		}
 	}
-	size = fread(data, 1, len, urandom);
-	if (size != len) {
-		perror("fread " RANDOM_FILE);
-		exit(EXIT_FAILURE);
+	return ret;
+}
+
+/**
+ * Release the start and phases of a run, once every Swift thread has ended.
+ */
+void
+swift_run_destroy(struct swift_run *run)
+{
+	pthread_cond_destroy(&run->condvar);
+	pthread_mutex_destroy(&run->mutex);
+}
+
+/**
+ * Make the run one part of a distributed run of the given number of Swift threads in all: the last of this
+ * process's Swift threads to arrive at the start calls the given barrier, which waits for every other process
+ * and returns the time of the clock used for timing at which all start.
+ */
+void
+swift_run_distribute(struct swift_run *run, unsigned int total_threads, uint64_t (*barrier)(void *arg), void *barrier_arg)
+{
+	run->num_threads = total_threads;
+	run->barrier = barrier;
+	run->barrier_arg = barrier_arg;
+}
+
+static void
+lock_run(struct swift_thread_args *args)
+{
+	int ret = pthread_mutex_lock(&args->run->mutex);
+
+	if (ret != 0) {
+		args->swift.errno_error("pthread_mutex_lock", ret);
+		abort(); /* Every other Swift thread would wait forever */
 	}
-	ret = fclose(urandom);
+}
+
+static void
+unlock_run(struct swift_thread_args *args)
+{
+	int ret = pthread_mutex_unlock(&args->run->mutex);
+
 	if (ret != 0) {
-		perror("fclose " RANDOM_FILE);
-		exit(EXIT_FAILURE);
+		args->swift.errno_error("pthread_mutex_unlock", ret);
+		abort(); /* Every other Swift thread would wait forever */
 	}
 }
 
 /**
- * Fill the given test data with the given type of data.
+ * Arrive at the start, and wait until every other Swift thread has arrived too, unless the Swift thread
+ * has already failed, in which case it gives up its steady state too and does not wait.
+ * Every Swift thread must arrive exactly once, whether or not it has failed.
  */
+void
+swift_thread_wait_for_start(struct swift_thread_args *args)
+{
+	struct swift_run *run = args->run;
+	int ret;
+
+	lock_run(args);
+	if (0 == --run->pending_start) {
+		run->start = run->barrier ? run->barrier(run->barrier_arg) : swift_clock_nanosecs();
+		ret = pthread_cond_broadcast(&run->condvar);
+		if (ret != 0) {
+			args->swift.errno_error("pthread_cond_broadcast", ret);
+			abort(); /* Every other Swift thread would wait forever */
+		}
+	}
+	while (0 == run->start && SCERR_SUCCESS == args->scerr) {
+		ret = pthread_cond_wait(&run->condvar, &run->mutex);
+		if (ret != 0) {
+			args->swift.errno_error("pthread_cond_wait", ret);
+			args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about pthread condvar errors */
+		}
+	}
+	if (SCERR_SUCCESS == args->scerr) {
+		args->in_steady = 1;
+	} else if (0 == --run->pending_steady) {
+		run->steady_end = swift_clock_nanosecs();
+	}
+	unlock_run(args);
+}
+
+/**
+ * Return the time at which the Swift thread becomes active: Swift threads become active in turn, evenly spread
+ * over the ramp-up.
+ */
+uint64_t
+swift_thread_activation(const struct swift_thread_args *args)
+{
+	const struct swift_run *run = args->run;
+
+	return run->start + run->ramp_up * (args->thread_num - 1) / run->num_threads;
+}
+
+/**
+ * Return the time at which every Swift thread's steady state starts, after the ramp-up and warm-up.
+ */
+uint64_t
+swift_thread_steady_start(const struct swift_thread_args *args)
+{
+	const struct swift_run *run = args->run;
+
+	return run->start + run->ramp_up + run->warm_up;
+}
+
+/**
+ * Return the time at which the given measured phase of the steady state, counting from zero (the puts, then
+ * the gets, or the mixed phase), ends for every Swift thread, if the run has a duration, or else zero.
+ * Each measured phase is to start when the last ends.
+ */
+uint64_t
+swift_thread_phase_deadline(const struct swift_thread_args *args, unsigned int phase)
+{
+	const struct swift_run *run = args->run;
+
+	if (0 == run->duration) {
+		return 0;
+	}
+	return swift_thread_steady_start(args) + run->duration * (phase + 1);
+}
+
+/**
+ * End the Swift thread's steady state, whether or not it has failed, if it started it.
+ */
+void
+swift_thread_end_steady(struct swift_thread_args *args)
+{
+	struct swift_run *run = args->run;
+
+	if (!args->in_steady) {
+		return;
+	}
+	args->in_steady = 0;
+	lock_run(args);
+	if (0 == --run->pending_steady) {
+		run->steady_end = swift_clock_nanosecs();
+	}
+	unlock_run(args);
+}
+
+/**
+ * Return whether the Swift thread is to go on with the cool-down: until every Swift thread's steady state
+ * has ended and the cool-down has passed since.
+ */
+int
+swift_thread_cooling(struct swift_thread_args *args)
+{
+	struct swift_run *run = args->run;
+	uint64_t steady_end;
+
+	if (0 == run->cool_down) {
+		return 0;
+	}
+	lock_run(args);
+	steady_end = run->steady_end;
+	unlock_run(args);
+	return 0 == steady_end || swift_clock_nanosecs() < steady_end + run->cool_down;
+}
+
+/**
+ * Return whether the Swift thread keeps the state of each of its objects: whether it exists, and its size.
+ * It does with a mixed workload, which may delete objects, or if each put draws its object's size.
+ */
+int
+swift_thread_tracks_objects(const struct swift_thread_args *args)
+{
+	return NULL != args->workload || NULL != args->sizes;
+}
+
+/**
+ * Return the length of the given object's data: the given length, unless the object is a file of the corpus.
+ */
+size_t
+swift_thread_object_len(const struct swift_thread_args *args, unsigned long object, size_t len)
+{
+	return test_data_object_len(args->data_type, args->thread_num, object, len);
+}
+
+/**
+ * Check that a get of the given object received all the test data expected and, if verifying hashes,
+ * that its CRC-32C is that recorded when the object was put.
+ */
+enum swift_error
+swift_thread_check_data(struct swift_thread_args *args, const struct compare_data_args *compare_args, unsigned long object)
+{
+	if (compare_data_complete(compare_args, (VERIFY_HASH == args->verify_data) ? args->object_crcs[object] : 0)) {
+		return SCERR_SUCCESS;
+	}
+	fprintf(stderr, "Swift thread %u: object %lu does not hold the data put into it\n", args->thread_num, object);
+	return SCERR_URL_FAILED; /* Not the right error code, but swift client should not know about test data verification */
+}
+
 static void
-gen_test_data(unsigned int thread_num, enum test_data_type data_type, char *data, size_t len)
+local_swift_end(void *arg)
 {
-	switch(data_type) {
-	case SIMPLE_TEXT:
-		gen_test_data_simple_text(thread_num, data, len);
-		break;
-	case ALL_ZEROES:
-		/* Nothing to do */
-		break;
-	case PSEUDO_RANDOM:
-		gen_test_data_urandom(data, len);
+	swift_end((swift_context_t *) arg);
+}
+
+/**
+ * Make the given object, and the container holding it, the target of subsequent object operations.
+ */
+static enum swift_error
+address_object(struct swift_thread_args *args, const struct keyspace *ks, unsigned long object, unsigned int *current_container)
+{
+	enum swift_error scerr = SCERR_SUCCESS;
+	unsigned int container = keyspace_object_container(ks, object);
+
+	if (container != *current_container) {
+		scerr = swift_set_container(&args->swift, keyspace_container_name(ks, container));
+		if (SCERR_SUCCESS == scerr) {
+			*current_container = container;
+		}
+	}
+	if (SCERR_SUCCESS == scerr) {
+		scerr = swift_set_object(&args->swift, keyspace_object_name(ks, object));
+	}
+	return scerr;
+}
+
+/**
+ * Prepare the thread's own easy handle for a request directly over HTTP: one which the Swift client library
+ * does not offer, or one whose timings are wanted. The body of the response to a get is discarded, unless
+ * the caller sets otherwise.
+ */
+static enum swift_error
+prepare_http(struct swift_thread_args *args, struct mixed_resources *mr, enum swift_http_method method, const char *url, const struct curl_slist *headers)
+{
+	enum swift_error scerr;
+	CURLcode res = CURLE_OK;
+
+	scerr = swift_http_prepare(&args->swift, mr->curl, method, url, headers, args->proxy, args->debug);
+	if (SCERR_SUCCESS == scerr && SWIFT_HTTP_GET == method) {
+		res = curl_easy_setopt(mr->curl, CURLOPT_WRITEFUNCTION, ignore_data);
+		if (CURLE_OK != res) {
+			args->swift.curl_error("curl_easy_setopt", res);
+			scerr = SCERR_INVARG;
+		}
+	}
+	return scerr;
+}
+
+/**
+ * Perform, directly over HTTP, a request which needs nothing more than prepare_http sets.
+ */
+static enum swift_error
+perform_http(struct swift_thread_args *args, struct mixed_resources *mr, enum swift_http_method method, const char *url, const struct curl_slist *headers)
+{
+	enum swift_error scerr;
+
+	scerr = prepare_http(args, mr, method, url, headers);
+	if (SCERR_SUCCESS == scerr) {
+		scerr = swift_http_result(&args->swift, mr->curl, curl_easy_perform(mr->curl));
+	}
+	return scerr;
+}
+
+/**
+ * Return whether operations of the given type are performed directly over HTTP, each as one request
+ * upon the thread's own easy handle, so that their timings can be recorded. Any operation may be, if requests
+ * are timed, except those of static large objects and of gets as concurrent ranges, which are made of many
+ * requests upon handles of their own.
+ */
+static int
+timed_op(const struct swift_thread_args *args, enum swift_op_type op)
+{
+	if (NULL == args->timings) {
+		return 0;
+	}
+	if (args->segment_size && (SWIFT_OP_PUT == op || SWIFT_OP_DELETE == op)) {
+		return 0;
+	}
+	return !(args->get_chunk_size && SWIFT_OP_GET == op);
+}
+
+/**
+ * Put the given length of the given object's test data into the currently-addressed object,
+ * generating the data as it is sent, and recording its CRC-32C if verifying hashes.
+ * A file of the corpus is instead handed to the Swift client library straight from its mapping.
+ * If objects are segmented, the object is instead put by the uploader as a static large object,
+ * recording its segment puts in segment_stats, if not NULL. If requests are timed, the object is put
+ * directly over HTTP.
+ */
+static enum swift_error
+put_object(struct swift_thread_args *args, const struct keyspace *ks, struct slo_uploader *slo, struct mixed_resources *mr, unsigned long object, size_t len, struct swift_op_stats *segment_stats)
+{
+	struct supply_data_args supply_args;
+	enum swift_error scerr;
+	CURLcode res;
+
+	if (args->segment_size) {
+		uint32_t crc = 0;
+		scerr = slo_put(slo, keyspace_object_url(ks, object), object, len, &crc, segment_stats);
+		if (SCERR_SUCCESS == scerr && VERIFY_HASH == args->verify_data) {
+			args->object_crcs[object] = crc;
+		}
+		return scerr;
+	}
+
+	test_data_source_init(&supply_args.source, args->data_type, args->thread_num, object);
+	supply_args.hash = (VERIFY_HASH == args->verify_data);
+	supply_args.crc = 0;
+	supply_args.len = len;
+	supply_args.off = 0;
+	if (timed_op(args, SWIFT_OP_PUT)) {
+		scerr = prepare_http(args, mr, SWIFT_HTTP_PUT, keyspace_object_url(ks, object), mr->headers);
+		if (SCERR_SUCCESS == scerr) {
+			res = curl_easy_setopt(mr->curl, CURLOPT_READFUNCTION, supply_data);
+			if (CURLE_OK == res) {
+				res = curl_easy_setopt(mr->curl, CURLOPT_READDATA, &supply_args);
+			}
+			if (CURLE_OK == res) {
+				res = curl_easy_setopt(mr->curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t) len);
+			}
+			if (CURLE_OK != res) {
+				args->swift.curl_error("curl_easy_setopt", res);
+				scerr = SCERR_INVARG;
+			}
+		}
+		if (SCERR_SUCCESS == scerr) {
+			scerr = swift_http_result(&args->swift, mr->curl, curl_easy_perform(mr->curl));
+		}
+	} else if (FILE_DATA == args->data_type) {
+		assert(len == supply_args.source.shared_len);
+		if (supply_args.hash) {
+			supply_args.crc = test_data_crc32c(0, supply_args.source.shared, len);
+		}
+		scerr = swift_put_data(&args->swift, (void *) supply_args.source.shared, len, 0, NULL, NULL);
+	} else {
+		scerr = swift_put(&args->swift, supply_data, &supply_args, 0, NULL, NULL);
+	}
+	if (SCERR_SUCCESS == scerr && supply_args.hash) {
+		args->object_crcs[object] = supply_args.crc;
+	}
+	return scerr;
+}
+
+/**
+ * Delete the currently-addressed object, along with its segments if it is a static large object,
+ * directly over HTTP if requests are timed.
+ */
+static enum swift_error
+delete_object(struct swift_thread_args *args, const struct keyspace *ks, struct slo_uploader *slo, struct mixed_resources *mr, unsigned long object)
+{
+	if (args->segment_size) {
+		return slo_delete(slo, keyspace_object_url(ks, object), object);
+	}
+	if (timed_op(args, SWIFT_OP_DELETE)) {
+		return perform_http(args, mr, SWIFT_HTTP_DELETE, keyspace_object_url(ks, object), mr->headers);
+	}
+	return swift_delete_object(&args->swift);
+}
+
+/**
+ * Get the currently-addressed object, verifying if so required that it holds the given length of the given object's test data.
+ * If objects are got in chunks, the object is instead got by the downloader as concurrent ranges,
+ * recording its chunk gets in chunk_stats, if not NULL. If requests are timed, the object is got directly over HTTP.
+ */
+static enum swift_error
+get_object(struct swift_thread_args *args, const struct keyspace *ks, struct range_downloader *dl, struct mixed_resources *mr, unsigned long object, size_t len, struct swift_op_stats *chunk_stats)
+{
+	struct compare_data_args compare_args;
+
+	enum swift_error scerr;
+	CURLcode res;
+
+	if (args->get_chunk_size) {
+		return range_get(dl, keyspace_object_url(ks, object), object, len, chunk_stats);
+	}
+
+	if (timed_op(args, SWIFT_OP_GET) && VERIFY_NONE == args->verify_data) {
+		return perform_http(args, mr, SWIFT_HTTP_GET, keyspace_object_url(ks, object), mr->headers);
+	}
+	if (VERIFY_NONE == args->verify_data) {
+		return swift_get(&args->swift, ignore_data, NULL);
+	}
+	compare_args.swift = &args->swift;
+	test_data_source_init(&compare_args.source, args->data_type, args->thread_num, object);
+	compare_args.mode = args->verify_data;
+	compare_args.crc = 0;
+	compare_args.len = len;
+	compare_args.off = 0;
+	if (timed_op(args, SWIFT_OP_GET)) {
+		scerr = prepare_http(args, mr, SWIFT_HTTP_GET, keyspace_object_url(ks, object), mr->headers);
+		if (SCERR_SUCCESS == scerr) {
+			res = curl_easy_setopt(mr->curl, CURLOPT_WRITEFUNCTION, compare_data);
+			if (CURLE_OK == res) {
+				res = curl_easy_setopt(mr->curl, CURLOPT_WRITEDATA, &compare_args);
+			}
+			if (CURLE_OK != res) {
+				args->swift.curl_error("curl_easy_setopt", res);
+				scerr = SCERR_INVARG;
+			}
+		}
+		if (SCERR_SUCCESS == scerr) {
+			scerr = swift_http_result(&args->swift, mr->curl, curl_easy_perform(mr->curl));
+		}
+	} else {
+		scerr = swift_get(&args->swift, compare_data, &compare_args);
+	}
+	if (SCERR_SUCCESS == scerr) {
+		scerr = swift_thread_check_data(args, &compare_args, object);
+	}
+	return scerr;
+}
+
+static void
+local_keyspace_free(void *arg)
+{
+	keyspace_free((struct keyspace *) arg);
+}
+
+/**
+ * Acquire the resources of the mixed phase, if there is to be one, of timed requests, if they are timed,
+ * of the shared prefill and cleanup, if shared, and of the check of a reused dataset.
+ */
+static void
+init_mixed(struct swift_thread_args *args, struct mixed_resources *mr)
+{
+	memset(mr, 0, sizeof(*mr));
+	if ((!swift_thread_tracks_objects(args) && NULL == args->timings && NULL == args->bulk && !args->reuse_dataset) || SCERR_SUCCESS != args->scerr) {
+		return;
+	}
+	if (swift_thread_tracks_objects(args) && workload_state_init(&mr->ws, args->workload, args->sizes, args->data_size, args->num_objects, args->thread_num)) {
+		args->scerr = SCERR_ALLOC_FAILED;
+		return;
+	}
+	mr->curl = curl_easy_init();
+	if (NULL == mr->curl) {
+		args->scerr = SCERR_INIT_FAILED;
+		return;
+	}
+	mr->headers = swift_http_auth_headers(args->auth_token);
+	mr->post_headers = swift_http_post_headers(args->auth_token);
+	if (NULL == mr->headers || NULL == mr->post_headers) {
+		args->scerr = SCERR_ALLOC_FAILED;
+	}
+}
+
+/**
+ * Release the resources of the mixed phase and of timed requests. Usable as a pthread cleanup handler.
+ */
+static void
+free_mixed(void *arg)
+{
+	struct mixed_resources *mr = (struct mixed_resources *) arg;
+
+	workload_state_free(&mr->ws);
+	if (mr->curl) {
+		curl_easy_cleanup(mr->curl);
+	}
+	if (mr->headers) {
+		curl_slist_free_all(mr->headers);
+	}
+	if (mr->post_headers) {
+		curl_slist_free_all(mr->post_headers);
+	}
+}
+
+/**
+ * List the container of the given operation's object, or the account, directly over HTTP, page by page
+ * as the workload gives, recording each page in page_stats, if not NULL.
+ */
+static enum swift_error
+list_objects(struct swift_thread_args *args, const struct keyspace *ks, struct mixed_resources *mr, const struct workload_op *op, struct swift_op_stats *page_stats)
+{
+	const struct listing_spec *spec = &args->workload->listing;
+	struct listing *l = &mr->listing;
+	char prefix[LISTING_NAME_MAX] = "";
+	enum swift_error scerr;
+	uint64_t page_start;
+	int more = 0;
+
+	if (op->account) {
+		listing_init(l, spec, args->swift_url, NULL);
+	} else {
+		if (spec->prefix[0]) {
+			keyspace_object_prefix(args->thread_num, args->num_objects, spec->prefix, prefix, sizeof(prefix));
+		}
+		listing_init(l, spec, keyspace_container_url(ks, keyspace_object_container(ks, op->key)), prefix);
+	}
+	do {
+		page_start = swift_clock_nanosecs();
+		scerr = listing_prepare_page(l, &args->swift, mr->curl, mr->headers, args->proxy, args->debug);
+		if (SCERR_SUCCESS == scerr) {
+			scerr = swift_http_result(&args->swift, mr->curl, curl_easy_perform(mr->curl));
+		}
+		if (SCERR_SUCCESS == scerr) {
+			more = listing_page_done(l);
+			if (more < 0) {
+				scerr = SCERR_URL_FAILED; /* Not the right error code, but swift client should not know about listings */
+			}
+		}
+		if (page_stats && SCERR_SUCCESS == scerr) {
+			swift_record_op(page_stats, page_start, page_start, l->parser.bytes);
+		}
+	} while (SCERR_SUCCESS == scerr && more > 0);
+	return scerr;
+}
+
+/**
+ * Perform one operation of a mixed workload. Segment puts, chunk gets and listing pages are recorded only if record is set.
+ */
+static enum swift_error
+perform_mixed_op(struct swift_thread_args *args, const struct keyspace *ks, struct slo_uploader *slo, struct range_downloader *dl, struct mixed_resources *mr, const struct workload_op *op, unsigned int *current_container, int record)
+{
+	enum swift_error scerr = SCERR_SUCCESS;
+
+	switch (op->op) {
+	case SWIFT_OP_PUT:
+	case SWIFT_OP_GET:
+	case SWIFT_OP_DELETE:
+		scerr = address_object(args, ks, op->key, current_container);
 		break;
 	default:
-		assert(0);
 		break;
 	}
+	if (SCERR_SUCCESS != scerr) {
+		return scerr;
+	}
+
+	switch (op->op) {
+	case SWIFT_OP_PUT:
+		return put_object(args, ks, slo, mr, op->key, op->size, record ? &args->segment_stats : NULL);
+	case SWIFT_OP_GET:
+		return get_object(args, ks, dl, mr, op->key, op->size, record ? &args->chunk_stats : NULL);
+	case SWIFT_OP_DELETE:
+		return delete_object(args, ks, slo, mr, op->key);
+	case SWIFT_OP_HEAD:
+		return perform_http(args, mr, SWIFT_HTTP_HEAD, keyspace_object_url(ks, op->key), mr->headers);
+	case SWIFT_OP_POST:
+		return perform_http(args, mr, SWIFT_HTTP_POST, keyspace_object_url(ks, op->key), mr->post_headers);
+	case SWIFT_OP_LIST:
+		return list_objects(args, ks, mr, op, record ? &args->page_stats : NULL);
+	}
+	return SCERR_INVARG;
 }
 
-static void
-free_test_data(void *arg)
+/**
+ * Wait for the intended start time of the next operation and return it, if operations are issued at a fixed rate,
+ * or else return the current time. There is no waiting for a time at or beyond the given deadline, if not zero.
+ */
+static uint64_t
+await_arrival(const struct swift_thread_args *args, struct arrival_schedule *arrivals, uint64_t deadline)
 {
-	struct compare_data_args *args = (struct compare_data_args *) arg;
+	uint64_t when;
 
-	if (args->data) {
-		free(args->data);
+	if (0 == args->rate) {
+		return swift_clock_nanosecs();
+	}
+	when = arrival_next(arrivals);
+	if (0 == deadline || when < deadline) {
+		swift_wait_until(when);
 	}
+	return when;
 }
 
 /**
- * Generate a Swift object name unique to this thread.
+ * Adopt any refreshed authentication token, rebuilding every header list built from the old one.
  */
-static void
-gen_object_name(unsigned int thread_num, wchar_t *name, size_t len)
+static enum swift_error
+keep_token(struct thread_state *ts)
+{
+	struct swift_thread_args *args = ts->args;
+	enum swift_error scerr;
+
+	if (!swift_thread_adopt_token(args)) {
+		return SCERR_SUCCESS;
+	}
+	scerr = swift_set_auth_token(&args->swift, args->auth_token);
+	if (SCERR_SUCCESS == scerr) {
+		scerr = swift_http_rebuild_headers(&ts->mixed.headers, swift_http_auth_headers, args->auth_token);
+	}
+	if (SCERR_SUCCESS == scerr) {
+		scerr = swift_http_rebuild_headers(&ts->mixed.post_headers, swift_http_post_headers, args->auth_token);
+	}
+	if (SCERR_SUCCESS == scerr) {
+		scerr = swift_http_rebuild_headers(&ts->slo.headers, swift_http_auth_headers, args->auth_token);
+	}
+	if (SCERR_SUCCESS == scerr) {
+		scerr = swift_http_rebuild_headers(&ts->dl.headers, swift_http_auth_headers, args->auth_token);
+	}
+	return scerr;
+}
+
+/**
+ * Perform the next operation of the given phase, on the arrival schedule if there is one,
+ * recording it only if record is set. If the operation would start at or beyond the deadline
+ * of the measured phase, it is not performed, and the phase is marked expired instead;
+ * the time already taken for the operation's start serves, so that the check costs no clock reading.
+ */
+static enum swift_error
+perform_next(struct thread_state *ts, enum thread_phase phase, int record)
 {
-	swprintf(name, len, L"Object %u", thread_num);
+	struct swift_thread_args *args = ts->args;
+	uint64_t intended = await_arrival(args, &ts->arrivals, ts->deadline);
+	uint64_t op_start;
+	struct workload_op op;
+	enum swift_error scerr;
+
+	if (ts->deadline && intended >= ts->deadline) {
+		ts->expired = 1;
+		return SCERR_SUCCESS;
+	}
+	scerr = keep_token(ts);
+	if (SCERR_SUCCESS != scerr) {
+		return scerr;
+	}
+	if (THREAD_MIXED == phase) {
+		workload_next(&ts->mixed.ws, key_chooser_next(&ts->chooser), &op);
+		op.size = swift_thread_object_len(args, op.key, op.size);
+	} else {
+		op.op = (THREAD_PUT == phase) ? SWIFT_OP_PUT : SWIFT_OP_GET;
+		op.key = key_chooser_next(&ts->chooser);
+		if (NULL == args->sizes) {
+			op.size = args->data_size;
+		} else {
+			/* A put draws a new size for its object; a get expects the size last drawn */
+			op.size = (SWIFT_OP_PUT == op.op) ? workload_prefill(&ts->mixed.ws, op.key) : workload_object_size(&ts->mixed.ws, op.key);
+		}
+		op.size = swift_thread_object_len(args, op.key, op.size);
+		scerr = address_object(args, &ts->keyspace, op.key, &ts->current_container);
+		if (SCERR_SUCCESS != scerr) {
+			return scerr;
+		}
+	}
+
+	op_start = swift_clock_nanosecs();
+	switch (phase) {
+	case THREAD_PUT:
+		scerr = put_object(args, &ts->keyspace, &ts->slo, &ts->mixed, op.key, op.size, record ? &args->segment_stats : NULL);
+		break;
+	case THREAD_GET:
+		scerr = get_object(args, &ts->keyspace, &ts->dl, &ts->mixed, op.key, op.size, record ? &args->chunk_stats : NULL);
+		break;
+	default:
+		scerr = perform_mixed_op(args, &ts->keyspace, &ts->slo, &ts->dl, &ts->mixed, &op, &ts->current_container, record);
+		break;
+	}
+	if (SCERR_SUCCESS == scerr && record) {
+		swift_thread_record_op(args, op.op, intended, op_start, (SWIFT_OP_PUT == op.op || SWIFT_OP_GET == op.op) ? op.size : 0);
+		if (timed_op(args, op.op)) {
+			swift_thread_record_timings(args, op.op, ts->mixed.curl);
+		}
+	} else if (SCERR_SUCCESS != scerr && record) {
+		swift_thread_record_failure(args, op.op);
+	}
+	return scerr;
 }
 
 /**
- * Generate a Swift container name unique to this thread.
+ * Perform the recorded operations of the given measured phase, the given one of the steady state counting from zero:
+ * num_iterations of them, or, if the run has a duration, as many as start before the phase's deadline.
  */
 static void
-gen_container_name(unsigned int thread_num, wchar_t *name, size_t len)
+run_measured_phase(struct thread_state *ts, enum thread_phase phase, unsigned int index)
 {
-	swprintf(name, len, L"Container %u", thread_num);
+	struct swift_thread_args *args = ts->args;
+	unsigned int i;
+
+	ts->deadline = swift_thread_phase_deadline(args, index);
+	ts->expired = 0;
+	for (i = 0; (ts->deadline || i < args->num_iterations) && !ts->expired && SCERR_SUCCESS == args->scerr; i++) {
+		args->scerr = perform_next(ts, phase, 1);
+	}
+	ts->deadline = 0;
 }
 
+/**
+ * Perform tasks of the shared prefill or cleanup, the thread's own and then any left to steal from other threads,
+ * until there are none left, then wait until every task stolen from the thread is done.
+ */
 static void
-local_swift_end(void *arg)
+run_bulk_phase(struct thread_state *ts)
 {
-	swift_end((swift_context_t *) arg);
+	struct swift_thread_args *args = ts->args;
+	struct bulk_task task;
+
+	while (SCERR_SUCCESS == args->scerr && 0 == bulk_take(args, &task)) {
+		args->scerr = keep_token(ts);
+		if (SCERR_SUCCESS == args->scerr) {
+			args->scerr = bulk_perform(&task, args, ts->mixed.curl, ts->mixed.headers);
+		}
+		bulk_done(&task);
+	}
+	bulk_close(args);
 }
 
 /**
@@ -191,50 +1059,57 @@ void *
 swift_thread_func(void *arg)
 {
 	struct swift_thread_args *args;
-	struct compare_data_args compare_args;
-	/* FIXME: Potential buffer over-runs */
-	wchar_t container_name[1024];
-	wchar_t object_name[1024];
-	int ret;
+	struct thread_state ts;
+	enum thread_phase first_phase, last_phase;
+	unsigned long k;
+	unsigned int c;
 
 	assert(arg != NULL);
 	args = (struct swift_thread_args *) arg;
 	assert(args->swift_url != NULL);
 	assert(args->auth_token != NULL);
 
+	swift_thread_init_stats(args);
+
 	args->scerr = swift_start(&args->swift);
 	if (args->scerr != SCERR_SUCCESS) {
+		swift_thread_wait_for_start(args);
+		swift_thread_release_token(args);
 		return NULL;
 	}
 	pthread_cleanup_push(local_swift_end, &args->swift);
 
+	/* Save thread start time */
+	swift_thread_save_time(args, &args->start_time);
+
+	ts.args = args;
+	ts.current_container = (unsigned int) -1;
+	ts.deadline = 0;
+	ts.expired = 0;
+
 	if (SCERR_SUCCESS == args->scerr) {
-		/* Save thread start time */
-		ret = clock_gettime(CLOCK_TO_USE, &args->start_time);
-		if (ret != 0) {
-			args->swift.errno_error("clock_gettime", errno);
-			args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about POSIX clock errors */
-		}
+		/* A mixed workload, segmenting, chunking, timing requests, sharing prefill and cleanup or checking a reused dataset needs URLs too, for the requests made directly over HTTP */
+		args->scerr = keyspace_init(&ts.keyspace, (args->workload || args->segment_size || args->get_chunk_size || args->timings || args->bulk || args->reuse_dataset) ? (KEYSPACE_NAMES | KEYSPACE_URLS) : KEYSPACE_NAMES, args->thread_num, args->num_containers, args->num_objects, args->swift_url);
 	}
-
-	compare_args.swift = &args->swift;
-	compare_args.off = 0;
-	compare_args.len = args->data_size;
-	if (ALL_ZEROES == args->data_type) {
-		/* Special case: there is no need ever to actually store a large number of zero bits */
-		compare_args.data = NULL;
-	} else {
-		compare_args.data = args->swift.allocator(NULL, args->data_size);
-		if (NULL == compare_args.data) {
-			args->scerr = SCERR_ALLOC_FAILED;
-		} else {
-			gen_test_data(args->thread_num, args->data_type, compare_args.data, compare_args.len);
-		}
+	if (SCERR_SUCCESS != args->scerr) {
+		/* Leave nothing for local_keyspace_free to free */
+		memset(&ts.keyspace, 0, sizeof(ts.keyspace));
 	}
-	pthread_cleanup_push(free_test_data, &compare_args);
+	pthread_cleanup_push(local_keyspace_free, &ts.keyspace);
+
+	init_mixed(args, &ts.mixed);
+	pthread_cleanup_push(free_mixed, &ts.mixed);
 
-	gen_container_name(args->thread_num, container_name, ELEMENTSOF(container_name));
-	gen_object_name(args->thread_num, object_name, ELEMENTSOF(object_name));
+	slo_init(&ts.slo, args);
+	pthread_cleanup_push(slo_free, &ts.slo);
+
+	range_init(&ts.dl, args);
+	pthread_cleanup_push(range_free, &ts.dl);
+
+	key_chooser_init(&ts.chooser, &args->key_distribution, args->num_objects, args->thread_num);
+	if (args->rate > 0) {
+		arrival_init(&ts.arrivals, args->arrival, args->rate, args->thread_num, args->num_threads);
+	}
 
 	if (SCERR_SUCCESS == args->scerr) {
 		args->scerr = swift_set_debug(&args->swift, args->debug);
@@ -253,124 +1128,134 @@ swift_thread_func(void *arg)
 		args->scerr = swift_set_url(&args->swift, args->swift_url);
 	}
 
-	if (SCERR_SUCCESS == args->scerr) {
-		args->scerr = swift_set_container(&args->swift, container_name);
-	}
-
-	if (SCERR_SUCCESS == args->scerr) {
-		args->scerr = swift_create_container(&args->swift, 0, NULL, NULL);
+	for (c = 0; !args->reuse_dataset && c < args->num_containers && SCERR_SUCCESS == args->scerr; c++) {
+		args->scerr = swift_set_container(&args->swift, keyspace_container_name(&ts.keyspace, c));
+		if (SCERR_SUCCESS == args->scerr) {
+			ts.current_container = c;
+			args->scerr = swift_create_container(&args->swift, 0, NULL, NULL);
+		}
 	}
 
-	if (SCERR_SUCCESS == args->scerr) {
-		args->scerr = swift_set_object(&args->swift, object_name);
+	/* Prefill: put every object once, so that any object may then be got, unless they exist already */
+	swift_thread_save_time(args, &args->start_prefill_time);
+	if (args->reuse_dataset && SCERR_SUCCESS == args->scerr) {
+		if (swift_thread_tracks_objects(args)) {
+			args->scerr = dataset_restore(args, &ts.mixed.ws);
+		}
+		if (SCERR_SUCCESS == args->scerr) {
+			args->scerr = dataset_check(args, ts.mixed.curl, ts.mixed.headers, &ts.keyspace);
+		}
+	} else if (args->bulk && SCERR_SUCCESS == args->scerr) {
+		/* Choose every size beforehand, so that any thread may put any of the objects */
+		for (k = 0; swift_thread_tracks_objects(args) && k < args->num_objects; k++) {
+			workload_prefill(&ts.mixed.ws, k);
+		}
+		bulk_publish(args, BULK_PREFILL, &ts.keyspace, swift_thread_tracks_objects(args) ? &ts.mixed.ws : NULL, BULK_BATCH);
+		run_bulk_phase(&ts);
 	}
-
-	if (SCERR_SUCCESS == args->scerr) {
-		ret = pthread_mutex_lock(args->start_mutex);
-		if (ret != 0) {
-			args->swift.errno_error("pthread_mutex_lock", ret);
-			args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about pthread mutex errors */
+	for (k = 0; !args->reuse_dataset && NULL == args->bulk && k < args->num_objects && SCERR_SUCCESS == args->scerr; k++) {
+		args->scerr = keep_token(&ts);
+		if (SCERR_SUCCESS == args->scerr) {
+			args->scerr = address_object(args, &ts.keyspace, k, &ts.current_container);
+		}
+		if (SCERR_SUCCESS == args->scerr) {
+			args->scerr = put_object(args, &ts.keyspace, &ts.slo, &ts.mixed, k, swift_thread_object_len(args, k, swift_thread_tracks_objects(args) ? workload_prefill(&ts.mixed.ws, k) : args->data_size), NULL);
 		}
 	}
+	swift_thread_save_time(args, &args->end_prefill_time);
 
+	swift_thread_wait_for_start(args);
+
+	/* Ramp-up and warm-up: become active in turn, then perform unrecorded operations until the steady state */
+	first_phase = args->workload ? THREAD_MIXED : THREAD_PUT;
+	last_phase = args->workload ? THREAD_MIXED : THREAD_GET;
 	if (SCERR_SUCCESS == args->scerr) {
-		ret = pthread_cond_wait(args->start_condvar, args->start_mutex);
-		if (ret != 0) {
-			args->swift.errno_error("pthread_cond_wait", ret);
-			args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about pthread condvar errors */
+		swift_wait_until(swift_thread_activation(args));
+		if (args->rate > 0) {
+			arrival_start(&ts.arrivals, swift_clock_nanosecs());
 		}
 	}
+	while (SCERR_SUCCESS == args->scerr && swift_clock_nanosecs() < swift_thread_steady_start(args)) {
+		args->scerr = perform_next(&ts, first_phase, 0);
+	}
 
-	if (SCERR_SUCCESS == args->scerr) {
-		ret = pthread_mutex_unlock(args->start_mutex);
-		if (ret != 0) {
-			args->swift.errno_error("pthread_mutex_unlock", ret);
-			args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about pthread mutex errors */
+	if (args->workload) {
+		/* Save time at start of mixed operations */
+		swift_thread_save_time(args, &args->start_mixed_time);
+		if (args->rate > 0) {
+			arrival_start(&ts.arrivals, swift_clock_nanosecs());
 		}
-	}
 
-	if (SCERR_SUCCESS == args->scerr) {
+		run_measured_phase(&ts, THREAD_MIXED, 0);
+
+		/* Save time at end of mixed operations */
+		swift_thread_save_time(args, &args->end_mixed_time);
+	} else {
 		/* Save time at start of put operations */
-		ret = clock_gettime(CLOCK_TO_USE, &args->start_put_time);
-		if (ret != 0) {
-			args->swift.errno_error("clock_gettime", errno);
-			args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about POSIX clock errors */
+		swift_thread_save_time(args, &args->start_put_time);
+		if (args->rate > 0) {
+			arrival_start(&ts.arrivals, swift_clock_nanosecs());
 		}
-	}
 
-	if (SCERR_SUCCESS == args->scerr) {
-		unsigned int i;
-		for (i = 0; i < args->num_iterations; i++) {
-			if (NULL == compare_args.data) {
-				/* Special case for all-zero data: Synthesise the data to be inserted at this point */
-				args->scerr = swift_put(&args->swift, make_zero_data, NULL, 0, NULL, NULL);
-			} else {
-				args->scerr = swift_put_data(&args->swift, compare_args.data, compare_args.len, 0, NULL, NULL);
-			}
-			if (args->scerr != SCERR_SUCCESS) {
-				break;
-			}
-		}
-	}
+		run_measured_phase(&ts, THREAD_PUT, 0);
 
-	if (SCERR_SUCCESS == args->scerr) {
 		/* Save time at end of put operations */
-		ret = clock_gettime(CLOCK_TO_USE, &args->end_put_time);
-		if (ret != 0) {
-			args->swift.errno_error("clock_gettime", errno);
-			args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about POSIX clock errors */
-		}
-	}
+		swift_thread_save_time(args, &args->end_put_time);
 
-	if (SCERR_SUCCESS == args->scerr) {
 		/* Save time at start of get operations */
-		ret = clock_gettime(CLOCK_TO_USE, &args->start_get_time);
-		if (ret != 0) {
-			args->swift.errno_error("clock_gettime", errno);
-			args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about POSIX clock errors */
+		swift_thread_save_time(args, &args->start_get_time);
+		if (args->rate > 0) {
+			arrival_start(&ts.arrivals, swift_clock_nanosecs());
 		}
-	}
 
-	if (SCERR_SUCCESS == args->scerr) {
-		unsigned int i;
-		for (i = 0; i < args->num_iterations; i++) {
-			if (args->verify_data) {
-				args->scerr = swift_get(&args->swift, compare_data, &compare_args);
-			} else {
-				args->scerr = swift_get(&args->swift, ignore_data, NULL);
-			}
-			if (args->scerr != SCERR_SUCCESS) {
-				break;
-			}
-		}
-	}
+		run_measured_phase(&ts, THREAD_GET, 1);
 
-	if (SCERR_SUCCESS == args->scerr) {
 		/* Save time at end of get operations */
-		ret = clock_gettime(CLOCK_TO_USE, &args->end_get_time);
-		if (ret != 0) {
-			args->swift.errno_error("clock_gettime", errno);
-			args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about POSIX clock errors */
-		}
+		swift_thread_save_time(args, &args->end_get_time);
 	}
 
-	if (SCERR_SUCCESS == args->scerr) {
-		args->scerr = swift_delete_object(&args->swift);
+	/* Cool-down: keep up the load, unrecorded, until the cool-down after every thread's steady state has passed */
+	swift_thread_end_steady(args);
+	while (SCERR_SUCCESS == args->scerr && swift_thread_cooling(args)) {
+		args->scerr = perform_next(&ts, last_phase, 0);
 	}
 
-	if (SCERR_SUCCESS == args->scerr) {
-		args->scerr = swift_delete_container(&args->swift);
+	/* Cleanup: delete every object still present, then every container, unless keeping them */
+	swift_thread_save_time(args, &args->start_cleanup_time);
+	if (args->keep_dataset && SCERR_SUCCESS == args->scerr) {
+		dataset_record(args, swift_thread_tracks_objects(args) ? &ts.mixed.ws : NULL);
+	} else if (args->bulk && SCERR_SUCCESS == args->scerr) {
+		bulk_publish(args, BULK_CLEANUP, &ts.keyspace, swift_thread_tracks_objects(args) ? &ts.mixed.ws : NULL, bulk_cleanup_batch(args, ts.mixed.curl));
+		run_bulk_phase(&ts);
+	}
+	for (k = 0; !args->keep_dataset && NULL == args->bulk && k < args->num_objects && SCERR_SUCCESS == args->scerr; k++) {
+		if (swift_thread_tracks_objects(args) && !workload_object_present(&ts.mixed.ws, k)) {
+			continue; /* Deleted during the mixed phase */
+		}
+		args->scerr = keep_token(&ts);
+		if (SCERR_SUCCESS == args->scerr) {
+			args->scerr = address_object(args, &ts.keyspace, k, &ts.current_container);
+		}
+		if (SCERR_SUCCESS == args->scerr) {
+			args->scerr = delete_object(args, &ts.keyspace, &ts.slo, &ts.mixed, k);
+		}
 	}
 
-	if (SCERR_SUCCESS == args->scerr) {
-		/* Save end time */
-		ret = clock_gettime(CLOCK_TO_USE, &args->end_time);
-		if (ret != 0) {
-			args->swift.errno_error("clock_gettime", errno);
-			args->scerr = SCERR_INIT_FAILED; /* Not the right error code, but swift client should not know about POSIX clock errors */
+	for (c = 0; !args->keep_dataset && c < args->num_containers && SCERR_SUCCESS == args->scerr; c++) {
+		args->scerr = swift_set_container(&args->swift, keyspace_container_name(&ts.keyspace, c));
+		if (SCERR_SUCCESS == args->scerr) {
+			args->scerr = swift_delete_container(&args->swift);
 		}
 	}
+	swift_thread_save_time(args, &args->end_cleanup_time);
+
+	/* Save end time */
+	swift_thread_save_time(args, &args->end_time);
+	swift_thread_release_token(args);
 
+	pthread_cleanup_pop(1);
+	pthread_cleanup_pop(1);
+	pthread_cleanup_pop(1);
 	pthread_cleanup_pop(1);
 	pthread_cleanup_pop(1);
 
@@ -1,15 +1,84 @@
 #ifndef SWIFT_THREAD_H_
 #define SWIFT_THREAD_H_
 
+#include <time.h>    /* struct timespec, CLOCK_* */
+#include <stdint.h>  /* uint64_t */
+#include <pthread.h> /* pthread_* */
+
 #include "swift-client.h"
+#include "histogram.h"
+#include "test-data.h"
+#include "keyspace.h"
+#include "arrival.h"
+#include "workload.h"
+#include "live-report.h"
+#include "auth-token.h"
+#include "request-timing.h"
+
+#ifdef CLOCK_MONOTONIC_RAW
+/* Use NTP-immune but Linux-specific clock */
+#define CLOCK_TO_USE CLOCK_MONOTONIC_RAW
+#else /* ndef CLOCK_MONOTONIC_RAW */
+/* Use POSIX-defined but NTP-vulnerable clock */
+#define CLOCK_TO_USE CLOCK_MONOTONIC
+#endif /* ndef CLOCK_MONOTONIC_RAW */
+
+/* Statistics gathered for each type of operation */
+struct swift_op_stats {
+	struct histogram latency; /* Latency of each successful operation in nanoseconds, from its intended start */
+	struct histogram service; /* Latency of each successful operation in nanoseconds, from its actual start */
+	unsigned long long bytes; /* Total object data transferred by successful operations */
+	unsigned long long errors; /* Number of failed operations */
+};
+
+/*
+ * Classes of object size by which puts and gets are broken down when sizes vary: objects of up to 4 KiB,
+ * 64 KiB, 1 MiB, 16 MiB and 256 MiB, and larger.
+ */
+#define SWIFT_SIZE_CLASSES 6
+
+/*
+ * Rows of statistics of a Swift thread: one per type of operation, then those of the segment puts
+ * of puts of static large objects, of the chunk gets of gets of objects as concurrent ranges,
+ * of the pages got by listings, and of the puts and then the gets of each class of object size.
+ */
+#define SWIFT_ROW_SEGMENT (SWIFT_OP_MAX + 1)
+#define SWIFT_ROW_CHUNK (SWIFT_OP_MAX + 2)
+#define SWIFT_ROW_PAGE (SWIFT_OP_MAX + 3)
+#define SWIFT_ROW_SIZED (SWIFT_OP_MAX + 4)
+#define SWIFT_ROW_MAX (SWIFT_ROW_SIZED + 2 * SWIFT_SIZE_CLASSES - 1)
 
-/* Types of test data with which to populate a Swift object */
-enum test_data_type {
-	SIMPLE_TEXT,  /* Simple text, easily identifiable in the Swift object's data */
-	ALL_ZEROES,    /* Null bytes */
-	PSEUDO_RANDOM /* Pseudo-random bits */
+/*
+ * Start and phases of a run, shared by all Swift threads. Each Swift thread, once it has created and filled
+ * its objects, arrives at the start; the last to arrive starts them all. Each then becomes active in turn
+ * over the ramp-up, and all go on through the warm-up to their steady state, the only phase whose operations
+ * are recorded. Each keeps up its load through the cool-down, which ends a given time after the last Swift
+ * thread's steady state ends. If the run has a duration, each measured phase of the steady state (the puts,
+ * then the gets, or the mixed phase) ends at a deadline common to all Swift threads, rather than after each has
+ * performed a number of operations, and the throughput of each is computed over that common window.
+ * A run may be one part of a distributed run, whose Swift threads are spread across several processes: the last
+ * of this process's Swift threads to arrive then waits at a barrier for those of every other process, which sets
+ * the start of all of them, and the ramp-up spreads the Swift threads of every process.
+ */
+struct swift_run {
+	pthread_mutex_t mutex;        /* Protects all of the below */
+	pthread_cond_t condvar;       /* Broadcast when the last Swift thread arrives at the start */
+	unsigned int num_threads;     /* Number of Swift threads, across all processes of a distributed run */
+	unsigned int pending_start;   /* Number of Swift threads yet to arrive at the start */
+	unsigned int pending_steady;  /* Number of Swift threads yet to end, or give up, their steady state */
+	uint64_t start;               /* Time at which the last Swift thread arrived at the start, or zero */
+	uint64_t steady_end;          /* Time at which the last Swift thread ended its steady state, or zero */
+	uint64_t ramp_up;             /* Nanoseconds over which Swift threads become active one by one */
+	uint64_t warm_up;             /* Nanoseconds after the ramp-up during which operations are not recorded */
+	uint64_t cool_down;           /* Nanoseconds after steady_end during which operations go on, not recorded */
+	uint64_t duration;            /* Nanoseconds for which each measured phase lasts, or zero if it lasts a number of operations */
+	uint64_t (*barrier)(void *arg); /* Waits for every process of a distributed run and returns the start, or NULL */
+	void *barrier_arg;            /* Argument to barrier */
 };
 
+struct bulk_queue;
+struct dataset_object;
+
 /**
  * In/out parameters to a Swift thread.
  */
@@ -18,24 +87,86 @@ struct swift_thread_args {
 	unsigned int debug;             /* Whether to enable Swift client library debugging */
 	pthread_t thread_id;            /* pthread thread ID */
 	unsigned int thread_num;        /* Swift thread index */
+	int cpu;                        /* CPU to which the thread is bound, or -1 if it is not */
+	int node;                       /* NUMA node of that CPU, or -1 if the thread is not bound */
 	const char *proxy;              /* Proxy to use, or NULL for none */
 	const char *swift_url;          /* Public endpoint URL of Swift service */
-	const char *auth_token;         /* Authentication token from Keystone */
+	const char *auth_token;         /* Authentication token from Keystone, as last adopted */
+	struct auth_tokens *tokens;     /* Source of refreshed authentication tokens */
+	struct auth_token_reader *token_reader; /* Version of the token in use by the thread */
 	enum swift_error scerr;         /* Swift client error encountered */
-	pthread_cond_t *start_condvar;  /* Wait for this condition before starting */
-	pthread_mutex_t *start_mutex;   /* Protects access to start condvar */
+	struct swift_run *run;          /* Start and phases of the run, shared by all Swift threads */
+	unsigned int in_steady;         /* Whether the thread has started, and not yet ended, its steady state */
 	enum test_data_type data_type;  /* Type of test data with which to fill Swift objects */
-	size_t data_size;               /* Length of each Swift object */
-	unsigned int num_iterations;    /* Number of sequential identical get and number of put operations */
-	unsigned int verify_data;       /* Whether to verify that retrieved data is that which was previously inserted */
+	size_t data_size;               /* Length of each Swift object, or the largest if sizes vary */
+	const struct size_distribution *sizes; /* Distribution from which each put draws its object's size, or NULL for data_size */
+	unsigned int num_iterations;    /* Number of sequential get and number of put operations */
+	enum verify_mode verify_data;   /* Whether and how to verify that retrieved data is that which was previously inserted */
+	uint32_t *object_crcs;          /* CRC-32C of the data last put into each object, if verifying hashes */
+	unsigned int queue_depth;       /* Number of requests a multi-request Swift thread keeps in flight */
+	unsigned int num_containers;    /* Number of containers across which the thread's objects are spread */
+	unsigned long num_objects;      /* Number of objects upon which the thread operates */
+	struct key_distribution_spec key_distribution; /* Distribution from which each put and get chooses its object */
+	double rate;                    /* Puts or gets per second issued by the thread regardless of completions, or zero to issue each when the last completes */
+	enum arrival_process arrival;   /* Process by which puts and gets arrive at the given rate */
+	unsigned int num_threads;       /* Number of Swift threads, across which arrivals are staggered */
+	const struct workload *workload; /* Mixed workload replacing the put and get phases, or NULL */
+	size_t segment_size;            /* Length of each segment of an object put as a static large object, or zero to put objects whole */
+	unsigned int segment_connections; /* Number of connections over which the segments of each object are put at once */
+	size_t get_chunk_size;          /* Length of each chunk of an object got as concurrent ranges, or zero to get objects whole */
+	unsigned int get_connections;   /* Number of connections over which the chunks of each object are got at once */
+	struct bulk_queue *bulk;        /* Queue of the prefill and cleanup shared by all Swift threads, or NULL if each does its own */
+	struct dataset_object *dataset; /* Record of each object of a dataset reused or to be kept, or NULL if neither */
+	unsigned int reuse_dataset;     /* Whether the containers and objects exist already, as recorded in dataset, to be checked rather than put */
+	unsigned int keep_dataset;      /* Whether to leave the containers and objects in place, recording them in dataset, rather than delete them */
 	struct timespec start_time;     /* Time of start of Swift thread */
+	struct timespec start_prefill_time; /* Time of start of initial put of every object */
+	struct timespec end_prefill_time;   /* Time of end of initial put of every object */
 	struct timespec start_put_time; /* Time of start of all put operations */
 	struct timespec end_put_time;   /* Time of end of all put operations */
 	struct timespec start_get_time; /* Time of start of all get operations */
 	struct timespec end_get_time;   /* Time of end of all get operations */
+	struct timespec start_mixed_time; /* Time of start of all operations of a mixed workload */
+	struct timespec end_mixed_time;   /* Time of end of all operations of a mixed workload */
+	struct timespec start_cleanup_time; /* Time of start of deletion of every object and container */
+	struct timespec end_cleanup_time;   /* Time of end of deletion of every object and container */
 	struct timespec end_time;       /* Time of end of Swift thread */
+	struct swift_op_stats op_stats[SWIFT_OP_MAX + 1]; /* Per-operation statistics, indexed by operation type */
+	struct swift_op_stats segment_stats; /* Statistics of the segment puts of measured puts of static large objects */
+	struct swift_op_stats chunk_stats;   /* Statistics of the chunk gets of gets of objects as concurrent ranges */
+	struct swift_op_stats page_stats;    /* Statistics of the pages got by measured listings */
+	struct swift_op_stats sized_stats[2 * SWIFT_SIZE_CLASSES]; /* Statistics of measured puts, then gets, of each class of object size, if sizes vary */
+	struct live_counters *live;          /* Counters of measured operations, sampled while the thread runs */
+	struct request_timings *timings;     /* Request timings of measured operations, indexed by operation type, or NULL if not timed */
 };
 
+uint64_t swift_clock_nanosecs(void);
+uint64_t swift_record_op(struct swift_op_stats *stats, uint64_t intended_nanosecs, uint64_t start_nanosecs, size_t bytes);
+uint64_t swift_thread_record_op(struct swift_thread_args *args, enum swift_op_type op, uint64_t intended_nanosecs, uint64_t start_nanosecs, size_t bytes);
+void swift_thread_record_failure(struct swift_thread_args *args, enum swift_op_type op);
+void swift_thread_record_timings(struct swift_thread_args *args, enum swift_op_type op, CURL *curl);
+void swift_wait_until(uint64_t when);
+void swift_thread_save_time(struct swift_thread_args *args, struct timespec *ts);
+void swift_thread_init_stats(struct swift_thread_args *args);
+int swift_run_init(struct swift_run *run, unsigned int num_threads, double ramp_up, double warm_up, double cool_down, double duration);
+void swift_run_destroy(struct swift_run *run);
+void swift_run_distribute(struct swift_run *run, unsigned int total_threads, uint64_t (*barrier)(void *arg), void *barrier_arg);
+void swift_thread_wait_for_start(struct swift_thread_args *args);
+uint64_t swift_thread_activation(const struct swift_thread_args *args);
+uint64_t swift_thread_steady_start(const struct swift_thread_args *args);
+uint64_t swift_thread_phase_deadline(const struct swift_thread_args *args, unsigned int phase);
+void swift_thread_end_steady(struct swift_thread_args *args);
+int swift_thread_cooling(struct swift_thread_args *args);
+const char *swift_row_name(unsigned int row);
+const struct swift_op_stats *swift_row_stats(const struct swift_thread_args *args, unsigned int row);
+void swift_row_window(const struct swift_thread_args *args, unsigned int n, unsigned int row, struct timespec *start, struct timespec *end);
+double swift_timespecs_to_secs(const struct timespec *start, const struct timespec *end);
+int swift_thread_adopt_token(struct swift_thread_args *args);
+void swift_thread_release_token(struct swift_thread_args *args);
+int swift_thread_tracks_objects(const struct swift_thread_args *args);
+size_t swift_thread_object_len(const struct swift_thread_args *args, unsigned long object, size_t len);
+enum swift_error swift_thread_check_data(struct swift_thread_args *args, const struct compare_data_args *compare_args, unsigned long object);
 void *swift_thread_func(void *arg);
+void *swift_multi_thread_func(void *arg);
 
 #endif /* SWIFT_THREAD_H_ */
@@ -0,0 +1,817 @@
+#include <stdio.h>   /* snprintf, perror */
+#include <string.h>  /* memcmp, memcpy, memset */
+#include <assert.h>  /* assert */
+#include <sys/mman.h> /* mmap, madvise, mprotect, munmap */
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define TEST_DATA_X86_KERNELS
+#include <immintrin.h> /* _mm_*, _mm256_*, _mm512_* */
+#endif
+
+#include "test-data.h"
+#include "prng.h"
+#include "corpus.h"
+
+/* Length of data regenerated at once for comparison with data received */
+#define COMPARE_CHUNK_LEN 4096
+/* Number of decimal digits of the line number within each line of simple text */
+#define LINE_NUMBER_DIGITS 16
+
+#ifdef min
+#undef min
+#endif
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+/* Size of the huge pages in which shared test data is preferably held */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/* Test data shared read-only by every object of one type beyond its header, set up by test_data_share */
+static unsigned char *shared_data;
+static size_t shared_len;
+static size_t shared_map_len;
+static enum test_data_type shared_type;
+
+/**
+ * Prepare to generate the test data of the given object of the given thread.
+ */
+void
+test_data_source_init(struct test_data_source *source, enum test_data_type type, unsigned int thread_num, unsigned long object)
+{
+	int len;
+
+	source->type = type;
+	source->seed = prng_seed(((uint64_t) thread_num << 40) ^ object);
+	source->shared = (shared_data && type == shared_type) ? shared_data : NULL;
+	source->shared_len = source->shared ? shared_len : 0;
+	source->header_len = TEST_DATA_HEADER_LEN;
+	if (FILE_DATA == type) {
+		const struct corpus_file *file = corpus_file(thread_num, object);
+		source->shared = file->data;
+		source->shared_len = file->len;
+		source->header_len = 0;
+	}
+	if (SIMPLE_TEXT == type) {
+		/* Fixed-width fields, so that every line is the same length; the line number goes in the gap */
+		len = snprintf(source->line_template, sizeof(source->line_template), "Thread %05u object %012lu line ", thread_num % 100000, object % 1000000000000UL);
+		assert(len + LINE_NUMBER_DIGITS < TEST_DATA_LINE_LEN);
+		source->line_number_at = len;
+		memset(source->line_template + len, '.', TEST_DATA_LINE_LEN - len - 1);
+		source->line_template[TEST_DATA_LINE_LEN - 1] = '\n';
+	}
+}
+
+/**
+ * Generate the given line of simple text.
+ */
+static void
+gen_text_line(const struct test_data_source *source, uint64_t line, char *out)
+{
+	char *p = out + source->line_number_at;
+	unsigned int i;
+
+	memcpy(out, source->line_template, TEST_DATA_LINE_LEN);
+	for (i = LINE_NUMBER_DIGITS; i--; line /= 10) {
+		p[i] = '0' + line % 10;
+	}
+}
+
+/**
+ * Generate simple text from the given offset.
+ */
+static void
+gen_simple_text(const struct test_data_source *source, uint64_t off, unsigned char *data, size_t len)
+{
+	char line[TEST_DATA_LINE_LEN];
+	uint64_t n = off / TEST_DATA_LINE_LEN;
+	size_t skip = off % TEST_DATA_LINE_LEN;
+
+	while (len) {
+		size_t part = min(len, TEST_DATA_LINE_LEN - skip);
+		gen_text_line(source, n++, line);
+		memcpy(data, line + skip, part);
+		data += part;
+		len -= part;
+		skip = 0;
+	}
+}
+
+/*
+ * Pseudo-random words are generated in counter mode: word i of the stream with a given seed
+ * is the splitmix64 output function of (seed + i * golden ratio), so that any word can be
+ * generated directly, and runs of words in parallel. Every kernel generates the same words.
+ */
+#define GOLDEN_GAMMA 0x9E3779B97F4A7C15ULL
+#define MIX_MULTIPLIER_1 0xBF58476D1CE4E5B9ULL
+#define MIX_MULTIPLIER_2 0x94D049BB133111EBULL
+
+/**
+ * Return the given 64-bit word of the pseudo-random stream with the given seed.
+ */
+static inline uint64_t
+random_word(uint64_t seed, uint64_t index)
+{
+	uint64_t z = seed + index * GOLDEN_GAMMA;
+
+	z = (z ^ (z >> 30)) * MIX_MULTIPLIER_1;
+	z = (z ^ (z >> 27)) * MIX_MULTIPLIER_2;
+	return z ^ (z >> 31);
+}
+
+/**
+ * Generate n consecutive words of the pseudo-random stream, from the given word onwards.
+ */
+static void
+gen_words_scalar(uint64_t seed, uint64_t index, unsigned char *data, size_t n)
+{
+	for (; n; n--, data += sizeof(uint64_t)) {
+		uint64_t word = random_word(seed, index++);
+		memcpy(data, &word, sizeof(word));
+	}
+}
+
+/**
+ * Return whether the given n words are those of the pseudo-random stream from the given word onwards.
+ * The comparison is fused with generation, so no expected data is ever stored.
+ */
+static int
+verify_words_scalar(uint64_t seed, uint64_t index, const unsigned char *data, size_t n)
+{
+	uint64_t diff = 0, word;
+
+	for (; n; n--, data += sizeof(uint64_t)) {
+		memcpy(&word, data, sizeof(word));
+		diff |= word ^ random_word(seed, index++);
+	}
+	return !diff;
+}
+
+/**
+ * Return whether the given data is all-zero bytes.
+ */
+static int
+all_zero_scalar(const unsigned char *data, size_t len)
+{
+	uint64_t acc = 0, word;
+
+	for (; len >= sizeof(word); len -= sizeof(word), data += sizeof(word)) {
+		memcpy(&word, data, sizeof(word));
+		acc |= word;
+	}
+	for (; len; len--) {
+		acc |= *data++;
+	}
+	return !acc;
+}
+
+/* Reflected CRC-32C (Castagnoli) polynomial, as used by iSCSI, ext4 and the SSE4.2 crc32 instruction */
+#define CRC32C_POLY 0x82F63B78U
+
+/* Table of the CRC-32C of each byte value, built by test_data_init */
+static uint32_t crc32c_table[256];
+
+/**
+ * Update the given raw (uninverted) CRC-32C state with the given data, a byte at a time.
+ */
+static uint32_t
+crc32c_scalar(uint32_t crc, const unsigned char *data, size_t len)
+{
+	for (; len; len--) {
+		crc = crc32c_table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+#ifdef TEST_DATA_X86_KERNELS
+
+/**
+ * Multiply each 64-bit lane by the given constant, split into 32-bit halves; AVX2 has no 64-bit multiply.
+ */
+__attribute__((target("avx2")))
+static inline __m256i
+mul64_avx2(__m256i z, __m256i c_lo, __m256i c_hi)
+{
+	__m256i lo_lo = _mm256_mul_epu32(z, c_lo);
+	__m256i hi_lo = _mm256_mul_epu32(_mm256_srli_epi64(z, 32), c_lo);
+	__m256i lo_hi = _mm256_mul_epu32(z, c_hi);
+
+	return _mm256_add_epi64(lo_lo, _mm256_slli_epi64(_mm256_add_epi64(hi_lo, lo_hi), 32));
+}
+
+/**
+ * Return the four pseudo-random words whose counters are in the given lanes.
+ */
+__attribute__((target("avx2")))
+static inline __m256i
+random_words_avx2(__m256i z)
+{
+	const __m256i m1_lo = _mm256_set1_epi64x((long long) (MIX_MULTIPLIER_1 & 0xFFFFFFFFU));
+	const __m256i m1_hi = _mm256_set1_epi64x((long long) (MIX_MULTIPLIER_1 >> 32));
+	const __m256i m2_lo = _mm256_set1_epi64x((long long) (MIX_MULTIPLIER_2 & 0xFFFFFFFFU));
+	const __m256i m2_hi = _mm256_set1_epi64x((long long) (MIX_MULTIPLIER_2 >> 32));
+
+	z = mul64_avx2(_mm256_xor_si256(z, _mm256_srli_epi64(z, 30)), m1_lo, m1_hi);
+	z = mul64_avx2(_mm256_xor_si256(z, _mm256_srli_epi64(z, 27)), m2_lo, m2_hi);
+	return _mm256_xor_si256(z, _mm256_srli_epi64(z, 31));
+}
+
+/**
+ * Return the counters of the four pseudo-random words from the given word onwards.
+ */
+__attribute__((target("avx2")))
+static inline __m256i
+counters_avx2(uint64_t seed, uint64_t index)
+{
+	uint64_t base = seed + index * GOLDEN_GAMMA;
+
+	return _mm256_set_epi64x((long long) (base + 3 * GOLDEN_GAMMA), (long long) (base + 2 * GOLDEN_GAMMA), (long long) (base + GOLDEN_GAMMA), (long long) base);
+}
+
+__attribute__((target("avx2")))
+static void
+gen_words_avx2(uint64_t seed, uint64_t index, unsigned char *data, size_t n)
+{
+	const __m256i step = _mm256_set1_epi64x((long long) (4 * GOLDEN_GAMMA));
+	__m256i x = counters_avx2(seed, index);
+
+	for (; n >= 4; n -= 4, data += 4 * sizeof(uint64_t), index += 4) {
+		_mm256_storeu_si256((__m256i *) data, random_words_avx2(x));
+		x = _mm256_add_epi64(x, step);
+	}
+	gen_words_scalar(seed, index, data, n);
+}
+
+__attribute__((target("avx2")))
+static int
+verify_words_avx2(uint64_t seed, uint64_t index, const unsigned char *data, size_t n)
+{
+	const __m256i step = _mm256_set1_epi64x((long long) (4 * GOLDEN_GAMMA));
+	__m256i x = counters_avx2(seed, index);
+	__m256i diff = _mm256_setzero_si256();
+
+	for (; n >= 4; n -= 4, data += 4 * sizeof(uint64_t), index += 4) {
+		diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) data), random_words_avx2(x)));
+		x = _mm256_add_epi64(x, step);
+	}
+	return _mm256_testz_si256(diff, diff) && verify_words_scalar(seed, index, data, n);
+}
+
+/**
+ * Return the eight pseudo-random words whose counters are in the given lanes.
+ */
+__attribute__((target("avx512f,avx512dq")))
+static inline __m512i
+random_words_avx512(__m512i z)
+{
+	const __m512i m1 = _mm512_set1_epi64((long long) MIX_MULTIPLIER_1);
+	const __m512i m2 = _mm512_set1_epi64((long long) MIX_MULTIPLIER_2);
+
+	z = _mm512_mullo_epi64(_mm512_xor_si512(z, _mm512_srli_epi64(z, 30)), m1);
+	z = _mm512_mullo_epi64(_mm512_xor_si512(z, _mm512_srli_epi64(z, 27)), m2);
+	return _mm512_xor_si512(z, _mm512_srli_epi64(z, 31));
+}
+
+/**
+ * Return the counters of the eight pseudo-random words from the given word onwards.
+ */
+__attribute__((target("avx512f,avx512dq")))
+static inline __m512i
+counters_avx512(uint64_t seed, uint64_t index)
+{
+	uint64_t base = seed + index * GOLDEN_GAMMA;
+
+	return _mm512_add_epi64(_mm512_set1_epi64((long long) base),
+		_mm512_mullo_epi64(_mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0), _mm512_set1_epi64((long long) GOLDEN_GAMMA)));
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static void
+gen_words_avx512(uint64_t seed, uint64_t index, unsigned char *data, size_t n)
+{
+	const __m512i step = _mm512_set1_epi64((long long) (8 * GOLDEN_GAMMA));
+	__m512i x = counters_avx512(seed, index);
+
+	for (; n >= 8; n -= 8, data += 8 * sizeof(uint64_t), index += 8) {
+		_mm512_storeu_si512((void *) data, random_words_avx512(x));
+		x = _mm512_add_epi64(x, step);
+	}
+	gen_words_scalar(seed, index, data, n);
+}
+
+__attribute__((target("avx512f,avx512dq")))
+static int
+verify_words_avx512(uint64_t seed, uint64_t index, const unsigned char *data, size_t n)
+{
+	const __m512i step = _mm512_set1_epi64((long long) (8 * GOLDEN_GAMMA));
+	__m512i x = counters_avx512(seed, index);
+	__m512i diff = _mm512_setzero_si512();
+
+	for (; n >= 8; n -= 8, data += 8 * sizeof(uint64_t), index += 8) {
+		diff = _mm512_or_si512(diff, _mm512_xor_si512(_mm512_loadu_si512((const void *) data), random_words_avx512(x)));
+		x = _mm512_add_epi64(x, step);
+	}
+	return !_mm512_test_epi64_mask(diff, diff) && verify_words_scalar(seed, index, data, n);
+}
+
+__attribute__((target("sse2")))
+static int
+all_zero_sse2(const unsigned char *data, size_t len)
+{
+	__m128i acc = _mm_setzero_si128();
+
+	for (; len >= 16; len -= 16, data += 16) {
+		acc = _mm_or_si128(acc, _mm_loadu_si128((const __m128i *) data));
+	}
+	return 0xFFFF == _mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) && all_zero_scalar(data, len);
+}
+
+__attribute__((target("avx2")))
+static int
+all_zero_avx2(const unsigned char *data, size_t len)
+{
+	__m256i acc = _mm256_setzero_si256();
+
+	for (; len >= 32; len -= 32, data += 32) {
+		acc = _mm256_or_si256(acc, _mm256_loadu_si256((const __m256i *) data));
+	}
+	return _mm256_testz_si256(acc, acc) && all_zero_scalar(data, len);
+}
+
+__attribute__((target("avx512f")))
+static int
+all_zero_avx512(const unsigned char *data, size_t len)
+{
+	__m512i acc = _mm512_setzero_si512();
+
+	for (; len >= 64; len -= 64, data += 64) {
+		acc = _mm512_or_si512(acc, _mm512_loadu_si512((const void *) data));
+	}
+	return !_mm512_test_epi64_mask(acc, acc) && all_zero_scalar(data, len);
+}
+
+/**
+ * Update the given raw CRC-32C state with the given data, eight bytes at a time, using the crc32 instruction.
+ */
+__attribute__((target("sse4.2")))
+static uint32_t
+crc32c_sse42(uint32_t crc, const unsigned char *data, size_t len)
+{
+	uint64_t crc64 = crc, word;
+
+	for (; len >= sizeof(word); len -= sizeof(word), data += sizeof(word)) {
+		memcpy(&word, data, sizeof(word));
+		crc64 = _mm_crc32_u64(crc64, word);
+	}
+	crc = (uint32_t) crc64;
+	for (; len; len--) {
+		crc = _mm_crc32_u8(crc, *data++);
+	}
+	return crc;
+}
+
+#endif /* TEST_DATA_X86_KERNELS */
+
+/* Kernels generating and verifying pseudo-random words, detecting zeroes and hashing, chosen by test_data_init for the CPU */
+static void (*gen_words)(uint64_t seed, uint64_t index, unsigned char *data, size_t n) = gen_words_scalar;
+static int (*verify_words)(uint64_t seed, uint64_t index, const unsigned char *data, size_t n) = verify_words_scalar;
+static int (*all_zero)(const unsigned char *data, size_t len) = all_zero_scalar;
+static uint32_t (*crc32c_update)(uint32_t crc, const unsigned char *data, size_t len) = crc32c_scalar;
+static const char *gen_words_name = "scalar";
+static const char *crc32c_name = "table";
+
+/**
+ * Build the table of the CRC-32C of each byte value.
+ */
+static void
+init_crc32c_table(void)
+{
+	uint32_t crc;
+	unsigned int i, bit;
+
+	for (i = 0; i < 256; i++) {
+		crc = i;
+		for (bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+		}
+		crc32c_table[i] = crc;
+	}
+}
+
+/**
+ * Choose the fastest kernels which the CPU supports, or the portable kernels if so requested.
+ * Must be called before any thread generates, verifies or hashes test data.
+ */
+void
+test_data_init(int portable)
+{
+	init_crc32c_table();
+	gen_words = gen_words_scalar;
+	verify_words = verify_words_scalar;
+	all_zero = all_zero_scalar;
+	crc32c_update = crc32c_scalar;
+	gen_words_name = "scalar";
+	crc32c_name = "table";
+	if (portable) {
+		return;
+	}
+#ifdef TEST_DATA_X86_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+		gen_words = gen_words_avx512;
+		verify_words = verify_words_avx512;
+		all_zero = all_zero_avx512;
+		gen_words_name = "avx512";
+	} else if (__builtin_cpu_supports("avx2")) {
+		gen_words = gen_words_avx2;
+		verify_words = verify_words_avx2;
+		all_zero = all_zero_avx2;
+		gen_words_name = "avx2";
+	} else if (__builtin_cpu_supports("sse2")) {
+		all_zero = all_zero_sse2;
+	}
+	if (__builtin_cpu_supports("sse4.2")) {
+		crc32c_update = crc32c_sse42;
+		crc32c_name = "sse4.2";
+	}
+#endif /* TEST_DATA_X86_KERNELS */
+}
+
+/**
+ * Return the name of the generation and verification kernels chosen by test_data_init.
+ */
+const char *
+test_data_kernel_name(void)
+{
+	return gen_words_name;
+}
+
+/**
+ * Return the name of the CRC-32C kernel chosen by test_data_init.
+ */
+const char *
+test_data_crc_kernel_name(void)
+{
+	return crc32c_name;
+}
+
+/**
+ * Update the given CRC-32C with the given data, as zlib's crc32 does for CRC-32: start from zero.
+ */
+uint32_t
+test_data_crc32c(uint32_t crc, const void *data, size_t len)
+{
+	return ~crc32c_update(~crc, (const unsigned char *) data, len);
+}
+
+/**
+ * Generate pseudo-random bits from the given offset.
+ */
+static void
+gen_pseudo_random(const struct test_data_source *source, uint64_t off, unsigned char *data, size_t len)
+{
+	uint64_t index = off / sizeof(uint64_t), word;
+	size_t skip = off % sizeof(uint64_t), n;
+
+	if (skip) {
+		size_t part = min(len, sizeof(word) - skip);
+		word = random_word(source->seed, index++);
+		memcpy(data, ((const unsigned char *) &word) + skip, part);
+		data += part;
+		len -= part;
+	}
+	n = len / sizeof(word);
+	gen_words(source->seed, index, data, n);
+	index += n;
+	data += n * sizeof(word);
+	len -= n * sizeof(word);
+	if (len) {
+		word = random_word(source->seed, index);
+		memcpy(data, &word, len);
+	}
+}
+
+/**
+ * Return whether the given data is the pseudo-random bits expected from the given offset.
+ */
+static int
+verify_pseudo_random(const struct test_data_source *source, uint64_t off, const unsigned char *data, size_t len)
+{
+	uint64_t index = off / sizeof(uint64_t), word;
+	size_t skip = off % sizeof(uint64_t), n;
+
+	if (skip) {
+		size_t part = min(len, sizeof(word) - skip);
+		word = random_word(source->seed, index++);
+		if (memcmp(data, ((const unsigned char *) &word) + skip, part)) {
+			return 0;
+		}
+		data += part;
+		len -= part;
+	}
+	n = len / sizeof(word);
+	if (!verify_words(source->seed, index, data, n)) {
+		return 0;
+	}
+	index += n;
+	data += n * sizeof(word);
+	len -= n * sizeof(word);
+	if (len) {
+		word = random_word(source->seed, index);
+		return !memcmp(data, &word, len);
+	}
+	return 1;
+}
+
+/**
+ * Generate the given length of the source's own test data, starting from the given offset within the object.
+ */
+static void
+gen_own_data(const struct test_data_source *source, uint64_t off, void *data, size_t len)
+{
+	switch (source->type) {
+	case SIMPLE_TEXT:
+		gen_simple_text(source, off, (unsigned char *) data, len);
+		break;
+	case ALL_ZEROES:
+		memset(data, 0, len);
+		break;
+	case PSEUDO_RANDOM:
+		gen_pseudo_random(source, off, (unsigned char *) data, len);
+		break;
+	default:
+		assert(0);
+		break;
+	}
+}
+
+/**
+ * Return the product of the given 32x32 matrix over GF(2), one column per element, and the given vector.
+ */
+static uint32_t
+gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+	uint32_t sum = 0;
+
+	for (; vec; vec >>= 1, mat++) {
+		if (vec & 1) {
+			sum ^= *mat;
+		}
+	}
+	return sum;
+}
+
+static void
+gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+	unsigned int n;
+
+	for (n = 0; n < 32; n++) {
+		square[n] = gf2_matrix_times(mat, mat[n]);
+	}
+}
+
+/**
+ * Return the CRC-32C of the concatenation of two pieces of data given the CRC-32C of each and the length of the second,
+ * as zlib's crc32_combine does for CRC-32, by applying len2 zero bytes' worth of shifts to the first CRC.
+ */
+uint32_t
+test_data_crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2)
+{
+	uint32_t even[32], odd[32], row = 1;
+	unsigned int n;
+
+	if (0 == len2) {
+		return crc1;
+	}
+
+	/* The operator for one zero bit, then for two, then for four */
+	odd[0] = CRC32C_POLY;
+	for (n = 1; n < 32; n++) {
+		odd[n] = row;
+		row <<= 1;
+	}
+	gf2_matrix_square(even, odd);
+	gf2_matrix_square(odd, even);
+
+	/* Apply an operator for each set bit of len2 bytes, squaring for each bit */
+	do {
+		gf2_matrix_square(even, odd);
+		if (len2 & 1) {
+			crc1 = gf2_matrix_times(even, crc1);
+		}
+		len2 >>= 1;
+		if (0 == len2) {
+			break;
+		}
+		gf2_matrix_square(odd, even);
+		if (len2 & 1) {
+			crc1 = gf2_matrix_times(odd, crc1);
+		}
+		len2 >>= 1;
+	} while (len2);
+
+	return crc1 ^ crc2;
+}
+
+/**
+ * Return the length of the given object of the given thread, given the length it has unless it is a file's.
+ */
+size_t
+test_data_object_len(enum test_data_type type, unsigned int thread_num, unsigned long object, size_t len)
+{
+	return (FILE_DATA == type) ? corpus_file(thread_num, object)->len : len;
+}
+
+/**
+ * Generate the given length of the source's test data, starting from the given offset within the object.
+ * If test data is shared, only the header is generated, and the rest copied from the shared data.
+ */
+void
+gen_test_data(const struct test_data_source *source, uint64_t off, void *data, size_t len)
+{
+	size_t part;
+
+	if (NULL == source->shared) {
+		gen_own_data(source, off, data, len);
+		return;
+	}
+	assert(off + len <= source->shared_len);
+	if (off < source->header_len) {
+		part = min(len, source->header_len - off);
+		gen_own_data(source, off, data, part);
+		data = (unsigned char *) data + part;
+		off += part;
+		len -= part;
+	}
+	memcpy(data, source->shared + off, len);
+}
+
+/**
+ * Return whether the given data is that expected of a source with shared test data, from the given offset.
+ */
+static int
+verify_shared(const struct test_data_source *source, uint64_t off, const unsigned char *data, size_t len)
+{
+	unsigned char header[TEST_DATA_HEADER_LEN];
+	size_t part;
+
+	if (off < source->header_len) {
+		part = min(len, source->header_len - off);
+		gen_own_data(source, off, header, part);
+		if (memcmp(data, header, part)) {
+			return 0;
+		}
+		data += part;
+		off += part;
+		len -= part;
+	}
+	return !memcmp(data, source->shared + off, len);
+}
+
+/**
+ * Generate the test data of the given type once, for the given length, into a read-only region shared
+ * by every object of that type beyond its header, so that threads copy rather than generate data.
+ * The region is held in huge pages if any are reserved, or else transparent huge pages are requested.
+ * Must be called before any thread generates test data. Returns zero on success.
+ */
+int
+test_data_share(enum test_data_type type, size_t len)
+{
+	struct test_data_source source;
+	size_t map_len = (len + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+	void *p = MAP_FAILED;
+
+	test_data_unshare();
+	if (0 == map_len) {
+		map_len = HUGE_PAGE_SIZE;
+	}
+#ifdef MAP_HUGETLB
+	p = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+	if (MAP_FAILED == p) {
+		/* No huge pages reserved */
+		p = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (MAP_FAILED == p) {
+			perror("mmap");
+			return -1;
+		}
+#ifdef MADV_HUGEPAGE
+		madvise(p, map_len, MADV_HUGEPAGE);
+#endif
+	}
+
+	/* The data of an object of no thread, as yet unshared */
+	test_data_source_init(&source, type, 0, 0);
+	gen_test_data(&source, 0, p, len);
+	if (0 != mprotect(p, map_len, PROT_READ)) {
+		perror("mprotect");
+		munmap(p, map_len);
+		return -1;
+	}
+
+	shared_data = (unsigned char *) p;
+	shared_len = len;
+	shared_map_len = map_len;
+	shared_type = type;
+	return 0;
+}
+
+/**
+ * Release any shared test data. Must not be called while any thread generates test data.
+ */
+void
+test_data_unshare(void)
+{
+	if (shared_data) {
+		munmap(shared_data, shared_map_len);
+		shared_data = NULL;
+	}
+}
+
+/**
+ * Compare the given data to that expected, regenerating the expected data at the same offset.
+ */
+size_t
+compare_data(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	struct compare_data_args *args = (struct compare_data_args *) userdata;
+	const unsigned char *received = (const unsigned char *) ptr;
+	size_t len = size * nmemb;
+
+	if (len > args->len - args->off) {
+		return CURL_READFUNC_ABORT; /* Longer than expected */
+	}
+
+	if (VERIFY_HASH == args->mode) {
+		/* Only hash the data as it arrives; compare_data_complete checks the hash */
+		args->crc = test_data_crc32c(args->crc, received, len);
+	} else if (args->source.shared) {
+		/* Require received data to be identical to the object's header and then the shared data */
+		if (!verify_shared(&args->source, args->off, received, len)) {
+			return CURL_READFUNC_ABORT; /* Not the expected data */
+		}
+	} else if (ALL_ZEROES == args->source.type) {
+		/* Require received data to be all-zero bytes */
+		if (!all_zero(received, len)) {
+			return CURL_READFUNC_ABORT; /* Not the expected data */
+		}
+	} else if (PSEUDO_RANDOM == args->source.type) {
+		/* Require received data to be identical to expected data, regenerated word by word */
+		if (!verify_pseudo_random(&args->source, args->off, received, len)) {
+			return CURL_READFUNC_ABORT; /* Not the expected data */
+		}
+	} else {
+		/* Require received data to be identical to expected data */
+		unsigned char expected[COMPARE_CHUNK_LEN];
+		size_t done, n;
+		for (done = 0; done < len; done += n) {
+			n = min(len - done, sizeof(expected));
+			gen_test_data(&args->source, args->off + done, expected, n);
+			if (memcmp(received + done, expected, n)) {
+				return CURL_READFUNC_ABORT; /* Not the expected data */
+			}
+		}
+	}
+
+	args->off += len;
+
+	return len;
+}
+
+/**
+ * Return whether all the data expected was received, and, if verifying a hash, whether it had the expected CRC-32C.
+ */
+int
+compare_data_complete(const struct compare_data_args *args, uint32_t expected_crc)
+{
+	if (args->off != args->len) {
+		return 0;
+	}
+	return VERIFY_HASH != args->mode || args->crc == expected_crc;
+}
+
+/**
+ * Ignore the given data.
+ */
+size_t
+ignore_data(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	return size * nmemb;
+}
+
+/**
+ * Supply the next part of the data to be inserted, generated directly into libcurl's buffer.
+ */
+size_t
+supply_data(void *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	struct supply_data_args *args = (struct supply_data_args *) userdata;
+
+	size = min(size * nmemb, args->len - args->off);
+	gen_test_data(&args->source, args->off, ptr, size);
+	if (args->hash) {
+		args->crc = test_data_crc32c(args->crc, ptr, size);
+	}
+	args->off += size;
+
+	return size;
+}
@@ -0,0 +1,79 @@
+#ifndef TEST_DATA_H_
+#define TEST_DATA_H_
+
+#include <stdint.h>  /* uint32_t, uint64_t */
+
+#include "swift-client.h"
+
+/* Types of test data with which to populate a Swift object */
+enum test_data_type {
+	SIMPLE_TEXT,  /* Simple text, easily identifiable in the Swift object's data */
+	ALL_ZEROES,    /* Null bytes */
+	PSEUDO_RANDOM, /* Pseudo-random bits */
+	FILE_DATA     /* Contents of the local files of the corpus */
+};
+
+/* Ways of verifying that retrieved data is that which was previously inserted */
+enum verify_mode {
+	VERIFY_NONE,  /* Do not verify */
+	VERIFY_DATA,  /* Compare every byte received to the test data regenerated at the same offset */
+	VERIFY_HASH   /* Compare a CRC-32C of the data received to that of the data inserted */
+};
+
+/* Length of each line of simple text */
+#define TEST_DATA_LINE_LEN 64
+/* Length of the head of each object which is generated for that object alone, when the rest is shared */
+#define TEST_DATA_HEADER_LEN TEST_DATA_LINE_LEN
+
+/*
+ * Source of the test data of one Swift object. Any part of the data can be generated
+ * independently of the rest, so that data is produced as it is sent and regenerated
+ * as it is received, and no copy of a whole object is ever held in memory.
+ * The data depends only on the thread, the object and the offset within the object, or, if test data
+ * is shared, beyond the header only on the offset. File data is all shared, the file's mapping with no header.
+ */
+struct test_data_source {
+	enum test_data_type type;                /* Type of test data */
+	uint64_t seed;                           /* Seed of pseudo-random data, derived from the thread and object */
+	char line_template[TEST_DATA_LINE_LEN];  /* Line of simple text, but for its line number */
+	unsigned int line_number_at;             /* Offset within each line of simple text of its line number */
+	const unsigned char *shared;             /* Data shared by every object beyond its header, or NULL */
+	size_t shared_len;                       /* Length of the shared data */
+	size_t header_len;                       /* Length of the head of the object generated for it alone, if shared */
+};
+
+/* In/out arguments to a compare_data callback */
+struct compare_data_args {
+	swift_context_t *swift;
+	struct test_data_source source; /* Source of the data expected */
+	enum verify_mode mode;          /* Whether to compare the data itself or its CRC-32C */
+	uint32_t crc;                   /* CRC-32C of the data already received, if verifying a hash */
+	size_t len;                     /* Total length of data expected */
+	size_t off;                     /* Length of data already compared */
+};
+
+/* In/out arguments to a supply_data callback */
+struct supply_data_args {
+	struct test_data_source source; /* Source of the data to supply */
+	int hash;                       /* Whether to compute the CRC-32C of the data supplied */
+	uint32_t crc;                   /* CRC-32C of the data already supplied, if computing a hash */
+	size_t len;                     /* Total length of data to supply */
+	size_t off;                     /* Length of data already supplied */
+};
+
+size_t compare_data(void *ptr, size_t size, size_t nmemb, void *userdata);
+int compare_data_complete(const struct compare_data_args *args, uint32_t expected_crc);
+size_t ignore_data(void *ptr, size_t size, size_t nmemb, void *userdata);
+size_t supply_data(void *ptr, size_t size, size_t nmemb, void *userdata);
+void test_data_init(int portable);
+int test_data_share(enum test_data_type type, size_t len);
+void test_data_unshare(void);
+const char *test_data_kernel_name(void);
+const char *test_data_crc_kernel_name(void);
+uint32_t test_data_crc32c(uint32_t crc, const void *data, size_t len);
+uint32_t test_data_crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+void test_data_source_init(struct test_data_source *source, enum test_data_type type, unsigned int thread_num, unsigned long object);
+size_t test_data_object_len(enum test_data_type type, unsigned int thread_num, unsigned long object, size_t len);
+void gen_test_data(const struct test_data_source *source, uint64_t off, void *data, size_t len);
+
+#endif /* TEST_DATA_H_ */
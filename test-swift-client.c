@@ -8,6 +8,9 @@
 #include <pthread.h> /* pthread_* */
 #include <assert.h>  /* assert */
 #include <errno.h>   /* errno */
+#include <time.h>    /* time */
+#include <sys/resource.h> /* setrlimit */
+#include <sys/mman.h> /* mmap, munmap */
 
 /* If defined, use GNU getopt_long; otherwise, use POSIX getopt */
 #define USE_GETOPT_LONG
@@ -21,6 +24,15 @@
 
 #include "keystone-thread.h"
 #include "swift-thread.h"
+#include "data-bench.h"
+#include "corpus.h"
+#include "slo.h"
+#include "results.h"
+#include "auth-token.h"
+#include "placement.h"
+#include "controller.h"
+#include "bulk.h"
+#include "dataset.h"
 
 /* Default number of Swift threads, if not over-ridden on command line */
 #define NUM_SWIFT_THREADS_DEFAULT 5
@@ -30,11 +42,28 @@
 #define OBJECT_SIZE_DEFAULT 1024
 /* Default type of test data with which to fill Swift objects */
 #define OBJECT_DATA_TYPE_DEFAULT SIMPLE_TEXT
-/* Default data-verification flag. If true, verify that retrieved data is what was previously inserted. If false, do not perform this verification */
-#define VERIFY_DATA_DEFAULT 1
+/* Default number of requests kept in flight by each Swift thread of the multi-request engine */
+#define QUEUE_DEPTH_DEFAULT 16
+/* Default number of containers across which each Swift thread spreads its objects */
+#define NUM_CONTAINERS_DEFAULT 1
+/* Default distribution from which the object addressed by each put and get is chosen */
+#define KEY_DISTRIBUTION_DEFAULT "uniform"
+/* Default process by which puts and gets arrive, when issued at a fixed rate */
+#define ARRIVAL_PROCESS_DEFAULT ARRIVAL_FIXED
+/* Default number of connections over which each Swift thread puts the segments of a static large object */
+#define SEGMENT_CONNECTIONS_DEFAULT 4
+/* Default number of connections over which each Swift thread gets the chunks of an object */
+#define GET_CONNECTIONS_DEFAULT 4
+/* Default number of seconds for which a Keystone token is taken to be valid once issued */
+#define TOKEN_LIFETIME_DEFAULT 3600
+/* Default data-verification mode. Unless VERIFY_NONE, verify that retrieved data is what was previously inserted */
+#define VERIFY_DATA_DEFAULT VERIFY_DATA
+/* Options which the controller of a distributed run keeps to itself, rather than sending to its agents */
+#define CONTROLLER_LOCAL_OPTIONS "AbBfhMNOY?"
 
-#define typealloc(type) (((type) *) malloc(sizeof(type)))
+#define typealloc(type) ((type *) malloc(sizeof(type)))
 #define typearrayalloc(count, type) ((type *) malloc((count) * sizeof(type)))
+#define ELEMENTSOF(arr) ((sizeof(arr) / sizeof((arr)[0])))
 
 static double
 timespecs_to_microsecs(const struct timespec *start, const struct timespec *end)
@@ -51,13 +80,198 @@ show_swift_times(const struct swift_thread_args *args, unsigned int n)
 {
 	fprintf(stderr, "Swift execution times for %u threads:\n", n);
 	while (n--) {
+		if (args->cpu >= 0) {
+			fprintf(stderr, "Thread %3u: bound to CPU %d, NUMA node %d\n", args->thread_num, args->cpu, args->node);
+		}
 		fprintf(stderr, "Thread %3u: total duration (microseconds): %12.3f\n", args->thread_num, timespecs_to_microsecs(&args->start_time, &args->end_time));
-		fprintf(stderr, "Thread %3u:   put duration (microseconds): %12.3f\n", args->thread_num, timespecs_to_microsecs(&args->start_put_time, &args->end_put_time));
-		fprintf(stderr, "Thread %3u:   get duration (microseconds): %12.3f\n", args->thread_num, timespecs_to_microsecs(&args->start_get_time, &args->end_get_time));
+		fprintf(stderr, "Thread %3u: prefill duration (microseconds): %10.3f\n", args->thread_num, timespecs_to_microsecs(&args->start_prefill_time, &args->end_prefill_time));
+		if (args->workload) {
+			fprintf(stderr, "Thread %3u: mixed duration (microseconds): %12.3f\n", args->thread_num, timespecs_to_microsecs(&args->start_mixed_time, &args->end_mixed_time));
+		} else {
+			fprintf(stderr, "Thread %3u:   put duration (microseconds): %12.3f\n", args->thread_num, timespecs_to_microsecs(&args->start_put_time, &args->end_put_time));
+			fprintf(stderr, "Thread %3u:   get duration (microseconds): %12.3f\n", args->thread_num, timespecs_to_microsecs(&args->start_get_time, &args->end_get_time));
+		}
+		fprintf(stderr, "Thread %3u: cleanup duration (microseconds): %10.3f\n", args->thread_num, timespecs_to_microsecs(&args->start_cleanup_time, &args->end_cleanup_time));
 		args++;
 	}
 }
 
+/**
+ * Display the mean, percentiles and maximum of the given latencies, in microseconds.
+ */
+static void
+show_latencies(const char *op_name, const char *label, const struct histogram *h)
+{
+	static const double percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+	unsigned int i;
+
+	fprintf(stderr, "%6s: %-7s mean %12.3f", op_name, label, histogram_mean(h) / 1000);
+	for (i = 0; i < ELEMENTSOF(percentiles); i++) {
+		fprintf(stderr, "  p%g %12.3f", percentiles[i], histogram_percentile(h, percentiles[i]) / 1000.0);
+	}
+	fprintf(stderr, "  max %12.3f\n", h->max / 1000.0);
+}
+
+/**
+ * Display latency percentiles and throughput of each type of operation, aggregated across all Swift threads.
+ * If operations were issued at a fixed rate, latency is measured from each operation's intended start,
+ * and service time, from its actual start, is shown too.
+ * The segment puts of puts of static large objects, and the chunk gets of gets of objects as concurrent ranges,
+ * are shown last, as the operations "segment" and "chunk".
+ */
+static void
+show_swift_op_stats(const struct swift_thread_args *args, unsigned int n)
+{
+	struct histogram *merged, *merged_service;
+	unsigned int op, i;
+
+	merged = typearrayalloc(2, struct histogram);
+	if (NULL == merged) {
+		perror("malloc");
+		return;
+	}
+	merged_service = &merged[1];
+
+	fprintf(stderr, "Swift operation statistics for %u threads (latencies in microseconds):\n", n);
+	for (op = 0; op <= SWIFT_ROW_MAX; op++) {
+		const char *name = swift_row_name(op);
+		unsigned long long bytes = 0;
+		struct timespec start, end;
+		double secs;
+
+		histogram_init(merged);
+		histogram_init(merged_service);
+		for (i = 0; i < n; i++) {
+			const struct swift_op_stats *stats = swift_row_stats(&args[i], op);
+			histogram_merge(merged, &stats->latency);
+			histogram_merge(merged_service, &stats->service);
+			bytes += stats->bytes;
+		}
+		if (0 == merged->count) {
+			continue;
+		}
+		swift_row_window(args, n, op, &start, &end);
+		secs = swift_timespecs_to_secs(&start, &end);
+
+		fprintf(stderr, "%6s: ops %10llu  ops/s %12.3f  MB/s %12.3f\n",
+			name,
+			(unsigned long long) merged->count,
+			(secs > 0) ? merged->count / secs : 0.0,
+			(secs > 0) ? bytes / secs / 1000000 : 0.0
+		);
+		show_latencies(name, "latency", merged);
+		if (args->rate > 0) {
+			show_latencies(name, "service", merged_service);
+		}
+	}
+
+	free(merged);
+}
+
+/**
+ * Display, for each type of operation, aggregated across all Swift threads, how many of its requests opened
+ * a new connection, and the latency percentiles of each phase of its requests, as timed by libcurl.
+ */
+static void
+show_request_timings(const struct swift_thread_args *args, unsigned int n)
+{
+	struct request_timings *merged;
+	unsigned int op, phase, i;
+
+	merged = typealloc(struct request_timings);
+	if (NULL == merged) {
+		perror("malloc");
+		return;
+	}
+
+	fprintf(stderr, "Request timings for %u threads (in microseconds; dns, connect and tls of new connections only):\n", n);
+	for (op = 0; op <= SWIFT_OP_MAX; op++) {
+		const char *name = swift_op_name(op);
+
+		request_timings_init(merged);
+		for (i = 0; i < n; i++) {
+			request_timings_merge(merged, &args[i].timings[op]);
+		}
+		if (0 == merged->requests) {
+			continue;
+		}
+		fprintf(stderr, "%6s: requests %10llu  new connections %10llu (%.1f%%)\n",
+			name,
+			merged->requests,
+			merged->new_connections,
+			100.0 * merged->new_connections / merged->requests
+		);
+		for (phase = 0; phase <= REQUEST_PHASE_MAX; phase++) {
+			if (merged->phases[phase].count) {
+				show_latencies(name, request_phase_name(phase), &merged->phases[phase]);
+			}
+		}
+	}
+
+	free(merged);
+}
+
+/**
+ * Show and write the results of a run of the given Swift threads, and compare them with any baseline.
+ * Returns EXIT_SUCCESS, or EXIT_FAILURE if any Swift thread failed, or the results could not be written,
+ * or have regressed from the baseline.
+ */
+static int
+report_run(const struct swift_thread_args *args, unsigned int n, unsigned int timed, const char *results_path, enum results_format results_format, const struct results_config *config, const char *baseline_path)
+{
+	unsigned int i;
+	int ret = EXIT_SUCCESS;
+
+	show_swift_times(args, n);
+	fprintf(stderr, "All threads: prefill duration (microseconds): %10.3f\n", bulk_phase_secs(args, n, BULK_PREFILL) * 1000000);
+	fprintf(stderr, "All threads: cleanup duration (microseconds): %10.3f\n", bulk_phase_secs(args, n, BULK_CLEANUP) * 1000000);
+	show_swift_op_stats(args, n);
+	if (timed) {
+		show_request_timings(args, n);
+	}
+
+	if (results_path && 0 != results_write(results_path, results_format, config, args, n)) {
+		ret = EXIT_FAILURE;
+	}
+	if (baseline_path && 0 != results_compare(baseline_path, args, n)) {
+		ret = EXIT_FAILURE; /* Regressed, or could not compare */
+	}
+	/* Propagate any error from any of the Swift threads */
+	for (i = 0; i < n; i++) {
+		if (SCERR_SUCCESS != args[i].scerr) {
+			ret = EXIT_FAILURE; /* Swift thread failed */
+		}
+	}
+	return ret;
+}
+
+/**
+ * Raise the limit on open file descriptors, if need be and if permitted, to allow at least the given number of connections.
+ */
+static void
+raise_file_limit(rlim_t connections)
+{
+	struct rlimit limit;
+	/* Allow for standard streams, epoll and other descriptors besides the connections themselves */
+	rlim_t wanted = connections + 64;
+
+	if (0 != getrlimit(RLIMIT_NOFILE, &limit)) {
+		perror("getrlimit");
+		return;
+	}
+	if (limit.rlim_cur >= wanted) {
+		return;
+	}
+	limit.rlim_cur = (RLIM_INFINITY == limit.rlim_max || limit.rlim_max > wanted) ? wanted : limit.rlim_max;
+	if (0 != setrlimit(RLIMIT_NOFILE, &limit)) {
+		perror("setrlimit");
+		return;
+	}
+	if (limit.rlim_cur < wanted) {
+		fprintf(stderr, "Warning: open file limit of %lu is too low for %lu connections\n", (unsigned long) limit.rlim_cur, (unsigned long) connections);
+	}
+}
+
 static unsigned int
 parse_bool(const char * val)
 {
@@ -79,8 +293,13 @@ main(int argc, char **argv)
 	struct keystone_thread_args keystone_args;
 
 	struct swift_thread_args *swift_args = NULL;
-	pthread_cond_t start_condvar = PTHREAD_COND_INITIALIZER;
-	pthread_mutex_t start_mutex = PTHREAD_MUTEX_INITIALIZER;
+	struct swift_run run;
+	struct live_reporter reporter;
+	struct auth_tokens tokens;
+	time_t token_issued;
+	struct request_timings *timings = NULL;
+	pthread_attr_t attr;
+	int *thread_cpus, *thread_nodes;
 
 	int ret;
 	unsigned int i;
@@ -92,39 +311,259 @@ main(int argc, char **argv)
 	const char *password = NULL;
 	const char *proxy = NULL;
 	unsigned long object_size = OBJECT_SIZE_DEFAULT;
+	struct size_distribution size_distribution;
+	const char *size_text = NULL;
 	const char *tenant_name = NULL;
 	const char *username = NULL;
-	unsigned int verify_data = VERIFY_DATA_DEFAULT;
+	enum verify_mode verify_data = VERIFY_DATA_DEFAULT;
+	uint32_t *object_crcs = NULL;
 	unsigned int verbose = 0;
+	void *(*swift_func)(void *) = swift_thread_func;
+	unsigned int queue_depth = QUEUE_DEPTH_DEFAULT;
+	unsigned long num_objects = 0; /* Zero for the engine's default */
+	unsigned int num_containers = NUM_CONTAINERS_DEFAULT;
+	struct key_distribution_spec key_distribution;
+	double rate = 0; /* Zero for closed-loop */
+	enum arrival_process arrival = ARRIVAL_PROCESS_DEFAULT;
+	struct workload workload;
+	unsigned int use_workload = 0;
+	unsigned int benchmark_data = 0;
+	unsigned int shared_data = 0;
+	unsigned int shared_setup = 0;
+	struct bulk_phases bulk;
+	const char *keep_dataset = NULL; /* NULL to delete the containers and objects after the run */
+	const char *reuse_dataset = NULL; /* NULL to create and fill new containers */
+	struct dataset_config dataset_config;
+	struct dataset_object *dataset_objects = NULL;
+	const char *corpus_path = NULL;
+	const char *data_name = "simple-text";
+	const char *key_distribution_name = KEY_DISTRIBUTION_DEFAULT;
+	const char *workload_text = NULL;
+	int corpus_is_dir = 0;
+	unsigned long segment_size = 0; /* Zero to put objects whole */
+	unsigned int segment_connections = SEGMENT_CONNECTIONS_DEFAULT;
+	unsigned long get_chunk_size = 0; /* Zero to get objects whole */
+	unsigned int get_connections = GET_CONNECTIONS_DEFAULT;
+	double ramp_up = 0, warm_up = 0, cool_down = 0; /* Seconds */
+	double duration = 0; /* Seconds of each measured phase, or zero to perform iterations */
+	double report_interval = 0; /* Zero to report only upon SIGUSR1 */
+	struct results_config results_config;
+	enum results_format results_format = RESULTS_JSON;
+	const char *results_path = NULL; /* NULL to write no machine-readable results */
+	const char *baseline_path = NULL; /* NULL to compare with no baseline */
+	const char *token_cache_dir = NULL; /* NULL to cache no tokens */
+	double token_lifetime = TOKEN_LIFETIME_DEFAULT;
+	unsigned int time_requests = 0;
+	struct placement_spec placement;
+	const char *placement_name = "none";
+	const char *controller_address = NULL; /* NULL unless the controller of a distributed run */
+	unsigned int num_agents = 0;
+	const char *agent_address = NULL; /* NULL unless to become an agent of a distributed run */
+	struct agent_session session;
+	unsigned int in_session = 0;
+	struct controller_options forwarded = { NULL, 0 };
+	unsigned int total_threads, first_thread;
+	unsigned int takes_arg;
 
-#define OPTSTRING "d:hi:k:n:p:s:t:u:v:V"
+#define OPTSTRING "a:A:b:Bc:C:d:D:e:Ef:g:G:hi:I:j:J:k:K:L:M:n:N:o:O:p:P:q:r:R:s:St:T:u:U:v:Vw:W:XY:z:Z:"
 #define HELP "\
 Where:\n\
+    agents\n\
+        Is the number of agents of a distributed run, each of which runs\n\
+        num-threads Swift threads, numbered after those of the agents before\n\
+        it, all of them starting together;\n\
+    arrival\n\
+        Is the process by which puts/gets arrive at the given rate, one of:\n\
+        fixed (default): At a constant interval;\n\
+        poisson: At exponentially-distributed intervals;\n\
+    baseline-file\n\
+        If given, is the JSON results of an earlier run, with which the\n\
+        throughput of each Swift thread and the latency of every operation\n\
+        of each type are compared by one-sided Mann-Whitney U tests, any\n\
+        regression both significant (p < 0.01) and of at least 5%% being\n\
+        flagged and failing the run. Throughput is tested only if there are\n\
+        enough Swift threads in the two runs for p to fall so low, such as\n\
+        four in one and five in the other, and is otherwise reported as\n\
+        having insufficient samples;\n\
+    containers\n\
+        Is the number of containers across which each Swift thread spreads\n\
+        its objects (default 1);\n\
+    controller-address\n\
+        Is the address, <host>:<port>, of the controller of a distributed run\n\
+        to which an agent connects, retrying for a minute until it listens.\n\
+        The agent then runs its share of the run, with the controller's\n\
+        options in place of any of its own, and sends back its statistics;\n\
+    cool-down\n\
+        Is the number of seconds, after the last Swift thread's measured\n\
+        operations, for which every Swift thread goes on with unrecorded\n\
+        operations of its last kind, so that load does not tail off while\n\
+        any operations are measured (default 0);\n\
     data\n\
         Is one of:\n\
         random: Fill Swift object(s) with pseudo-random bits;\n\
         simple-text (default): Fill Swift object(s) with identifiable text;\n\
         zeroes: Fill Swift object(s) with zero bits;\n\
+        file:<path>: Fill Swift object(s) with the contents of a local file;\n\
+        dir:<path>: Fill Swift object(s) with the contents of the files\n\
+            beneath a local directory, sharded across the Swift threads;\n\
+        Files are mapped into memory and sent from there, each object taking\n\
+        its file's size, which replaces size and a workload's sizes;\n\
+    duration\n\
+        If given, is the number of seconds for which every Swift thread\n\
+        performs measured operations of each kind (the puts, then the gets,\n\
+        or those of the workload), until a deadline common to all, instead\n\
+        of iterations of them, throughput being computed over that window;\n\
+    engine\n\
+        Is one of:\n\
+        threads (default): Each Swift thread performs one request at a time;\n\
+        multi: Each Swift thread keeps queue-depth requests in flight at once;\n\
+    get-chunk-size\n\
+        If given, is the size in bytes of the chunks in which each object is\n\
+        got, as concurrent range requests whose data is passed on, and\n\
+        verified, in order, in the threads engine only;\n\
+    get-connections\n\
+        Is the number of connections over which each Swift thread gets the\n\
+        chunks of an object at once, each with a chunk buffer (default 4);\n\
     http-proxy\n\
         Is the URL of a proxy to use for access to Keystone and Swift;\n\
     iterations\n\
-        Is the number of consecutive gets/puts performed by each Swift thread;\n\
+        Is the number of consecutive gets/puts performed by each Swift thread,\n\
+        or by each of its in-flight requests in the multi engine, or the\n\
+        number of operations drawn from the workload if one is given,\n\
+        unless a duration is given;\n\
+    key-distribution\n\
+        Chooses the object addressed by each get/put, and is one of:\n\
+        uniform (default): Every object equally likely;\n\
+        sequential: Each object in turn;\n\
+        zipf[:<skew>]: Zipfian popularity, with exponent skew (default 0.99);\n\
+        hotset[:<fraction>[:<ops-fraction>]]: A fraction (default 0.2) of the\n\
+            objects receives ops-fraction (default 0.8) of the gets/puts;\n\
     keystone-endpoint-url\n\
         Is any endpoint URL of the Keystone service;\n\
+    listen-address\n\
+        Is the address, [<host>:]<port>, on which the controller of a\n\
+        distributed run listens for its agents. The controller runs no Swift\n\
+        threads itself: it sends each agent its options but those of its\n\
+        output, baseline and agents, in clear, so any password too; starts\n\
+        all agents at once, once all have put their objects; and merges their\n\
+        statistics, sent at the end of the run, as though all of the Swift\n\
+        threads had run within it. Keystone credentials not given to it as\n\
+        options are taken from each agent's environment. The clocks of all\n\
+        hosts must be synchronised, by NTP or the like, and controller and\n\
+        agents must be the same build;\n\
+    manifest\n\
+        Is the file recording a dataset: the containers and objects of a run\n\
+        left in place by keep-dataset, with the size and any CRC-32C of each\n\
+        object. A run given it to reuse-dataset, with the same data, sizes,\n\
+        numbers of threads, containers and objects and Swift account, heads a\n\
+        sample of each thread's objects instead of creating and filling the\n\
+        containers, and leaves them in place, writing the manifest anew at the\n\
+        end, to keep-dataset if given or else where it was read. Each agent\n\
+        of a distributed run reads and writes its own, at the same path;\n\
     num-threads\n\
-        Is the number of concurrent Swift worker threads;\n\
+        Is the number of concurrent Swift worker threads, of each agent\n\
+        of a distributed run;\n\
+    objects\n\
+        Is the number of objects of each Swift thread, all put before any\n\
+        get/put is measured (default 1, or queue-depth in the multi engine);\n\
+    output-file\n\
+        If given, is the file to which to write the results of the run,\n\
+        or - for standard output;\n\
+    output-format\n\
+        Is the format in which results are written to output-file, one of:\n\
+        json (default): The configuration, host, and the throughput, errors,\n\
+            latency percentiles and histogram of each type of operation,\n\
+            and its request timings if recorded, across all Swift threads\n\
+            and of each;\n\
+        csv: The configuration and host as comment lines, then the same\n\
+            statistics, without histograms, in a row per type of operation\n\
+            across all Swift threads and of each;\n\
     password\n\
         Is the password for Keystone authentication;\n\
+    placement\n\
+        Is the placement of the Swift threads upon CPUs, one of:\n\
+        none (default): Left to the scheduler;\n\
+        compact: Bound to hyperthreads of a core, then cores of a NUMA\n\
+            node, then those of the next node, in turn;\n\
+        scatter: Bound to each NUMA node in turn, using one hyperthread of\n\
+            every core before the second of any;\n\
+        list:<cpus>: Bound to the listed CPUs in turn, such as 0,2,4-7;\n\
+        A bound thread's own buffers and statistics are then allocated on\n\
+        its CPU's NUMA node, and its CPU and node are in the results;\n\
+    queue-depth\n\
+        Is the number of requests kept in flight by each Swift thread\n\
+        of the multi engine (default 16);\n\
+    ramp-up\n\
+        Is the number of seconds, once every Swift thread has put its objects,\n\
+        over which the Swift threads start operating one by one, evenly\n\
+        spaced, unrecorded (default 0);\n\
+    rate\n\
+        Is the number of puts/gets per second issued across all Swift threads,\n\
+        of all agents of a distributed run,\n\
+        each on schedule whether or not earlier ones have completed, with\n\
+        latency measured from its scheduled time. If not given, each is issued\n\
+        when the last completes;\n\
+    report-interval\n\
+        Is the number of seconds between reports, while the Swift threads\n\
+        run, of the throughput and latency of the measured operations of the\n\
+        interval and of the whole run so far. Whether or not it is given,\n\
+        SIGUSR1 asks for such a report at once;\n\
+    segment-connections\n\
+        Is the number of connections over which each Swift thread puts the\n\
+        segments of a static large object at once (default 4);\n\
+    segment-size\n\
+        If given, is the size in bytes of the segments into which each object\n\
+        longer than it is split, its segments being put concurrently and then\n\
+        a manifest of them put as a static large object, in the threads engine\n\
+        only; an object may have no more than 1000 segments;\n\
     size\n\
-        Is the size in bytes of each Swift object;\n\
+        Is the size in bytes of each Swift object (default 1024), or else the\n\
+        distribution from which each put draws its object's size, one of\n\
+        <size>[-<size>][:<weight>],... of weighted sizes or ranges of sizes,\n\
+        uniform:<min>,<max>, lognormal:<median>,<sigma>[,<max>] (default max\n\
+        4 sigma above the median) or histogram:<file>, each of whose lines is\n\
+        <size>[-<size>] [<weight>], sizes given in bytes or with k, m or g;\n\
+        the puts and gets of each class of size are also reported, as rows\n\
+        put<=4k to put>256m and get<=4k to get>256m;\n\
     tenant-name\n\
         Is the tenant name for Keystone authentication;\n\
+    token-cache\n\
+        If given, is a directory in which each Keystone token is cached,\n\
+        with its Swift URL, keyed by Keystone URL, tenant and user, and from\n\
+        which a later run takes it while three quarters of its lifetime or\n\
+        less have passed, rather than authenticating anew;\n\
+    token-lifetime\n\
+        Is the number of seconds for which a Keystone token is valid once\n\
+        issued (default 3600). Once three quarters of it have passed, a new\n\
+        token is obtained in the background and used from then on, so that\n\
+        a run may last any time;\n\
     username\n\
         Is the user name for Keystone authentication;\n\
     verify-bool\n\
         Is true if the retrieved objects' data should be compared with\n\
         the data previously inserted into those objects,\n\
-        or false if the retrieved objects' data should be thrown away.\n\
+        hash if only the CRC-32C of the retrieved objects' data should be\n\
+        compared with that of the data inserted, computed as it was sent,\n\
+        or false if the retrieved objects' data should be thrown away;\n\
+    warm-up\n\
+        Is the number of seconds after the ramp-up for which every Swift\n\
+        thread performs unrecorded operations of its first kind, before its\n\
+        measured operations start, all at once (default 0);\n\
+    workload\n\
+        Replaces the puts and gets with a blend of operations, interleaved,\n\
+        given inline or as @<file-name>, as clauses separated by ';' or lines:\n\
+        ops=<op>:<weight>,... (required), where op is one of put, get, head,\n\
+            delete, list (of the object's container) or post (of metadata);\n\
+        sizes=<size-distribution>, as size (default: size);\n\
+        keys=<key-distribution> (default: key-distribution);\n\
+        list=<param>:<value>,... of each list, in JSON page by page, where\n\
+            param is one of limit (entries per page, default: 10000), pages\n\
+            (most read, default: 0 for all), prefix (leading digits of the\n\
+            numbers of the objects listed), delimiter (by which to roll up\n\
+            names) or account (fraction of lists of the account instead).\n\
+        A get, head, post or delete of an object deleted earlier becomes a put.\n\
+        Each page of a list is also reported, as a page.\n\
+        For example: ops=get:70,put:20,head:5,list:4,delete:1;sizes=4k:9,1m:1\n\
 "
 #ifdef USE_GETOPT_LONG
 #define USAGE "\
@@ -133,33 +572,111 @@ Usage:\n\
         Outputs this help text\n\
 or\n\
     %s\n\
-        [ --data { random | simple-text | zeroes } ]\n\
+        [ --data { random | simple-text | zeroes | file:<path> | dir:<path> } ]\n\
+        [ --engine { threads | multi } ] [ --queue-depth <n> ]\n\
+        [ --objects <n> ] [ --containers <n> ]\n\
+        [ --key-distribution <distribution> ]\n\
+        [ --rate <ops-per-sec> ] [ --arrival { fixed | poisson } ]\n\
         [ --http-proxy <proxy-url> ] [ --iterations <n> ]\n\
         [ --keystone-url <keystone-endpoint-URL> ] [ --num-threads <n> ]\n\
-        [ --password <password> ] [ --size <numbytes> ]\n\
+        [ --password <password> ] [ --size <size> ]\n\
+        [ --placement { none | compact | scatter | list:<cpus> } ]\n\
+        [ --segment-size <numbytes> ] [ --segment-connections <n> ]\n\
+        [ --get-chunk-size <numbytes> ] [ --get-connections <n> ]\n\
+        [ --ramp-up <secs> ] [ --warm-up <secs> ] [ --cool-down <secs> ]\n\
+        [ --duration <secs> ]\n\
+        [ --report-interval <secs> ]\n\
+        [ --output-file <file> ] [ --output-format { json | csv } ]\n\
+        [ --compare-baseline <baseline-file> ]\n\
         [ --tenant-name <tenant-name> ] [ --username <username> ]\n\
+        [ --token-cache <dir> ] [ --token-lifetime <secs> ]\n\
         [ --verbose ] [ --verify-data <verify-bool> ]\n\
+        [ --workload <workload> ] [ --shared-data ] [ --shared-setup ]\n\
+        [ --request-timings ]\n\
+        [ --keep-dataset <manifest> ] [ --reuse-dataset <manifest> ]\n\
+        [ --controller <listen-address> --agents <n> ]\n\
+or\n\
+    %s --agent <controller-address> [ --verbose ]\n\
+or\n\
+    %s --benchmark-data [ --num-threads <n> ] [ --size <numbytes> ]\n\
+        [ --iterations <n> ]\n\
 \n\
 " HELP "\
+    --benchmark-data\n\
+        If supplied, measures only the rate at which each type of test data is\n\
+        generated and verified by num-threads threads, each of iterations\n\
+        objects of the given size, without contacting Keystone or Swift.\n\
+    --request-timings\n\
+        If supplied, records libcurl's timings of each measured operation's\n\
+        request: name lookup, connect and TLS handshake of new connections,\n\
+        time to first byte and transfer, and how many requests opened a new\n\
+        connection rather than reusing one. The threads engine then issues\n\
+        its puts, gets and deletes directly over HTTP too, except those of\n\
+        static large objects and of gets in chunks, which are not timed.\n\
+    --shared-data\n\
+        If supplied, generates the test data once, into a read-only region\n\
+        in huge pages shared by all Swift threads, so that only the first\n\
+        line of each object is generated for it and the rest is copied.\n\
+    --shared-setup\n\
+        If supplied, the threads engine's Swift threads share the prefill and\n\
+        the cleanup: each puts, and later deletes, its own objects in batches,\n\
+        and once it has none left, takes batches from the others, so that no\n\
+        thread idles while another still has objects. Where the cluster offers\n\
+        bulk delete, each batch of the cleanup is deleted in one request.\n\
+        The prefill and cleanup of all threads together are timed separately.\n\
     --verbose\n\
         If supplied, triggers verbose logging of actions performed.\n\
 "
 	int option_index;
 	static struct option long_options[] = {
+		{"agent",        required_argument, NULL, 'A'},
+		{"agent-session", required_argument, NULL, 'Y'}, /* Internal: an agent's session, once it has its options */
+		{"agents",       required_argument, NULL, 'N'},
+		{"arrival",      required_argument, NULL, 'a'},
+		{"benchmark-data", no_argument,     NULL, 'B'},
+		{"compare-baseline", required_argument, NULL, 'b'},
+		{"containers",   required_argument, NULL, 'c'},
+		{"controller",   required_argument, NULL, 'M'},
+		{"cool-down",    required_argument, NULL, 'C'},
 		{"data",         required_argument, NULL, 'd'},
+		{"duration",     required_argument, NULL, 'D'},
+		{"engine",       required_argument, NULL, 'e'},
+		{"get-chunk-size", required_argument, NULL, 'g'},
+		{"get-connections", required_argument, NULL, 'J'},
 		{"help",         no_argument,       NULL, 'h'},
 		{"http-proxy",   required_argument, NULL, 'r'}, /* 'p' already taken for '--password' and 'h' for '--help' */
 		{"iterations",   required_argument, NULL, 'i'},
+		{"key-distribution", required_argument, NULL, 'K'},
+		{"keep-dataset", required_argument, NULL, 'Z'},
 		{"keystone-url", required_argument, NULL, 'k'},
 		{"num-threads",  required_argument, NULL, 'n'},
+		{"objects",      required_argument, NULL, 'o'},
+		{"output-file",  required_argument, NULL, 'f'},
+		{"output-format", required_argument, NULL, 'O'},
 		{"password",     required_argument, NULL, 'p'},
+		{"placement",    required_argument, NULL, 'P'},
+		{"queue-depth",  required_argument, NULL, 'q'},
+		{"ramp-up",      required_argument, NULL, 'U'},
+		{"rate",         required_argument, NULL, 'R'},
+		{"report-interval", required_argument, NULL, 'I'},
+		{"request-timings", no_argument,    NULL, 'X'},
+		{"reuse-dataset", required_argument, NULL, 'z'},
+		{"segment-connections", required_argument, NULL, 'j'},
+		{"segment-size", required_argument, NULL, 'G'},
+		{"shared-data",  no_argument,       NULL, 'S'},
+		{"shared-setup", no_argument,       NULL, 'E'},
 		{"size",         required_argument, NULL, 's'},
 		{"tenant-name",  required_argument, NULL, 't'},
+		{"token-cache",  required_argument, NULL, 'T'},
+		{"token-lifetime", required_argument, NULL, 'L'},
 		{"username",     required_argument, NULL, 'u'},
 		{"verbose",      no_argument,       NULL, 'V'},
 		{"verify-data",  required_argument, NULL, 'v'},
+		{"warm-up",      required_argument, NULL, 'W'},
+		{"workload",     required_argument, NULL, 'w'},
 		{NULL,           0,                 NULL, 0}
 	};
+	const struct option *long_option;
 #else /* ndef USE_GETOPT_LONG */
 #define USAGE "\
 Usage:\n\
@@ -167,18 +684,56 @@ Usage:\n\
         Outputs this help text\n\
 or\n\
     %s\n\
-        [ -d { random | simple-text | zeroes } ]\n\
+        [ -d { random | simple-text | zeroes | file:<path> | dir:<path> } ]\n\
+        [ -e { threads | multi } ] [ -q <n> ]\n\
+        [ -o <n> ] [ -c <n> ] [ -K <distribution> ]\n\
+        [ -R <ops-per-sec> ] [ -a { fixed | poisson } ]\n\
         [ -i <n> ] [ -k <keystone-endpoint-URL> ] [ -n <n> ]\n\
-        [ -p <password> ] [ -r <proxy-url> ] [ -s <numbytes> ]\n\
-        [ -t <tenant-name> ] [ -u <username> ]\n\
-        [ -v <verify-bool> ] [ -V ]\n\
+        [ -p <password> ] [ -r <proxy-url> ] [ -s <size> ]\n\
+        [ -P { none | compact | scatter | list:<cpus> } ]\n\
+        [ -G <numbytes> ] [ -j <n> ] [ -g <numbytes> ] [ -J <n> ]\n\
+        [ -U <secs> ] [ -W <secs> ] [ -C <secs> ] [ -D <secs> ] [ -I <secs> ]\n\
+        [ -f <file> ] [ -O { json | csv } ] [ -b <baseline-file> ]\n\
+        [ -t <tenant-name> ] [ -u <username> ] [ -T <dir> ] [ -L <secs> ]\n\
+        [ -v <verify-bool> ] [ -V ] [ -w <workload> ] [ -S ] [ -E ] [ -X ]\n\
+        [ -Z <manifest> ] [ -z <manifest> ]\n\
+        [ -M <listen-address> -N <n> ]\n\
+or\n\
+    %s -A <controller-address> [ -V ]\n\
+or\n\
+    %s -B [ -n <n> ] [ -s <numbytes> ] [ -i <n> ]\n\
 \n\
 " HELP "\
+    -B\n\
+        If supplied, measures only the rate at which each type of test data is\n\
+        generated and verified by num-threads threads, each of iterations\n\
+        objects of the given size, without contacting Keystone or Swift.\n\
+    -E\n\
+        If supplied, the threads engine's Swift threads share the prefill and\n\
+        the cleanup: each puts, and later deletes, its own objects in batches,\n\
+        and once it has none left, takes batches from the others, so that no\n\
+        thread idles while another still has objects. Where the cluster offers\n\
+        bulk delete, each batch of the cleanup is deleted in one request.\n\
+        The prefill and cleanup of all threads together are timed separately.\n\
+    -S\n\
+        If supplied, generates the test data once, into a read-only region\n\
+        in huge pages shared by all Swift threads, so that only the first\n\
+        line of each object is generated for it and the rest is copied.\n\
     -V\n\
         If supplied, triggers verbose logging of actions performed.\n\
+    -X\n\
+        If supplied, records libcurl's timings of each measured operation's\n\
+        request: name lookup, connect and TLS handshake of new connections,\n\
+        time to first byte and transfer, and how many requests opened a new\n\
+        connection rather than reusing one. The threads engine then issues\n\
+        its puts, gets and deletes directly over HTTP too, except those of\n\
+        static large objects and of gets in chunks, which are not timed.\n\
 "
 #endif /* USE_GETOPT_LONG */
 
+	parse_key_distribution(KEY_DISTRIBUTION_DEFAULT, &key_distribution);
+	parse_placement("none", &placement);
+
 	for (;;) {
 #ifdef USE_GETOPT_LONG
 		ret = getopt_long(argc, argv, OPTSTRING, long_options, &option_index);
@@ -188,7 +743,47 @@ or\n\
 		if (-1 == ret) {
 			break;
 		}
+		/* Keep every option but the controller's own, in case they are to be sent to agents, with its argument if it takes one */
+#ifdef USE_GETOPT_LONG
+		for (long_option = long_options; long_option->name && long_option->val != ret; long_option++) {
+			continue;
+		}
+		takes_arg = (NULL != long_option->name && no_argument != long_option->has_arg);
+#else /* ndef USE_GETOPT_LONG */
+		takes_arg = (NULL != strchr(OPTSTRING, ret) && ':' == strchr(OPTSTRING, ret)[1]);
+#endif /* ndef USE_GETOPT_LONG */
+		if (NULL == strchr(CONTROLLER_LOCAL_OPTIONS, ret) && 0 != controller_record_option(&forwarded, ret, takes_arg ? optarg : NULL)) {
+			perror("malloc");
+			return EXIT_FAILURE;
+		}
 		switch (ret) {
+		case 'a':
+			if (parse_arrival_process(optarg, &arrival)) {
+				fprintf(stderr, "Unrecognised arrival process '%s'. Choices are: fixed, poisson\n", optarg);
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'A':
+			agent_address = optarg;
+			break;
+		case 'b':
+			baseline_path = optarg;
+			break;
+		case 'B':
+			benchmark_data = 1;
+			break;
+		case 'c':
+			num_containers = atoi(optarg);
+			break;
+		case 'C':
+			cool_down = atof(optarg);
+			if (cool_down < 0) {
+				fputs("Cool-down must not be negative.\n", stderr);
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
 		case 'd':
 			if (0 == strcmp(optarg, "random")) {
 				data_type = PSEUDO_RANDOM;
@@ -196,62 +791,253 @@ or\n\
 				data_type = SIMPLE_TEXT;
 			} else if (0 == strcmp(optarg, "zeroes")) {
 				data_type = ALL_ZEROES;
+			} else if (0 == strncmp(optarg, "file:", 5)) {
+				data_type = FILE_DATA;
+				corpus_path = optarg + 5;
+				corpus_is_dir = 0;
+			} else if (0 == strncmp(optarg, "dir:", 4)) {
+				data_type = FILE_DATA;
+				corpus_path = optarg + 4;
+				corpus_is_dir = 1;
+			} else {
+				fprintf(stderr, "Unrecognised data type '%s'. Choices are: random, simple-text, zeroes, file:<path>, dir:<path>\n", optarg);
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			data_name = optarg;
+			break;
+		case 'D':
+			duration = atof(optarg);
+			if (duration <= 0) {
+				fputs("Duration must be positive.\n", stderr);
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'e':
+			if (0 == strcmp(optarg, "threads")) {
+				swift_func = swift_thread_func;
+			} else if (0 == strcmp(optarg, "multi")) {
+				swift_func = swift_multi_thread_func;
 			} else {
-				fprintf(stderr, "Unrecognised data type '%s'. Choices are: random, simple-text, zeroes\n", optarg);
-				fprintf(stderr, USAGE, argv[0], argv[0]);
+				fprintf(stderr, "Unrecognised engine '%s'. Choices are: threads, multi\n", optarg);
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'f':
+			results_path = optarg;
+			break;
+		case 'g':
+			errno = 0;
+			get_chunk_size = strtoul(optarg, NULL, 0);
+			if (errno) {
+				perror("strtoul");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'G':
+			errno = 0;
+			segment_size = strtoul(optarg, NULL, 0);
+			if (errno) {
+				perror("strtoul");
 				return EXIT_FAILURE;
 			}
 			break;
 		case 'h':
-			fprintf(stderr, USAGE, argv[0], argv[0]);
+			fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
 			return EXIT_SUCCESS;
 		case 'i':
 			iterations = atoi(optarg);
 			break;
+		case 'I':
+			report_interval = atof(optarg);
+			if (report_interval < 0) {
+				fputs("Report interval must not be negative.\n", stderr);
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'j':
+			segment_connections = atoi(optarg);
+			break;
+		case 'J':
+			get_connections = atoi(optarg);
+			break;
+		case 'K':
+			if (parse_key_distribution(optarg, &key_distribution)) {
+				fprintf(stderr, "Unrecognised key distribution '%s'. Choices are: uniform, sequential, zipf[:<skew>], hotset[:<fraction>[:<ops-fraction>]]\n", optarg);
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			key_distribution_name = optarg;
+			break;
 		case 'k':
 			keystone_url = optarg;
 			break;
+		case 'L':
+			token_lifetime = atof(optarg);
+			if (token_lifetime <= 0) {
+				fputs("Token lifetime must be positive.\n", stderr);
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'M':
+			controller_address = optarg;
+			break;
 		case 'n':
 			num_swift_threads = atoi(optarg);
 			break;
+		case 'N':
+			num_agents = atoi(optarg);
+			break;
 		case 'p':
 			password = optarg;
 			break;
-		case 'r':
-			proxy = optarg;
+		case 'P':
+			free(placement.cpus);
+			if (parse_placement(optarg, &placement)) {
+				fprintf(stderr, "Unrecognised placement '%s'. Choices are: none, compact, scatter, list:<cpus>\n", optarg);
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			placement_name = optarg;
 			break;
-		case 's':
+		case 'o':
 			errno = 0;
-			object_size = strtoul(optarg, NULL, 0);
+			num_objects = strtoul(optarg, NULL, 0);
 			if (errno) {
 				perror("strtoul");
 				return EXIT_FAILURE;
 			}
 			break;
+		case 'O':
+			if (parse_results_format(optarg, &results_format)) {
+				fprintf(stderr, "Unrecognised output format '%s'. Choices are: json, csv\n", optarg);
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'q':
+			queue_depth = atoi(optarg);
+			break;
+		case 'R':
+			rate = atof(optarg);
+			if (rate <= 0) {
+				fputs("Rate must be positive.\n", stderr);
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'r':
+			proxy = optarg;
+			break;
+		case 's':
+			if (parse_size_distribution(optarg, &size_distribution)) {
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			object_size = size_distribution.max;
+			size_text = (SIZES_FIXED == size_distribution.type) ? NULL : optarg;
+			break;
+		case 'S':
+			shared_data = 1;
+			break;
+		case 'E':
+			shared_setup = 1;
+			break;
 		case 't':
 			tenant_name = optarg;
 			break;
+		case 'T':
+			token_cache_dir = optarg;
+			break;
 		case 'u':
 			username = optarg;
 			break;
+		case 'U':
+			ramp_up = atof(optarg);
+			if (ramp_up < 0) {
+				fputs("Ramp-up must not be negative.\n", stderr);
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
 		case 'v':
-			verify_data = parse_bool(optarg);
+			if (0 == strcasecmp(optarg, "hash")) {
+				verify_data = VERIFY_HASH;
+			} else {
+				verify_data = parse_bool(optarg) ? VERIFY_DATA : VERIFY_NONE;
+			}
 			break;
 		case 'V':
 			verbose = 1;
 			break;
+		case 'w':
+			if (parse_workload(optarg, &workload)) {
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			use_workload = 1;
+			workload_text = optarg;
+			break;
+		case 'W':
+			warm_up = atof(optarg);
+			if (warm_up < 0) {
+				fputs("Warm-up must not be negative.\n", stderr);
+				fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'X':
+			time_requests = 1;
+			break;
+		case 'z':
+			reuse_dataset = optarg;
+			break;
+		case 'Z':
+			keep_dataset = optarg;
+			break;
+		case 'Y':
+			if (parse_agent_session(optarg, &session)) {
+				fprintf(stderr, "Invalid agent session '%s'\n", optarg);
+				return EXIT_FAILURE;
+			}
+			in_session = 1;
+			break;
 		case '?':
 		default:
-			fprintf(stderr, USAGE, argv[0], argv[0]);
+			fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
 			return EXIT_FAILURE;
 		}
 	}
 
 	if (optind < argc) {
 		fprintf(stderr, "Unrecognised non-option argument: %s\n", argv[optind]);
-		fprintf(stderr, USAGE, argv[0], argv[0]);
+		fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (agent_address) {
+		/* Returns only on failure: otherwise, this process is replaced by one with the controller's options */
+		agent_exec(agent_address, argv[0], verbose);
+		return EXIT_FAILURE;
+	}
+
+	if (controller_address && 0 == num_agents) {
+		fputs("A controller needs at least one agent.\n", stderr);
+		fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
 		return EXIT_FAILURE;
 	}
+	total_threads = num_swift_threads * (controller_address ? num_agents : in_session ? session.num_agents : 1);
+	first_thread = in_session ? session.index * num_swift_threads : 0;
+
+	test_data_init(0);
+
+	if (benchmark_data) {
+		return run_data_benchmark(num_swift_threads, object_size, iterations);
+	}
 
 	/* Default unset parameters from environment variables */
 	if (NULL == keystone_url) {
@@ -270,7 +1056,7 @@ or\n\
 		proxy = getenv("http_proxy");
 	}
 
-	if (NULL == keystone_url) {
+	if (NULL == keystone_url && NULL == controller_address) {
 		fputs("No Keystone URL specified via "
 #ifdef USE_GETOPT_LONG
 				"--keystone-url"
@@ -278,11 +1064,11 @@ or\n\
 				"-k"
 #endif
 				", and OS_AUTH_URL unset.\n", stderr);
-		fprintf(stderr, USAGE, argv[0], argv[0]);
+		fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
 		return EXIT_FAILURE;
 	}
 
-	if (NULL == tenant_name) {
+	if (NULL == tenant_name && NULL == controller_address) {
 		fputs("No tenant name specified via "
 #ifdef USE_GETOPT_LONG
 				"--tenant-name"
@@ -290,11 +1076,11 @@ or\n\
 				"-t"
 #endif
 				", and OS_TENANT_NAME unset.\n", stderr);
-		fprintf(stderr, USAGE, argv[0], argv[0]);
+		fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
 		return EXIT_FAILURE;
 	}
 
-	if (NULL == username) {
+	if (NULL == username && NULL == controller_address) {
 		fputs("No username specified via "
 #ifdef USE_GETOPT_LONG
 				"--username"
@@ -302,11 +1088,11 @@ or\n\
 				"-u"
 #endif
 				", and OS_USERNAME unset.\n", stderr);
-		fprintf(stderr, USAGE, argv[0], argv[0]);
+		fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
 		return EXIT_FAILURE;
 	}
 
-	if (NULL == password) {
+	if (NULL == password && NULL == controller_address) {
 		fputs("No password specified via "
 #ifdef USE_GETOPT_LONG
 				"--password"
@@ -314,15 +1100,232 @@ or\n\
 				"-p"
 #endif
 				", and OS_PASSWORD unset.\n", stderr);
-		fprintf(stderr, USAGE, argv[0], argv[0]);
+		fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (0 == queue_depth) {
+		fputs("Queue depth must be at least one.\n", stderr);
+		fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (0 == num_containers) {
+		fputs("Number of containers must be at least one.\n", stderr);
+		fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (0 == num_objects) {
+		/* By default, give each in-flight request an object of its own */
+		num_objects = (swift_multi_thread_func == swift_func) ? queue_depth : 1;
+	}
+
+	if (use_workload) {
+		if (workload.has_keys) {
+			key_distribution = workload.keys;
+			key_distribution_name = NULL; /* Given by the workload */
+		}
+		if (swift_multi_thread_func == swift_func && num_objects < queue_depth) {
+			fputs("A workload in the multi engine needs at least as many objects as the queue depth.\n", stderr);
+			fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+			return EXIT_FAILURE;
+		}
+	} else if (size_text && swift_multi_thread_func == swift_func && num_objects < queue_depth) {
+		fputs("Sizes drawn from a distribution in the multi engine need at least as many objects as the queue depth.\n", stderr);
+		fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	memset(&results_config, 0, sizeof(results_config));
+	results_config.engine = (swift_multi_thread_func == swift_func) ? "multi" : "threads";
+	results_config.data = data_name;
+	results_config.verify = (VERIFY_HASH == verify_data) ? "hash" : (VERIFY_NONE == verify_data) ? "false" : "true";
+	results_config.num_threads = num_swift_threads;
+	results_config.iterations = iterations;
+	results_config.size = object_size;
+	results_config.sizes = size_text;
+	results_config.num_objects = num_objects;
+	results_config.num_containers = num_containers;
+	results_config.queue_depth = queue_depth;
+	results_config.key_distribution = key_distribution_name;
+	results_config.workload = use_workload ? workload_text : NULL;
+	results_config.rate = rate;
+	results_config.arrival = (ARRIVAL_POISSON == arrival) ? "poisson" : "fixed";
+	results_config.segment_size = segment_size;
+	results_config.segment_connections = segment_connections;
+	results_config.get_chunk_size = get_chunk_size;
+	results_config.get_connections = get_connections;
+	results_config.ramp_up = ramp_up;
+	results_config.warm_up = warm_up;
+	results_config.cool_down = cool_down;
+	results_config.duration = duration;
+	results_config.shared_data = shared_data;
+	results_config.shared_setup = shared_setup;
+	results_config.keep_dataset = keep_dataset;
+	results_config.reuse_dataset = reuse_dataset;
+	results_config.request_timings = time_requests;
+	results_config.placement = placement_name;
+	results_config.num_agents = controller_address ? num_agents : 0;
+
+	if (controller_address) {
+		/* The controller's Swift threads stand for those of its agents, and receive their statistics */
+		swift_args = (struct swift_thread_args *) calloc(total_threads, sizeof(*swift_args));
+		if (time_requests) {
+			timings = typearrayalloc(total_threads * (SWIFT_OP_MAX + 1), struct request_timings);
+		}
+		if (NULL == swift_args || (time_requests && NULL == timings)) {
+			perror("malloc");
+			return EXIT_FAILURE;
+		}
+		ret = swift_run_init(&run, total_threads, ramp_up, warm_up, cool_down, duration);
+		if (ret != 0) {
+			errno = ret;
+			perror("swift_run_init");
+			return EXIT_FAILURE;
+		}
+		for (i = 0; i < total_threads; i++) {
+			swift_args[i].rate = rate / total_threads;
+			swift_args[i].num_threads = total_threads;
+			swift_args[i].workload = use_workload ? &workload : NULL;
+			swift_args[i].run = &run;
+			swift_args[i].timings = timings ? &timings[i * (SWIFT_OP_MAX + 1)] : NULL;
+		}
+		ret = controller_run(controller_address, num_agents, &forwarded, swift_args, num_swift_threads, &run);
+		swift_run_destroy(&run);
+		if (0 == ret) {
+			ret = report_run(swift_args, total_threads, NULL != timings, results_path, results_format, &results_config, baseline_path);
+		} else {
+			ret = EXIT_FAILURE;
+		}
+		free(swift_args);
+		free(timings);
+		controller_options_free(&forwarded);
+		return ret;
+	}
+
+	if (FILE_DATA == data_type) {
+		if (size_text || (use_workload && workload.has_sizes)) {
+			fputs("Sizes cannot be drawn from a distribution for file data, whose objects take their files' sizes.\n", stderr);
+			fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+			return EXIT_FAILURE;
+		}
+		if (0 != corpus_load(corpus_path, corpus_is_dir, total_threads)) {
+			return EXIT_FAILURE;
+		}
+		atexit(corpus_free);
+	}
+
+	if (segment_size) {
+		if (swift_multi_thread_func == swift_func) {
+			fputs("Objects can be put as static large objects only in the threads engine.\n", stderr);
+			fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+			return EXIT_FAILURE;
+		}
+		if (0 == segment_connections) {
+			fputs("Number of segment connections must be at least one.\n", stderr);
+			fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+			return EXIT_FAILURE;
+		}
+		if ((FILE_DATA == data_type ? corpus_max_len() : use_workload ? workload_max_size(&workload, object_size) : object_size) > segment_size * SLO_MAX_SEGMENTS) {
+			fprintf(stderr, "An object may have no more than %u segments.\n", SLO_MAX_SEGMENTS);
+			fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+			return EXIT_FAILURE;
+		}
+		raise_file_limit((rlim_t) num_swift_threads * segment_connections);
+	}
+
+	if (get_chunk_size) {
+		if (swift_multi_thread_func == swift_func) {
+			fputs("Objects can be got in chunks only in the threads engine.\n", stderr);
+			fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+			return EXIT_FAILURE;
+		}
+		if (0 == get_connections) {
+			fputs("Number of get connections must be at least one.\n", stderr);
+			fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+			return EXIT_FAILURE;
+		}
+		raise_file_limit((rlim_t) num_swift_threads * get_connections);
+	}
+
+	if (segment_size && (keep_dataset || reuse_dataset)) {
+		fputs("Static large objects cannot be kept or reused as a dataset.\n", stderr);
+		fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* A reused dataset stays in place, its manifest written anew to record what the run leaves */
+	if (reuse_dataset && NULL == keep_dataset) {
+		keep_dataset = reuse_dataset;
+	}
+
+	if (shared_setup) {
+		if (swift_multi_thread_func == swift_func) {
+			fputs("Prefill and cleanup can be shared only in the threads engine.\n", stderr);
+			fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+			return EXIT_FAILURE;
+		}
+		if (segment_size) {
+			fputs("Prefill and cleanup cannot be shared when putting static large objects.\n", stderr);
+			fprintf(stderr, USAGE, argv[0], argv[0], argv[0], argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* Zeroes cost nothing to generate, so are never worth sharing, and files are shared already */
+	if (shared_data && (SIMPLE_TEXT == data_type || PSEUDO_RANDOM == data_type)) {
+		if (0 != test_data_share(data_type, use_workload ? workload_max_size(&workload, object_size) : object_size)) {
+			return EXIT_FAILURE;
+		}
+		atexit(test_data_unshare);
+	}
+
+	if (swift_multi_thread_func == swift_func) {
+		raise_file_limit((rlim_t) num_swift_threads * queue_depth);
+	}
+
+	thread_cpus = typearrayalloc(num_swift_threads, int);
+	thread_nodes = typearrayalloc(num_swift_threads, int);
+	if (NULL == thread_cpus || NULL == thread_nodes) {
+		return EXIT_FAILURE;
+	}
+	if (0 != placement_assign(&placement, num_swift_threads, thread_cpus, thread_nodes)) {
 		return EXIT_FAILURE;
 	}
 
-	swift_args = typearrayalloc(num_swift_threads, struct swift_thread_args);
-	if (NULL == swift_args) {
+	/*
+	 * Mapped rather than allocated and cleared, so that its pages are zero without being touched here. The pages
+	 * holding only a Swift thread's statistics are first touched, and so placed, by that thread; those holding any
+	 * of the fields set below before the threads start, at either end of each thread's arguments, are placed here.
+	 */
+	swift_args = (struct swift_thread_args *) mmap(NULL, num_swift_threads * sizeof(*swift_args), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (MAP_FAILED == swift_args) {
+		perror("mmap");
 		return EXIT_FAILURE;
 	}
 
+	if (time_requests) {
+		timings = typearrayalloc(num_swift_threads * (SWIFT_OP_MAX + 1), struct request_timings);
+		if (NULL == timings) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (VERIFY_HASH == verify_data) {
+		object_crcs = typearrayalloc(num_swift_threads * num_objects, uint32_t);
+		if (NULL == object_crcs) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (keep_dataset || reuse_dataset) {
+		dataset_objects = typearrayalloc(num_swift_threads * num_objects, struct dataset_object);
+		if (NULL == dataset_objects) {
+			return EXIT_FAILURE;
+		}
+	}
+
 	if (swift_global_init() != SCERR_SUCCESS) {
 		return EXIT_FAILURE;
 	}
@@ -341,68 +1344,129 @@ or\n\
 	keystone_args.username = username;
 	keystone_args.password = password;
 
-	ret = pthread_create(&keystone_args.thread_id, NULL, keystone_thread_func, &keystone_args);
-	if (ret != 0) {
-		perror("pthread_create");
+	if (token_cache_dir && 0 == auth_token_cache_load(token_cache_dir, &keystone_args, token_lifetime, &token_issued)) {
+		if (verbose) {
+			fprintf(stderr, "Using cached Keystone token, issued %ld seconds ago\n", (long) (time(NULL) - token_issued));
+		}
+	} else {
+		token_issued = time(NULL);
+
+		ret = pthread_create(&keystone_args.thread_id, NULL, keystone_thread_func, &keystone_args);
+		if (ret != 0) {
+			perror("pthread_create");
+			return EXIT_FAILURE;
+		}
+
+		ret = pthread_join(keystone_args.thread_id, NULL);
+		if (ret != 0) {
+			perror("pthread_join");
+			return EXIT_FAILURE;
+		}
+
+		if (KSERR_SUCCESS != keystone_args.kserr) {
+			return EXIT_FAILURE; /* Keystone thread failed */
+		}
+
+		if (token_cache_dir) {
+			auth_token_cache_store(token_cache_dir, &keystone_args, token_issued);
+		}
+	}
+
+	assert(keystone_args.swift_url);
+	assert(keystone_args.auth_token);
+
+	dataset_config.data_type = data_type;
+	dataset_config.data_name = data_name;
+	dataset_config.swift_url = keystone_args.swift_url;
+	dataset_config.num_threads = num_swift_threads;
+	dataset_config.first_thread = first_thread + 1;
+	dataset_config.num_containers = num_containers;
+	dataset_config.num_objects = num_objects;
+	dataset_config.data_size = object_size;
+	dataset_config.hashed = (VERIFY_HASH == verify_data);
+	if (reuse_dataset && 0 != dataset_load(reuse_dataset, &dataset_config, dataset_objects, object_crcs)) {
 		return EXIT_FAILURE;
 	}
 
-	ret = pthread_join(keystone_args.thread_id, NULL);
+	ret = swift_run_init(&run, num_swift_threads, ramp_up, warm_up, cool_down, duration);
 	if (ret != 0) {
-		perror("pthread_join");
+		errno = ret;
+		perror("swift_run_init");
 		return EXIT_FAILURE;
 	}
+	if (in_session) {
+		swift_run_distribute(&run, total_threads, agent_barrier, &session);
+	}
 
-	if (KSERR_SUCCESS != keystone_args.kserr) {
-		return EXIT_FAILURE; /* Keystone thread failed */
+	if (0 != live_reporter_start(&reporter, num_swift_threads, report_interval)) {
+		return EXIT_FAILURE;
 	}
 
-	assert(keystone_args.swift_url);
-	assert(keystone_args.auth_token);
+	if (0 != auth_tokens_start(&tokens, &keystone_args, token_cache_dir, token_lifetime, token_issued, num_swift_threads)) {
+		return EXIT_FAILURE;
+	}
+
+	if (shared_setup) {
+		ret = bulk_init(&bulk, num_swift_threads);
+		if (ret != 0) {
+			errno = ret;
+			perror("bulk_init");
+			return EXIT_FAILURE;
+		}
+	}
 
-	/* Start all of the Swift threads */
-	memset(swift_args, 0, sizeof(swift_args));
+	/* Start all of the Swift threads, which start operating together once the last has put its objects */
 	for (i = 0; i < num_swift_threads; i++) {
 		swift_args[i].debug = verbose;
 		swift_args[i].proxy = proxy;
-		swift_args[i].thread_num = i + 1;
+		swift_args[i].thread_num = first_thread + i + 1;
+		swift_args[i].cpu = thread_cpus[i];
+		swift_args[i].node = thread_nodes[i];
 		swift_args[i].data_type = data_type;
 		swift_args[i].data_size = object_size;
 		swift_args[i].verify_data = verify_data;
+		swift_args[i].object_crcs = object_crcs ? &object_crcs[i * num_objects] : NULL;
 		swift_args[i].num_iterations = iterations;
+		swift_args[i].queue_depth = queue_depth;
+		swift_args[i].num_objects = num_objects;
+		swift_args[i].num_containers = num_containers;
+		swift_args[i].key_distribution = key_distribution;
+		swift_args[i].rate = rate / total_threads;
+		swift_args[i].arrival = arrival;
+		swift_args[i].num_threads = total_threads;
+		swift_args[i].workload = use_workload ? &workload : NULL;
+		swift_args[i].sizes = (use_workload && workload.has_sizes) ? &workload.sizes : size_text ? &size_distribution : NULL;
+		swift_args[i].segment_size = segment_size;
+		swift_args[i].segment_connections = segment_connections;
+		swift_args[i].get_chunk_size = get_chunk_size;
+		swift_args[i].get_connections = get_connections;
+		swift_args[i].bulk = shared_setup ? &bulk.queues[i] : NULL;
+		swift_args[i].dataset = dataset_objects ? &dataset_objects[i * num_objects] : NULL;
+		swift_args[i].reuse_dataset = (NULL != reuse_dataset);
+		swift_args[i].keep_dataset = (NULL != keep_dataset);
 		swift_args[i].swift_url = keystone_args.swift_url;
-		swift_args[i].auth_token = keystone_args.auth_token;
-		swift_args[i].start_condvar = &start_condvar;
-		swift_args[i].start_mutex = &start_mutex;
-		ret = pthread_create(&swift_args[i].thread_id, NULL, swift_thread_func, &swift_args[i]);
+		swift_args[i].auth_token = auth_tokens_first(&tokens);
+		swift_args[i].tokens = &tokens;
+		swift_args[i].token_reader = &tokens.readers[i];
+		swift_args[i].run = &run;
+		swift_args[i].live = &reporter.counters[i];
+		swift_args[i].timings = timings ? &timings[i * (SWIFT_OP_MAX + 1)] : NULL;
+		ret = pthread_attr_init(&attr);
+		if (0 == ret) {
+			/* Bound from its creation, so that all that the thread first touches is on its node */
+			ret = placement_set_attr(&attr, swift_args[i].cpu);
+			if (0 == ret) {
+				ret = pthread_create(&swift_args[i].thread_id, &attr, swift_func, &swift_args[i]);
+			}
+			pthread_attr_destroy(&attr);
+		}
 		if (ret != 0) {
+			errno = ret;
 			perror("pthread_create");
 			return EXIT_FAILURE;
 		}
 	}
 
-	/* Wait for threads to start. FIXME: Not robust. Plain wrong actually. */
-	sleep(2);
-
-	/* Broadcast the start condvar, telling all Swift threads to start */
-	ret = pthread_mutex_lock(&start_mutex);
-	if (ret != 0) {
-		perror("pthread_mutex_lock");
-		return EXIT_FAILURE;
-	}
-
-	ret = pthread_cond_broadcast(&start_condvar);
-	if (ret != 0) {
-		perror("pthread_cond_broadcast");
-		return EXIT_FAILURE;
-	}
-
-	ret = pthread_mutex_unlock(&start_mutex);
-	if (ret != 0) {
-		perror("pthread_mutex_unlock");
-		return EXIT_FAILURE;
-	}
-
 	/* Wait for each of the Swift threads to complete */
 	for (i = 0; i < num_swift_threads; i++) {
 		ret = pthread_join(swift_args[i].thread_id, NULL);
@@ -412,31 +1476,46 @@ or\n\
 		}
 	}
 
-	ret = pthread_cond_destroy(&start_condvar);
-	if (ret != 0) {
-		perror("pthread_cond_destroy");
-		return EXIT_FAILURE;
+	live_reporter_stop(&reporter);
+	auth_tokens_stop(&tokens);
+	swift_run_destroy(&run);
+	if (shared_setup) {
+		bulk_destroy(&bulk);
 	}
 
-	ret = pthread_mutex_destroy(&start_mutex);
-	if (ret != 0) {
-		perror("pthread_mutex_destroy");
-		return EXIT_FAILURE;
+	/* The dataset is kept only if every Swift thread recorded its objects, though any left in place stay */
+	ret = EXIT_SUCCESS;
+	if (keep_dataset) {
+		for (i = 0; i < num_swift_threads; i++) {
+			if (SCERR_SUCCESS != swift_args[i].scerr) {
+				fprintf(stderr, "%s: not written, as Swift thread %u failed\n", keep_dataset, swift_args[i].thread_num);
+				ret = EXIT_FAILURE;
+				break;
+			}
+		}
+		if (EXIT_SUCCESS == ret && 0 != dataset_save(keep_dataset, &dataset_config, dataset_objects)) {
+			ret = EXIT_FAILURE;
+		}
 	}
 
-	show_swift_times(swift_args, num_swift_threads);
-
-	ret = SCERR_SUCCESS;
-	/* Propagate any error from any of the Swift threads */
-	for (i = 0; i < num_swift_threads; i++) {
-		if (SCERR_SUCCESS != swift_args[i].scerr) {
-			ret = EXIT_FAILURE; /* Swift thread failed */
-		}
+	/* An agent sends its statistics to the controller before showing them itself */
+	if (in_session && 0 != agent_send_results(&session, swift_args, num_swift_threads, &run)) {
+		ret = EXIT_FAILURE;
+	}
+	if (EXIT_SUCCESS != report_run(swift_args, num_swift_threads, NULL != timings, results_path, results_format, &results_config, baseline_path)) {
+		ret = EXIT_FAILURE;
 	}
 
 	free(keystone_args.auth_token);
 	free(keystone_args.swift_url);
-	free(swift_args);
+	munmap(swift_args, num_swift_threads * sizeof(*swift_args));
+	free(object_crcs);
+	free(dataset_objects);
+	free(timings);
+	free(thread_cpus);
+	free(thread_nodes);
+	free(placement.cpus);
+	controller_options_free(&forwarded);
 
 	return ret;
 }
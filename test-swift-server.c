@@ -0,0 +1,1973 @@
+/*
+ * test-swift-server.c
+ *
+ * Minimal in-memory stand-in for the Keystone and Swift services, sufficient
+ * for test-swift-client to run against on a single host without a devstack.
+ * Each worker thread runs its own epoll loop on its own SO_REUSEPORT listening
+ * socket; objects are held in memory, shared between all worker threads.
+ */
+
+#define _GNU_SOURCE  /* strcasestr, memmem */
+
+#include <stdio.h>      /* [sn]printf */
+#include <stdlib.h>     /* malloc, free, strtoul */
+#include <stddef.h>     /* offsetof */
+#include <string.h>     /* memcpy, strcmp */
+#include <ctype.h>      /* isxdigit */
+#include <strings.h>    /* strncasecmp */
+#include <pthread.h>    /* pthread_* */
+#include <assert.h>     /* assert */
+#include <errno.h>      /* errno */
+#include <time.h>       /* time, gmtime_r, strftime */
+#include <signal.h>     /* signal */
+#include <unistd.h>     /* read, write, close */
+#include <fcntl.h>      /* fcntl */
+#include <sys/uio.h>    /* writev */
+#include <sys/socket.h> /* socket, bind, listen, accept4 */
+#include <sys/epoll.h>  /* epoll_* */
+#include <netinet/in.h> /* struct sockaddr_in */
+#include <netinet/tcp.h> /* TCP_NODELAY */
+#include <arpa/inet.h>  /* inet_pton */
+#include <getopt.h>     /* getopt_long */
+
+/* Default TCP port on which to listen */
+#define PORT_DEFAULT 8080
+/* Default address on which to listen */
+#define ADDRESS_DEFAULT "127.0.0.1"
+/* Default number of worker threads */
+#define NUM_THREADS_DEFAULT 4
+/* Default lifetime of issued tokens, in seconds */
+#define TOKEN_LIFETIME_DEFAULT (24 * 60 * 60)
+
+/* Size of each connection's input buffer */
+#define INPUT_BUFFER_SIZE (16 * 1024)
+/* Largest acceptable request line and headers */
+#define MAX_HEAD_SIZE (8 * 1024)
+/* Maximum number of epoll events to process per wakeup */
+#define MAX_EVENTS 256
+/* Initial number of hash buckets in each container and in the container table */
+#define INITIAL_BUCKETS 64
+/* Largest acceptable request body; Swift's own limit on a single object */
+#define MAX_BODY_SIZE (5ULL * 1024 * 1024 * 1024)
+/* Prefix of every token issued. The remainder of the token is its expiry time */
+#define TOKEN_PREFIX "stand-in-"
+/* Characters allowed in a tenant name, which is copied unescaped into JSON and into its account's URL */
+#define TENANT_NAME_CHARS "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-._~"
+/* Queries of an object put of a static large object's manifest, and of a delete of the manifest with its segments */
+#define SLO_PUT_QUERY "multipart-manifest=put"
+#define SLO_DELETE_QUERY "multipart-manifest=delete"
+/* Greatest number of segments of a static large object, as Swift's default */
+#define SLO_MAX_SEGMENTS 1000
+/* Query of an account post of a bulk delete */
+#define BULK_DELETE_QUERY "bulk-delete"
+/* Greatest number of objects deleted by one bulk delete, as Swift's default */
+#define BULK_DELETE_MAX 10000
+/* Greatest number of entries of one page of a listing, as Swift's default container_listing_limit */
+#define LISTING_LIMIT_MAX 10000
+/* Longest listing query parameter understood, including the terminating NUL */
+#define LISTING_PARAM_MAX 1025
+
+#define typealloc(type) ((type *) malloc(sizeof(type)))
+#define typearrayalloc(count, type) ((type *) malloc((count) * sizeof(type)))
+
+/* Immutable data of a stored object, shared by the store and any responses still sending it */
+struct object_data {
+	unsigned long refcount; /* Number of references held; accessed atomically */
+	size_t size;            /* Length of data */
+	unsigned char data[];   /* The object's data */
+};
+
+/* An object within a container */
+struct stored_object {
+	char *name;                   /* Object name, decoded from the request path */
+	struct object_data *data;     /* Object's current data */
+	char *segments;               /* Paths of a static large object's segments, one per line, or NULL */
+	struct stored_object *next;   /* Next object in the same hash bucket */
+};
+
+/* A container within an account */
+struct container {
+	char *name;                   /* "account/container", decoded from the request path */
+	pthread_rwlock_t lock;        /* Protects all of the below */
+	struct stored_object **buckets; /* Hash table of objects */
+	size_t num_buckets;           /* Number of hash buckets */
+	size_t num_objects;           /* Number of objects */
+	unsigned long long bytes;     /* Total size of all objects */
+	const char **sorted;          /* Names of all objects in order, or NULL if one has been added or removed since */
+	pthread_mutex_t sorted_lock;  /* Serialises readers sorting the names; writers holding lock need not take it */
+	struct container *next;       /* Next container in the same hash bucket */
+};
+
+/* States of a connection */
+enum connection_state {
+	READ_HEAD,       /* Awaiting the request line and headers */
+	READ_BODY,       /* Awaiting a body with a known length */
+	READ_CHUNK_SIZE, /* Awaiting a chunk-size line of a chunked body */
+	READ_CHUNK_DATA, /* Awaiting the data of a chunk of a chunked body */
+	READ_CHUNK_END,  /* Awaiting the CRLF after a chunk's data */
+	READ_TRAILER,    /* Awaiting the end of the trailer of a chunked body */
+	WRITE_RESPONSE   /* Sending the response */
+};
+
+/* Parsed request line and headers */
+struct request {
+	char *method;                 /* Request method */
+	char *path;                   /* Request path, excluding any query */
+	char *query;                  /* Query string after '?', or NULL */
+	char *auth_token;             /* X-Auth-Token header, or NULL */
+	char *host;                   /* Host header, or NULL */
+	char *range;                  /* Range header, or NULL */
+	size_t content_length;        /* Content-Length header, or zero */
+	unsigned int chunked;         /* Whether the body uses chunked transfer-coding */
+	unsigned int keep_alive;      /* Whether the connection persists after this request */
+	unsigned int expect_continue; /* Whether the client awaits "100 Continue" */
+};
+
+/* A client connection, owned by a single worker thread */
+struct connection {
+	int fd;                         /* Socket */
+	enum connection_state state;    /* What the connection is waiting for */
+	char in[INPUT_BUFFER_SIZE + 1]; /* Unprocessed input; always NUL-terminated */
+	size_t in_len;                  /* Length of unprocessed input */
+	char head[MAX_HEAD_SIZE];       /* Copy of current request's head, into which request's fields point */
+	struct request req;             /* Current request */
+	struct object_data *body;       /* Body received so far */
+	size_t body_cap;                /* Capacity of body's data */
+	size_t chunk_remaining;         /* Bytes remaining in current chunk */
+	char out_head[1024];            /* Response status line and headers */
+	size_t out_head_len;            /* Length of response head */
+	struct object_data *out_body;   /* Data of which the response body is a part, or NULL */
+	size_t out_body_start;          /* Offset of the response body within out_body */
+	size_t out_body_len;            /* Length of the response body */
+	size_t out_off;                 /* Bytes of head and body already sent */
+	unsigned int close_after;       /* Whether to close once the response is sent */
+	uint32_t events;                /* Events for which the socket is currently registered */
+};
+
+/* Configuration shared by all worker threads */
+struct server_args {
+	const char *address;          /* Address on which to listen */
+	unsigned short port;          /* Port on which to listen */
+	unsigned long token_lifetime; /* Lifetime in seconds of issued tokens */
+	unsigned int verbose;         /* Whether to log each request */
+};
+
+/* Per-thread arguments */
+struct worker_args {
+	pthread_t thread_id;              /* pthread thread ID */
+	unsigned int thread_num;          /* Worker thread index */
+	const struct server_args *server; /* Shared configuration */
+	int listen_fd;                    /* This worker's listening socket */
+};
+
+/* Hash table of all containers in all accounts */
+static pthread_rwlock_t containers_lock = PTHREAD_RWLOCK_INITIALIZER;
+static struct container *containers[INITIAL_BUCKETS * 16];
+
+static unsigned long
+hash_string(const char *s)
+{
+	/* FNV-1a */
+	unsigned long h = 2166136261UL;
+
+	while (*s) {
+		h ^= (unsigned char) *s++;
+		h *= 16777619UL;
+	}
+	return h;
+}
+
+static struct object_data *
+object_data_alloc(size_t size)
+{
+	struct object_data *d = malloc(sizeof(*d) + size);
+
+	if (d) {
+		d->refcount = 1;
+		d->size = size;
+	}
+	return d;
+}
+
+static struct object_data *
+object_data_ref(struct object_data *d)
+{
+	__atomic_add_fetch(&d->refcount, 1, __ATOMIC_RELAXED);
+	return d;
+}
+
+static void
+object_data_unref(struct object_data *d)
+{
+	if (d && 0 == __atomic_sub_fetch(&d->refcount, 1, __ATOMIC_ACQ_REL)) {
+		free(d);
+	}
+}
+
+/**
+ * Return a new object data holding a copy of the given string.
+ */
+static struct object_data *
+object_data_from_string(const char *s, size_t len)
+{
+	struct object_data *d = object_data_alloc(len);
+
+	if (d) {
+		memcpy(d->data, s, len);
+	}
+	return d;
+}
+
+/**
+ * Find the named container. Caller must hold containers_lock.
+ */
+static struct container *
+find_container(const char *name)
+{
+	struct container *c;
+
+	for (c = containers[hash_string(name) % (sizeof(containers) / sizeof(containers[0]))]; c; c = c->next) {
+		if (0 == strcmp(c->name, name)) {
+			return c;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Find the named object within the container. Caller must hold the container's lock.
+ */
+static struct stored_object **
+find_object(struct container *c, const char *name)
+{
+	struct stored_object **o;
+
+	for (o = &c->buckets[hash_string(name) % c->num_buckets]; *o; o = &(*o)->next) {
+		if (0 == strcmp((*o)->name, name)) {
+			return o;
+		}
+	}
+	return o;
+}
+
+/**
+ * Double the number of hash buckets in the container. Caller must hold the container's write lock.
+ */
+static void
+grow_container(struct container *c)
+{
+	size_t new_num_buckets = c->num_buckets * 2, i;
+	struct stored_object **new_buckets = calloc(new_num_buckets, sizeof(*new_buckets));
+
+	if (NULL == new_buckets) {
+		return; /* Carry on with longer chains */
+	}
+	for (i = 0; i < c->num_buckets; i++) {
+		struct stored_object *o, *next;
+		for (o = c->buckets[i]; o; o = next) {
+			struct stored_object **b = &new_buckets[hash_string(o->name) % new_num_buckets];
+			next = o->next;
+			o->next = *b;
+			*b = o;
+		}
+	}
+	free(c->buckets);
+	c->buckets = new_buckets;
+	c->num_buckets = new_num_buckets;
+}
+
+/**
+ * Forget the order of the container's names, once an object has been added or removed.
+ * Caller must hold the container's write lock.
+ */
+static void
+forget_sorted(struct container *c)
+{
+	free(c->sorted);
+	c->sorted = NULL;
+}
+
+/**
+ * Remove the given object from the container. Caller must hold the container's write lock.
+ */
+static void
+remove_object(struct container *c, struct stored_object **o)
+{
+	struct stored_object *old = *o;
+
+	*o = old->next;
+	forget_sorted(c);
+	c->num_objects--;
+	c->bytes -= old->data->size;
+	object_data_unref(old->data);
+	free(old->segments);
+	free(old->name);
+	free(old);
+}
+
+/**
+ * Prepare a response with the given status whose body is the given part of the given data, if any.
+ * Takes ownership of the data reference.
+ */
+static void
+respond_part(struct connection *conn, unsigned int status, const char *reason, const char *extra_headers, struct object_data *body, size_t body_start, size_t body_len, unsigned int head_only)
+{
+	conn->out_head_len = snprintf(conn->out_head, sizeof(conn->out_head),
+		"HTTP/1.1 %u %s\r\n"
+		"Content-Length: %zu\r\n"
+		"X-Trans-Id: stand-in\r\n"
+		"%s"
+		"%s"
+		"\r\n",
+		status, reason,
+		body_len,
+		extra_headers ? extra_headers : "",
+		conn->req.keep_alive ? "" : "Connection: close\r\n"
+	);
+	if (conn->out_head_len >= sizeof(conn->out_head)) {
+		conn->out_head_len = sizeof(conn->out_head) - 1;
+	}
+	if (head_only) {
+		object_data_unref(body);
+		body = NULL;
+	}
+	conn->out_body = body;
+	conn->out_body_start = body_start;
+	conn->out_body_len = body ? body_len : 0;
+	conn->out_off = 0;
+	conn->close_after = !conn->req.keep_alive;
+	conn->state = WRITE_RESPONSE;
+}
+
+/**
+ * Prepare a response with the given status and optional body.
+ * Takes ownership of the body reference.
+ */
+static void
+respond(struct connection *conn, unsigned int status, const char *reason, const char *extra_headers, struct object_data *body, unsigned int head_only)
+{
+	respond_part(conn, status, reason, extra_headers, body, 0, body ? body->size : 0, head_only);
+}
+
+static void
+respond_status(struct connection *conn, unsigned int status, const char *reason)
+{
+	respond(conn, status, reason, NULL, NULL, 0);
+}
+
+/**
+ * Copy the value of the named JSON string field in the given text of the given size, which need not be
+ * NUL-terminated, into buf, or leave buf untouched if there is no such field.
+ */
+static void
+json_string_field(const char *json, size_t size, const char *field, char *buf, size_t len)
+{
+	char key[64];
+	const char *p, *end, *limit = json + size;
+	size_t key_len;
+
+	key_len = snprintf(key, sizeof(key), "\"%s\"", field);
+	p = memmem(json, size, key, key_len);
+	if (NULL == p) {
+		return;
+	}
+	p += key_len;
+	p = memchr(p, '"', limit - p);
+	if (NULL == p) {
+		return;
+	}
+	p++;
+	end = memchr(p, '"', limit - p);
+	if (NULL == end || (size_t) (end - p) >= len) {
+		return;
+	}
+	memcpy(buf, p, end - p);
+	buf[end - p] = '\0';
+}
+
+/**
+ * Issue a token and service catalog, in Keystone v2.0 or v3 form depending upon the request path.
+ */
+static void
+handle_tokens(const struct server_args *server, struct connection *conn)
+{
+	char tenant[128] = "test";
+	char token[64], expires[64], swift_url[256], keystone_url[256], headers[128];
+	char *json;
+	time_t expiry = time(NULL) + server->token_lifetime;
+	struct tm tm;
+	unsigned int v3 = (NULL != strstr(conn->req.path, "/v3/"));
+	const char *host = conn->req.host ? conn->req.host : server->address;
+	struct object_data *body;
+
+	if (conn->body) {
+		const char *text = (const char *) conn->body->data;
+		json_string_field(text, conn->body->size, "tenantName", tenant, sizeof(tenant));
+		json_string_field(text, conn->body->size, "project_name", tenant, sizeof(tenant));
+	}
+	if ('\0' == tenant[0] || '\0' != tenant[strspn(tenant, TENANT_NAME_CHARS)]) {
+		respond_status(conn, 400, "Bad Request");
+		return;
+	}
+	gmtime_r(&expiry, &tm);
+	strftime(expires, sizeof(expires), "%Y-%m-%dT%H:%M:%SZ", &tm);
+	snprintf(token, sizeof(token), TOKEN_PREFIX "%lu", (unsigned long) expiry);
+	snprintf(swift_url, sizeof(swift_url), "http://%s/v1/AUTH_%s", host, tenant);
+	snprintf(keystone_url, sizeof(keystone_url), "http://%s/%s", host, v3 ? "v3" : "v2.0");
+
+	if (v3) {
+		if (-1 == asprintf(&json,
+			"{\"token\":{\"expires_at\":\"%s\",\"project\":{\"name\":\"%s\",\"id\":\"%s\"},\"catalog\":["
+			"{\"type\":\"object-store\",\"name\":\"swift\",\"endpoints\":["
+			"{\"interface\":\"public\",\"region\":\"RegionOne\",\"url\":\"%s\"},"
+			"{\"interface\":\"internal\",\"region\":\"RegionOne\",\"url\":\"%s\"},"
+			"{\"interface\":\"admin\",\"region\":\"RegionOne\",\"url\":\"%s\"}]},"
+			"{\"type\":\"identity\",\"name\":\"keystone\",\"endpoints\":["
+			"{\"interface\":\"public\",\"region\":\"RegionOne\",\"url\":\"%s\"}]}]}}",
+			expires, tenant, tenant, swift_url, swift_url, swift_url, keystone_url)) {
+			json = NULL;
+		}
+		snprintf(headers, sizeof(headers), "Content-Type: application/json\r\nX-Subject-Token: %s\r\n", token);
+	} else {
+		if (-1 == asprintf(&json,
+			"{\"access\":{\"token\":{\"id\":\"%s\",\"expires\":\"%s\",\"tenant\":{\"name\":\"%s\",\"id\":\"%s\"}},"
+			"\"serviceCatalog\":["
+			"{\"type\":\"object-store\",\"name\":\"swift\",\"endpoints\":[{\"region\":\"RegionOne\","
+			"\"publicURL\":\"%s\",\"internalURL\":\"%s\",\"adminURL\":\"%s\"}]},"
+			"{\"type\":\"identity\",\"name\":\"keystone\",\"endpoints\":[{\"region\":\"RegionOne\","
+			"\"publicURL\":\"%s\",\"internalURL\":\"%s\",\"adminURL\":\"%s\"}]}],"
+			"\"user\":{\"name\":\"test\",\"id\":\"test\"}}}",
+			token, expires, tenant, tenant, swift_url, swift_url, swift_url, keystone_url, keystone_url, keystone_url)) {
+			json = NULL;
+		}
+		snprintf(headers, sizeof(headers), "Content-Type: application/json\r\n");
+	}
+	if (NULL == json) {
+		respond_status(conn, 500, "Internal Server Error");
+		return;
+	}
+	body = object_data_from_string(json, strlen(json));
+	free(json);
+	if (NULL == body) {
+		respond_status(conn, 500, "Internal Server Error");
+		return;
+	}
+	respond(conn, v3 ? 201 : 200, v3 ? "Created" : "OK", headers, body, 0);
+}
+
+/**
+ * Whether the given token was issued by this server and has not expired.
+ */
+static unsigned int
+token_valid(const char *token)
+{
+	if (NULL == token || 0 != strncmp(token, TOKEN_PREFIX, strlen(TOKEN_PREFIX))) {
+		return 0;
+	}
+	return strtoul(token + strlen(TOKEN_PREFIX), NULL, 10) > (unsigned long) time(NULL);
+}
+
+/**
+ * Decode %-escapes in the given string, in place.
+ */
+static void
+url_decode(char *s)
+{
+	char *out = s;
+
+	while (*s) {
+		if ('%' == s[0] && isxdigit((unsigned char) s[1]) && isxdigit((unsigned char) s[2])) {
+			char hex[3] = { s[1], s[2], '\0' };
+			*out++ = (char) strtoul(hex, NULL, 16);
+			s += 3;
+		} else {
+			*out++ = *s++;
+		}
+	}
+	*out = '\0';
+}
+
+/**
+ * Copy the value of the given parameter of the request's query, decoded, into the given buffer of LISTING_PARAM_MAX,
+ * returning it, or return the given default if the query lacks it or it does not fit.
+ */
+static const char *
+query_param(const struct connection *conn, const char *param, char *value, const char *dflt)
+{
+	size_t len = strlen(param), value_len;
+	const char *p = conn->req.query;
+
+	while (p) {
+		if (0 == strncmp(p, param, len) && '=' == p[len]) {
+			p += len + 1;
+			value_len = strcspn(p, "&");
+			if (value_len >= LISTING_PARAM_MAX) {
+				return dflt;
+			}
+			memcpy(value, p, value_len);
+			value[value_len] = '\0';
+			url_decode(value);
+			return value;
+		}
+		p = strchr(p, '&');
+		if (p) {
+			p++;
+		}
+	}
+	return dflt;
+}
+
+/**
+ * Append the given name to the given body as a JSON listing entry of the given key, escaping it as needed.
+ * Returns the new length of the body, which has room for the longest entry.
+ */
+static size_t
+append_json_entry(unsigned char *body, size_t len, const char *key, const char *name, size_t name_len)
+{
+	const unsigned char *s = (const unsigned char *) name;
+	size_t i;
+
+	len += sprintf((char *) body + len, "%s{\"%s\":\"", len > 1 ? "," : "", key);
+	for (i = 0; i < name_len; i++) {
+		if ('"' == s[i] || '\\' == s[i]) {
+			body[len++] = '\\';
+			body[len++] = s[i];
+		} else if (s[i] < 0x20) {
+			len += sprintf((char *) body + len, "\\u%04x", s[i]);
+		} else {
+			body[len++] = s[i];
+		}
+	}
+	body[len++] = '"';
+	body[len++] = '}';
+	return len;
+}
+
+/* One entry of a listing */
+struct listing_entry {
+	const char *name;             /* Name of the entry, or of an object within a rolled-up part */
+	size_t len;                   /* Length of the entry's name, or of the part */
+	unsigned int subdir;          /* Whether the entry is a rolled-up part */
+};
+
+static int
+compare_names(const void *a, const void *b)
+{
+	return strcmp(*(const char *const *) a, *(const char *const *) b);
+}
+
+/**
+ * Return the names of all objects of the container in order, or NULL if out of memory, sorting them only if an
+ * object has been added or removed since they were last sorted. Caller must hold the container's lock, until
+ * which the names stay valid.
+ */
+static const char **
+sorted_names(struct container *c)
+{
+	const char **names;
+	size_t count = 0, i;
+
+	pthread_mutex_lock(&c->sorted_lock);
+	if (NULL == c->sorted && NULL != (names = typearrayalloc(c->num_objects ? c->num_objects : 1, const char *))) {
+		for (i = 0; i < c->num_buckets; i++) {
+			struct stored_object *o;
+			for (o = c->buckets[i]; o; o = o->next) {
+				names[count++] = o->name;
+			}
+		}
+		qsort(names, count, sizeof(*names), compare_names);
+		c->sorted = names;
+	}
+	names = c->sorted;
+	pthread_mutex_unlock(&c->sorted_lock);
+	return names;
+}
+
+/**
+ * Return the index of the first of the given names in order after the given key, or, if at is set, at or after it.
+ */
+static size_t
+first_name_after(const char **names, size_t count, const char *key, unsigned int at)
+{
+	size_t low = 0, high = count, mid;
+	int cmp;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		cmp = strcmp(names[mid], key);
+		if (cmp < 0 || (0 == cmp && !at)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+/**
+ * Respond with the given names, which are in order, as selected by the request's query: those after any marker with any
+ * prefix, those sharing a part up to any delimiter after the prefix rolled up into one, up to the limit.
+ * The listing is a newline-separated list, or 204 if empty, unless the query asks for JSON: then an array
+ * of objects, each with the name of an entry or, for a rolled-up part, a subdir.
+ */
+static void
+respond_listing(struct connection *conn, const char **names, size_t count, const char *headers)
+{
+	char marker_buf[LISTING_PARAM_MAX], prefix_buf[LISTING_PARAM_MAX], delimiter_buf[LISTING_PARAM_MAX], buf[LISTING_PARAM_MAX];
+	const char *marker = query_param(conn, "marker", marker_buf, "");
+	const char *prefix = query_param(conn, "prefix", prefix_buf, "");
+	const char *delimiter = query_param(conn, "delimiter", delimiter_buf, "");
+	unsigned int json = (0 == strcmp(query_param(conn, "format", buf, "plain"), "json"));
+	unsigned long limit = strtoul(query_param(conn, "limit", buf, "10000"), NULL, 10);
+	size_t prefix_len = strlen(prefix), i, n = 0, len = 2;
+	struct listing_entry *entries;
+	struct object_data *body;
+
+	if (limit > LISTING_LIMIT_MAX) {
+		respond_status(conn, 412, "Precondition Failed");
+		return;
+	}
+	entries = typearrayalloc(count ? count : 1, struct listing_entry);
+	if (NULL == entries) {
+		respond_status(conn, 500, "Internal Server Error");
+		return;
+	}
+	/* Names at or before the marker were listed on an earlier page, and those with the prefix sort together */
+	i = (strcmp(marker, prefix) >= 0) ? first_name_after(names, count, marker, 0) : first_name_after(names, count, prefix, 1);
+	for (; i < count && n < limit; i++) {
+		const char *d;
+		size_t name_len;
+
+		if (0 != strncmp(names[i], prefix, prefix_len)) {
+			break; /* Past the names with the prefix */
+		}
+		d = delimiter[0] ? strstr(names[i] + prefix_len, delimiter) : NULL;
+		name_len = d ? (size_t) (d - names[i]) + strlen(delimiter) : strlen(names[i]);
+		if (d && n && entries[n - 1].subdir && entries[n - 1].len == name_len && 0 == strncmp(entries[n - 1].name, names[i], name_len)) {
+			/* Rolled up into the part already listed */
+			continue;
+		}
+		if (d ? strncmp(names[i], marker, name_len) < 0 || (0 == strncmp(names[i], marker, name_len) && strlen(marker) >= name_len)
+			: strcmp(names[i], marker) <= 0) {
+			/* At or before the marker, or a part within which the marker lies, listed on an earlier page */
+			continue;
+		}
+		entries[n].name = names[i];
+		entries[n].len = name_len;
+		entries[n].subdir = (NULL != d);
+		/* Room for the name, escaped as JSON at worst, and the object around it */
+		len += 6 * name_len + 16;
+		n++;
+	}
+	if (0 == n && !json) {
+		free(entries);
+		respond(conn, 204, "No Content", headers, NULL, 0);
+		return;
+	}
+	body = object_data_alloc(len);
+	if (NULL == body) {
+		free(entries);
+		respond_status(conn, 500, "Internal Server Error");
+		return;
+	}
+	len = 0;
+	if (json) {
+		body->data[len++] = '[';
+	}
+	for (i = 0; i < n; i++) {
+		if (json) {
+			len = append_json_entry(body->data, len, entries[i].subdir ? "subdir" : "name", entries[i].name, entries[i].len);
+		} else {
+			memcpy(body->data + len, entries[i].name, entries[i].len);
+			len += entries[i].len;
+			body->data[len++] = '\n';
+		}
+	}
+	if (json) {
+		body->data[len++] = ']';
+	}
+	body->size = len;
+	free(entries);
+	respond(conn, 200, "OK", headers, body, !strcmp(conn->req.method, "HEAD"));
+}
+
+static void
+handle_account(struct connection *conn, const char *account)
+{
+	const char **names = NULL;
+	size_t count = 0, cap = 0, i, account_len = strlen(account);
+	char headers[128];
+
+	pthread_rwlock_rdlock(&containers_lock);
+	for (i = 0; i < sizeof(containers) / sizeof(containers[0]); i++) {
+		struct container *c;
+		for (c = containers[i]; c; c = c->next) {
+			if (0 == strncmp(c->name, account, account_len) && '/' == c->name[account_len]) {
+				if (count == cap) {
+					const char **new_names = realloc(names, (cap = cap ? cap * 2 : 64) * sizeof(*names));
+					if (NULL == new_names) {
+						break;
+					}
+					names = new_names;
+				}
+				names[count++] = c->name + account_len + 1;
+			}
+		}
+	}
+	snprintf(headers, sizeof(headers), "X-Account-Container-Count: %zu\r\n", count);
+	if (0 == strcmp(conn->req.method, "GET") || 0 == strcmp(conn->req.method, "HEAD")) {
+		qsort(names, count, sizeof(*names), compare_names);
+		respond_listing(conn, names, count, headers);
+	} else {
+		respond_status(conn, 405, "Method Not Allowed");
+	}
+	pthread_rwlock_unlock(&containers_lock);
+	free(names);
+}
+
+static void
+handle_container(struct connection *conn, const char *name)
+{
+	const char *method = conn->req.method;
+	struct container *c;
+
+	if (0 == strcmp(method, "PUT")) {
+		pthread_rwlock_wrlock(&containers_lock);
+		if (find_container(name)) {
+			pthread_rwlock_unlock(&containers_lock);
+			respond_status(conn, 202, "Accepted");
+			return;
+		}
+		c = typealloc(struct container);
+		if (c) {
+			c->name = strdup(name);
+			c->buckets = calloc(INITIAL_BUCKETS, sizeof(*c->buckets));
+			c->num_buckets = INITIAL_BUCKETS;
+			c->num_objects = 0;
+			c->bytes = 0;
+			c->sorted = NULL;
+			pthread_rwlock_init(&c->lock, NULL);
+			pthread_mutex_init(&c->sorted_lock, NULL);
+			if (NULL == c->name || NULL == c->buckets) {
+				free(c->name);
+				free(c->buckets);
+				free(c);
+				c = NULL;
+			}
+		}
+		if (c) {
+			struct container **bucket = &containers[hash_string(name) % (sizeof(containers) / sizeof(containers[0]))];
+			c->next = *bucket;
+			*bucket = c;
+		}
+		pthread_rwlock_unlock(&containers_lock);
+		if (c) {
+			respond_status(conn, 201, "Created");
+		} else {
+			respond_status(conn, 500, "Internal Server Error");
+		}
+	} else if (0 == strcmp(method, "DELETE")) {
+		struct container **p;
+		pthread_rwlock_wrlock(&containers_lock);
+		for (p = &containers[hash_string(name) % (sizeof(containers) / sizeof(containers[0]))]; *p; p = &(*p)->next) {
+			if (0 == strcmp((*p)->name, name)) {
+				break;
+			}
+		}
+		c = *p;
+		if (NULL == c) {
+			pthread_rwlock_unlock(&containers_lock);
+			respond_status(conn, 404, "Not Found");
+			return;
+		}
+		if (c->num_objects) {
+			pthread_rwlock_unlock(&containers_lock);
+			respond_status(conn, 409, "Conflict");
+			return;
+		}
+		*p = c->next;
+		pthread_rwlock_unlock(&containers_lock);
+		/* No other thread can now find the container, and none holds its lock without holding containers_lock */
+		pthread_rwlock_destroy(&c->lock);
+		pthread_mutex_destroy(&c->sorted_lock);
+		free(c->sorted);
+		free(c->buckets);
+		free(c->name);
+		free(c);
+		respond_status(conn, 204, "No Content");
+	} else if (0 == strcmp(method, "GET") || 0 == strcmp(method, "HEAD") || 0 == strcmp(method, "POST")) {
+		char headers[128];
+		pthread_rwlock_rdlock(&containers_lock);
+		c = find_container(name);
+		if (NULL == c) {
+			pthread_rwlock_unlock(&containers_lock);
+			respond_status(conn, 404, "Not Found");
+			return;
+		}
+		pthread_rwlock_rdlock(&c->lock);
+		snprintf(headers, sizeof(headers), "X-Container-Object-Count: %zu\r\nX-Container-Bytes-Used: %llu\r\n", c->num_objects, c->bytes);
+		if (0 == strcmp(method, "POST")) {
+			respond(conn, 204, "No Content", headers, NULL, 0);
+		} else {
+			const char **names = sorted_names(c);
+			if (names) {
+				respond_listing(conn, names, c->num_objects, headers);
+			} else {
+				respond_status(conn, 500, "Internal Server Error");
+			}
+		}
+		pthread_rwlock_unlock(&c->lock);
+		pthread_rwlock_unlock(&containers_lock);
+	} else {
+		respond_status(conn, 405, "Method Not Allowed");
+	}
+}
+
+/**
+ * Return whether the request's query includes the given parameter.
+ */
+static unsigned int
+has_query(const struct connection *conn, const char *param)
+{
+	size_t len = strlen(param);
+	const char *p = conn->req.query;
+
+	while (p) {
+		if (0 == strncmp(p, param, len) && ('\0' == p[len] || '&' == p[len])) {
+			return 1;
+		}
+		p = strchr(p, '&');
+		if (p) {
+			p++;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Split the path "/container/object" of a segment, within the account of the given "account/container",
+ * into the full container name and the object name, in the given buffers. Returns zero on success.
+ */
+static int
+split_segment_path(const char *account_container, const char *path, char *container, size_t container_len, const char **object)
+{
+	size_t account_len = strcspn(account_container, "/");
+	const char *slash;
+
+	if ('/' != path[0] || NULL == (slash = strchr(path + 1, '/')) || '\0' == slash[1]) {
+		return -1;
+	}
+	if (account_len + 1 + (slash - path) >= container_len) {
+		return -1;
+	}
+	memcpy(container, account_container, account_len);
+	container[account_len] = '/';
+	memcpy(container + account_len + 1, path + 1, slash - path - 1);
+	container[account_len + (slash - path)] = '\0';
+	*object = slash + 1;
+	return 0;
+}
+
+/**
+ * Return a reference to the data of the segment at the given path, or NULL if there is no such object.
+ */
+static struct object_data *
+find_segment_data(const char *account_container, const char *path)
+{
+	char container_name[MAX_HEAD_SIZE];
+	const char *object_name;
+	struct container *c;
+	struct stored_object **o;
+	struct object_data *data = NULL;
+
+	if (split_segment_path(account_container, path, container_name, sizeof(container_name), &object_name)) {
+		return NULL;
+	}
+	pthread_rwlock_rdlock(&containers_lock);
+	c = find_container(container_name);
+	if (c) {
+		pthread_rwlock_rdlock(&c->lock);
+		o = find_object(c, object_name);
+		if (*o) {
+			data = object_data_ref((*o)->data);
+		}
+		pthread_rwlock_unlock(&c->lock);
+	}
+	pthread_rwlock_unlock(&containers_lock);
+	return data;
+}
+
+/**
+ * Return the data of a static large object, the concatenation of its segments' data, given its manifest:
+ * a JSON array of objects each with a "path" of "/container/object" within the manifest's account.
+ * Each segment's path is set, one per line, in *segments, for a later delete of the manifest and its segments.
+ * Unlike Swift, which assembles the data on each get, the data is copied once, when the manifest is put.
+ * Returns NULL if the manifest is invalid or any segment is missing.
+ */
+static struct object_data *
+assemble_manifest(const char *account_container, const struct object_data *manifest, char **segments)
+{
+	struct object_data *parts[SLO_MAX_SEGMENTS], *data = NULL;
+	char path[MAX_HEAD_SIZE];
+	char *json, *p, *end;
+	size_t num_parts = 0, size = 0, used = 0, i;
+
+	*segments = NULL;
+	if (NULL == manifest) {
+		return NULL;
+	}
+	json = malloc(manifest->size + 1);
+	*segments = malloc(manifest->size + 1); /* The paths are no longer than the manifest */
+	if (NULL == json || NULL == *segments) {
+		goto done;
+	}
+	memcpy(json, manifest->data, manifest->size);
+	json[manifest->size] = '\0';
+
+	for (p = json; NULL != (p = strstr(p, "\"path\"")); p = end + 1) {
+		p = strchr(p + 6, '"');
+		if (NULL == p || NULL == (end = strchr(++p, '"')) || (size_t) (end - p) >= sizeof(path) || SLO_MAX_SEGMENTS == num_parts) {
+			goto done;
+		}
+		memcpy(path, p, end - p);
+		path[end - p] = '\0';
+		parts[num_parts] = find_segment_data(account_container, path);
+		if (NULL == parts[num_parts]) {
+			goto done;
+		}
+		size += parts[num_parts++]->size;
+		used += sprintf(*segments + used, "%s\n", path);
+	}
+	if (0 == num_parts) {
+		goto done;
+	}
+
+	data = object_data_alloc(size);
+	if (data) {
+		for (size = 0, i = 0; i < num_parts; i++) {
+			memcpy(data->data + size, parts[i]->data, parts[i]->size);
+			size += parts[i]->size;
+		}
+	}
+
+done:
+	for (i = 0; i < num_parts; i++) {
+		object_data_unref(parts[i]);
+	}
+	free(json);
+	if (NULL == data) {
+		free(*segments);
+		*segments = NULL;
+	}
+	return data;
+}
+
+/**
+ * Delete each of the given segments of a deleted static large object, ignoring any already gone.
+ */
+static void
+delete_segment_objects(const char *account_container, char *segments)
+{
+	char container_name[MAX_HEAD_SIZE];
+	const char *object_name;
+	char *path, *saveptr = NULL;
+	struct container *c;
+	struct stored_object **o;
+
+	for (path = strtok_r(segments, "\n", &saveptr); path; path = strtok_r(NULL, "\n", &saveptr)) {
+		if (split_segment_path(account_container, path, container_name, sizeof(container_name), &object_name)) {
+			continue;
+		}
+		pthread_rwlock_rdlock(&containers_lock);
+		c = find_container(container_name);
+		if (c) {
+			pthread_rwlock_wrlock(&c->lock);
+			o = find_object(c, object_name);
+			if (*o) {
+				remove_object(c, o);
+			}
+			pthread_rwlock_unlock(&c->lock);
+		}
+		pthread_rwlock_unlock(&containers_lock);
+	}
+}
+
+/**
+ * Parse the value of a Range header against data of the given size into the offset and length of the single
+ * range it asks for. Returns 1 if the range is satisfiable, -1 if not, or 0 if the header is to be ignored,
+ * as it is if malformed or asking for more than one range.
+ */
+static int
+parse_range(const char *value, size_t size, size_t *start, size_t *len)
+{
+	unsigned long long first, last;
+	char *end;
+
+	if (0 != strncmp(value, "bytes=", 6) || strchr(value, ',')) {
+		return 0;
+	}
+	value += 6;
+	if ('-' == *value) {
+		/* Suffix: the last bytes of the data */
+		last = strtoull(value + 1, &end, 10);
+		if (end == value + 1 || *end) {
+			return 0;
+		}
+		if (0 == last) {
+			return -1;
+		}
+		*len = (last < size) ? last : size;
+		*start = size - *len;
+		return (0 == size) ? -1 : 1;
+	}
+	first = strtoull(value, &end, 10);
+	if (end == value || '-' != *end) {
+		return 0;
+	}
+	value = end + 1;
+	last = *value ? strtoull(value, &end, 10) : (unsigned long long) -1;
+	if (*value && (end == value || *end || last < first)) {
+		return 0;
+	}
+	if (first >= size) {
+		return -1;
+	}
+	*start = first;
+	*len = ((last < size) ? last + 1 : size) - first;
+	return 1;
+}
+
+/**
+ * Handle a request for an object. Called once any request body has been received in full.
+ */
+static void
+handle_object(struct connection *conn, const char *container_name, const char *object_name)
+{
+	const char *method = conn->req.method;
+	struct container *c;
+	struct stored_object **o;
+	unsigned int write = (0 == strcmp(method, "PUT") || 0 == strcmp(method, "DELETE"));
+	char *segments = NULL, *delete_segments = NULL;
+
+	if (0 == strcmp(method, "PUT") && has_query(conn, SLO_PUT_QUERY)) {
+		/* Replace the manifest by its segments' data, gathered before taking the manifest's container's lock */
+		struct object_data *data = assemble_manifest(container_name, conn->body, &segments);
+		if (NULL == data) {
+			respond_status(conn, 400, "Bad Request");
+			return;
+		}
+		object_data_unref(conn->body);
+		conn->body = data;
+	}
+
+	pthread_rwlock_rdlock(&containers_lock);
+	c = find_container(container_name);
+	if (NULL == c) {
+		pthread_rwlock_unlock(&containers_lock);
+		free(segments);
+		respond_status(conn, 404, "Not Found");
+		return;
+	}
+	if (write) {
+		pthread_rwlock_wrlock(&c->lock);
+	} else {
+		pthread_rwlock_rdlock(&c->lock);
+	}
+	o = find_object(c, object_name);
+
+	if (0 == strcmp(method, "PUT")) {
+		struct object_data *data = conn->body ? conn->body : object_data_alloc(0);
+		conn->body = NULL;
+		if (NULL == data) {
+			respond_status(conn, 500, "Internal Server Error");
+		} else if (*o) {
+			c->bytes += data->size;
+			c->bytes -= (*o)->data->size;
+			object_data_unref((*o)->data);
+			(*o)->data = data;
+			/* Any earlier manifest's segments are left in place, as Swift does */
+			free((*o)->segments);
+			(*o)->segments = segments;
+			segments = NULL;
+			respond_status(conn, 201, "Created");
+		} else {
+			struct stored_object *new_object = typealloc(struct stored_object);
+			if (new_object && NULL != (new_object->name = strdup(object_name))) {
+				new_object->data = data;
+				new_object->segments = segments;
+				segments = NULL;
+				new_object->next = NULL;
+				*o = new_object;
+				forget_sorted(c);
+				c->num_objects++;
+				c->bytes += data->size;
+				if (c->num_objects > 2 * c->num_buckets) {
+					grow_container(c);
+				}
+				respond_status(conn, 201, "Created");
+			} else {
+				free(new_object);
+				object_data_unref(data);
+				respond_status(conn, 500, "Internal Server Error");
+			}
+		}
+	} else if (NULL == *o) {
+		respond_status(conn, 404, "Not Found");
+	} else if (0 == strcmp(method, "DELETE")) {
+		if (has_query(conn, SLO_DELETE_QUERY)) {
+			if (NULL == (*o)->segments) {
+				respond_status(conn, 400, "Bad Request"); /* Not a static large object */
+			} else {
+				/* Delete the segments once the manifest's container's lock is released */
+				delete_segments = (*o)->segments;
+				(*o)->segments = NULL;
+				remove_object(c, o);
+				respond_status(conn, 200, "OK");
+			}
+		} else {
+			remove_object(c, o);
+			respond_status(conn, 204, "No Content");
+		}
+	} else if (0 == strcmp(method, "GET") || 0 == strcmp(method, "HEAD")) {
+		struct object_data *data = (*o)->data;
+		size_t start, len;
+		int range = conn->req.range ? parse_range(conn->req.range, data->size, &start, &len) : 0;
+		if (range > 0) {
+			char headers[128];
+			snprintf(headers, sizeof(headers), "Content-Type: application/octet-stream\r\nContent-Range: bytes %zu-%zu/%zu\r\n", start, start + len - 1, data->size);
+			respond_part(conn, 206, "Partial Content", headers, object_data_ref(data), start, len, !strcmp(method, "HEAD"));
+		} else if (range < 0) {
+			char headers[64];
+			snprintf(headers, sizeof(headers), "Content-Range: bytes */%zu\r\n", data->size);
+			respond(conn, 416, "Range Not Satisfiable", headers, NULL, 0);
+		} else {
+			respond(conn, 200, "OK", "Content-Type: application/octet-stream\r\n", object_data_ref(data), !strcmp(method, "HEAD"));
+		}
+	} else if (0 == strcmp(method, "POST")) {
+		respond_status(conn, 202, "Accepted");
+	} else {
+		respond_status(conn, 405, "Method Not Allowed");
+	}
+
+	pthread_rwlock_unlock(&c->lock);
+	pthread_rwlock_unlock(&containers_lock);
+	free(segments);
+
+	if (delete_segments) {
+		delete_segment_objects(container_name, delete_segments);
+		free(delete_segments);
+	}
+}
+
+/**
+ * Respond with the cluster's capabilities, as Swift's /info does, which need no token:
+ * only those of the middleware the stand-in implements.
+ */
+static void
+handle_info(struct connection *conn)
+{
+	struct object_data *body;
+	char json[256];
+	int len;
+
+	if (0 != strcmp(conn->req.method, "GET") && 0 != strcmp(conn->req.method, "HEAD")) {
+		respond_status(conn, 405, "Method Not Allowed");
+		return;
+	}
+	len = snprintf(json, sizeof(json),
+		"{\"swift\":{\"version\":\"stand-in\"},"
+		"\"bulk_delete\":{\"max_deletes_per_request\":%d,\"max_failed_deletes\":1000},"
+		"\"slo\":{\"max_manifest_segments\":%d}}",
+		BULK_DELETE_MAX, SLO_MAX_SEGMENTS);
+	body = object_data_from_string(json, len);
+	if (NULL == body) {
+		respond_status(conn, 500, "Internal Server Error");
+		return;
+	}
+	respond(conn, 200, "OK", "Content-Type: application/json\r\n", body, !strcmp(conn->req.method, "HEAD"));
+}
+
+/**
+ * Delete each object listed, one URL-encoded "/container/object" per line, in the body of a bulk delete
+ * within the given account, and respond with a JSON summary, as Swift's bulk middleware does.
+ * Objects already absent count as not found rather than failing; containers are not deleted.
+ */
+static void
+handle_bulk_delete(struct connection *conn, const char *account)
+{
+	char container_name[MAX_HEAD_SIZE];
+	unsigned long deleted = 0, not_found = 0, lines = 0;
+	const char *object_name;
+	char *text, *path, *saveptr = NULL, *json;
+	struct object_data *body;
+	struct container *c;
+	struct stored_object **o;
+	unsigned int found;
+	size_t len = conn->body ? conn->body->size : 0;
+
+	text = malloc(len + 1);
+	if (NULL == text) {
+		respond_status(conn, 500, "Internal Server Error");
+		return;
+	}
+	if (len) {
+		memcpy(text, conn->body->data, len);
+	}
+	text[len] = '\0';
+
+	for (path = strtok_r(text, "\r\n", &saveptr); path; path = strtok_r(NULL, "\r\n", &saveptr)) {
+		if (++lines > BULK_DELETE_MAX) {
+			break;
+		}
+		url_decode(path);
+		if (split_segment_path(account, path, container_name, sizeof(container_name), &object_name)) {
+			not_found++;
+			continue;
+		}
+		found = 0;
+		pthread_rwlock_rdlock(&containers_lock);
+		c = find_container(container_name);
+		if (c) {
+			pthread_rwlock_wrlock(&c->lock);
+			o = find_object(c, object_name);
+			if (*o) {
+				remove_object(c, o);
+				found = 1;
+			}
+			pthread_rwlock_unlock(&c->lock);
+		}
+		pthread_rwlock_unlock(&containers_lock);
+		if (found) {
+			deleted++;
+		} else {
+			not_found++;
+		}
+	}
+	free(text);
+
+	if (-1 == asprintf(&json, "{\"Number Deleted\":%lu,\"Number Not Found\":%lu,\"Response Body\":\"\",\"Response Status\":\"%s\",\"Errors\":[]}",
+		deleted, not_found, (lines > BULK_DELETE_MAX) ? "413 Request Entity Too Large" : "200 OK")) {
+		respond_status(conn, 500, "Internal Server Error");
+		return;
+	}
+	body = object_data_from_string(json, strlen(json));
+	free(json);
+	if (NULL == body) {
+		respond_status(conn, 500, "Internal Server Error");
+		return;
+	}
+	respond(conn, 200, "OK", "Content-Type: application/json\r\n", body, 0);
+}
+
+/**
+ * Dispatch a fully-received request.
+ */
+static void
+handle_request(const struct server_args *server, struct connection *conn)
+{
+	char *path = conn->req.path;
+	char *account, *container = NULL, *object = NULL, *p;
+	size_t path_len;
+
+	if (server->verbose) {
+		fprintf(stderr, "%s %s%s%s\n", conn->req.method, path, conn->req.query ? "?" : "", conn->req.query ? conn->req.query : "");
+	}
+	url_decode(path);
+	path_len = strlen(path);
+
+	if (path_len >= 7 && 0 == strcmp(path + path_len - 7, "/tokens") && 0 == strcmp(conn->req.method, "POST")) {
+		handle_tokens(server, conn);
+		return;
+	}
+	if (0 == strcmp(path, "/info")) {
+		handle_info(conn);
+		return;
+	}
+	if (0 != strncmp(path, "/v1/", 4) || '\0' == path[4]) {
+		respond_status(conn, 404, "Not Found");
+		return;
+	}
+	if (!token_valid(conn->req.auth_token)) {
+		respond_status(conn, 401, "Unauthorized");
+		return;
+	}
+
+	/* Split path into account, container and object, keeping account/container together */
+	account = path + 4;
+	p = strchr(account, '/');
+	if (p && p[1]) {
+		container = account;
+		p = strchr(p + 1, '/');
+		if (p && p[1]) {
+			*p = '\0';
+			object = p + 1;
+		} else if (p) {
+			*p = '\0'; /* Trailing slash */
+		}
+	} else if (p) {
+		*p = '\0'; /* Trailing slash */
+	}
+
+	if (object) {
+		handle_object(conn, container, object);
+	} else if (container) {
+		handle_container(conn, container);
+	} else if (0 == strcmp(conn->req.method, "POST") && has_query(conn, BULK_DELETE_QUERY)) {
+		handle_bulk_delete(conn, account);
+	} else {
+		handle_account(conn, account);
+	}
+}
+
+/**
+ * Parse the request head, which is NUL-terminated. Returns zero on success.
+ */
+static int
+parse_request_head(struct request *req, char *head)
+{
+	char *line, *next, *p;
+
+	memset(req, 0, sizeof(*req));
+	req->keep_alive = 1;
+
+	next = strstr(head, "\r\n");
+	if (NULL == next) {
+		return -1;
+	}
+	*next = '\0';
+	next += 2;
+
+	/* Request line */
+	req->method = head;
+	p = strchr(head, ' ');
+	if (NULL == p) {
+		return -1;
+	}
+	*p++ = '\0';
+	req->path = p;
+	p = strchr(p, ' ');
+	if (NULL == p) {
+		return -1;
+	}
+	*p++ = '\0';
+	if (0 == strcmp(p, "HTTP/1.0")) {
+		req->keep_alive = 0;
+	}
+	p = strchr(req->path, '?');
+	if (p) {
+		*p = '\0';
+		req->query = p + 1;
+	}
+
+	/* Headers */
+	for (line = next; line && *line; line = next) {
+		char *value;
+		next = strstr(line, "\r\n");
+		if (next) {
+			*next = '\0';
+			next += 2;
+		}
+		value = strchr(line, ':');
+		if (NULL == value) {
+			return -1;
+		}
+		*value++ = '\0';
+		while (' ' == *value || '\t' == *value) {
+			value++;
+		}
+		if (0 == strcasecmp(line, "Content-Length")) {
+			req->content_length = strtoull(value, NULL, 10);
+		} else if (0 == strcasecmp(line, "Transfer-Encoding")) {
+			req->chunked = (NULL != strcasestr(value, "chunked"));
+		} else if (0 == strcasecmp(line, "Connection")) {
+			if (0 == strcasecmp(value, "close")) {
+				req->keep_alive = 0;
+			} else if (0 == strcasecmp(value, "keep-alive")) {
+				req->keep_alive = 1;
+			}
+		} else if (0 == strcasecmp(line, "Expect")) {
+			req->expect_continue = (0 == strcasecmp(value, "100-continue"));
+		} else if (0 == strcasecmp(line, "X-Auth-Token")) {
+			req->auth_token = value;
+		} else if (0 == strcasecmp(line, "Host")) {
+			req->host = value;
+		} else if (0 == strcasecmp(line, "Range")) {
+			req->range = value;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Ensure the body being received can hold at least the given number of bytes. Returns zero on success.
+ */
+static int
+reserve_body(struct connection *conn, size_t size)
+{
+	struct object_data *new_body;
+	size_t new_cap;
+
+	if (conn->body && conn->body_cap >= size) {
+		return 0;
+	}
+	new_cap = conn->body_cap ? conn->body_cap : 4096;
+	while (new_cap < size) {
+		new_cap *= 2;
+	}
+	new_body = realloc(conn->body, sizeof(*new_body) + new_cap);
+	if (NULL == new_body) {
+		return -1;
+	}
+	if (NULL == conn->body) {
+		new_body->refcount = 1;
+		new_body->size = 0;
+	}
+	conn->body = new_body;
+	conn->body_cap = new_cap;
+	return 0;
+}
+
+/**
+ * Discard the given number of bytes from the front of the connection's input buffer.
+ */
+static void
+consume_input(struct connection *conn, size_t len)
+{
+	memmove(conn->in, conn->in + len, conn->in_len - len);
+	conn->in_len -= len;
+	conn->in[conn->in_len] = '\0';
+}
+
+/**
+ * Send a response immediately and unconditionally, ignoring partial writes. Used only for "100 Continue".
+ */
+static void
+send_interim(struct connection *conn, const char *text)
+{
+	ssize_t ret = write(conn->fd, text, strlen(text));
+	(void) ret;
+}
+
+/**
+ * Advance the connection's state machine as far as the buffered input allows.
+ * Returns zero if more input is needed, or one if a response is ready to send.
+ */
+static int
+process_input(const struct server_args *server, struct connection *conn)
+{
+	for (;;) {
+		switch (conn->state) {
+		case READ_HEAD:
+			{
+				char *end = strstr(conn->in, "\r\n\r\n");
+				size_t head_len;
+				if (NULL == end || (size_t) (end - conn->in) + 2 >= MAX_HEAD_SIZE) {
+					if (end || conn->in_len >= MAX_HEAD_SIZE) {
+						conn->req.keep_alive = 0;
+						respond_status(conn, 431, "Request Header Fields Too Large");
+						return 1;
+					}
+					return 0;
+				}
+				head_len = end - conn->in + 4;
+				memcpy(conn->head, conn->in, head_len - 2);
+				conn->head[head_len - 2] = '\0';
+				consume_input(conn, head_len);
+				if (parse_request_head(&conn->req, conn->head)) {
+					conn->req.keep_alive = 0;
+					respond_status(conn, 400, "Bad Request");
+					return 1;
+				}
+				if (conn->req.expect_continue) {
+					send_interim(conn, "HTTP/1.1 100 Continue\r\n\r\n");
+				}
+				if (conn->req.chunked) {
+					if (reserve_body(conn, 0)) {
+						conn->req.keep_alive = 0;
+						respond_status(conn, 500, "Internal Server Error");
+						return 1;
+					}
+					conn->state = READ_CHUNK_SIZE;
+				} else if (conn->req.content_length > MAX_BODY_SIZE) {
+					conn->req.keep_alive = 0;
+					respond_status(conn, 413, "Request Entity Too Large");
+					return 1;
+				} else if (conn->req.content_length) {
+					conn->body = object_data_alloc(conn->req.content_length);
+					if (NULL == conn->body) {
+						conn->req.keep_alive = 0;
+						respond_status(conn, 507, "Insufficient Storage");
+						return 1;
+					}
+					conn->body->size = 0;
+					conn->body_cap = conn->req.content_length;
+					conn->state = READ_BODY;
+				} else {
+					handle_request(server, conn);
+					return 1;
+				}
+			}
+			break;
+		case READ_BODY:
+			{
+				size_t len = conn->body_cap - conn->body->size;
+				if (len > conn->in_len) {
+					len = conn->in_len;
+				}
+				memcpy(conn->body->data + conn->body->size, conn->in, len);
+				conn->body->size += len;
+				consume_input(conn, len);
+				if (conn->body->size < conn->body_cap) {
+					return 0;
+				}
+				handle_request(server, conn);
+				return 1;
+			}
+		case READ_CHUNK_SIZE:
+			{
+				char *end = strstr(conn->in, "\r\n");
+				if (NULL == end) {
+					return 0;
+				}
+				conn->chunk_remaining = strtoull(conn->in, NULL, 16);
+				consume_input(conn, end - conn->in + 2);
+				if (0 == conn->chunk_remaining) {
+					conn->state = READ_TRAILER;
+				} else if (conn->body->size + conn->chunk_remaining > MAX_BODY_SIZE) {
+					conn->req.keep_alive = 0;
+					respond_status(conn, 413, "Request Entity Too Large");
+					return 1;
+				} else if (reserve_body(conn, conn->body->size + conn->chunk_remaining)) {
+					conn->req.keep_alive = 0;
+					respond_status(conn, 507, "Insufficient Storage");
+					return 1;
+				} else {
+					conn->state = READ_CHUNK_DATA;
+				}
+			}
+			break;
+		case READ_CHUNK_DATA:
+			{
+				size_t len = conn->chunk_remaining;
+				if (len > conn->in_len) {
+					len = conn->in_len;
+				}
+				memcpy(conn->body->data + conn->body->size, conn->in, len);
+				conn->body->size += len;
+				conn->chunk_remaining -= len;
+				consume_input(conn, len);
+				if (conn->chunk_remaining) {
+					return 0;
+				}
+				conn->state = READ_CHUNK_END;
+			}
+			break;
+		case READ_CHUNK_END:
+			if (conn->in_len < 2) {
+				return 0;
+			}
+			consume_input(conn, 2);
+			conn->state = READ_CHUNK_SIZE;
+			break;
+		case READ_TRAILER:
+			{
+				char *end = strstr(conn->in, "\r\n");
+				if (NULL == end) {
+					return 0;
+				}
+				consume_input(conn, end - conn->in + 2);
+				if (end == conn->in) {
+					/* Empty line ends the trailer */
+					handle_request(server, conn);
+					return 1;
+				}
+			}
+			break;
+		case WRITE_RESPONSE:
+			return 1;
+		}
+	}
+}
+
+/**
+ * Read directly into a body of known length, bypassing the input buffer.
+ * Returns the result of read().
+ */
+static ssize_t
+read_body_direct(struct connection *conn)
+{
+	ssize_t ret = read(conn->fd, conn->body->data + conn->body->size, conn->body_cap - conn->body->size);
+
+	if (ret > 0) {
+		conn->body->size += ret;
+	}
+	return ret;
+}
+
+static void
+close_connection(int epoll_fd, struct connection *conn)
+{
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+	close(conn->fd);
+	object_data_unref(conn->body);
+	object_data_unref(conn->out_body);
+	free(conn);
+}
+
+static void
+set_events(int epoll_fd, struct connection *conn, uint32_t events)
+{
+	struct epoll_event ev;
+
+	if (events == conn->events) {
+		return;
+	}
+	conn->events = events;
+	ev.events = events;
+	ev.data.ptr = conn;
+	epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+}
+
+/**
+ * Send as much as possible of the pending response.
+ * Returns 1 if the response has been sent in full, 0 if the socket is full, or -1 on error.
+ */
+static int
+write_response(struct connection *conn)
+{
+	for (;;) {
+		struct iovec iov[2];
+		int iovcnt = 0;
+		size_t body_len = conn->out_body ? conn->out_body_len : 0;
+		ssize_t ret;
+
+		if (conn->out_off >= conn->out_head_len + body_len) {
+			return 1;
+		}
+		if (conn->out_off < conn->out_head_len) {
+			iov[iovcnt].iov_base = conn->out_head + conn->out_off;
+			iov[iovcnt].iov_len = conn->out_head_len - conn->out_off;
+			iovcnt++;
+			if (body_len) {
+				iov[iovcnt].iov_base = conn->out_body->data + conn->out_body_start;
+				iov[iovcnt].iov_len = body_len;
+				iovcnt++;
+			}
+		} else {
+			iov[iovcnt].iov_base = conn->out_body->data + conn->out_body_start + (conn->out_off - conn->out_head_len);
+			iov[iovcnt].iov_len = conn->out_head_len + body_len - conn->out_off;
+			iovcnt++;
+		}
+		ret = writev(conn->fd, iov, iovcnt);
+		if (ret < 0) {
+			if (EAGAIN == errno || EWOULDBLOCK == errno) {
+				return 0;
+			}
+			if (EINTR == errno) {
+				continue;
+			}
+			return -1;
+		}
+		conn->out_off += ret;
+	}
+}
+
+/**
+ * Reset the connection ready for its next request.
+ */
+static void
+finish_response(struct connection *conn)
+{
+	object_data_unref(conn->body);
+	conn->body = NULL;
+	conn->body_cap = 0;
+	object_data_unref(conn->out_body);
+	conn->out_body = NULL;
+	conn->state = READ_HEAD;
+}
+
+/**
+ * Handle readiness of a connection. Returns non-zero if the connection should be closed.
+ */
+static int
+service_connection(const struct server_args *server, int epoll_fd, struct connection *conn, uint32_t events)
+{
+	if (events & (EPOLLERR | EPOLLHUP)) {
+		return 1;
+	}
+
+	if (WRITE_RESPONSE != conn->state && (events & EPOLLIN)) {
+		ssize_t ret;
+		if (READ_BODY == conn->state && 0 == conn->in_len) {
+			ret = read_body_direct(conn);
+		} else {
+			ret = read(conn->fd, conn->in + conn->in_len, INPUT_BUFFER_SIZE - conn->in_len);
+			if (ret > 0) {
+				conn->in_len += ret;
+				conn->in[conn->in_len] = '\0';
+			}
+		}
+		if (0 == ret) {
+			return 1; /* Peer closed */
+		}
+		if (ret < 0) {
+			return !(EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno);
+		}
+	}
+
+	/* Process and answer as many requests as are complete, including any pipelined ones */
+	for (;;) {
+		int ret;
+		if (WRITE_RESPONSE != conn->state && !process_input(server, conn)) {
+			set_events(epoll_fd, conn, EPOLLIN);
+			return 0;
+		}
+		ret = write_response(conn);
+		if (ret < 0) {
+			return 1;
+		}
+		if (0 == ret) {
+			set_events(epoll_fd, conn, EPOLLOUT);
+			return 0;
+		}
+		if (conn->close_after) {
+			return 1;
+		}
+		finish_response(conn);
+	}
+}
+
+static void
+accept_connections(int epoll_fd, int listen_fd)
+{
+	for (;;) {
+		struct epoll_event ev;
+		struct connection *conn;
+		int one = 1;
+		int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) {
+			if (EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno) {
+				perror("accept4");
+			}
+			return;
+		}
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		conn = typealloc(struct connection);
+		if (NULL == conn) {
+			close(fd);
+			continue;
+		}
+		memset(conn, 0, offsetof(struct connection, in));
+		conn->fd = fd;
+		conn->state = READ_HEAD;
+		conn->in_len = 0;
+		conn->in[0] = '\0';
+		conn->body = NULL;
+		conn->body_cap = 0;
+		conn->out_body = NULL;
+		conn->events = EPOLLIN;
+		ev.events = EPOLLIN;
+		ev.data.ptr = conn;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev)) {
+			perror("epoll_ctl");
+			close(fd);
+			free(conn);
+		}
+	}
+}
+
+static int
+open_listen_socket(const struct server_args *server)
+{
+	struct sockaddr_in addr;
+	int fd, one = 1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(server->port);
+	if (1 != inet_pton(AF_INET, server->address, &addr.sin_addr)) {
+		fprintf(stderr, "Invalid IPv4 address '%s'\n", server->address);
+		return -1;
+	}
+	fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		perror("socket");
+		return -1;
+	}
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) || setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one))) {
+		perror("setsockopt");
+		close(fd);
+		return -1;
+	}
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr))) {
+		perror("bind");
+		close(fd);
+		return -1;
+	}
+	if (listen(fd, SOMAXCONN)) {
+		perror("listen");
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * Executed by each worker thread.
+ */
+static void *
+worker_thread_func(void *arg)
+{
+	struct worker_args *args = (struct worker_args *) arg;
+	struct epoll_event ev, events[MAX_EVENTS];
+	int epoll_fd;
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0) {
+		perror("epoll_create1");
+		return NULL;
+	}
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL; /* Identifies the listening socket */
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, args->listen_fd, &ev)) {
+		perror("epoll_ctl");
+		close(epoll_fd);
+		return NULL;
+	}
+
+	for (;;) {
+		int i, n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+		if (n < 0) {
+			if (EINTR == errno) {
+				continue;
+			}
+			perror("epoll_wait");
+			break;
+		}
+		for (i = 0; i < n; i++) {
+			struct connection *conn = (struct connection *) events[i].data.ptr;
+			if (NULL == conn) {
+				accept_connections(epoll_fd, args->listen_fd);
+			} else if (service_connection(args->server, epoll_fd, conn, events[i].events)) {
+				close_connection(epoll_fd, conn);
+			}
+		}
+	}
+
+	close(epoll_fd);
+	return NULL;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct server_args server;
+	struct worker_args *workers;
+	unsigned int num_threads = NUM_THREADS_DEFAULT;
+	unsigned int i;
+	int ret;
+
+#define OPTSTRING "a:hl:n:p:V"
+#define USAGE "\
+Usage:\n\
+    %s --help\n\
+        Outputs this help text\n\
+or\n\
+    %s\n\
+        [ --address <ipv4-address> ] [ --num-threads <n> ]\n\
+        [ --port <port> ] [ --token-lifetime <seconds> ] [ --verbose ]\n\
+\n\
+Serves Keystone token requests (POST .../tokens) and the Swift account,\n\
+container and object API under /v1/, holding all objects in memory.\n\
+Point test-swift-client at http://<address>:<port>/v2.0 as its Keystone URL.\n\
+"
+	int option_index;
+	static struct option long_options[] = {
+		{"address",        required_argument, NULL, 'a'},
+		{"help",           no_argument,       NULL, 'h'},
+		{"token-lifetime", required_argument, NULL, 'l'},
+		{"num-threads",    required_argument, NULL, 'n'},
+		{"port",           required_argument, NULL, 'p'},
+		{"verbose",        no_argument,       NULL, 'V'},
+		{NULL,             0,                 NULL, 0}
+	};
+
+	server.address = ADDRESS_DEFAULT;
+	server.port = PORT_DEFAULT;
+	server.token_lifetime = TOKEN_LIFETIME_DEFAULT;
+	server.verbose = 0;
+
+	for (;;) {
+		ret = getopt_long(argc, argv, OPTSTRING, long_options, &option_index);
+		if (-1 == ret) {
+			break;
+		}
+		switch (ret) {
+		case 'a':
+			server.address = optarg;
+			break;
+		case 'h':
+			fprintf(stderr, USAGE, argv[0], argv[0]);
+			return EXIT_SUCCESS;
+		case 'l':
+			server.token_lifetime = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			num_threads = atoi(optarg);
+			break;
+		case 'p':
+			server.port = atoi(optarg);
+			break;
+		case 'V':
+			server.verbose = 1;
+			break;
+		case '?':
+		default:
+			fprintf(stderr, USAGE, argv[0], argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind < argc || 0 == num_threads) {
+		fprintf(stderr, USAGE, argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	workers = typearrayalloc(num_threads, struct worker_args);
+	if (NULL == workers) {
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < num_threads; i++) {
+		workers[i].thread_num = i + 1;
+		workers[i].server = &server;
+		workers[i].listen_fd = open_listen_socket(&server);
+		if (workers[i].listen_fd < 0) {
+			return EXIT_FAILURE;
+		}
+		ret = pthread_create(&workers[i].thread_id, NULL, worker_thread_func, &workers[i]);
+		if (ret != 0) {
+			errno = ret;
+			perror("pthread_create");
+			return EXIT_FAILURE;
+		}
+	}
+
+	fprintf(stderr, "Listening on %s:%u with %u threads\n", server.address, server.port, num_threads);
+
+	for (i = 0; i < num_threads; i++) {
+		ret = pthread_join(workers[i].thread_id, NULL);
+		if (ret != 0) {
+			errno = ret;
+			perror("pthread_join");
+			return EXIT_FAILURE;
+		}
+	}
+
+	free(workers);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,659 @@
+#include <stdio.h>   /* fopen, fread, fprintf */
+#include <stdlib.h>  /* malloc, calloc, free, strtod, strtoull */
+#include <string.h>  /* memset, strcmp, strchr, strcspn, strdup, strncmp, strtok_r, strspn */
+#include <math.h>    /* cos, exp, fmin, log, sqrt */
+#include <assert.h>  /* assert */
+
+#include "workload.h"
+#include "prng.h"
+
+/* Largest workload file read */
+#define WORKLOAD_FILE_MAX (64 * 1024)
+/* Standard deviations above the median of a log-normal distribution of sizes of its largest size, unless given */
+#define SIZES_LOGNORMAL_TAIL 4.0
+/* Largest object which Swift accepts by default, its max_file_size */
+#define SIZES_MAX_OBJECT 5368709122.0
+
+static const char *const op_names[SWIFT_OP_MAX + 1] = {
+	"put",
+	"get",
+	"head",
+	"delete",
+	"list",
+	"post"
+};
+
+/**
+ * Return the human-readable name of the given type of operation.
+ */
+const char *
+swift_op_name(enum swift_op_type op)
+{
+	assert(op <= SWIFT_OP_MAX);
+	return op_names[op];
+}
+
+/**
+ * Prepare to choose among n outcomes with the given relative weights, not all zero.
+ */
+static void
+alias_table_init(struct alias_table *t, const double *weights, unsigned int n)
+{
+	double scaled[ALIAS_TABLE_MAX], sum = 0;
+	unsigned int small[ALIAS_TABLE_MAX], large[ALIAS_TABLE_MAX];
+	unsigned int i, num_small = 0, num_large = 0;
+
+	assert(n > 0 && n <= ALIAS_TABLE_MAX);
+
+	t->n = n;
+	for (i = 0; i < n; i++) {
+		sum += weights[i];
+	}
+	assert(sum > 0);
+	for (i = 0; i < n; i++) {
+		scaled[i] = weights[i] * n / sum;
+		if (scaled[i] < 1.0) {
+			small[num_small++] = i;
+		} else {
+			large[num_large++] = i;
+		}
+	}
+	/* Fill each under-full column with the excess of an over-full one */
+	while (num_small && num_large) {
+		unsigned int s = small[--num_small], l = large[--num_large];
+		t->prob[s] = scaled[s];
+		t->alias[s] = l;
+		scaled[l] -= 1.0 - scaled[s];
+		if (scaled[l] < 1.0) {
+			small[num_small++] = l;
+		} else {
+			large[num_large++] = l;
+		}
+	}
+	/* Whatever remains is full, bar rounding error */
+	while (num_large) {
+		i = large[--num_large];
+		t->prob[i] = 1.0;
+		t->alias[i] = i;
+	}
+	while (num_small) {
+		i = small[--num_small];
+		t->prob[i] = 1.0;
+		t->alias[i] = i;
+	}
+}
+
+/**
+ * Choose an outcome: one pseudo-random number, one comparison.
+ */
+static unsigned int
+alias_table_choose(const struct alias_table *t, uint64_t *rng)
+{
+	double u = prng_double(rng) * t->n;
+	unsigned int column = (unsigned int) u;
+
+	return (u - column < t->prob[column]) ? column : t->alias[column];
+}
+
+/**
+ * Parse a size in bytes, optionally suffixed by k, m or g for binary multiples.
+ * Returns zero on success.
+ */
+static int
+parse_size(const char *text, size_t *size)
+{
+	char *end;
+	unsigned long long n = strtoull(text, &end, 0);
+
+	switch (*end) {
+	case 'k': case 'K':
+		n <<= 10;
+		end++;
+		break;
+	case 'm': case 'M':
+		n <<= 20;
+		end++;
+		break;
+	case 'g': case 'G':
+		n <<= 30;
+		end++;
+		break;
+	}
+	if (end == text || *end) {
+		return -1;
+	}
+	*size = (size_t) n;
+	return 0;
+}
+
+/**
+ * Read the whole of the given file into a newly-allocated NUL-terminated buffer, or return NULL.
+ */
+static char *
+read_workload_file(const char *path)
+{
+	FILE *f;
+	char *text;
+	size_t len;
+
+	f = fopen(path, "r");
+	if (NULL == f) {
+		perror(path);
+		return NULL;
+	}
+	text = (char *) malloc(WORKLOAD_FILE_MAX + 1);
+	if (NULL == text) {
+		fclose(f);
+		return NULL;
+	}
+	len = fread(text, 1, WORKLOAD_FILE_MAX + 1, f);
+	if (ferror(f) || len > WORKLOAD_FILE_MAX) {
+		fprintf(stderr, "Workload: %s: unreadable, or longer than %u bytes\n", path, WORKLOAD_FILE_MAX);
+		free(text);
+		fclose(f);
+		return NULL;
+	}
+	fclose(f);
+	text[len] = '\0';
+	return text;
+}
+
+/**
+ * Parse a comma-separated list of "<name>:<weight>" items of the "ops" clause.
+ * Returns zero on success.
+ */
+static int
+parse_ops(char *value, struct workload *wl)
+{
+	char *item, *save = NULL;
+	double sum = 0;
+
+	for (item = strtok_r(value, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+		char *colon = strchr(item, ':'), *end;
+		unsigned int op;
+		double weight;
+
+		if (NULL == colon) {
+			fprintf(stderr, "Workload: operation '%s' has no weight\n", item);
+			return -1;
+		}
+		*colon = '\0';
+		for (op = 0; op <= SWIFT_OP_MAX && strcmp(item, op_names[op]); op++)
+			;
+		if (op > SWIFT_OP_MAX) {
+			fprintf(stderr, "Workload: unrecognised operation '%s'. Choices are: put, get, head, delete, list, post\n", item);
+			return -1;
+		}
+		weight = strtod(colon + 1, &end);
+		if (end == colon + 1 || *end || !(weight >= 0)) {
+			fprintf(stderr, "Workload: invalid weight '%s' of operation '%s'\n", colon + 1, item);
+			return -1;
+		}
+		wl->op_weights[op] = weight;
+		sum += weight;
+	}
+	if (!(sum > 0)) {
+		fputs("Workload: operation weights must not all be zero\n", stderr);
+		return -1;
+	}
+	alias_table_init(&wl->ops, wl->op_weights, SWIFT_OP_MAX + 1);
+	return 0;
+}
+
+/**
+ * Parse a size, or a range of sizes "<min>-<max>", into the given bounds. Returns zero on success.
+ */
+static int
+parse_size_range(char *text, size_t *min, size_t *max)
+{
+	char *dash = strchr(text, '-');
+
+	if (dash) {
+		*dash = '\0';
+	}
+	if (parse_size(text, min) || (dash ? parse_size(dash + 1, max) : parse_size(text, max)) || *min > *max) {
+		if (dash) {
+			*dash = '-';
+		}
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Add a bin of the given sizes and weight "<size>[-<size>][<sep><weight>]", where sep is ':' or white space,
+ * to the given distribution. Returns zero on success.
+ */
+static int
+parse_size_bin(char *item, const char *sep, struct size_distribution *d)
+{
+	char *weight_text = item + strcspn(item, sep), *end;
+	double weight = 1;
+
+	if (ALIAS_TABLE_MAX == d->num_bins) {
+		fprintf(stderr, "Sizes: more than %u bins\n", ALIAS_TABLE_MAX);
+		return -1;
+	}
+	if (*weight_text) {
+		*weight_text++ = '\0';
+		weight_text += strspn(weight_text, sep);
+		weight = strtod(weight_text, &end);
+		end += strspn(end, sep);
+		if (end == weight_text || *end || !(weight >= 0)) {
+			fprintf(stderr, "Sizes: invalid weight '%s' of size '%s'\n", weight_text, item);
+			return -1;
+		}
+	}
+	if (parse_size_range(item, &d->bin_min[d->num_bins], &d->bin_max[d->num_bins])) {
+		fprintf(stderr, "Sizes: invalid object size '%s'\n", item);
+		return -1;
+	}
+	d->bin_weights[d->num_bins++] = weight;
+	return 0;
+}
+
+/**
+ * Complete a distribution of weighted bins, one of a single size becoming a fixed distribution.
+ * Returns zero on success.
+ */
+static int
+finish_size_bins(struct size_distribution *d)
+{
+	double sum = 0;
+	unsigned int i;
+
+	if (0 == d->num_bins) {
+		fputs("Sizes: no sizes given\n", stderr);
+		return -1;
+	}
+	d->min = d->bin_min[0];
+	d->max = d->bin_max[0];
+	for (i = 0; i < d->num_bins; i++) {
+		sum += d->bin_weights[i];
+		if (d->bin_min[i] < d->min) {
+			d->min = d->bin_min[i];
+		}
+		if (d->bin_max[i] > d->max) {
+			d->max = d->bin_max[i];
+		}
+	}
+	if (!(sum > 0)) {
+		fputs("Sizes: weights must not all be zero\n", stderr);
+		return -1;
+	}
+	d->type = (1 == d->num_bins && d->min == d->max) ? SIZES_FIXED : SIZES_BINS;
+	alias_table_init(&d->bins, d->bin_weights, d->num_bins);
+	return 0;
+}
+
+/**
+ * Parse a histogram file of sizes: a bin "<size>[-<size>] [<weight>]" per line, ignoring blank lines and
+ * anything after '#', as exported from the object sizes of a real cluster. Returns zero on success.
+ */
+static int
+parse_size_histogram(const char *path, struct size_distribution *d)
+{
+	char *text = read_workload_file(path), *line, *save = NULL;
+	int ret = 0;
+
+	if (NULL == text) {
+		return -1;
+	}
+	for (line = strtok_r(text, "\n", &save); line && 0 == ret; line = strtok_r(NULL, "\n", &save)) {
+		line[strcspn(line, "#")] = '\0';
+		line += strspn(line, " \t\r");
+		if (*line) {
+			ret = parse_size_bin(line, " \t\r", d);
+		}
+	}
+	free(text);
+	return ret ? ret : finish_size_bins(d);
+}
+
+/**
+ * Parse a distribution of sizes in the given modifiable text, of one of the forms:
+ * "<size>[-<size>][:<weight>],...", weighted bins, or a fixed size if only one is given;
+ * "uniform:<min>,<max>"; "lognormal:<median>,<sigma>[,<max>]"; "histogram:<file-name>".
+ * Returns zero on success, having reported any error.
+ */
+static int
+parse_size_text(char *text, struct size_distribution *d)
+{
+	char *item, *save = NULL, *end;
+	size_t median;
+
+	memset(d, 0, sizeof(*d));
+	if (0 == strncmp(text, "uniform:", 8)) {
+		item = strchr(text + 8, ',');
+		if (item) {
+			*item++ = '\0';
+		}
+		if (NULL == item || parse_size(text + 8, &d->min) || parse_size(item, &d->max) || d->min > d->max) {
+			fputs("Sizes: a uniform distribution must be uniform:<min>,<max>\n", stderr);
+			return -1;
+		}
+		d->type = SIZES_UNIFORM;
+		return 0;
+	} else if (0 == strncmp(text, "lognormal:", 10)) {
+		item = strtok_r(text + 10, ",", &save);
+		if (NULL == item || parse_size(item, &median) || 0 == median || NULL == (item = strtok_r(NULL, ",", &save))) {
+			fputs("Sizes: a log-normal distribution must be lognormal:<median>,<sigma>[,<max>]\n", stderr);
+			return -1;
+		}
+		d->sigma = strtod(item, &end);
+		if (end == item || *end || !(d->sigma >= 0)) {
+			fprintf(stderr, "Sizes: invalid sigma '%s' of log-normal distribution\n", item);
+			return -1;
+		}
+		d->mu = log((double) median);
+		/* Unless given, the largest size is that many standard deviations above the median, as far as Swift allows */
+		d->max = (size_t) fmin(exp(d->mu + SIZES_LOGNORMAL_TAIL * d->sigma), SIZES_MAX_OBJECT);
+		item = strtok_r(NULL, ",", &save);
+		if (item && (parse_size(item, &d->max) || d->max < median || strtok_r(NULL, ",", &save))) {
+			fprintf(stderr, "Sizes: invalid largest size '%s' of log-normal distribution\n", item);
+			return -1;
+		}
+		d->type = SIZES_LOGNORMAL;
+		return 0;
+	} else if (0 == strncmp(text, "histogram:", 10)) {
+		return parse_size_histogram(text + 10, d);
+	}
+	for (item = strtok_r(text, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+		if (parse_size_bin(item, ":", d)) {
+			return -1;
+		}
+	}
+	return finish_size_bins(d);
+}
+
+/**
+ * Parse a distribution of object sizes, as parse_size_text.
+ * For example: "4k:80,64k-1m:15,100m:5", "lognormal:64k,1.5,1g" or "histogram:sizes.txt".
+ * Returns zero on success, having reported any error.
+ */
+int
+parse_size_distribution(const char *spec, struct size_distribution *d)
+{
+	char *text = strdup(spec);
+	int ret;
+
+	if (NULL == text) {
+		return -1;
+	}
+	ret = parse_size_text(text, d);
+	free(text);
+	return ret;
+}
+
+/**
+ * Draw a size from the given distribution.
+ */
+size_t
+size_distribution_draw(const struct size_distribution *d, uint64_t *rng)
+{
+	unsigned int bin;
+	double u, size;
+
+	switch (d->type) {
+	case SIZES_FIXED:
+		break;
+	case SIZES_UNIFORM:
+		return d->min + prng_below(rng, d->max - d->min + 1);
+	case SIZES_LOGNORMAL:
+		/* Box-Muller: a standard normal deviate from two uniform ones, the first in (0, 1] */
+		u = 1.0 - prng_double(rng);
+		size = exp(d->mu + d->sigma * sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * prng_double(rng)));
+		return (size < (double) d->max) ? (size_t) (size + 0.5) : d->max;
+	case SIZES_BINS:
+		bin = alias_table_choose(&d->bins, rng);
+		return d->bin_min[bin] + ((d->bin_max[bin] > d->bin_min[bin]) ? prng_below(rng, d->bin_max[bin] - d->bin_min[bin] + 1) : 0);
+	}
+	return d->min;
+}
+
+/**
+ * Return whether the given distribution could draw the given size.
+ */
+int
+size_distribution_allows(const struct size_distribution *d, size_t size)
+{
+	unsigned int i;
+
+	if (SIZES_BINS != d->type) {
+		return d->min <= size && size <= d->max;
+	}
+	for (i = 0; i < d->num_bins; i++) {
+		if (d->bin_min[i] <= size && size <= d->bin_max[i]) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Parse workload clauses, separated by semicolons or newlines, in the given modifiable text.
+ * Returns zero on success.
+ */
+static int
+parse_workload_text(char *text, struct workload *wl)
+{
+	char *clause, *save = NULL, *p;
+	unsigned int has_ops = 0;
+
+	/* Strip comments */
+	for (p = text; *p; p++) {
+		if ('#' == *p) {
+			while (*p && '\n' != *p) {
+				*p++ = ' ';
+			}
+			if (!*p) {
+				break;
+			}
+		}
+	}
+
+	for (clause = strtok_r(text, ";\n", &save); clause; clause = strtok_r(NULL, ";\n", &save)) {
+		char *eq, *value;
+		int ret;
+
+		/* Strip all white space: none is meaningful */
+		for (p = value = clause; *p; p++) {
+			if (' ' != *p && '\t' != *p && '\r' != *p) {
+				*value++ = *p;
+			}
+		}
+		*value = '\0';
+		if ('\0' == *clause) {
+			continue;
+		}
+
+		eq = strchr(clause, '=');
+		if (NULL == eq) {
+			fprintf(stderr, "Workload: clause '%s' is not of the form <name>=<value>\n", clause);
+			return -1;
+		}
+		*eq = '\0';
+		value = eq + 1;
+		if (0 == strcmp(clause, "ops")) {
+			ret = parse_ops(value, wl);
+			has_ops = 1;
+		} else if (0 == strcmp(clause, "sizes")) {
+			ret = parse_size_text(value, &wl->sizes);
+			wl->has_sizes = 1;
+		} else if (0 == strcmp(clause, "list")) {
+			ret = parse_listing_spec(value, &wl->listing);
+		} else if (0 == strcmp(clause, "keys")) {
+			ret = parse_key_distribution(value, &wl->keys);
+			if (ret) {
+				fprintf(stderr, "Workload: unrecognised key distribution '%s'\n", value);
+			}
+			wl->has_keys = 1;
+		} else {
+			fprintf(stderr, "Workload: unrecognised clause '%s'. Choices are: ops, sizes, keys, list\n", clause);
+			ret = -1;
+		}
+		if (ret) {
+			return ret;
+		}
+	}
+
+	if (!has_ops) {
+		fputs("Workload: no ops clause\n", stderr);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Parse a workload, given either inline or, if prefixed by '@', as the name of a file containing it.
+ * For example: "ops=get:70,put:20,head:5,list:4,delete:1; sizes=4k:80,1m:20; keys=zipf:0.99; list=limit:1000,pages:1"
+ * Returns zero on success, having reported any error.
+ */
+int
+parse_workload(const char *spec, struct workload *wl)
+{
+	char *text;
+	int ret;
+
+	memset(wl, 0, sizeof(*wl));
+	wl->listing.limit = LISTING_LIMIT_DEFAULT;
+	text = ('@' == spec[0]) ? read_workload_file(spec + 1) : strdup(spec);
+	if (NULL == text) {
+		return -1;
+	}
+	ret = parse_workload_text(text, wl);
+	free(text);
+	return ret;
+}
+
+/**
+ * Return the size of the largest object which the workload puts, given the size used if it specifies none.
+ */
+size_t
+workload_max_size(const struct workload *wl, size_t default_size)
+{
+	return wl->has_sizes ? wl->sizes.max : default_size;
+}
+
+/**
+ * Prepare a thread's state of the given workload, or NULL if only sizes vary, with every object absent,
+ * each put drawing its object's size from the given distribution, or NULL for default_size.
+ * Returns zero on success.
+ */
+int
+workload_state_init(struct workload_state *ws, const struct workload *wl, const struct size_distribution *sizes, size_t default_size, unsigned long num_objects, uint64_t seed)
+{
+	ws->workload = wl;
+	ws->sizes = sizes;
+	ws->default_size = default_size;
+	/* A different sequence from that of the thread's key chooser */
+	ws->rng = prng_seed(~seed);
+	ws->object_sizes = (size_t *) calloc(num_objects, sizeof(*ws->object_sizes));
+	return (NULL == ws->object_sizes) ? -1 : 0;
+}
+
+void
+workload_state_free(struct workload_state *ws)
+{
+	free(ws->object_sizes);
+	ws->object_sizes = NULL;
+}
+
+/**
+ * Choose the size of the given object, which is about to be put, and remember it.
+ */
+static size_t
+choose_size(struct workload_state *ws, unsigned long key)
+{
+	size_t size = ws->sizes ? size_distribution_draw(ws->sizes, &ws->rng) : ws->default_size;
+
+	ws->object_sizes[key] = size + 1;
+	return size;
+}
+
+/**
+ * Return the size of the given object, which is about to be put during prefill or a phase of puts.
+ */
+size_t
+workload_prefill(struct workload_state *ws, unsigned long key)
+{
+	return choose_size(ws, key);
+}
+
+/**
+ * Return the size chosen for the given object when it was last put, which must be present.
+ */
+size_t
+workload_object_size(const struct workload_state *ws, unsigned long key)
+{
+	return ws->object_sizes[key] - 1;
+}
+
+/**
+ * Note that the given object exists already with the given size, one which the distribution of sizes could draw.
+ * Returns zero on success, or else -1 if it could not.
+ */
+int
+workload_object_restore(struct workload_state *ws, unsigned long key, size_t size)
+{
+	if (ws->sizes ? !size_distribution_allows(ws->sizes, size) : size != ws->default_size) {
+		return -1;
+	}
+	ws->object_sizes[key] = size + 1;
+	return 0;
+}
+
+/**
+ * Return whether the given object has been put and not since deleted.
+ */
+int
+workload_object_present(const struct workload_state *ws, unsigned long key)
+{
+	return 0 != ws->object_sizes[key];
+}
+
+/**
+ * Note that the given object is now known to be absent.
+ */
+void
+workload_object_absent(struct workload_state *ws, unsigned long key)
+{
+	ws->object_sizes[key] = 0;
+}
+
+/**
+ * Draw the next operation of the mixed phase, upon the given object.
+ * An operation which requires an object, upon an object deleted earlier, becomes a put of that object,
+ * so that operations succeed and the set of objects does not dwindle.
+ */
+void
+workload_next(struct workload_state *ws, unsigned long key, struct workload_op *op)
+{
+	op->op = (enum swift_op_type) alias_table_choose(&ws->workload->ops, &ws->rng);
+	op->key = key;
+	op->size = 0;
+	op->account = 0;
+
+	switch (op->op) {
+	case SWIFT_OP_LIST:
+		/* Lists the object's container, or the account */
+		op->account = (ws->workload->listing.account > 0 && prng_double(&ws->rng) < ws->workload->listing.account);
+		return;
+	case SWIFT_OP_PUT:
+		break;
+	case SWIFT_OP_GET:
+	case SWIFT_OP_HEAD:
+	case SWIFT_OP_DELETE:
+	case SWIFT_OP_POST:
+		if (0 == ws->object_sizes[op->key]) {
+			op->op = SWIFT_OP_PUT;
+			break;
+		}
+		op->size = ws->object_sizes[op->key] - 1;
+		if (SWIFT_OP_DELETE == op->op) {
+			ws->object_sizes[op->key] = 0;
+		}
+		return;
+	}
+	op->size = choose_size(ws, op->key);
+}
@@ -0,0 +1,104 @@
+#ifndef WORKLOAD_H_
+#define WORKLOAD_H_
+
+#include <stddef.h>  /* size_t */
+#include <stdint.h>  /* uint64_t */
+
+#include "keyspace.h"
+#include "listing.h"
+
+/*
+ * Mixed workload: a blend of operation types, of object sizes and a key distribution,
+ * from which each operation of a Swift thread's mixed phase is drawn.
+ */
+
+/* Types of operation timed individually by a Swift thread */
+enum swift_op_type {
+	SWIFT_OP_PUT,    /* Object put */
+	SWIFT_OP_GET,    /* Object get */
+	SWIFT_OP_HEAD,   /* Object head */
+	SWIFT_OP_DELETE, /* Object delete */
+	SWIFT_OP_LIST,   /* Container listing */
+	SWIFT_OP_POST,   /* Object metadata update */
+	SWIFT_OP_MAX = SWIFT_OP_POST
+};
+
+/* Greatest number of outcomes of a weighted choice, and so of bins of a distribution of object sizes */
+#define ALIAS_TABLE_MAX 256
+
+/* Weighted choice among a small number of outcomes in constant time, by Vose's alias method */
+struct alias_table {
+	unsigned int n;                         /* Number of outcomes */
+	double prob[ALIAS_TABLE_MAX];           /* Probability of keeping each column's own outcome */
+	unsigned int alias[ALIAS_TABLE_MAX];    /* Outcome chosen instead if a column's own is not kept */
+};
+
+/* Distributions from which the size of each object put may be drawn */
+enum size_distribution_type {
+	SIZES_FIXED,     /* Every object of one size */
+	SIZES_UNIFORM,   /* Every size within a range equally likely */
+	SIZES_LOGNORMAL, /* Sizes whose logarithms are normally distributed, up to a largest */
+	SIZES_BINS       /* Weighted bins, each of one size or of every size within a range equally likely */
+};
+
+/* Distribution of object sizes, shared read-only by all Swift threads */
+struct size_distribution {
+	enum size_distribution_type type;       /* Distribution */
+	size_t min;                             /* Smallest size drawn */
+	size_t max;                             /* Largest size drawn */
+	double mu;                              /* Mean of the logarithm of a log-normal size: that of its median */
+	double sigma;                           /* Standard deviation of the logarithm of a log-normal size */
+	unsigned int num_bins;                  /* Number of bins */
+	size_t bin_min[ALIAS_TABLE_MAX];        /* Smallest size of each bin */
+	size_t bin_max[ALIAS_TABLE_MAX];        /* Largest size of each bin */
+	double bin_weights[ALIAS_TABLE_MAX];    /* Relative frequency of each bin */
+	struct alias_table bins;                /* Choice of bin */
+};
+
+/* Workload specification, shared read-only by all Swift threads */
+struct workload {
+	double op_weights[SWIFT_OP_MAX + 1];    /* Relative frequency of each type of operation */
+	struct alias_table ops;                 /* Choice of type of operation */
+	unsigned int has_sizes;                 /* Whether sizes overrides the thread's object sizes */
+	struct size_distribution sizes;         /* Distribution from which each put draws its object's size */
+	unsigned int has_keys;                  /* Whether keys overrides the key distribution given otherwise */
+	struct key_distribution_spec keys;      /* Distribution from which each operation chooses its object */
+	struct listing_spec listing;            /* Parameters of each listing */
+};
+
+/* One operation drawn from a workload */
+struct workload_op {
+	enum swift_op_type op;                  /* Type of operation */
+	unsigned long key;                      /* Object addressed */
+	size_t size;                            /* Size of the object put, or expected to be got */
+	unsigned int account;                   /* Whether a listing lists the account, not the object's container */
+};
+
+/*
+ * Per-thread state of a mixed workload, or of the objects of a thread whose puts draw their sizes from
+ * a distribution: which objects exist, and their sizes.
+ */
+struct workload_state {
+	const struct workload *workload;        /* Workload specification, or NULL if only sizes vary */
+	const struct size_distribution *sizes;  /* Distribution of object sizes, or NULL if all are of default_size */
+	size_t default_size;                    /* Size of every object if there is no distribution of sizes */
+	uint64_t rng;                           /* Pseudo-random generator state */
+	size_t *object_sizes;                   /* Per object, zero if absent or else one more than its size */
+};
+
+const char *swift_op_name(enum swift_op_type op);
+int parse_size_distribution(const char *spec, struct size_distribution *d);
+size_t size_distribution_draw(const struct size_distribution *d, uint64_t *rng);
+int size_distribution_allows(const struct size_distribution *d, size_t size);
+int parse_workload(const char *spec, struct workload *wl);
+size_t workload_max_size(const struct workload *wl, size_t default_size);
+int workload_state_init(struct workload_state *ws, const struct workload *wl, const struct size_distribution *sizes, size_t default_size, unsigned long num_objects, uint64_t seed);
+void workload_state_free(struct workload_state *ws);
+size_t workload_prefill(struct workload_state *ws, unsigned long key);
+size_t workload_object_size(const struct workload_state *ws, unsigned long key);
+int workload_object_restore(struct workload_state *ws, unsigned long key, size_t size);
+int workload_object_present(const struct workload_state *ws, unsigned long key);
+void workload_object_absent(struct workload_state *ws, unsigned long key);
+void workload_next(struct workload_state *ws, unsigned long key, struct workload_op *op);
+
+#endif /* WORKLOAD_H_ */